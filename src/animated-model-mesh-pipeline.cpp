@@ -34,6 +34,8 @@ bool AnimatedModelMeshPipeline::initPipeline(const PipelineConfig & config)
         this->indirectBufferIndex = this->config.indirectBufferIndex;
     }
 
+    this->gpuAnimation = this->config.useGpuAnimation && this->renderer->usesGpuCulling();
+
     this->pushConstantRange = VkPushConstantRange {};
 
     if (!this->renderer->usesGpuCulling()) {
@@ -73,23 +75,43 @@ bool AnimatedModelMeshPipeline::initPipeline(const PipelineConfig & config)
 }
 
 template<>
-bool AnimatedModelMeshPipeline::addObjectsToBeRendered(const std::vector<AnimatedModelMeshRenderable *> & additionalObjectsToBeRendered, const bool useAltGraphicsQueue) {
+bool AnimatedModelMeshPipeline::addVertexJointInfo(const VkDeviceSize firstVertex, const std::vector<VertexJointInfo> & additionalVertexJointInfo) {
+    if (!this->vertexJointBuffer.isInitialized() || additionalVertexJointInfo.empty()) return false;
+
+    // indexed like the vertex buffer (gl_VertexIndex)
+    const VkDeviceSize vertexJointOffset = firstVertex * sizeof(VertexJointInfo);
+    const VkDeviceSize additionalVertexJointSize = additionalVertexJointInfo.size() * sizeof(VertexJointInfo);
+    if (vertexJointOffset + additionalVertexJointSize > this->vertexJointBuffer.getSize()) {
+        logError("Pipeline '" + this->name + "': vertex joint buffer size too small");
+        return false;
+    }
+
+    memcpy(static_cast<char *>(this->vertexJointBuffer.getBufferData()) + vertexJointOffset, additionalVertexJointInfo.data(), additionalVertexJointSize);
+    this->vertexJointBuffer.updateContentSize(std::max(this->vertexJointBuffer.getContentSize(), vertexJointOffset + additionalVertexJointSize));
+
+    return true;
+}
+
+template<>
+bool AnimatedModelMeshPipeline::addObjectsToBeRendered(const std::vector<AnimatedModelMeshRenderable *> & additionalObjectsToBeRendered) {
     if (!this->vertexBuffer.isInitialized() || additionalObjectsToBeRendered.empty()) return false;
 
     const std::lock_guard<std::mutex> lock(this->additionMutex);
 
-    std::vector<ModelVertex> additionalVertices;
+    // objects not fitting (or not waiting for the buffers to grow) are dropped further down
+    if (this->deferUntilGrown(additionalObjectsToBeRendered, sizeof(ModelMeshData))) return true;
+
+    std::vector<PackedModelVertex> additionalVertices;
     std::vector<uint32_t> additionalIndices;
+    std::vector<VertexJointInfo> additionalVertexJointInfo;
 
     VkDeviceSize vertexBufferContentSize =  this->vertexBuffer.getContentSize();
     VkDeviceSize indexBufferContentSize =  this->indexBuffer.getContentSize();
     const VkDeviceSize meshDataBufferContentSize = this->ssboMeshBuffer.getContentSize();
-    VkDeviceSize animationMatrixBufferContentSize = this->animationMatrixBuffer.getContentSize();
 
     const VkDeviceSize vertexBufferSize = this->vertexBuffer.getSize();
     const VkDeviceSize indexBufferSize = this->indexBuffer.getSize();
     const VkDeviceSize meshDataBufferSize = this->ssboMeshBuffer.getSize();
-    const VkDeviceSize animationMatrixBufferSize = this->animationMatrixBuffer.getSize();
 
     const VkDeviceSize meshDataSize = sizeof(ModelMeshData);
     std::vector<ModelMeshData> meshDatas;
@@ -97,7 +119,6 @@ bool AnimatedModelMeshPipeline::addObjectsToBeRendered(const std::vector<Animate
     VkDeviceSize vertexBufferAdditionalContentSize =  0;
     VkDeviceSize indexBufferAdditionalContentSize =  0;
     VkDeviceSize meshDataBufferAdditionalContentSize =  0;
-    VkDeviceSize animationMatrixBufferAdditionalContentSize =  0;
 
     // collect new vertices and indices
     uint32_t additionalObjectsAdded = 0;
@@ -106,10 +127,16 @@ bool AnimatedModelMeshPipeline::addObjectsToBeRendered(const std::vector<Animate
             logInfo("Warning: Object to be rendered has not been registered with the GlobalRenderableStore!");
         }
 
+        const MeshBufferOffsets offsets = {
+            (vertexBufferContentSize + vertexBufferAdditionalContentSize) / sizeof(PackedModelVertex),
+            (indexBufferContentSize + indexBufferAdditionalContentSize) / sizeof(uint32_t),
+            static_cast<uint32_t>((meshDataBufferContentSize + meshDataBufferAdditionalContentSize) / meshDataSize)
+        };
+
         bool bufferTooSmall = false;
         for (const auto & mesh : o->getMeshes()) {
-            vertexBufferAdditionalContentSize += sizeof(ModelVertex) * mesh.vertices.size();
-            indexBufferAdditionalContentSize += sizeof(uint32_t) * mesh.indices.size();
+            vertexBufferAdditionalContentSize += sizeof(PackedModelVertex) * mesh.vertices.size();
+            indexBufferAdditionalContentSize += sizeof(uint32_t) * getIndexCountWithLods(mesh);
             meshDataBufferAdditionalContentSize += meshDataSize;
 
             // only continue if we fit into the pre-allocated size
@@ -126,35 +153,56 @@ bool AnimatedModelMeshPipeline::addObjectsToBeRendered(const std::vector<Animate
                 meshDatas.emplace_back(meshData);
             }
 
-            additionalVertices.insert(additionalVertices.end(), mesh.vertices.begin(), mesh.vertices.end());
-            additionalIndices.insert(additionalIndices.end(), mesh.indices.begin(), mesh.indices.end());
+            for (const auto & v : mesh.vertices) additionalVertices.emplace_back(packVertex(v));
+            appendIndicesWithLods(mesh, additionalIndices);
         }
 
         if (bufferTooSmall) break;
 
+        /**
+         * every instance gets its own joint palette in the animation matrix buffer,
+         * the joint indices per vertex are rebased onto it once and never change thereafter
+         */
+        o->calculateJointMatrices();
+
+        const uint32_t nrOfJoints = o->getJointMatrices().size();
+        VkDeviceSize jointPaletteOffset = 0;
+        if (nrOfJoints > 0) {
+            if (!this->animationMatrixBuffer.allocate(nrOfJoints * sizeof(glm::mat4), jointPaletteOffset)) {
+                logError("Pipeline '" + this->name + "': animation matrix buffer size too small. Added " + std::to_string(additionalObjectsAdded) + " of " + std::to_string(additionalObjectsToBeRendered.size()));
+                break;
+            }
+            this->animationMatrixBuffer.write(jointPaletteOffset, o->getJointMatrices().data(), nrOfJoints * sizeof(glm::mat4));
+        }
+        const uint32_t jointPaletteBase = jointPaletteOffset / sizeof(glm::mat4);
+
+        const auto & vertexJointInfo = o->getVertexJointInfo();
+        const size_t nrOfVertices = additionalVertices.size() - additionalVertexJointInfo.size();
+        for (size_t i=0;i<nrOfVertices;i++) {
+            VertexJointInfo jointInfo = i < vertexJointInfo.size() ? vertexJointInfo[i] : VertexJointInfo {};
+            for (uint32_t j=0;j<4;j++) {
+                if (jointInfo.vertexIds[j] >= nrOfJoints) jointInfo.weights[j] = 0.0f;
+                jointInfo.vertexIds[j] += jointPaletteBase;
+            }
+            additionalVertexJointInfo.emplace_back(jointInfo);
+        }
+
         // do this in batches
         if (vertexBufferAdditionalContentSize > 250 * MEGA_BYTE) {
-            if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices, useAltGraphicsQueue)) break;
+            if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices)) break;
+            this->addVertexJointInfo(vertexBufferContentSize / sizeof(PackedModelVertex), additionalVertexJointInfo);
 
             vertexBufferContentSize = this->vertexBuffer.getContentSize();
-            indexBufferContentSize = this->vertexBuffer.getContentSize();
+            indexBufferContentSize = this->indexBuffer.getContentSize();
             vertexBufferAdditionalContentSize = 0;
             indexBufferAdditionalContentSize = 0;
 
             additionalVertices.clear();
             additionalIndices.clear();
+            additionalVertexJointInfo.clear();
         }
 
-        o->calculateAnimationMatrices();
-
-        const auto & animationMatrices = o->getAnimationMatrices();
-        animationMatrixBufferAdditionalContentSize = animationMatrices.size() * sizeof(glm::mat4);
-        if (animationMatrixBufferContentSize+animationMatrixBufferAdditionalContentSize <= animationMatrixBufferSize) {
-            memcpy(static_cast<char *>(this->animationMatrixBuffer.getBufferData())+ animationMatrixBufferContentSize, animationMatrices.data(), animationMatrixBufferAdditionalContentSize);
-            animationMatrixBufferContentSize += animationMatrixBufferAdditionalContentSize;
-            this->animationMatrixBuffer.updateContentSize(animationMatrixBufferContentSize);
-        }
-
+        this->meshBufferOffsets[o] = offsets;
         additionalObjectsAdded++;
     }
 
@@ -167,7 +215,8 @@ bool AnimatedModelMeshPipeline::addObjectsToBeRendered(const std::vector<Animate
     }
 
     // delegate filling up vertex and index buffeers to break up code
-    if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices, useAltGraphicsQueue)) return false;
+    if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices)) return false;
+    this->addVertexJointInfo(vertexBufferContentSize / sizeof(PackedModelVertex), additionalVertexJointInfo);
 
     /**
      * Populate per instance and mesh data buffers
@@ -195,20 +244,29 @@ bool AnimatedModelMeshPipeline::addObjectsToBeRendered(const std::vector<Animate
         additionalObjectsAdded = c;
 
         const VkDeviceSize totalIntanceDataSize = instanceDataSize * meshInstanceData.size();
-        memcpy(static_cast<char *>(this->ssboInstanceBuffer.getBufferData()) + instanceDataOffset, meshInstanceData.data(), totalIntanceDataSize);
-
-        this->ssboInstanceBuffer.updateContentSize(instanceDataOffset + totalIntanceDataSize);
+        if (!this->ssboInstanceBuffer.allocate(totalIntanceDataSize, instanceDataOffset)) {
+            logError("Pipeline '" + this->name + "': instance data buffer size too small");
+            return false;
+        }
+        this->ssboInstanceBuffer.write(instanceDataOffset, meshInstanceData.data(), totalIntanceDataSize);
     }
 
     // finally add object references to be used for draw loop and object updates
-    this->objectsToBeRendered.insert(
-        this->objectsToBeRendered.end(), additionalObjectsToBeRendered.begin(),
-        additionalObjectsToBeRendered.begin() + additionalObjectsAdded
-    );
+    this->appendObjectsToBeRendered(additionalObjectsToBeRendered, additionalObjectsAdded);
 
     return true;
 }
 
+template<>
+bool AnimatedModelMeshPipeline::removeObjectsToBeRendered(const std::vector<AnimatedModelMeshRenderable *> & objectsToBeRemoved) {
+    if (objectsToBeRemoved.empty()) return true;
+
+    // the joint palettes of the animation pipeline are laid out in instance order
+    logError("Pipeline '" + this->name + "': animated models cannot be removed individually, clear the pipeline instead");
+
+    return false;
+}
+
 template<>
 void AnimatedModelMeshPipeline::draw(const VkCommandBuffer& commandBuffer, const uint16_t commandBufferIndex)
 {
@@ -238,8 +296,8 @@ void AnimatedModelMeshPipeline::draw(const VkCommandBuffer& commandBuffer, const
 
         uint32_t maxSize = this->renderer->getMaxIndirectCallCount(this->indirectBufferIndex);
 
-        const VkBuffer & buffer = this->renderer->getIndirectDrawBuffer(this->indirectBufferIndex).getBuffer();
-        const VkBuffer & countBuffer = this->renderer->getIndirectDrawCountBuffer(this->indirectBufferIndex).getBuffer();
+        const VkBuffer & buffer = this->renderer->getIndirectDrawBuffer(this->indirectBufferIndex, commandBufferIndex).getBuffer();
+        const VkBuffer & countBuffer = this->renderer->getIndirectDrawCountBuffer(this->indirectBufferIndex, commandBufferIndex).getBuffer();
 
         vkCmdDrawIndexedIndirectCount(commandBuffer, buffer,0, countBuffer, 0, maxSize, indirectDrawBufferSize);
 
@@ -248,10 +306,9 @@ void AnimatedModelMeshPipeline::draw(const VkCommandBuffer& commandBuffer, const
 
     // direct drawing from here on only
 
-    VkDeviceSize vertexOffset = 0;
-    VkDeviceSize indexOffset = 0;
-
     for (const auto & o : this->objectsToBeRendered) {
+        MeshBufferOffsets offsets = this->getMeshBufferOffsets(o);
+
         for (const auto & m : o->getMeshes()) {
             const VkDeviceSize vertexCount = m.vertices.size();
             const VkDeviceSize indexCount = m.indices.size();
@@ -265,32 +322,42 @@ void AnimatedModelMeshPipeline::draw(const VkCommandBuffer& commandBuffer, const
                 };
 
                 vkCmdPushConstants(commandBuffer, this->layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants) , &pushConstants);
-                vkCmdDrawIndexed(commandBuffer, indexCount, 1, indexOffset, vertexOffset, 0);
+                vkCmdDrawIndexed(commandBuffer, indexCount, 1, offsets.indexOffset, offsets.vertexOffset, 0);
             }
 
-            vertexOffset += vertexCount;
-            indexOffset += indexCount;
+            offsets.vertexOffset += vertexCount;
+            offsets.indexOffset += getIndexCountWithLods(m);
         }
     }
 }
 
+/**
+ *  Palettes are evaluated in parallel before recording, every renderable writes into a range of
+ *  the animation (and instance) buffer assigned to it upfront. The palette sizes are known after adding
+ */
 template<>
 void AnimatedModelMeshPipeline::update() {
-    uint32_t i=0,j=0;
-    VkDeviceSize instanceDataSize = sizeof(ColorMeshInstanceData);
-    VkDeviceSize animationMatrixDataSize = sizeof(glm::mat4);
+    const size_t nrOfObjects = this->objectsToBeRendered.size();
+    const VkDeviceSize instanceDataSize = sizeof(ColorMeshInstanceData);
+    const VkDeviceSize animationMatrixDataSize = sizeof(glm::mat4);
+
+    std::vector<uint32_t> paletteOffsets(nrOfObjects + 1, 0);
+    for (size_t i=0;i<nrOfObjects;i++) {
+        paletteOffsets[i+1] = paletteOffsets[i] + this->objectsToBeRendered[i]->getJointMatrices().size();
+    }
 
-    for (auto & o : this->objectsToBeRendered) {
+    const auto updateObject = [&](const size_t i) {
+        auto & o = this->objectsToBeRendered[i];
 
-        if (o->calculateAnimationMatrices()) {
-            const auto & animationMatrices = o->getAnimationMatrices();
-            memcpy(static_cast<char *>(this->animationMatrixBuffer.getBufferData()) + (j * animationMatrixDataSize), animationMatrices.data(), animationMatrices.size() * animationMatrixDataSize);
+        // palettes are evaluated by the linked animation pipeline otherwise, see AnimationPipeline
+        if (!this->gpuAnimation && o->calculateJointMatrices()) {
+            // only the palette is uploaded, blending happens in the vertex shader
+            const uint32_t nrOfJoints = std::min<uint32_t>(o->getJointMatrices().size(), paletteOffsets[i+1] - paletteOffsets[i]);
+            this->animationMatrixBuffer.write(paletteOffsets[i] * animationMatrixDataSize, o->getJointMatrices().data(), nrOfJoints * animationMatrixDataSize);
 
             o->setDirty(true);
         }
 
-        j += o->getAnimationMatrices().size();
-
         if (o->isDirty()) {
             if (this->renderer->usesGpuCulling()) {
                 const BoundingSphere sphere = o->getBoundingSphere();
@@ -298,11 +365,26 @@ void AnimatedModelMeshPipeline::update() {
                     o->getMatrix(), sphere.center, sphere.radius
                 };
 
-                memcpy(static_cast<char *>(this->ssboInstanceBuffer.getBufferData()) + (i * instanceDataSize), &instanceData, instanceDataSize);
+                this->ssboInstanceBuffer.write(i * instanceDataSize, &instanceData, instanceDataSize);
             }
             o->setDirty(false);
         }
+    };
+
+    const size_t numberOfWorkers = this->gpuAnimation ? 1 :
+        std::min<size_t>(this->renderer->getWorkerPool().getConcurrency(), nrOfObjects / MIN_ANIMATIONS_PER_UPDATE_THREAD);
 
-        i++;
+    if (numberOfWorkers <= 1) {
+        for (size_t i=0;i<nrOfObjects;i++) updateObject(i);
+    } else {
+        // contiguous slices keep neighbouring writes (and their dirty chunks) with one worker
+        const size_t sliceSize = (nrOfObjects + numberOfWorkers - 1) / numberOfWorkers;
+
+        this->renderer->getWorkerPool().run(numberOfWorkers, [&](const size_t w) {
+            for (size_t i=w*sliceSize;i<std::min(nrOfObjects, (w+1)*sliceSize);i++) updateObject(i);
+        });
     }
+
+    this->ssboInstanceBuffer.flush(this->renderer->getCurrentFrame());
+    this->animationMatrixBuffer.flush(this->renderer->getCurrentFrame());
 }
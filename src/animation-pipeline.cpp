@@ -0,0 +1,360 @@
+#include "includes/engine.h"
+
+AnimationPipeline::AnimationPipeline(const std::string name, Renderer * renderer) : ComputePipeline(name, renderer) { }
+
+bool AnimationPipeline::initPipeline(const PipelineConfig & config) {
+    if (this->renderer == nullptr || !this->renderer->isReady()) {
+        logError("Pipeline " + this->name + " requires a ready renderer instance!");
+        return false;
+    }
+
+    this->config = std::move(static_cast<const AnimationPipelineConfig &>(config));
+
+    if (this->config.linkedGraphicsPipeline.has_value()) {
+        const auto linkedPipeline = std::get_if<AnimatedModelMeshPipeline *>(&this->config.linkedGraphicsPipeline.value());
+        if (linkedPipeline != nullptr) this->linkedGraphicsPipeline = *linkedPipeline;
+    }
+
+    if (this->linkedGraphicsPipeline == nullptr) {
+        logError("Pipeline " + this->name + " requires a linked animated model pipeline");
+        return false;
+    }
+
+    // palettes are written into the linked pipeline's animation matrix buffer, there is no indirect buffer
+    this->indirectBufferIndex = -1;
+
+    for (const auto & s : this->config.shaders) {
+        if (!this->addShader((Engine::getAppPath(SHADERS) / s.file).string(), s.shaderType)) {
+            logError("Failed to add shader: " + s.file);
+        }
+    }
+
+    if (this->getNumberOfValidShaders() < 1) {
+        logError(" '" + this->name + "' Pipeline needs compute shader at a minimum!");
+        return false;
+    }
+
+    if (!this->createComputeBuffers()) {
+        logError("Failed to create Animation Pipeline Buffers");
+        return false;
+    }
+
+    if (!this->createDescriptorPool()) {
+        logError("Failed to create Animation Pipeline Descriptor Pool");
+        return false;
+    }
+
+    return this->createPipeline();
+}
+
+bool AnimationPipeline::createPipeline()
+{
+    if (!this->createDescriptors()) {
+        logError("Failed to create Animation Pipeline Descriptors");
+        return false;
+    }
+
+    return this->createComputePipelineCommon();
+}
+
+bool AnimationPipeline::createDescriptorPool() {
+    if (this->renderer == nullptr || !this->renderer->isReady() || this->descriptorPool.isInitialized()) return false;
+
+    const uint32_t count = this->renderer->getFramesInFlight();
+
+    for (uint32_t i=0;i<6;i++) {
+        this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
+    }
+
+    this->descriptorPool.createPool(this->renderer->getLogicalDevice(), count);
+
+    return this->descriptorPool.isInitialized();
+}
+
+bool AnimationPipeline::createDescriptors() {
+    if (this->renderer == nullptr || !this->renderer->isReady() || this->linkedGraphicsPipeline == nullptr) return false;
+
+    this->descriptors.destroy(this->renderer->getLogicalDevice());
+    this->descriptorPool.resetPool(this->renderer->getLogicalDevice());
+
+    for (uint32_t i=0;i<6;i++) {
+        this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+    }
+
+    this->descriptors.create(this->renderer->getLogicalDevice(), this->descriptorPool.getPool(), this->renderer->getFramesInFlight());
+
+    if (!this->descriptors.isInitialized()) return false;
+
+    const VkDescriptorBufferInfo & nodeInfo = this->nodeBuffer.getDescriptorInfo();
+    const VkDescriptorBufferInfo & trackInfo = this->trackBuffer.getDescriptorInfo();
+    const VkDescriptorBufferInfo & keyInfo = this->computeBuffer.getDescriptorInfo();
+    const VkDescriptorBufferInfo & jointInfo = this->jointBuffer.getDescriptorInfo();
+
+    const uint32_t descSize = this->descriptors.getDescriptorSets().size();
+    for (size_t i = 0; i < descSize; i++) {
+        const VkDescriptorBufferInfo & instanceInfo = this->instanceBuffer.getDescriptorInfo(i);
+        const VkDescriptorBufferInfo & animationMatrixInfo = this->linkedGraphicsPipeline->getAnimationMatrixDescriptorInfo(i);
+
+        this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), 0, i, instanceInfo);
+        this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), 1, i, nodeInfo);
+        this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), 2, i, trackInfo);
+        this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), 3, i, keyInfo);
+        this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), 4, i, jointInfo);
+        this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), 5, i, animationMatrixInfo);
+    }
+
+    return true;
+}
+
+/**
+ *  Key frames (compute buffer), nodes, tracks and joints are appended to by the cpu only, hence host visible.
+ */
+bool AnimationPipeline::createComputeBuffers()
+{
+    if (this->renderer == nullptr || !this->renderer->isReady()) return false;
+
+    if (this->config.reservedComputeSpace == 0 || this->config.reservedSkeletonSpace == 0) {
+        logError("The configuration has reserved 0 space for animation buffers!");
+        return false;
+    }
+
+    const VkPhysicalDevice & physicalDevice = this->renderer->getPhysicalDevice();
+    const VkDevice & logicalDevice = this->renderer->getLogicalDevice();
+
+    this->computeBuffer.destroy(logicalDevice);
+    this->nodeBuffer.destroy(logicalDevice);
+    this->trackBuffer.destroy(logicalDevice);
+    this->jointBuffer.destroy(logicalDevice);
+
+    if (this->computeBuffer.createSharedStorageBuffer(physicalDevice, logicalDevice, this->config.reservedComputeSpace) != VK_SUCCESS ||
+        this->nodeBuffer.createSharedStorageBuffer(physicalDevice, logicalDevice, this->config.reservedSkeletonSpace) != VK_SUCCESS ||
+        this->trackBuffer.createSharedStorageBuffer(physicalDevice, logicalDevice, this->config.reservedSkeletonSpace) != VK_SUCCESS ||
+        this->jointBuffer.createSharedStorageBuffer(physicalDevice, logicalDevice, this->config.reservedSkeletonSpace) != VK_SUCCESS ||
+        this->instanceBuffer.create(physicalDevice, logicalDevice, this->config.reservedInstanceDataSpace, this->renderer->getFramesInFlight()) != VK_SUCCESS) {
+        logError("Allocation: Not enough host space!");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ *  Flattens hierarchy, joints and key frames of a renderable. Nodes are stored parents first,
+ *  every animation gets a track per node. Mirrors AnimationData::calculateJointTransformation,
+ *  joints found more than once in the hierarchy end up with the node visited last.
+ */
+bool AnimationPipeline::addAnimationData(AnimatedModelMeshRenderable * renderable) {
+    const uint32_t jointCount = renderable->getJointMatrices().size();
+
+    std::vector<const NodeInformation *> nodeInfos;
+    std::vector<AnimationNodeData> nodes;
+    std::vector<std::pair<const NodeInformation *, int32_t>> nodesToVisit = { { &renderable->getRootNode(), -1 } };
+    while (!nodesToVisit.empty()) {
+        const auto [node, parent] = nodesToVisit.back();
+        nodesToVisit.pop_back();
+
+        AnimationNodeData nodeData;
+        nodeData.transformation = node->transformation;
+        nodeData.parent = parent;
+        nodes.emplace_back(nodeData);
+        nodeInfos.emplace_back(node);
+
+        const int32_t nodeIndex = nodes.size() - 1;
+        for (auto child = node->children.rbegin(); child != node->children.rend(); child++) {
+            nodesToVisit.emplace_back(&(*child), nodeIndex);
+        }
+    }
+
+    std::vector<AnimationJointData> joints(jointCount);
+    for (uint32_t i=0;i<jointCount;i++) {
+        joints[i].offsetMatrix = renderable->getJoints()[i].offsetMatrix;
+    }
+
+    const auto & jointIndexByName = renderable->getJointIndexByName();
+    for (uint32_t i=0;i<nodeInfos.size();i++) {
+        const auto jointIndex = jointIndexByName.find(nodeInfos[i]->name);
+        if (jointIndex != jointIndexByName.end() && jointIndex->second < jointCount) joints[jointIndex->second].node = i;
+    }
+
+    const uint32_t nodeOffset = this->nodeBuffer.getContentSize() / sizeof(AnimationNodeData);
+    const uint32_t trackOffset = this->trackBuffer.getContentSize() / sizeof(AnimationTrackData);
+    const uint32_t keyOffset = this->computeBuffer.getContentSize() / sizeof(AnimationKeyData);
+    const uint32_t jointOffset = this->jointBuffer.getContentSize() / sizeof(AnimationJointData);
+
+    std::vector<AnimationTrackData> tracks;
+    std::vector<AnimationKeyData> keys;
+    std::unordered_map<std::string, uint32_t> trackOffsets;
+
+    for (const auto & animation : renderable->getAnimations()) {
+        trackOffsets[animation.first] = trackOffset + tracks.size();
+
+        std::unordered_map<std::string, const AnimationDetails *> detailsByName;
+        for (const auto & details : animation.second.details) detailsByName.try_emplace(details.name, &details);
+
+        for (const auto & node : nodeInfos) {
+            AnimationTrackData track;
+
+            const auto details = node->name.empty() ? detailsByName.end() : detailsByName.find(node->name);
+            if (details != detailsByName.end()) {
+                track.animated = 1;
+
+                track.positionOffset = keyOffset + keys.size();
+                track.positionCount = details->second->positions.size();
+                for (const auto & e : details->second->positions) keys.push_back({ glm::vec4(e.translation, 0.0f), static_cast<float>(e.time) });
+
+                track.rotationOffset = keyOffset + keys.size();
+                track.rotationCount = details->second->rotations.size();
+                for (const auto & e : details->second->rotations) keys.push_back({ glm::vec4(e.rotation.x, e.rotation.y, e.rotation.z, e.rotation.w), static_cast<float>(e.time) });
+
+                track.scalingOffset = keyOffset + keys.size();
+                track.scalingCount = details->second->scalings.size();
+                for (const auto & e : details->second->scalings) keys.push_back({ glm::vec4(e.scaling, 0.0f), static_cast<float>(e.time) });
+            }
+
+            tracks.emplace_back(track);
+        }
+    }
+
+    const VkDeviceSize nodesSize = nodes.size() * sizeof(AnimationNodeData);
+    const VkDeviceSize tracksSize = tracks.size() * sizeof(AnimationTrackData);
+    const VkDeviceSize keysSize = keys.size() * sizeof(AnimationKeyData);
+    const VkDeviceSize jointsSize = joints.size() * sizeof(AnimationJointData);
+
+    VkDeviceSize instanceDataOffset = 0;
+    if (this->nodeBuffer.getContentSize() + nodesSize > this->nodeBuffer.getSize() ||
+        this->trackBuffer.getContentSize() + tracksSize > this->trackBuffer.getSize() ||
+        this->computeBuffer.getContentSize() + keysSize > this->computeBuffer.getSize() ||
+        this->jointBuffer.getContentSize() + jointsSize > this->jointBuffer.getSize() ||
+        !this->instanceBuffer.allocate(sizeof(AnimationInstanceData), instanceDataOffset)) {
+        logError("Animation Buffers not big enough!");
+        return false;
+    }
+
+    memcpy(static_cast<char *>(this->nodeBuffer.getBufferData()) + this->nodeBuffer.getContentSize(), nodes.data(), nodesSize);
+    this->nodeBuffer.updateContentSize(this->nodeBuffer.getContentSize() + nodesSize);
+    memcpy(static_cast<char *>(this->trackBuffer.getBufferData()) + this->trackBuffer.getContentSize(), tracks.data(), tracksSize);
+    this->trackBuffer.updateContentSize(this->trackBuffer.getContentSize() + tracksSize);
+    memcpy(static_cast<char *>(this->computeBuffer.getBufferData()) + this->computeBuffer.getContentSize(), keys.data(), keysSize);
+    this->computeBuffer.updateContentSize(this->computeBuffer.getContentSize() + keysSize);
+    memcpy(static_cast<char *>(this->jointBuffer.getBufferData()) + this->jointBuffer.getContentSize(), joints.data(), jointsSize);
+    this->jointBuffer.updateContentSize(this->jointBuffer.getContentSize() + jointsSize);
+
+    // without a known animation the palette stays as is (see AnimationData::calculateJointMatrices)
+    AnimationInstanceData instance;
+    instance.rootInverseTransformation = renderable->getRootInverseTransformation();
+    instance.nodeOffset = nodeOffset;
+    instance.jointOffset = jointOffset;
+    instance.paletteOffset = this->paletteOffset;
+    instance.time = renderable->getCurrentAnimationTime();
+
+    const auto currentTrackOffset = trackOffsets.find(renderable->getCurrentAnimation());
+    if (currentTrackOffset != trackOffsets.end()) {
+        instance.trackOffset = currentTrackOffset->second;
+        instance.jointCount = jointCount;
+    }
+
+    this->instanceBuffer.write(instanceDataOffset, &instance, sizeof(AnimationInstanceData));
+
+    this->instances.emplace_back(instance);
+    this->trackOffsetsByAnimation.emplace_back(std::move(trackOffsets));
+    this->paletteOffset += jointCount;
+    this->maxJointCount = std::max(this->maxJointCount, jointCount);
+
+    return true;
+}
+
+/**
+ *  Only animation and time per instance change from frame to frame, everything else is evaluated on the gpu
+ */
+void AnimationPipeline::update() {
+    if (this->renderer == nullptr || !this->renderer->isReady() || this->linkedGraphicsPipeline == nullptr) return;
+
+    const auto & renderables = this->linkedGraphicsPipeline->getRenderables();
+
+    // the linked pipeline was cleared, start over
+    if (renderables.size() < this->instanceOffset) {
+        this->computeBuffer.updateContentSize(0);
+        this->nodeBuffer.updateContentSize(0);
+        this->trackBuffer.updateContentSize(0);
+        this->jointBuffer.updateContentSize(0);
+        this->instanceBuffer.clear();
+        this->instances.clear();
+        this->trackOffsetsByAnimation.clear();
+        this->instanceOffset = 0;
+        this->paletteOffset = 0;
+        this->maxJointCount = 0;
+        this->renderer->invalidateCommandBuffers();
+    }
+
+    // new instances change the dispatch size
+    if (renderables.size() > this->instanceOffset) {
+        for (uint32_t i=this->instanceOffset;i<renderables.size();i++) {
+            if (!this->addAnimationData(renderables[i])) break;
+            this->instanceOffset++;
+        }
+
+        this->renderer->invalidateCommandBuffers();
+    }
+
+    for (uint32_t i=0;i<this->instances.size();i++) {
+        const auto & renderable = renderables[i];
+        auto & instance = this->instances[i];
+        if (instance.jointCount == 0) continue;
+
+        const auto & trackOffsets = this->trackOffsetsByAnimation[i];
+        const auto trackOffset = trackOffsets.find(renderable->getCurrentAnimation());
+        const float time = renderable->getCurrentAnimationTime();
+        if (trackOffset == trackOffsets.end() || (trackOffset->second == instance.trackOffset && time == instance.time)) continue;
+
+        instance.trackOffset = trackOffset->second;
+        instance.time = time;
+        this->instanceBuffer.write(i * sizeof(AnimationInstanceData), &instance, sizeof(AnimationInstanceData));
+    }
+
+    this->instanceBuffer.flush(this->renderer->getCurrentFrame());
+}
+
+void AnimationPipeline::compute(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex) {
+    if (this->instances.empty() || this->maxJointCount == 0) return;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->layout, 0, 1, &this->descriptors.getDescriptorSets()[commandBufferIndex], 0, nullptr);
+
+    // x: joints, y: instances
+    vkCmdDispatch(commandBuffer, (this->maxJointCount / 32)+1, this->instances.size(), 1);
+
+    // the palettes are handed over to the graphics queue which acquires them in turn
+    if (this->renderer->getGraphicsQueueIndex() != this->renderer->getComputeQueueIndex()) {
+        const VkDescriptorBufferInfo & animationMatrixInfo = this->linkedGraphicsPipeline->getAnimationMatrixDescriptorInfo(commandBufferIndex);
+
+        const VkBufferMemoryBarrier paletteBarrier {
+            VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            nullptr,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            0,
+            static_cast<uint32_t>(this->renderer->getComputeQueueIndex()),
+            static_cast<uint32_t>(this->renderer->getGraphicsQueueIndex()),
+            animationMatrixInfo.buffer,
+            animationMatrixInfo.offset,
+            animationMatrixInfo.range
+        };
+
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0,
+            0, nullptr,
+            1, &paletteBarrier,
+            0, nullptr
+        );
+    }
+}
+
+AnimationPipeline::~AnimationPipeline() {
+    this->computeBuffer.destroy(this->renderer->getLogicalDevice());
+    this->nodeBuffer.destroy(this->renderer->getLogicalDevice());
+    this->trackBuffer.destroy(this->renderer->getLogicalDevice());
+    this->jointBuffer.destroy(this->renderer->getLogicalDevice());
+    this->instanceBuffer.destroy(this->renderer->getLogicalDevice());
+}
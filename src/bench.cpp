@@ -0,0 +1,346 @@
+#include "includes/server.h"
+
+#include <sstream>
+#include <iomanip>
+
+void logInfo(std::string message) {
+    std::cerr << message << std::endl;
+}
+
+void logError(std::string message) {
+    std::cerr << message << std::endl;
+}
+
+static constexpr uint32_t BENCHMARK_SEED = 4711;
+static const std::vector<int64_t> BENCHMARK_SCENE_SIZES = { 1000, 10000, 100000 };
+
+template<typename T>
+static inline void doNotOptimize(T const & value) {
+    #if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+    #else
+        static volatile const void * sink = nullptr;
+        sink = &value;
+    #endif
+}
+
+/**
+ *  Runs the measured loop of a benchmark in batches: the batch size is calibrated until a batch takes
+ *  at least the minimum time, one more batch warms up and the timings of the following batches are kept.
+ *  Timing starts with the first call to keepRunning, anything set up before that is not measured.
+ */
+class BenchmarkState final {
+    private:
+        const uint32_t repetitions;
+        const std::chrono::nanoseconds minBatchTime;
+
+        uint64_t batchSize = 1;
+        uint64_t remaining = 0;
+        bool calibrated = false;
+        bool warmedUp = false;
+        bool started = false;
+
+        std::chrono::steady_clock::time_point batchStart;
+
+    public:
+        std::vector<double> nanosPerIteration;
+        int64_t itemsPerIteration = 0;
+
+        BenchmarkState(const BenchmarkState&) = delete;
+        BenchmarkState& operator=(const BenchmarkState &) = delete;
+        BenchmarkState(BenchmarkState &&) = delete;
+        BenchmarkState & operator=(BenchmarkState) = delete;
+        BenchmarkState(const uint32_t repetitions, const uint32_t minBatchTimeInMillis) :
+            repetitions(repetitions), minBatchTime(std::chrono::milliseconds(minBatchTimeInMillis)) {};
+
+        bool keepRunning() {
+            if (this->remaining > 0) {
+                this->remaining--;
+                return true;
+            }
+
+            const auto now = std::chrono::steady_clock::now();
+            if (this->started) {
+                const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - this->batchStart);
+
+                if (!this->calibrated) {
+                    if (elapsed < this->minBatchTime) {
+                        const double factor = elapsed.count() <= 0 ? 100.0 : 1.4 * this->minBatchTime.count() / elapsed.count();
+                        this->batchSize = std::max<uint64_t>(this->batchSize + 1, static_cast<uint64_t>(this->batchSize * std::min(factor, 100.0)));
+                    } else this->calibrated = true;
+                } else if (!this->warmedUp) {
+                    this->warmedUp = true;
+                } else {
+                    this->nanosPerIteration.emplace_back(static_cast<double>(elapsed.count()) / this->batchSize);
+                    if (this->nanosPerIteration.size() >= this->repetitions) return false;
+                }
+            }
+
+            this->started = true;
+            this->remaining = this->batchSize - 1;
+            this->batchStart = std::chrono::steady_clock::now();
+
+            return true;
+        }
+};
+
+struct Benchmark final {
+    std::string name;
+    std::vector<int64_t> args;
+    std::function<void(BenchmarkState &, const int64_t)> function;
+};
+
+struct BenchmarkResult final {
+    std::string name;
+    uint32_t repetitions = 0;
+    double median = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double coefficientOfVariation = 0.0;
+    double itemsPerSecond = 0.0;
+};
+
+static BenchmarkResult summarize(const std::string & name, BenchmarkState & state) {
+    BenchmarkResult result;
+    result.name = name;
+
+    auto samples = state.nanosPerIteration;
+    if (samples.empty()) return result;
+
+    std::sort(samples.begin(), samples.end());
+
+    result.repetitions = samples.size();
+    result.min = samples.front();
+    result.max = samples.back();
+    result.median = samples.size() % 2 == 0 ?
+        (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2 : samples[samples.size() / 2];
+
+    double mean = 0.0;
+    for (const auto & s : samples) mean += s;
+    mean /= samples.size();
+
+    double variance = 0.0;
+    for (const auto & s : samples) variance += (s - mean) * (s - mean);
+    variance /= samples.size();
+
+    result.coefficientOfVariation = mean > 0.0 ? 100.0 * std::sqrt(variance) / mean : 0.0;
+    if (state.itemsPerIteration > 0 && result.median > 0.0) result.itemsPerSecond = state.itemsPerIteration * 1e9 / result.median;
+
+    return result;
+}
+
+// deterministic scenes of boxes and spheres, the area grows with the count to keep the density constant
+static std::vector<PhysicsObject *> createScene(const int64_t count) {
+
+    std::mt19937 random(BENCHMARK_SEED);
+    const float halfLength = std::sqrt(static_cast<float>(count)) * UNIFORM_GRID_CELL_LENGTH / 2;
+    std::uniform_real_distribution<float> positionDistribution(-halfLength, halfLength);
+    std::uniform_real_distribution<float> sizeDistribution(0.5f, 3.0f);
+    std::uniform_real_distribution<float> rotationDistribution(0.0f, glm::pi<float>());
+
+    std::vector<PhysicsObject *> objects;
+    objects.reserve(count);
+
+    for (int64_t i=0;i<count;i++) {
+        const std::string id = "bench-" + std::to_string(i);
+        const float size = sizeDistribution(random);
+
+        PhysicsObject * physicsObject = nullptr;
+        if (i % 2 == 0) {
+            physicsObject = ObjectFactory::loadSphere(id, size);
+            if (physicsObject != nullptr) physicsObject->setProperty<float>("radius", size);
+        } else {
+            physicsObject = ObjectFactory::loadBox(id, size, sizeDistribution(random), size);
+            if (physicsObject != nullptr) physicsObject->setRotation({ 0.0f, rotationDistribution(random), 0.0f });
+        }
+
+        if (physicsObject == nullptr) continue;
+
+        physicsObject->setPosition(glm::vec3(positionDistribution(random), positionDistribution(random) / 10, positionDistribution(random)));
+        physicsObject->recalculateBoundingVolumes();
+        objects.emplace_back(physicsObject);
+    }
+
+    return objects;
+}
+
+// the objects of a benchmark live in the singletons, they are dropped for the next benchmark to start from scratch
+static void tearDownScene() {
+    SpatialHashMap::INSTANCE()->clear();
+    GlobalPhysicsObjectStore::INSTANCE()->clear();
+}
+
+static PhysicsObject * loadSkinnedModel(const std::string & file, const unsigned int flags = 0, const bool useFirstChildAsRoot = false) {
+    const auto location = (ObjectFactory::getAppPath(MODELS) / file).string();
+
+    auto physicsObject = ObjectFactory::loadModel(location, "bench-" + file, flags, useFirstChildAsRoot);
+    if (physicsObject == nullptr || physicsObject->getCurrentAnimation().empty()) {
+        logError("Skipping skinned model benchmark, failed to load animated model: " + location);
+        return nullptr;
+    }
+
+    return physicsObject;
+}
+
+static std::vector<Benchmark> registerBenchmarks() {
+    std::vector<Benchmark> benchmarks;
+
+    benchmarks.push_back({ "PhysicsObject::recalculateBoundingVolumes", BENCHMARK_SCENE_SIZES, [](BenchmarkState & state, const int64_t count) {
+        const auto objects = createScene(count);
+        state.itemsPerIteration = objects.size();
+
+        while (state.keepRunning()) {
+            for (auto o : objects) {
+                o->recalculateBoundingVolumes();
+                doNotOptimize(o->getBoundingBox());
+            }
+        }
+    }});
+
+    benchmarks.push_back({ "PhysicsObject::getOrUpdateSpatialHashKeys", BENCHMARK_SCENE_SIZES, [](BenchmarkState & state, const int64_t count) {
+        const auto objects = createScene(count);
+        state.itemsPerIteration = objects.size();
+
+        while (state.keepRunning()) {
+            for (auto o : objects) {
+                const auto keys = o->getOrUpdateSpatialHashKeys(true);
+                doNotOptimize(keys);
+            }
+        }
+    }});
+
+    benchmarks.push_back({ "SpatialHashMap::performBroadPhaseCollisionCheck", BENCHMARK_SCENE_SIZES, [](BenchmarkState & state, const int64_t count) {
+        const auto objects = createScene(count);
+        for (auto o : objects) SpatialHashMap::INSTANCE()->addObject(o);
+        state.itemsPerIteration = objects.size();
+
+        while (state.keepRunning()) {
+            const auto collisions = SpatialHashMap::INSTANCE()->performBroadPhaseCollisionCheck(objects);
+            doNotOptimize(collisions);
+        }
+    }});
+
+    const auto animationBenchmark = [](const std::string & file, const unsigned int flags, const bool useFirstChildAsRoot, const bool paletteOnly = false) {
+        return [file, flags, useFirstChildAsRoot, paletteOnly](BenchmarkState & state, const int64_t instances) {
+            const auto physicsObject = loadSkinnedModel(file, flags, useFirstChildAsRoot);
+            if (physicsObject == nullptr) return;
+
+            state.itemsPerIteration = instances;
+
+            float animationTime = 0.0f;
+            while (state.keepRunning()) {
+                for (int64_t i=0;i<instances;i++) {
+                    animationTime += 0.01f;
+                    physicsObject->setCurrentAnimationTime(animationTime);
+                    doNotOptimize(paletteOnly ? physicsObject->calculateJointMatrices() : physicsObject->calculateAnimationMatrices());
+                }
+            }
+        };
+    };
+
+    benchmarks.push_back({ "AnimationData::calculateAnimationMatrices/CesiumMan", { 1, 100 },
+        animationBenchmark("CesiumMan.gltf", aiProcess_ConvertToLeftHanded | aiProcess_ForceGenNormals, true) });
+    benchmarks.push_back({ "AnimationData::calculateAnimationMatrices/BobLamp", { 1, 100 },
+        animationBenchmark("bob_lamp_update.md5mesh", aiProcess_ConvertToLeftHanded, false) });
+    benchmarks.push_back({ "AnimationData::calculateJointMatrices/CesiumMan", { 1, 100 },
+        animationBenchmark("CesiumMan.gltf", aiProcess_ConvertToLeftHanded | aiProcess_ForceGenNormals, true, true) });
+
+    benchmarks.push_back({ "extractFrustumPlanes", { 1000 }, [](BenchmarkState & state, const int64_t count) {
+        std::vector<glm::mat4> matrices;
+        for (int64_t i=0;i<count;i++) {
+            const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+            const glm::mat4 view = glm::lookAt(glm::vec3(i, 10, i), glm::vec3(0.0f), glm::vec3(0, 1, 0));
+            matrices.emplace_back(projection * view);
+        }
+        state.itemsPerIteration = count;
+
+        while (state.keepRunning()) {
+            for (const auto & m : matrices) doNotOptimize(extractFrustumPlanes(m));
+        }
+    }});
+
+    return benchmarks;
+}
+
+static std::string formatNanos(const double nanos) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+
+    if (nanos >= 1e9) out << nanos / 1e9 << " s";
+    else if (nanos >= 1e6) out << nanos / 1e6 << " ms";
+    else if (nanos >= 1e3) out << nanos / 1e3 << " us";
+    else out << nanos << " ns";
+
+    return out.str();
+}
+
+int main(int argc, char* argv []) {
+    std::string root = "assets";
+    std::string filter = "";
+    bool json = false;
+    uint32_t repetitions = 10;
+    uint32_t minBatchTimeInMillis = 50;
+
+    for (int i=1;i<argc;i++) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--filter=", 0) == 0) filter = arg.substr(9);
+        else if (arg == "--json") json = true;
+        else if (arg.rfind("--repetitions=", 0) == 0) repetitions = std::max(1, std::atoi(arg.substr(14).c_str()));
+        else if (arg.rfind("--min-time=", 0) == 0) minBatchTimeInMillis = std::max(1, std::atoi(arg.substr(11).c_str()));
+        else if (arg.rfind("--", 0) != 0) root = arg;
+        else {
+            logError("Usage: playground-bench [assets dir] [--filter=<substring>] [--repetitions=<n>] [--min-time=<ms>] [--json]");
+            return -1;
+        }
+    }
+
+    ObjectFactory::base = root;
+    if (!std::filesystem::is_directory(ObjectFactory::base)) {
+        logError("App Directory " + ObjectFactory::base.string() + " does not exist!");
+        return -1;
+    }
+
+    std::vector<BenchmarkResult> results;
+
+    if (!json) {
+        std::cout << std::left << std::setw(64) << "Benchmark" << std::right << std::setw(12) << "Median" <<
+            std::setw(12) << "Min" << std::setw(12) << "Max" << std::setw(8) << "CV%" << std::setw(16) << "Items/s" << std::endl;
+    }
+
+    for (const auto & benchmark : registerBenchmarks()) {
+        for (const auto & arg : benchmark.args) {
+            const std::string name = benchmark.name + "/" + std::to_string(arg);
+            if (!filter.empty() && name.find(filter) == std::string::npos) continue;
+
+            BenchmarkState state(repetitions, minBatchTimeInMillis);
+            benchmark.function(state, arg);
+            tearDownScene();
+
+            const auto result = summarize(name, state);
+            if (result.repetitions == 0) continue;
+
+            results.emplace_back(result);
+
+            if (!json) {
+                std::cout << std::left << std::setw(64) << result.name << std::right << std::setw(12) << formatNanos(result.median) <<
+                    std::setw(12) << formatNanos(result.min) << std::setw(12) << formatNanos(result.max) <<
+                    std::setw(8) << std::fixed << std::setprecision(1) << result.coefficientOfVariation <<
+                    std::setw(16) << std::setprecision(0) << result.itemsPerSecond << std::endl;
+            }
+        }
+    }
+
+    if (json) {
+        std::cout << "{\"benchmarks\":[";
+        for (size_t i=0;i<results.size();i++) {
+            const auto & r = results[i];
+            std::cout << (i > 0 ? "," : "") << "{\"name\":\"" << r.name << "\",\"repetitions\":" << r.repetitions <<
+                std::fixed << std::setprecision(1) << ",\"median_ns\":" << r.median << ",\"min_ns\":" << r.min <<
+                ",\"max_ns\":" << r.max << ",\"cv_percent\":" << r.coefficientOfVariation <<
+                std::setprecision(0) << ",\"items_per_second\":" << r.itemsPerSecond << "}";
+        }
+        std::cout << "]}" << std::endl;
+    }
+
+    return 0;
+}
@@ -22,44 +22,7 @@ void Camera::updateFrustum() {
 }
 
 const std::array<glm::vec4, 6> Camera::calculateFrustum(const glm::mat4 & matrix) {
-    std::array<glm::vec4, 6> frustum;
-
-    frustum[0].x = matrix[0].w + matrix[0].x;
-    frustum[0].y = matrix[1].w + matrix[1].x;
-    frustum[0].z = matrix[2].w + matrix[2].x;
-    frustum[0].w = matrix[3].w + matrix[3].x;
-
-    frustum[1].x = matrix[0].w - matrix[0].x;
-    frustum[1].y = matrix[1].w - matrix[1].x;
-    frustum[1].z = matrix[2].w - matrix[2].x;
-    frustum[1].w = matrix[3].w - matrix[3].x;
-
-    frustum[2].x = matrix[0].w - matrix[0].y;
-    frustum[2].y = matrix[1].w - matrix[1].y;
-    frustum[2].z = matrix[2].w - matrix[2].y;
-    frustum[2].w = matrix[3].w - matrix[3].y;
-
-    frustum[3].x = matrix[0].w + matrix[0].y;
-    frustum[3].y = matrix[1].w + matrix[1].y;
-    frustum[3].z = matrix[2].w + matrix[2].y;
-    frustum[3].w = matrix[3].w + matrix[3].y;
-
-    frustum[4].x = matrix[0].w + matrix[0].z;
-    frustum[4].y = matrix[1].w + matrix[1].z;
-    frustum[4].z = matrix[2].w + matrix[2].z;
-    frustum[4].w = matrix[3].w + matrix[3].z;
-
-    frustum[5].x = matrix[0].w - matrix[0].z;
-    frustum[5].y = matrix[1].w - matrix[1].z;
-    frustum[5].z = matrix[2].w - matrix[2].z;
-    frustum[5].w = matrix[3].w - matrix[3].z;
-
-    for (uint32_t i = 0; i < frustum.size(); i++) {
-        float length = sqrtf(frustum[i].x * frustum[i].x + frustum[i].y * frustum[i].y + frustum[i].z * frustum[i].z);
-        frustum[i] /= length;
-    }
-
-    return frustum;
+    return extractFrustumPlanes(matrix);
 }
 
 const std::array<glm::vec4, 6> & Camera::getFrustumPlanes() {
@@ -73,11 +73,14 @@ bool ColorMeshPipeline0::initPipeline(const PipelineConfig & config)
 }
 
 template<>
-bool ColorMeshPipeline0::addObjectsToBeRendered(const std::vector<ColorMeshRenderable *> & additionalObjectsToBeRendered, const bool useAltGraphicsQueue) {
+bool ColorMeshPipeline0::addObjectsToBeRendered(const std::vector<ColorMeshRenderable *> & additionalObjectsToBeRendered) {
     if (!this->vertexBuffer.isInitialized() || additionalObjectsToBeRendered.empty()) return false;
 
     const std::lock_guard<std::mutex> lock(this->additionMutex);
 
+    // objects not fitting (or not waiting for the buffers to grow) are dropped further down
+    if (this->deferUntilGrown(additionalObjectsToBeRendered, sizeof(ColorMeshData))) return true;
+
     std::vector<Vertex> additionalVertices;
     std::vector<uint32_t> additionalIndices;
 
@@ -103,10 +106,33 @@ bool ColorMeshPipeline0::addObjectsToBeRendered(const std::vector<ColorMeshRende
             logInfo("Warning: Object to be rendered has not been registered with the GlobalRenderableStore!");
         }
 
+        // renderables sharing the geometry of another one only come with instance data
+        if (o->getGeometryOwner() != nullptr) {
+            if (!this->meshBufferOffsets.contains(o->getGeometryOwner())) {
+                logError("Pipeline '" + this->name + "': the geometry owner of '" + o->getId() + "' has not been added");
+                break;
+            }
+
+            additionalObjectsAdded++;
+            continue;
+        }
+
+        // owners removed and added again still have their geometry
+        if (this->meshBufferOffsets.contains(o)) {
+            additionalObjectsAdded++;
+            continue;
+        }
+
+        const MeshBufferOffsets offsets = {
+            (vertexBufferContentSize + vertexBufferAdditionalContentSize) / sizeof(Vertex),
+            (indexBufferContentSize + indexBufferAdditionalContentSize) / sizeof(uint32_t),
+            static_cast<uint32_t>((meshDataBufferContentSize + meshDataBufferAdditionalContentSize) / meshDataSize)
+        };
+
         bool bufferTooSmall = false;
         for (const auto & mesh : o->getMeshes()) {
             vertexBufferAdditionalContentSize += sizeof(Vertex) * mesh.vertices.size();
-            indexBufferAdditionalContentSize += sizeof(uint32_t) * mesh.indices.size();
+            indexBufferAdditionalContentSize += sizeof(uint32_t) * getIndexCountWithLods(mesh);
             meshDataBufferAdditionalContentSize += meshDataSize;
 
             // only continue if we fit into the pre-allocated size
@@ -124,17 +150,19 @@ bool ColorMeshPipeline0::addObjectsToBeRendered(const std::vector<ColorMeshRende
             }
 
             additionalVertices.insert(additionalVertices.end(), mesh.vertices.begin(), mesh.vertices.end());
-            additionalIndices.insert(additionalIndices.end(), mesh.indices.begin(), mesh.indices.end());
+            appendIndicesWithLods(mesh, additionalIndices);
         }
 
         if (bufferTooSmall) break;
 
+        this->meshBufferOffsets[o] = offsets;
+
         // do this in batches
         if (vertexBufferAdditionalContentSize > 250 * MEGA_BYTE) {
-            if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices, useAltGraphicsQueue)) break;
+            if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices)) break;
 
             vertexBufferContentSize = this->vertexBuffer.getContentSize();
-            indexBufferContentSize = this->vertexBuffer.getContentSize();
+            indexBufferContentSize = this->indexBuffer.getContentSize();
             vertexBufferAdditionalContentSize = 0;
             indexBufferAdditionalContentSize = 0;
 
@@ -154,7 +182,7 @@ bool ColorMeshPipeline0::addObjectsToBeRendered(const std::vector<ColorMeshRende
     }
 
     // delegate filling up vertex and index buffeers to break up code
-    if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices, useAltGraphicsQueue)) return false;
+    if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices)) return false;
 
     /**
      * Populate per instance and mesh data buffers
@@ -182,16 +210,15 @@ bool ColorMeshPipeline0::addObjectsToBeRendered(const std::vector<ColorMeshRende
         additionalObjectsAdded = c;
 
         const VkDeviceSize totalIntanceDataSize = instanceDataSize * meshInstanceData.size();
-        memcpy(static_cast<char *>(this->ssboInstanceBuffer.getBufferData()) + instanceDataOffset, meshInstanceData.data(), totalIntanceDataSize);
-
-        this->ssboInstanceBuffer.updateContentSize(instanceDataOffset + totalIntanceDataSize);
+        if (!this->ssboInstanceBuffer.allocate(totalIntanceDataSize, instanceDataOffset)) {
+            logError("Pipeline '" + this->name + "': instance data buffer size too small");
+            return false;
+        }
+        this->ssboInstanceBuffer.write(instanceDataOffset, meshInstanceData.data(), totalIntanceDataSize);
     }
 
     // finally add object references to be used for draw loop and object updates
-    this->objectsToBeRendered.insert(
-        this->objectsToBeRendered.end(), additionalObjectsToBeRendered.begin(),
-        additionalObjectsToBeRendered.begin() + additionalObjectsAdded
-    );
+    this->appendObjectsToBeRendered(additionalObjectsToBeRendered, additionalObjectsAdded);
 
     return true;
 }
@@ -199,10 +226,13 @@ bool ColorMeshPipeline0::addObjectsToBeRendered(const std::vector<ColorMeshRende
 void ColorMeshPipeline::updateVertexBufferForObjectWithId(const std::string & id) {
     std::vector<Vertex> additionalVertices;
 
-    VkDeviceSize vertexBufferOffset = 0;
-
     for (const auto & o : this->objectsToBeRendered) {
         if (o->getId() == id) {
+            // the vertices of a shared geometry belong to its owner
+            if (o->getGeometryOwner() != nullptr) return;
+
+            const VkDeviceSize vertexBufferOffset = this->getMeshBufferOffsets(o).vertexOffset * sizeof(Vertex);
+
             for (auto & m : o->getMeshes()) {
                 additionalVertices.insert(additionalVertices.end(), m.vertices.begin(), m.vertices.end());
             }
@@ -210,36 +240,13 @@ void ColorMeshPipeline::updateVertexBufferForObjectWithId(const std::string & id
             const auto & vertexSpace  = sizeof(Vertex) * additionalVertices.size();
 
             if (this->usesDeviceLocalVertexBuffer) {
-                Buffer stagingBuffer;
-
-                stagingBuffer.createStagingBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), vertexSpace);
-                if (stagingBuffer.isInitialized()) {
-                    memcpy(static_cast<char *>(stagingBuffer.getBufferData()), additionalVertices.data(), vertexSpace);
-
-                    const CommandPool & pool = renderer->getGraphicsCommandPool();
-                    const VkCommandBuffer & commandBuffer = pool.beginPrimaryCommandBuffer(renderer->getLogicalDevice());
-
-                    VkBufferCopy copyRegion {};
-                    copyRegion.srcOffset = 0;
-                    copyRegion.dstOffset = vertexBufferOffset;
-                    copyRegion.size = vertexSpace;
-                    vkCmdCopyBuffer(commandBuffer, stagingBuffer.getBuffer(), this->vertexBuffer.getBuffer(), 1, &copyRegion);
-
-                    pool.endCommandBuffer(commandBuffer);
-                    pool.submitCommandBuffer(renderer->getLogicalDevice(), renderer->getGraphicsQueue(), commandBuffer);
-
-                    stagingBuffer.destroy(this->renderer->getLogicalDevice());
-                }
+                this->renderer->getUploadManager().uploadBuffer(this->vertexBuffer, vertexBufferOffset, additionalVertices.data(), vertexSpace);
             } else {
                 memcpy(static_cast<char *>(this->vertexBuffer.getBufferData()) + vertexBufferOffset, additionalVertices.data(), vertexSpace);
             }
 
             break;
         }
-
-        for (auto & m : o->getMeshes()) {
-            vertexBufferOffset += sizeof(Vertex) * m.vertices.size();
-        }
     }
 }
 
@@ -272,8 +279,8 @@ void ColorMeshPipeline0::draw(const VkCommandBuffer& commandBuffer, const uint16
 
         uint32_t maxSize = this->renderer->getMaxIndirectCallCount(this->indirectBufferIndex);
 
-        const VkBuffer & buffer = this->renderer->getIndirectDrawBuffer(this->indirectBufferIndex).getBuffer();
-        const VkBuffer & countBuffer = this->renderer->getIndirectDrawCountBuffer(this->indirectBufferIndex).getBuffer();
+        const VkBuffer & buffer = this->renderer->getIndirectDrawBuffer(this->indirectBufferIndex, commandBufferIndex).getBuffer();
+        const VkBuffer & countBuffer = this->renderer->getIndirectDrawCountBuffer(this->indirectBufferIndex, commandBufferIndex).getBuffer();
 
         vkCmdDrawIndexedIndirectCount(commandBuffer, buffer,0, countBuffer, 0, maxSize, indirectDrawBufferSize);
 
@@ -282,10 +289,10 @@ void ColorMeshPipeline0::draw(const VkCommandBuffer& commandBuffer, const uint16
 
     // direct drawing from here on only
 
-    VkDeviceSize vertexOffset = 0;
-    VkDeviceSize indexOffset = 0;
-
     for (const auto & o : this->objectsToBeRendered) {
+        // renderables sharing a geometry draw the meshes of its owner
+        MeshBufferOffsets offsets = this->getMeshBufferOffsets(o);
+
         for (const auto & m : o->getMeshes()) {
             const VkDeviceSize vertexCount = m.vertices.size();
             const VkDeviceSize indexCount = m.indices.size();
@@ -293,11 +300,11 @@ void ColorMeshPipeline0::draw(const VkCommandBuffer& commandBuffer, const uint16
             if (o->shouldBeRendered()) {
                 const ColorMeshPushConstants & pushConstants = { o->getMatrix(), m.color };
                 vkCmdPushConstants(commandBuffer, this->layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants) , &pushConstants);
-                vkCmdDrawIndexed(commandBuffer, indexCount, 1, indexOffset, vertexOffset, 0);
+                vkCmdDrawIndexed(commandBuffer, indexCount, 1, offsets.indexOffset, offsets.vertexOffset, 0);
             }
 
-            vertexOffset += vertexCount;
-            indexOffset += indexCount;
+            offsets.vertexOffset += vertexCount;
+            offsets.indexOffset += getIndexCountWithLods(m);
         }
     }
 }
@@ -23,6 +23,20 @@ uint32_t Communication::getRandomUint32() {
     return Communication::distribution(Communication::default_random_engine);
 }
 
+CommClient::CommClient(const std::string ip, const uint16_t broadcastPort, const uint16_t requestPort, const uint16_t shards) : Communication(ip, broadcastPort, requestPort)
+{
+    // every shard listens on its own request port, counting up from the first one
+    const uint16_t nrOfShards = std::max<uint16_t>(shards, 1);
+    for (uint16_t i=0;i<nrOfShards;i++) {
+        this->shardRequestAddresses.emplace_back("tcp://" + ip + ":" + std::to_string(requestPort + i));
+    }
+
+    std::random_device randomDevice;
+    std::uniform_int_distribution<uint64_t> distribution;
+    this->replyGroup = "client-" + std::to_string(distribution(randomDevice));
+    this->joinGroup(this->replyGroup);
+}
+
 bool CommClient::start(std::function<void(void*)> messageHandler)
 {
     if (this->running) return true;
@@ -32,32 +46,52 @@ bool CommClient::start(std::function<void(void*)> messageHandler)
     return this->startTcp();
 }
 
+bool CommClient::startWithoutBroadcast()
+{
+    if (this->running) return true;
+
+    this->running = this->startTcp();
+
+    return this->running;
+}
+
 bool CommClient::startTcp()
 {
     logInfo("CommClient: Connecting to TCP router...");
 
     this->tcpContext = zmq_ctx_new();
-    this->tcpSocket = zmq_socket(this->tcpContext, ZMQ_REQ);
 
-    int timeOut = 1000;
-    zmq_setsockopt(this->tcpSocket, ZMQ_LINGER, &timeOut, sizeof(int));
-    timeOut = 2000;
-    zmq_setsockopt(this->tcpSocket, ZMQ_RCVTIMEO, &timeOut, sizeof(int));
+    for (const auto & address : this->shardRequestAddresses) {
+        void * tcpSocket = zmq_socket(this->tcpContext, ZMQ_REQ);
 
-    // set identity
-    const auto now = Communication::getTimeInMillis();
-    const auto rnd = Communication::getRandomUint32();
-    const auto id = "REQ" + std::to_string(now) + std::to_string(rnd);
+        int timeOut = 1000;
+        zmq_setsockopt(tcpSocket, ZMQ_LINGER, &timeOut, sizeof(int));
+        timeOut = REQUEST_REPLY_TIMEOUT;
+        zmq_setsockopt(tcpSocket, ZMQ_RCVTIMEO, &timeOut, sizeof(int));
 
-    zmq_setsockopt (this->tcpSocket, ZMQ_IDENTITY, id.c_str(), id.size());
+        // a request that timed out must not keep the socket from sending the next one, its late reply is dropped
+        int relaxed = 1;
+        zmq_setsockopt(tcpSocket, ZMQ_REQ_RELAXED, &relaxed, sizeof(int));
+        zmq_setsockopt(tcpSocket, ZMQ_REQ_CORRELATE, &relaxed, sizeof(int));
 
-    int ret = zmq_connect(this->tcpSocket, this->requestAddress.c_str());
-    if (ret < 0) {
-        logError("CommClient: Failed to connect to TCP router");
-        return false;
+        // set identity
+        const auto now = Communication::getTimeInMillis();
+        const auto rnd = Communication::getRandomUint32();
+        const auto id = "REQ" + std::to_string(now) + std::to_string(rnd);
+
+        zmq_setsockopt (tcpSocket, ZMQ_IDENTITY, id.c_str(), id.size());
+
+        int ret = zmq_connect(tcpSocket, address.c_str());
+        if (ret < 0) {
+            zmq_close(tcpSocket);
+            logError("CommClient: Failed to connect to TCP router at " + address);
+            return false;
+        }
+
+        this->tcpSockets.emplace_back(tcpSocket);
     }
 
-    logInfo("CommClient: Connected to TCP router");
+    logInfo("CommClient: Connected to TCP router(s)");
 
     return true;
 }
@@ -76,7 +110,12 @@ bool CommClient::startBroadcastListener(std::function<void(void *)> messageHandl
             return;
         }
 
-        zmq_join(dish, "broadcast");
+        {
+            const std::lock_guard<std::mutex> lock(this->groupMutex);
+
+            for (const auto & g : this->groups) zmq_join(dish, g.c_str());
+            this->broadcastDish = dish;
+        }
 
         logInfo("Listening to broadcast traffic at: " + this->broadcastAddress);
 
@@ -96,6 +135,11 @@ bool CommClient::startBroadcastListener(std::function<void(void *)> messageHandl
 
         logInfo("Stopped listening to broadcast traffic.");
 
+        {
+            const std::lock_guard<std::mutex> lock(this->groupMutex);
+            this->broadcastDish = nullptr;
+        }
+
         zmq_close(dish);
         zmq_ctx_term(ctx);
     });
@@ -105,68 +149,214 @@ bool CommClient::startBroadcastListener(std::function<void(void *)> messageHandl
     return this->running;
 }
 
-void CommClient::sendBlocking(std::shared_ptr<flatbuffers::FlatBufferBuilder> & message, const std::function<void (void*)> & callback)
+/**
+ *  Sends a copy of the message to every shard, the sockets that took it are to be polled for their reply.
+ *  Returns false if any shard could not be sent to
+ */
+bool CommClient::sendToAllShards(const void * data, const size_t size, std::vector<zmq_pollitem_t> & pendingReplies)
 {
-    zmq_msg_t msg;
-    int size = message->GetSize();
-
-    void * dataToBeSentCloned = malloc(size);
-    memcpy(dataToBeSentCloned, message->GetBufferPointer(), size);
-
-    auto freeFn = [](void * s, void * h) {
+    auto freeFn = [](void * s, void * /* hint */) {
         if (s != nullptr) free(s);
     };
 
-    zmq_msg_init_data (&msg, dataToBeSentCloned, size, freeFn, NULL);
-    zmq_sendmsg(this->tcpSocket, &msg, ZMQ_DONTWAIT);
-    /*
-    const auto ret = zmq_sendmsg(this->tcpSocket, &msg, ZMQ_DONTWAIT);
-    if (ret < 0) {
-        callback(nullptr);
-        zmq_msg_close (&msg);
-        return;
-    }*/
+    pendingReplies.clear();
+    for (auto & tcpSocket : this->tcpSockets) {
+        void * dataToBeSentCloned = malloc(size);
+        memcpy(dataToBeSentCloned, data, size);
 
-    // wait for reply (for ack)
-    zmq_msg_t recv_msg;
-    zmq_msg_init (&recv_msg);
-    size = zmq_recvmsg (this->tcpSocket, &recv_msg, 0);
-    if (size < 0) {
-        callback(nullptr);
-        zmq_msg_close (&msg);
+        zmq_msg_t msg;
+        zmq_msg_init_data (&msg, dataToBeSentCloned, size, freeFn, NULL);
+        if (zmq_sendmsg(tcpSocket, &msg, ZMQ_DONTWAIT) < 0) {
+            zmq_msg_close (&msg);
+            continue;
+        }
+
+        pendingReplies.push_back({ tcpSocket, 0, ZMQ_POLLIN, 0 });
+    }
+
+    return pendingReplies.size() == this->tcpSockets.size();
+}
+
+/**
+ *  Receives the replies that came in within the timeout (in millis), the first one is handed out if asked for.
+ *  Returns false if receiving failed, polling failing gives up on the replies still pending
+ */
+bool CommClient::receiveReplies(std::vector<zmq_pollitem_t> & pendingReplies, size_t & numberOfPendingReplies, const long timeout, void ** firstReply)
+{
+    if (zmq_poll(pendingReplies.data(), pendingReplies.size(), timeout) < 0) {
+        numberOfPendingReplies = 0;
+        return false;
+    }
+
+    bool failed = false;
+    for (auto & p : pendingReplies) {
+        if ((p.revents & ZMQ_POLLIN) == 0) continue;
+
+        // wait for reply (for ack)
+        zmq_msg_t recv_msg;
+        zmq_msg_init (&recv_msg);
+        const int received = zmq_recvmsg (p.socket, &recv_msg, 0);
+        if (received < 0) {
+            failed = true;
+        } else if (firstReply != nullptr && *firstReply == nullptr) {
+            *firstReply = malloc(received);
+            memcpy(*firstReply, zmq_msg_data(&recv_msg), received);
+        }
         zmq_msg_close(&recv_msg);
-        return;
+
+        // replied sockets are no longer polled
+        p.events = 0;
+        p.revents = 0;
+        numberOfPendingReplies--;
     }
 
-    void * dataReceived = zmq_msg_data(&recv_msg);
-    void * dataReceivedCloned = malloc(size);
-    memcpy(dataReceivedCloned, dataReceived, size);
-    zmq_msg_close(&recv_msg);
-    callback(dataReceivedCloned);
+    return !failed;
+}
 
-    zmq_msg_close (&msg);
+/**
+ *  Sends the message to every shard first and then collects the replies as they come in,
+ *  so that the round trips overlap instead of adding up. Each shard deals with the objects of its region.
+ *  Returns false if any shard failed to reply, the first reply is handed out if asked for
+ */
+bool CommClient::sendToShards(const void * data, const size_t size, void ** firstReply)
+{
+    std::vector<zmq_pollitem_t> pendingReplies;
+    bool failed = !this->sendToAllShards(data, size, pendingReplies);
+
+    size_t numberOfPendingReplies = pendingReplies.size();
+    const uint64_t deadline = Communication::getTimeInMillis() + REQUEST_REPLY_TIMEOUT;
+
+    while (numberOfPendingReplies > 0) {
+        const uint64_t now = Communication::getTimeInMillis();
+        if (now >= deadline) {
+            failed = true;
+            break;
+        }
+
+        if (!this->receiveReplies(pendingReplies, numberOfPendingReplies, static_cast<long>(deadline - now), firstReply)) failed = true;
+    }
+
+    return !failed;
+}
+
+void CommClient::sendBlocking(std::shared_ptr<flatbuffers::FlatBufferBuilder> & message, const std::function<void (void*)> & callback)
+{
+    const ScopedTimer timer("comm.request_roundtrip");
+    Metrics::INSTANCE()->recordValue("comm.request_bytes", message->GetSize());
+
+    // the callback is handed the first reply or nullptr if any shard failed to reply
+    void * reply = nullptr;
+    if (!this->sendToShards(message->GetBufferPointer(), message->GetSize(), &reply) || reply == nullptr) {
+        if (reply != nullptr) free(reply);
+        callback(nullptr);
+        return;
+    }
+
+    callback(reply);
 }
 
 void CommClient::sendBlockingWithoutAck(void * data, const size_t size) {
-    zmq_msg_t msg;
-    zmq_msg_init_data (&msg, data, size, NULL, NULL);
-    zmq_sendmsg(this->tcpSocket, &msg, ZMQ_DONTWAIT);
+    this->sendToShards(data, size);
+}
 
-    // wait for reply (for ack)
-    zmq_msg_t recv_msg;
-    zmq_msg_init (&recv_msg);
-    zmq_recvmsg (this->tcpSocket, &recv_msg, 0);
+/**
+ *  Queues the message behind the ones queued earlier and returns right away.
+ *  pollAsyncRequests (to be called regularly by the same thread) sends and collects the replies,
+ *  the callback is handed the first reply or nullptr if any shard failed to reply
+ */
+void CommClient::sendAsync(std::shared_ptr<flatbuffers::FlatBufferBuilder> & message, const std::function<void (void*)> & callback)
+{
+    const uint8_t * data = message->GetBufferPointer();
+    this->asyncRequests.push_back({ std::vector<uint8_t>(data, data + message->GetSize()), callback });
 
-    zmq_msg_close(&recv_msg);
-    zmq_msg_close (&msg);
+    this->pollAsyncRequests();
+}
+
+void CommClient::pollAsyncRequests()
+{
+    while (!this->asyncRequests.empty()) {
+        auto & request = this->asyncRequests.front();
+
+        if (!this->asyncInFlight) {
+            Metrics::INSTANCE()->recordValue("comm.request_bytes", request.data.size());
+
+            this->asyncFailed = !this->sendToAllShards(request.data.data(), request.data.size(), this->asyncPendingReplies);
+            this->asyncNumberOfPendingReplies = this->asyncPendingReplies.size();
+            this->asyncDeadline = Communication::getTimeInMillis() + REQUEST_REPLY_TIMEOUT;
+            this->asyncInFlight = true;
+        }
+
+        if (this->asyncNumberOfPendingReplies > 0) {
+            if (Communication::getTimeInMillis() >= this->asyncDeadline) {
+                this->asyncFailed = true;
+            } else {
+                if (!this->receiveReplies(this->asyncPendingReplies, this->asyncNumberOfPendingReplies, 0, &this->asyncReply)) this->asyncFailed = true;
+                if (this->asyncNumberOfPendingReplies > 0) return;
+            }
+        }
+
+        void * reply = this->asyncReply;
+        this->asyncReply = nullptr;
+        this->asyncInFlight = false;
+        if (this->asyncFailed && reply != nullptr) {
+            free(reply);
+            reply = nullptr;
+        }
+
+        const auto callback = request.callback;
+        this->asyncRequests.pop_front();
+        callback(reply);
+    }
+}
+
+void CommClient::joinGroup(const std::string & group)
+{
+    const std::lock_guard<std::mutex> lock(this->groupMutex);
+
+    if (!this->groups.emplace(group).second) return;
+
+    // dish sockets are thread safe, joins before the listener is up are done by the listener
+    if (this->broadcastDish != nullptr) zmq_join(this->broadcastDish, group.c_str());
+}
+
+std::vector<std::string> CommClient::getGroups()
+{
+    const std::lock_guard<std::mutex> lock(this->groupMutex);
+
+    return std::vector<std::string>(this->groups.begin(), this->groups.end());
+}
+
+const std::string & CommClient::getReplyGroup() const
+{
+    return this->replyGroup;
+}
+
+void CommClient::leaveGroup(const std::string & group)
+{
+    if (group == BROADCAST_GROUP || group == this->replyGroup) return;
+
+    const std::lock_guard<std::mutex> lock(this->groupMutex);
+
+    if (this->groups.erase(group) == 0) return;
+
+    if (this->broadcastDish != nullptr) zmq_leave(this->broadcastDish, group.c_str());
 }
 
 void CommClient::stop()
 {
     if (!this->running) return;
 
-    if (this->tcpSocket != nullptr) zmq_close(this->tcpSocket);
+    if (this->asyncReply != nullptr) free(this->asyncReply);
+    this->asyncReply = nullptr;
+    this->asyncRequests.clear();
+    this->asyncPendingReplies.clear();
+    this->asyncNumberOfPendingReplies = 0;
+    this->asyncInFlight = false;
+
+    for (auto & tcpSocket : this->tcpSockets) zmq_close(tcpSocket);
+    this->tcpSockets.clear();
     if (this->tcpContext != nullptr) zmq_ctx_term(this->tcpContext);
+    this->tcpContext = nullptr;
 
     logInfo("Shutting down CommClient ...");
 
@@ -253,6 +443,9 @@ bool CommServer::startRequestListener(std::function<void(void *)> messageHandler
                 // read actual message
                 size = zmq_recvmsg (this->requestListener, &recv_msg, 0);
                 if (size > 0) {
+                    Metrics::INSTANCE()->incrementCounter("comm.requests_received");
+                    Metrics::INSTANCE()->recordValue("comm.received_bytes", size);
+
                     void * dataReceived = zmq_msg_data(&recv_msg);
                     void * dataCloned = malloc(size);
                     memcpy(dataCloned, dataReceived, size);
@@ -290,11 +483,16 @@ bool CommServer::startRequestListener(std::function<void(void *)> messageHandler
     return true;
 }
 
-void CommServer::sendBlocking(std::shared_ptr<flatbuffers::FlatBufferBuilder> & message)
+void CommServer::sendBlocking(std::shared_ptr<flatbuffers::FlatBufferBuilder> & message, const std::string & group)
 {
+    const ScopedTimer timer("comm.broadcast_send");
+
     zmq_msg_t msg;
     const int size = message->GetSize();
 
+    Metrics::INSTANCE()->incrementCounter("comm.broadcasts_sent");
+    Metrics::INSTANCE()->recordValue("comm.broadcast_bytes", size);
+
     void * clonedData = malloc(size);
     memcpy(clonedData, message->GetBufferPointer(), size);
 
@@ -303,17 +501,17 @@ void CommServer::sendBlocking(std::shared_ptr<flatbuffers::FlatBufferBuilder> &
     };
 
     zmq_msg_init_data(&msg, clonedData, size, freeFn, NULL);
-    zmq_msg_set_group(&msg, "broadcast");
+    zmq_msg_set_group(&msg, group.c_str());
     zmq_sendmsg(this->broadcastRadio, &msg, ZMQ_DONTWAIT);
 
     zmq_msg_close (&msg);
 }
 
-void CommServer::send(std::shared_ptr<flatbuffers::FlatBufferBuilder> & message)
+void CommServer::send(std::shared_ptr<flatbuffers::FlatBufferBuilder> & message, const std::string & group)
 {
     if (!this->running) return;
 
-    this->sendBlocking(message);
+    this->sendBlocking(message, group);
 }
 
 void CommServer::stop()
@@ -330,14 +528,20 @@ void CommServer::stop()
 
 void CommCenter::queueMessages(void * message)
 {
+    const std::lock_guard<std::mutex> lock(this->messagesMutex);
+
     this->messages.emplace(message);
+
+    Metrics::INSTANCE()->setGauge("comm.queue_depth", this->messages.size());
 }
 
 void * CommCenter::getNextMessage()
 {
+    const std::lock_guard<std::mutex> lock(this->messagesMutex);
+
     if (this->messages.empty()) return nullptr;
 
-    const auto & ret = this->messages.front();
+    const auto ret = this->messages.front();
     this->messages.pop();
 
     return ret;
@@ -484,6 +688,18 @@ void CommCenter::addObjectPropertiesUpdateRequest(CommBuilder& builder, const st
     builder.messages.push_back(update.Union());
 }
 
+void CommCenter::addInterestUpdateRequest(CommBuilder & builder, const std::string & replyGroup, const std::vector<std::string> & cells)
+{
+    // the reply group leads, the server sends the snapshot of the cells there
+    std::vector<std::string> groups = { replyGroup };
+    groups.insert(groups.end(), cells.begin(), cells.end());
+
+    const auto interest = CreateInterestUpdateRequest(*builder.builder, builder.builder->CreateVectorOfStrings(groups));
+
+    builder.messageTypes.push_back(MessageUnion_InterestUpdateRequest);
+    builder.messages.push_back(interest.Union());
+}
+
 
 std::default_random_engine Communication::default_random_engine = std::default_random_engine();
 std::uniform_int_distribution<int> Communication::distribution(1,10);
@@ -34,9 +34,19 @@ bool CullPipeline::initPipeline(const PipelineConfig & config) {
         return false;
     }
 
+    if (!this->createVisibilityBuffers()) {
+        logError("Failed to create Cull Pipeline Visibility Buffers");
+        return false;
+    }
+
+    if (!this->createBatchBuffers()) {
+        logError("Failed to create Cull Pipeline Batch Buffers");
+        return false;
+    }
+
     this->pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
     this->pushConstantRange.offset = 0;
-    this->pushConstantRange.size = sizeof(uint32_t);
+    this->pushConstantRange.size = sizeof(CullPushConstants);
 
     if (!this->createDescriptorPool()) {
         logError("Failed to create Cull Pipeline Descriptor Pool");
@@ -59,13 +69,18 @@ bool CullPipeline::createPipeline()
 bool CullPipeline::createDescriptorPool() {
     if (this->renderer == nullptr || !this->renderer->isReady() || this->descriptorPool.isInitialized()) return false;
 
-    const uint32_t count = this->renderer->getImageCount();
+    const uint32_t count = this->renderer->getFramesInFlight();
 
     this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, count);
     this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
     this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
     this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
     this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
+    this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
+    this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, count);
+    this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
+    this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
+    this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
 
     this->descriptorPool.createPool(this->renderer->getLogicalDevice(), count);
 
@@ -83,35 +98,58 @@ bool CullPipeline::createDescriptors() {
     this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
     this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
     this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+    this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+    this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+    this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+    this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+    this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
 
-    this->descriptors.create(this->renderer->getLogicalDevice(), this->descriptorPool.getPool(), this->renderer->getImageCount());
+    this->descriptors.create(this->renderer->getLogicalDevice(), this->descriptorPool.getPool(), this->renderer->getFramesInFlight());
 
     if (!this->descriptors.isInitialized()) return false;
 
-    const VkDescriptorBufferInfo & indirectDrawInfo = this->renderer->getIndirectDrawBuffer(this->indirectBufferIndex).getDescriptorInfo();
-    const VkDescriptorBufferInfo & indirectDrawCountInfo = this->renderer->getIndirectDrawCountBuffer(this->indirectBufferIndex).getDescriptorInfo();
     const VkDescriptorBufferInfo & componentsDrawInfo = this->computeBuffer.getDescriptorInfo();
 
-    VkDescriptorBufferInfo instanceDataInfo;
+    GraphicsPipeline * linkedPipeline = nullptr;
 
     if (this->linkedGraphicsPipeline.has_value()) {
-        if (!std::visit([&instanceDataInfo](auto&& arg) -> bool {
-            instanceDataInfo = static_cast<GraphicsPipeline *>(arg)->getInstanceDataDescriptorInfo();
+        if (!std::visit([&linkedPipeline](auto&& arg) -> bool {
+            linkedPipeline = static_cast<GraphicsPipeline *>(arg);
             return true;
         }, this->linkedGraphicsPipeline.value()))
 
         return false;
     }
 
+    // the pyramid is bound no matter whether occlusion culling is on, the shader skips it otherwise
+    const DepthPyramidPipeline * depthPyramid = this->renderer->getDepthPyramidPipeline();
+    if (depthPyramid == nullptr) {
+        logError("Pipeline " + this->name + " requires a depth pyramid");
+        return false;
+    }
+
     const uint32_t descSize = this->descriptors.getDescriptorSets().size();
     for (size_t i = 0; i < descSize; i++) {
         const VkDescriptorBufferInfo & uniformBufferInfo = this->renderer->getUniformComputeBuffer(i).getDescriptorInfo();
+        const VkDescriptorBufferInfo & indirectDrawInfo = this->renderer->getIndirectDrawBuffer(this->indirectBufferIndex, i).getDescriptorInfo();
+        const VkDescriptorBufferInfo & indirectDrawCountInfo = this->renderer->getIndirectDrawCountBuffer(this->indirectBufferIndex, i).getDescriptorInfo();
+        const VkDescriptorBufferInfo instanceDataInfo = linkedPipeline != nullptr ? linkedPipeline->getInstanceDataDescriptorInfo(i) : VkDescriptorBufferInfo {};
+        const VkDescriptorBufferInfo & visibilityInfo = this->visibilityBuffers[i].getDescriptorInfo();
+        const VkDescriptorImageInfo & depthPyramidInfo = depthPyramid->getDescriptorInfo(i);
+        const VkDescriptorBufferInfo & batchInfo = this->batchBuffers[i].getDescriptorInfo();
+        const VkDescriptorBufferInfo & commandLodInfo = this->commandLodBuffers[i].getDescriptorInfo();
+        const VkDescriptorBufferInfo & indirectInstanceInfo = this->renderer->getIndirectInstanceBuffer(this->indirectBufferIndex, i).getDescriptorInfo();
 
         this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), 0, i, uniformBufferInfo);
         this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), 1, i, componentsDrawInfo);
         this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), 2, i, indirectDrawInfo);
         this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), 3, i, indirectDrawCountInfo);
         this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), 4, i, instanceDataInfo);
+        this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), 5, i, visibilityInfo);
+        this->descriptors.updateWriteDescriptorWithImageInfo(this->renderer->getLogicalDevice(), 6, i, { depthPyramidInfo });
+        this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), 7, i, batchInfo);
+        this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), 8, i, commandLodInfo);
+        this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), 9, i, indirectInstanceInfo);
     }
 
     return true;
@@ -158,356 +196,423 @@ bool CullPipeline::createComputeBuffer()
     return true;
 }
 
-template<typename T>
-void CullPipeline::updateComputeBuffer(T * pipeline) {}
-
-template<>
-void CullPipeline::updateComputeBuffer(TextureMeshPipeline * pipeline) {
-    const auto & renderables = pipeline->getRenderables();
-    if (renderables.size() <= this->instanceOffset) return;
+/**
+ *  A flag for every draw command the compute buffer has room for, zeroed so that nothing counts as visible to begin with
+ */
+bool CullPipeline::createVisibilityBuffers()
+{
+    if (this->renderer == nullptr || !this->renderer->isReady()) return false;
 
-    const VkDeviceSize drawCommandSize = sizeof(ColorMeshDrawCommand);
-    const VkDeviceSize maxSize = this->computeBuffer.getSize();
+    const bool isVertexMeshCulling = this->linkedGraphicsPipeline.has_value() && std::holds_alternative<VertexMeshPipeline *>(this->linkedGraphicsPipeline.value());
+    const VkDeviceSize drawCommandSize = isVertexMeshCulling ? sizeof(VertexMeshDrawCommand) : sizeof(ColorMeshDrawCommand);
+    const VkDeviceSize visibilitySize = (this->computeBuffer.getSize() / drawCommandSize) * sizeof(uint32_t);
 
-    std::vector<ColorMeshDrawCommand> drawCommands;
-    VkDeviceSize computeBufferContentSize = this->computeBuffer.getContentSize();
-    VkDeviceSize additionalDrawCommandSize = 0;
+    for (auto & b : this->visibilityBuffers) {
+        this->renderer->trackDeviceLocalMemory(b.getSize(), true);
+        b.destroy(this->renderer->getLogicalDevice());
+    }
+    this->visibilityBuffers = std::vector<Buffer>(this->renderer->getFramesInFlight());
 
-    for (uint32_t i=this->instanceOffset;i<renderables.size();i++) {
-        auto renderable = renderables[i];
+    const CommandPool & pool = this->renderer->getGraphicsCommandPool();
+    const VkCommandBuffer & commandBuffer = pool.beginPrimaryCommandBuffer(this->renderer->getLogicalDevice());
+    if (commandBuffer == nullptr) return false;
 
-        const VkDeviceSize additionalSize = renderable->getMeshes().size() * drawCommandSize;
-        if (computeBufferContentSize + additionalDrawCommandSize + additionalSize > maxSize) {
-            logError("Compute Buffer not big enough!");
+    bool success = true;
+    for (auto & b : this->visibilityBuffers) {
+        if (b.createDeviceLocalBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), visibilitySize) != VK_SUCCESS) {
+            logError("Allocation: Not enough device local space for visibility buffer!");
+            success = false;
             break;
         }
 
-        for (auto & m : renderable->getMeshes()) {
-            const ColorMeshDrawCommand drawCommand = {
-                static_cast<uint32_t>(m.indices.size()),
-                this->indexOffset, static_cast<int32_t>(this->vertexOffset),
-                this->instanceOffset, this->meshOffset
-
-            };
-            drawCommands.emplace_back(drawCommand);
-
-            this->vertexOffset += m.vertices.size();
-            this->indexOffset += m.indices.size();
-            this->meshOffset++;
-        }
-
-        additionalDrawCommandSize += additionalSize;
-        this->instanceOffset++;
+        this->renderer->trackDeviceLocalMemory(b.getSize());
+        vkCmdFillBuffer(commandBuffer, b.getBuffer(), 0, b.getSize(), 0);
     }
 
-    if (this->usesDeviceLocalComputeBuffer) {
-        Buffer stagingBuffer;
-        stagingBuffer.createStagingBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), additionalDrawCommandSize);
-        if (stagingBuffer.isInitialized()) {
-            stagingBuffer.updateContentSize(additionalDrawCommandSize);
-
-            memcpy(static_cast<char *>(stagingBuffer.getBufferData()), drawCommands.data(), additionalDrawCommandSize);
+    pool.endCommandBuffer(commandBuffer);
+    pool.submitCommandBuffer(this->renderer->getLogicalDevice(), this->renderer->getGraphicsQueue(), commandBuffer);
 
-            const CommandPool & pool = renderer->getGraphicsCommandPool();
-            const VkCommandBuffer & commandBuffer = pool.beginPrimaryCommandBuffer(renderer->getLogicalDevice());
+    return success;
+}
 
-            VkBufferCopy copyRegion {};
-            copyRegion.srcOffset = 0;
-            copyRegion.dstOffset = computeBufferContentSize;
-            copyRegion.size = additionalDrawCommandSize;
-            vkCmdCopyBuffer(commandBuffer, stagingBuffer.getBuffer(), this->computeBuffer.getBuffer(), 1, &copyRegion);
+/**
+ *  A counter for every batch and lod plus the running total of visible instances, and the lod of every draw command.
+ *  Both are reset or written by the cull passes before being read, so they are left uninitialized
+ */
+bool CullPipeline::createBatchBuffers()
+{
+    if (this->renderer == nullptr || !this->renderer->isReady()) return false;
 
-            pool.endCommandBuffer(commandBuffer);
-            pool.submitCommandBuffer(renderer->getLogicalDevice(), renderer->getComputeQueue(), commandBuffer);
+    const bool isVertexMeshCulling = this->linkedGraphicsPipeline.has_value() && std::holds_alternative<VertexMeshPipeline *>(this->linkedGraphicsPipeline.value());
+    const VkDeviceSize drawCommandSize = isVertexMeshCulling ? sizeof(VertexMeshDrawCommand) : sizeof(ColorMeshDrawCommand);
+    const VkDeviceSize maxDrawCommands = this->computeBuffer.getSize() / drawCommandSize;
 
-            stagingBuffer.destroy(this->renderer->getLogicalDevice());
+    for (auto & b : this->batchBuffers) {
+        this->renderer->trackDeviceLocalMemory(b.getSize(), true);
+        b.destroy(this->renderer->getLogicalDevice());
+    }
+    for (auto & b : this->commandLodBuffers) {
+        this->renderer->trackDeviceLocalMemory(b.getSize(), true);
+        b.destroy(this->renderer->getLogicalDevice());
+    }
+    this->batchBuffers = std::vector<Buffer>(this->renderer->getFramesInFlight());
+    this->commandLodBuffers = std::vector<Buffer>(this->renderer->getFramesInFlight());
+
+    for (uint16_t i=0;i<this->renderer->getFramesInFlight();i++) {
+        if (this->batchBuffers[i].createDeviceLocalBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), (1 + maxDrawCommands * MAX_MESH_LODS) * sizeof(uint32_t)) != VK_SUCCESS ||
+            this->commandLodBuffers[i].createDeviceLocalBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), maxDrawCommands * sizeof(uint32_t)) != VK_SUCCESS) {
+            logError("Allocation: Not enough device local space for batch buffers!");
+            return false;
         }
-    } else {
-        memcpy(static_cast<char *>(this->computeBuffer.getBufferData()) + computeBufferContentSize, drawCommands.data(), additionalDrawCommandSize);
+
+        this->renderer->trackDeviceLocalMemory(this->batchBuffers[i].getSize());
+        this->renderer->trackDeviceLocalMemory(this->commandLodBuffers[i].getSize());
     }
 
-    this->drawCount = this->meshOffset;
-    this->computeBuffer.updateContentSize(computeBufferContentSize + additionalDrawCommandSize);
-    this->renderer->setMaxIndirectCallCount(this->drawCount, this->indirectBufferIndex);
+    return true;
 }
 
-template<>
-void CullPipeline::updateComputeBuffer(ModelMeshPipeline * pipeline) {
-    const auto & renderables = pipeline->getRenderables();
-    if (renderables.size() <= this->instanceOffset) return;
+/**
+ *  Takes the lowest free slot or appends one, new slots start out invisible
+ */
+uint32_t CullPipeline::allocateSlot(const Renderable * renderable) {
+    uint32_t slot = this->slotOwners.size();
 
-    const VkDeviceSize drawCommandSize = sizeof(ColorMeshDrawCommand);
-    const VkDeviceSize maxSize = this->computeBuffer.getSize();
+    if (!this->freeSlots.empty()) {
+        slot = *this->freeSlots.begin();
+        this->freeSlots.erase(this->freeSlots.begin());
+        this->slotOwners[slot] = renderable;
+    } else this->slotOwners.emplace_back(renderable);
 
-    std::vector<ColorMeshDrawCommand> drawCommands;
-    VkDeviceSize computeBufferContentSize = this->computeBuffer.getContentSize();
-    VkDeviceSize additionalDrawCommandSize = 0;
+    this->dirtySlots.insert(slot);
+    this->addedSlots.insert(slot);
 
-    for (uint32_t i=this->instanceOffset;i<renderables.size();i++) {
-        auto renderable = renderables[i];
-
-        const VkDeviceSize additionalSize = renderable->getMeshes().size() * drawCommandSize;
-        if (computeBufferContentSize + additionalDrawCommandSize + additionalSize > maxSize) {
-            logError("Compute Buffer not big enough!");
-            break;
-        }
-
-        for (auto & m : renderable->getMeshes()) {
-            const ColorMeshDrawCommand drawCommand = {
-                static_cast<uint32_t>(m.indices.size()),
-                this->indexOffset, static_cast<int32_t>(this->vertexOffset),
-                this->instanceOffset, this->meshOffset
-
-            };
-            drawCommands.emplace_back(drawCommand);
-
-            this->vertexOffset += m.vertices.size();
-            this->indexOffset += m.indices.size();
-            this->meshOffset++;
-        }
+    return slot;
+}
 
-        additionalDrawCommandSize += additionalSize;
-        this->instanceOffset++;
+uint32_t CullPipeline::allocateBatch() {
+    if (this->freeBatches.empty()) {
+        this->batchReferences.emplace_back(0);
+        return this->batchReferences.size() - 1;
     }
 
-    if (this->usesDeviceLocalComputeBuffer) {
-        Buffer stagingBuffer;
-        stagingBuffer.createStagingBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), additionalDrawCommandSize);
-        if (stagingBuffer.isInitialized()) {
-            stagingBuffer.updateContentSize(additionalDrawCommandSize);
-
-            memcpy(static_cast<char *>(stagingBuffer.getBufferData()), drawCommands.data(), additionalDrawCommandSize);
+    const uint32_t batch = this->freeBatches.back();
+    this->freeBatches.pop_back();
 
-            const CommandPool & pool = renderer->getGraphicsCommandPool();
-            const VkCommandBuffer & commandBuffer = pool.beginPrimaryCommandBuffer(renderer->getLogicalDevice());
-
-            VkBufferCopy copyRegion {};
-            copyRegion.srcOffset = 0;
-            copyRegion.dstOffset = computeBufferContentSize;
-            copyRegion.size = additionalDrawCommandSize;
-            vkCmdCopyBuffer(commandBuffer, stagingBuffer.getBuffer(), this->computeBuffer.getBuffer(), 1, &copyRegion);
+    return batch;
+}
 
-            pool.endCommandBuffer(commandBuffer);
-            pool.submitCommandBuffer(renderer->getLogicalDevice(), renderer->getComputeQueue(), commandBuffer);
+void CullPipeline::releaseBatch(const uint32_t batch) {
+    if (batch >= this->batchReferences.size() || this->batchReferences[batch] == 0) return;
 
-            stagingBuffer.destroy(this->renderer->getLogicalDevice());
-        }
-    } else {
-        memcpy(static_cast<char *>(this->computeBuffer.getBufferData()) + computeBufferContentSize, drawCommands.data(), additionalDrawCommandSize);
-    }
-
-    this->drawCount = this->meshOffset;
-    this->computeBuffer.updateContentSize(computeBufferContentSize + additionalDrawCommandSize);
-    this->renderer->setMaxIndirectCallCount(this->drawCount, this->indirectBufferIndex);
+    this->batchReferences[batch]--;
+    if (this->batchReferences[batch] == 0) this->freeBatches.emplace_back(batch);
 }
 
-template<>
-void CullPipeline::updateComputeBuffer(AnimatedModelMeshPipeline * pipeline) {
-    const auto & renderables = pipeline->getRenderables();
-    if (renderables.size() <= this->instanceOffset) return;
+void CullPipeline::clearSlots() {
+    this->slotsByRenderable.clear();
+    this->slotOwners.clear();
+    this->freeSlots.clear();
+    this->dirtySlots.clear();
+    this->addedSlots.clear();
+    this->pendingDrawCommandCopies.clear();
+    this->pendingVisibilityCopies.clear();
+    this->drawCommands.clear();
+    this->vertexDrawCommands.clear();
+    this->sharedDrawCommands.clear();
+    this->batchReferences.clear();
+    this->freeBatches.clear();
+}
 
-    const VkDeviceSize drawCommandSize = sizeof(ColorMeshDrawCommand);
-    const VkDeviceSize maxSize = this->computeBuffer.getSize();
+/**
+ *  Renderables sharing the geometry of another copy its draw commands, they end up in the owner's batches.
+ *  Owners start a batch for every draw command
+ */
+template<typename R, typename C>
+void CullPipeline::addDrawCommands(MeshPipeline<R, C> * pipeline, const R * renderable, const uint32_t instance, std::vector<ColorMeshDrawCommand> & commands) {
+    const VkDeviceSize maxDrawCommands = this->computeBuffer.getSize() / sizeof(ColorMeshDrawCommand);
+    const VkDeviceSize usedSlots = this->slotOwners.size() - this->freeSlots.size();
 
     std::vector<ColorMeshDrawCommand> drawCommands;
-    VkDeviceSize computeBufferContentSize = this->computeBuffer.getContentSize();
-    VkDeviceSize additionalDrawCommandSize = 0;
 
-    for (uint32_t i=this->instanceOffset;i<renderables.size();i++) {
-        auto renderable = renderables[i];
+    // owners added again go back into their kept batches as well
+    const auto geometryOwner = renderable->getGeometryOwner();
+    const auto ownerDrawCommands = this->sharedDrawCommands.find(geometryOwner != nullptr ? geometryOwner : renderable);
+    if (ownerDrawCommands != this->sharedDrawCommands.end()) {
 
-        const VkDeviceSize additionalSize = renderable->getMeshes().size() * drawCommandSize;
-        if (computeBufferContentSize + additionalDrawCommandSize + additionalSize > maxSize) {
+        if (usedSlots + ownerDrawCommands->second.size() > maxDrawCommands) {
             logError("Compute Buffer not big enough!");
-            break;
+            return;
         }
 
-        for (auto & m : renderable->getMeshes()) {
-            const ColorMeshDrawCommand drawCommand = {
-                static_cast<uint32_t>(m.indices.size()),
-                this->indexOffset, static_cast<int32_t>(this->vertexOffset),
-                this->instanceOffset, this->meshOffset
-
-            };
-            drawCommands.emplace_back(drawCommand);
+        drawCommands = ownerDrawCommands->second;
+    } else if (geometryOwner != nullptr) {
+        logError("The geometry owner of a renderable has not been added to Pipeline " + this->name);
+        return;
+    } else {
+        VkDeviceSize drawCommandCount = 0;
+        for (auto & m : renderable->getMeshes()) drawCommandCount += this->getDrawCommandCount(m);
 
-            this->vertexOffset += m.vertices.size();
-            this->indexOffset += m.indices.size();
-            this->meshOffset++;
+        // batches can outlive their draw commands, shared ones, and can thus run out before the slots
+        const VkDeviceSize usedBatches = this->batchReferences.size() - this->freeBatches.size();
+        if (usedSlots + drawCommandCount > maxDrawCommands || usedBatches + drawCommandCount > maxDrawCommands) {
+            logError("Compute Buffer not big enough!");
+            return;
         }
 
-        additionalDrawCommandSize += additionalSize;
-        this->instanceOffset++;
-    }
-
-    if (this->usesDeviceLocalComputeBuffer) {
-        Buffer stagingBuffer;
-        stagingBuffer.createStagingBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), additionalDrawCommandSize);
-        if (stagingBuffer.isInitialized()) {
-            stagingBuffer.updateContentSize(additionalDrawCommandSize);
-
-            memcpy(static_cast<char *>(stagingBuffer.getBufferData()), drawCommands.data(), additionalDrawCommandSize);
+        MeshBufferOffsets offsets = pipeline->getMeshBufferOffsets(renderable);
+        for (auto & m : renderable->getMeshes()) this->addDrawCommand(m, offsets, drawCommands);
 
-            const CommandPool & pool = renderer->getGraphicsCommandPool();
-            const VkCommandBuffer & commandBuffer = pool.beginPrimaryCommandBuffer(renderer->getLogicalDevice());
-
-            VkBufferCopy copyRegion {};
-            copyRegion.srcOffset = 0;
-            copyRegion.dstOffset = computeBufferContentSize;
-            copyRegion.size = additionalDrawCommandSize;
-            vkCmdCopyBuffer(commandBuffer, stagingBuffer.getBuffer(), this->computeBuffer.getBuffer(), 1, &copyRegion);
-
-            pool.endCommandBuffer(commandBuffer);
-            pool.submitCommandBuffer(renderer->getLogicalDevice(), renderer->getComputeQueue(), commandBuffer);
-
-            stagingBuffer.destroy(this->renderer->getLogicalDevice());
+        if (renderable->isGeometryShareable()) {
+            for (const auto & d : drawCommands) this->batchReferences[d.batch]++;
+            this->sharedDrawCommands[renderable] = drawCommands;
         }
-    } else {
-        memcpy(static_cast<char *>(this->computeBuffer.getBufferData()) + computeBufferContentSize, drawCommands.data(), additionalDrawCommandSize);
     }
 
-    this->drawCount = this->meshOffset;
-    this->computeBuffer.updateContentSize(computeBufferContentSize + additionalDrawCommandSize);
-    this->renderer->setMaxIndirectCallCount(this->drawCount, this->indirectBufferIndex);
-}
+    std::vector<uint32_t> & slots = this->slotsByRenderable[renderable];
+    for (ColorMeshDrawCommand & d : drawCommands) {
+        d.firstInstance = instance;
+        this->batchReferences[d.batch]++;
 
-template<>
-void CullPipeline::updateComputeBuffer(ColorMeshPipeline * pipeline) {
-    const auto & renderables = pipeline->getRenderables();
-    if (renderables.size() <= this->instanceOffset) return;
+        const uint32_t slot = this->allocateSlot(renderable);
+        if (slot >= commands.size()) commands.resize(slot + 1);
+        commands[slot] = d;
+        slots.emplace_back(slot);
+    }
+}
 
-    const VkDeviceSize drawCommandSize = sizeof(ColorMeshDrawCommand);
-    const VkDeviceSize maxSize = this->computeBuffer.getSize();
+void CullPipeline::addDrawCommands(VertexMeshPipeline0 * pipeline, const VertexMeshRenderable * renderable, const uint32_t instance, std::vector<VertexMeshDrawCommand> & commands) {
+    const VkDeviceSize maxDrawCommands = this->computeBuffer.getSize() / sizeof(VertexMeshDrawCommand);
+    if (this->slotOwners.size() - this->freeSlots.size() + renderable->getMeshes().size() > maxDrawCommands) {
+        logError("Compute Buffer not big enough!");
+        return;
+    }
 
-    std::vector<ColorMeshDrawCommand> drawCommands;
-    VkDeviceSize computeBufferContentSize = this->computeBuffer.getContentSize();
-    VkDeviceSize additionalDrawCommandSize = 0;
+    MeshBufferOffsets offsets = pipeline->getMeshBufferOffsets(renderable);
+
+    std::vector<uint32_t> & slots = this->slotsByRenderable[renderable];
+    for (auto & m : renderable->getMeshes()) {
+        const uint32_t slot = this->allocateSlot(renderable);
+        if (slot >= commands.size()) commands.resize(slot + 1);
+        commands[slot] = {
+            static_cast<uint32_t>(m.vertices.size()),
+            static_cast<uint32_t>(offsets.vertexOffset),
+            instance,
+            offsets.firstMesh
+        };
+        slots.emplace_back(slot);
+
+        offsets.vertexOffset += m.vertices.size();
+        offsets.firstMesh++;
+    }
+}
 
-    for (uint32_t i=this->instanceOffset;i<renderables.size();i++) {
-        auto renderable = renderables[i];
+template<typename M>
+void CullPipeline::addDrawCommand(const M & mesh, MeshBufferOffsets & offsets, std::vector<ColorMeshDrawCommand> & drawCommands) {
+    ColorMeshDrawCommand drawCommand {};
+    drawCommand.vertexOffset = static_cast<int32_t>(offsets.vertexOffset);
+    drawCommand.meshInstance = offsets.firstMesh;
+
+    // the lod index ranges follow the full resolution ones, see appendIndicesWithLods
+    drawCommand.indexCount[0] = mesh.indices.size();
+    drawCommand.indexOffset[0] = offsets.indexOffset;
+    drawCommand.lodCount = 1;
+    uint32_t lodIndexOffset = offsets.indexOffset + mesh.indices.size();
+    for (const auto & lod : mesh.lods) {
+        if (drawCommand.lodCount >= MAX_MESH_LODS) break;
+
+        drawCommand.indexCount[drawCommand.lodCount] = lod.size();
+        drawCommand.indexOffset[drawCommand.lodCount] = lodIndexOffset;
+        drawCommand.lodCount++;
+        lodIndexOffset += lod.size();
+    }
 
-        const VkDeviceSize additionalSize = renderable->getMeshes().size() * drawCommandSize;
-        if (computeBufferContentSize + additionalDrawCommandSize + additionalSize > maxSize) {
-            logError("Compute Buffer not big enough!");
-            break;
+    if (mesh.clusters.empty()) {
+        drawCommand.batch = this->allocateBatch();
+        drawCommands.emplace_back(drawCommand);
+    } else {
+        // the clusters are culled on their own at full resolution, the lods are drawn for the mesh as a whole
+        for (const auto & c : mesh.clusters) {
+            ColorMeshDrawCommand clusterDrawCommand = drawCommand;
+            std::fill(std::begin(clusterDrawCommand.indexCount), std::end(clusterDrawCommand.indexCount), 0);
+            clusterDrawCommand.indexCount[0] = c.indexCount;
+            clusterDrawCommand.indexOffset[0] = offsets.indexOffset + c.indexOffset;
+            clusterDrawCommand.clusterSphere = glm::vec4(c.center, c.radius);
+            clusterDrawCommand.clusterCone = glm::vec4(c.coneAxis, c.coneCutoff);
+            clusterDrawCommand.batch = this->allocateBatch();
+            drawCommands.emplace_back(clusterDrawCommand);
         }
 
-        for (auto & m : renderable->getMeshes()) {
-            const ColorMeshDrawCommand drawCommand = {
-                static_cast<uint32_t>(m.indices.size()),
-                this->indexOffset, static_cast<int32_t>(this->vertexOffset),
-                this->instanceOffset, this->meshOffset
-
-            };
+        if (drawCommand.lodCount > 1) {
+            drawCommand.indexCount[0] = 0;
+            drawCommand.batch = this->allocateBatch();
             drawCommands.emplace_back(drawCommand);
-
-            this->vertexOffset += m.vertices.size();
-            this->indexOffset += m.indices.size();
-            this->meshOffset++;
         }
-
-        additionalDrawCommandSize += additionalSize;
-        this->instanceOffset++;
     }
 
-    if (this->usesDeviceLocalComputeBuffer) {
-        Buffer stagingBuffer;
-        stagingBuffer.createStagingBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), additionalDrawCommandSize);
-        if (stagingBuffer.isInitialized()) {
-            stagingBuffer.updateContentSize(additionalDrawCommandSize);
-
-            memcpy(static_cast<char *>(stagingBuffer.getBufferData()), drawCommands.data(), additionalDrawCommandSize);
+    offsets.vertexOffset += mesh.vertices.size();
+    offsets.indexOffset += getIndexCountWithLods(mesh);
+    offsets.firstMesh++;
+}
 
-            const CommandPool & pool = renderer->getGraphicsCommandPool();
-            const VkCommandBuffer & commandBuffer = pool.beginPrimaryCommandBuffer(renderer->getLogicalDevice());
+template<typename M>
+uint32_t CullPipeline::getDrawCommandCount(const M & mesh) {
+    if (mesh.clusters.empty()) return 1;
 
-            VkBufferCopy copyRegion {};
-            copyRegion.srcOffset = 0;
-            copyRegion.dstOffset = computeBufferContentSize;
-            copyRegion.size = additionalDrawCommandSize;
-            vkCmdCopyBuffer(commandBuffer, stagingBuffer.getBuffer(), this->computeBuffer.getBuffer(), 1, &copyRegion);
+    return mesh.clusters.size() + (mesh.lods.empty() ? 0 : 1);
+}
 
-            pool.endCommandBuffer(commandBuffer);
-            pool.submitCommandBuffer(renderer->getLogicalDevice(), renderer->getComputeQueue(), commandBuffer);
+template<typename D>
+void CullPipeline::moveDrawCommands(const Renderable * renderable, const uint32_t instance, std::vector<D> & commands) {
+    const auto slots = this->slotsByRenderable.find(renderable);
+    if (slots == this->slotsByRenderable.end()) return;
 
-            stagingBuffer.destroy(this->renderer->getLogicalDevice());
-        }
-    } else {
-        memcpy(static_cast<char *>(this->computeBuffer.getBufferData()) + computeBufferContentSize, drawCommands.data(), additionalDrawCommandSize);
+    for (const uint32_t slot : slots->second) {
+        commands[slot].firstInstance = instance;
+        this->dirtySlots.insert(slot);
     }
-
-    this->drawCount = this->meshOffset;
-    this->computeBuffer.updateContentSize(computeBufferContentSize + additionalDrawCommandSize);
-    this->renderer->setMaxIndirectCallCount(this->drawCount, this->indirectBufferIndex);
 }
 
-template<>
-void CullPipeline::updateComputeBuffer(VertexMeshPipeline * pipeline) {
-    const auto & renderables = pipeline->getRenderables();
-    if (renderables.size() <= this->instanceOffset) return;
+/**
+ *  Freed slots hold an empty draw command which the cull shaders skip
+ */
+template<typename D>
+void CullPipeline::removeDrawCommands(const Renderable * renderable, std::vector<D> & commands) {
+    const auto slots = this->slotsByRenderable.find(renderable);
+    if (slots == this->slotsByRenderable.end()) return;
+
+    for (const uint32_t slot : slots->second) {
+        if constexpr (std::is_same_v<D, ColorMeshDrawCommand>) this->releaseBatch(commands[slot].batch);
+
+        commands[slot] = {};
+        this->slotOwners[slot] = nullptr;
+        this->freeSlots.insert(slot);
+        this->dirtySlots.insert(slot);
+    }
 
-    const VkDeviceSize drawCommandSize = sizeof(VertexMeshDrawCommand);
-    const VkDeviceSize maxSize = this->computeBuffer.getSize();
+    this->slotsByRenderable.erase(slots);
+}
 
-    std::vector<VertexMeshDrawCommand> drawCommands;
-    VkDeviceSize computeBufferContentSize = this->computeBuffer.getContentSize();
-    VkDeviceSize additionalDrawCommandSize = 0;
+template<typename D>
+void CullPipeline::trimSlots(std::vector<D> & commands) {
+    while (!this->slotOwners.empty() && this->slotOwners.back() == nullptr) {
+        const uint32_t slot = this->slotOwners.size() - 1;
+        this->freeSlots.erase(slot);
+        this->dirtySlots.erase(slot);
+        this->addedSlots.erase(slot);
+        this->slotOwners.pop_back();
+    }
 
-    for (uint32_t i=this->instanceOffset;i<renderables.size();i++) {
-        auto renderable = renderables[i];
+    commands.resize(this->slotOwners.size());
+}
 
-        const VkDeviceSize additionalSize = renderable->getMeshes().size() * drawCommandSize;
-        if (computeBufferContentSize + additionalDrawCommandSize + additionalSize > maxSize) {
-            logError("Compute Buffer not big enough!");
-            break;
+/**
+ *  Drops the free slots at the end and, once too many are left in between, moves the last draw commands into them
+ *  so that the dispatch covers no more than the live ones. Changed draw commands are queued for upload,
+ *  the moves (for device local compute buffers) and the visibility resets are recorded with the next compute commands.
+ *  Either waits for the frames in flight, slots they read might be rewritten
+ */
+template<typename D>
+void CullPipeline::commitSlots(std::vector<D> & commands) {
+    this->trimSlots(commands);
+
+    const VkDeviceSize drawCommandSize = sizeof(D);
+
+    // moves still to be recorded cannot be moved again
+    const bool hasPendingCopies = !this->pendingDrawCommandCopies.empty() || !this->pendingVisibilityCopies.empty();
+    if (!hasPendingCopies && !this->freeSlots.empty() && this->freeSlots.size() > CULL_SLOT_COMPACTION_RATIO * this->slotOwners.size()) {
+        while (!this->freeSlots.empty()) {
+            const uint32_t to = *this->freeSlots.begin();
+            const uint32_t from = this->slotOwners.size() - 1;
+            this->freeSlots.erase(this->freeSlots.begin());
+
+            const Renderable * owner = this->slotOwners[from];
+            std::vector<uint32_t> & slots = this->slotsByRenderable[owner];
+            std::replace(slots.begin(), slots.end(), from, to);
+
+            this->slotOwners[to] = owner;
+            commands[to] = commands[from];
+
+            // uploads land ahead of the copies, so changed draw commands are uploaded into their new slot instead
+            if (this->dirtySlots.erase(from) > 0 || !this->usesDeviceLocalComputeBuffer) {
+                this->dirtySlots.insert(to);
+            } else {
+                this->dirtySlots.erase(to);
+                this->pendingDrawCommandCopies.push_back({ from * drawCommandSize, to * drawCommandSize, drawCommandSize });
+            }
+
+            if (this->addedSlots.erase(from) > 0) {
+                this->addedSlots.insert(to);
+            } else {
+                this->addedSlots.erase(to);
+                this->pendingVisibilityCopies.push_back({ from * sizeof(uint32_t), to * sizeof(uint32_t), sizeof(uint32_t) });
+            }
+
+            this->slotOwners[from] = nullptr;
+            this->trimSlots(commands);
         }
+    }
 
-        for (auto & m : renderable->getMeshes()) {
-            const VertexMeshDrawCommand drawCommand = {
-                static_cast<uint32_t>(m.vertices.size()),
-                this->vertexOffset,
-                this->instanceOffset,
-                this->meshOffset
-            };
-            drawCommands.emplace_back(drawCommand);
-
-            this->vertexOffset += m.vertices.size();
-            this->meshOffset++;
+    // consecutive slots go into one upload
+    uint32_t runStart = 0;
+    uint32_t runLength = 0;
+    const auto uploadRun = [this, &commands, drawCommandSize, &runStart, &runLength]() {
+        if (runLength == 0) return;
+        this->renderer->getUploadManager().uploadBuffer(this->computeBuffer, runStart * drawCommandSize, commands.data() + runStart, runLength * drawCommandSize, true);
+        runLength = 0;
+    };
+
+    for (const uint32_t slot : this->dirtySlots) {
+        if (runLength > 0 && runStart + runLength == slot) {
+            runLength++;
+            continue;
         }
 
-        additionalDrawCommandSize += additionalSize;
-        this->instanceOffset++;
+        uploadRun();
+        runStart = slot;
+        runLength = 1;
     }
+    uploadRun();
 
-    if (this->usesDeviceLocalComputeBuffer) {
-        Buffer stagingBuffer;
-        stagingBuffer.createStagingBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), additionalDrawCommandSize);
-        if (stagingBuffer.isInitialized()) {
-            stagingBuffer.updateContentSize(additionalDrawCommandSize);
-
-            memcpy(static_cast<char *>(stagingBuffer.getBufferData()), drawCommands.data(), additionalDrawCommandSize);
-
-            const CommandPool & pool = renderer->getGraphicsCommandPool();
-            const VkCommandBuffer & commandBuffer = pool.beginPrimaryCommandBuffer(renderer->getLogicalDevice());
+    this->dirtySlots.clear();
+    this->computeBuffer.updateContentSize(commands.size() * drawCommandSize);
 
-            VkBufferCopy copyRegion {};
-            copyRegion.srcOffset = 0;
-            copyRegion.dstOffset = computeBufferContentSize;
-            copyRegion.size = additionalDrawCommandSize;
-            vkCmdCopyBuffer(commandBuffer, stagingBuffer.getBuffer(), this->computeBuffer.getBuffer(), 1, &copyRegion);
+    // the batch count is recorded into the command buffers along with the draw count, as are the pending changes
+    if (this->batchCount != this->batchReferences.size() || !this->addedSlots.empty() || !this->pendingDrawCommandCopies.empty() || !this->pendingVisibilityCopies.empty()) {
+        this->batchCount = this->batchReferences.size();
+        this->renderer->invalidateCommandBuffers();
+    }
 
-            pool.endCommandBuffer(commandBuffer);
-            pool.submitCommandBuffer(renderer->getLogicalDevice(), renderer->getComputeQueue(), commandBuffer);
+    this->drawCount = this->slotOwners.size();
+    this->renderer->setMaxIndirectCallCount(this->drawCount, this->indirectBufferIndex);
+}
 
-            stagingBuffer.destroy(this->renderer->getLogicalDevice());
+/**
+ *  Catches up on the instance changes of the linked pipeline, at a cost in proportion to what changed
+ */
+template<typename R, typename C, typename D>
+void CullPipeline::updateComputeBuffer(MeshPipeline<R, C> * pipeline, std::vector<D> & commands) {
+    const std::vector<InstanceChange> changes = pipeline->takeInstanceChanges();
+    if (changes.empty()) return;
+
+    for (const auto & c : changes) {
+        switch (c.type) {
+            case INSTANCE_ADDED:
+                this->addDrawCommands(pipeline, static_cast<const R *>(c.renderable), c.instance, commands);
+                break;
+            case INSTANCE_MOVED:
+                this->moveDrawCommands(c.renderable, c.instance, commands);
+                break;
+            case INSTANCE_REMOVED:
+                this->removeDrawCommands(c.renderable, commands);
+                break;
+            case INSTANCES_CLEARED:
+                this->clearSlots();
+                break;
         }
-    } else {
-        memcpy(static_cast<char *>(this->computeBuffer.getBufferData()) + computeBufferContentSize, drawCommands.data(), additionalDrawCommandSize);
     }
 
-    this->drawCount = this->meshOffset;
-    this->computeBuffer.updateContentSize(computeBufferContentSize + additionalDrawCommandSize);
-    this->renderer->setMaxIndirectCallCount(this->drawCount, this->indirectBufferIndex);
+    this->commitSlots(commands);
 }
 
 void CullPipeline::update() {
@@ -515,24 +620,152 @@ void CullPipeline::update() {
 
     if (this->linkedGraphicsPipeline.has_value()) {
         std::visit([this](auto&& arg) {
-            this->updateComputeBuffer(arg);
+            if constexpr (std::is_same_v<std::decay_t<decltype(arg)>, VertexMeshPipeline *>) {
+                this->updateComputeBuffer(arg, this->vertexDrawCommands);
+            } else {
+                this->updateComputeBuffer(arg, this->drawCommands);
+            }
         }, this->linkedGraphicsPipeline.value());
     }
 }
 
+/**
+ *  Applies the compaction moves and visibility resets of the last update (to the flags of all frames) ahead of the cull passes.
+ *  A command buffer holding them must not be submitted again, it is invalidated right away
+ */
+void CullPipeline::recordSlotChanges(const VkCommandBuffer & commandBuffer) {
+    if (this->addedSlots.empty() && this->pendingDrawCommandCopies.empty() && this->pendingVisibilityCopies.empty()) return;
+
+    const VkMemoryBarrier cullBarrier {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT
+    };
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        1, &cullBarrier,
+        0, nullptr,
+        0, nullptr
+    );
+
+    if (!this->pendingDrawCommandCopies.empty()) {
+        vkCmdCopyBuffer(commandBuffer, this->computeBuffer.getBuffer(), this->computeBuffer.getBuffer(), this->pendingDrawCommandCopies.size(), this->pendingDrawCommandCopies.data());
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> addedRuns;
+    for (const uint32_t slot : this->addedSlots) {
+        if (!addedRuns.empty() && addedRuns.back().first + addedRuns.back().second == slot) addedRuns.back().second++;
+        else addedRuns.emplace_back(slot, 1);
+    }
+
+    // copies and fills never touch the same flags
+    for (auto & b : this->visibilityBuffers) {
+        if (!this->pendingVisibilityCopies.empty()) {
+            vkCmdCopyBuffer(commandBuffer, b.getBuffer(), b.getBuffer(), this->pendingVisibilityCopies.size(), this->pendingVisibilityCopies.data());
+        }
+        for (const auto & r : addedRuns) vkCmdFillBuffer(commandBuffer, b.getBuffer(), r.first * sizeof(uint32_t), r.second * sizeof(uint32_t), 0);
+    }
+
+    this->addedSlots.clear();
+    this->pendingDrawCommandCopies.clear();
+    this->pendingVisibilityCopies.clear();
+
+    this->renderer->setComputeOverwritesDataInUse();
+    this->renderer->invalidateCommandBuffers();
+}
+
 void CullPipeline::compute(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex) {
-    // reset count and send max draw count
-    vkCmdFillBuffer(commandBuffer, this->renderer->getIndirectDrawCountBuffer(this->indirectBufferIndex).getBuffer(),
-                    0, this->renderer->getIndirectDrawCountBuffer(this->indirectBufferIndex).getSize(), 0);
-    vkCmdPushConstants(commandBuffer, this->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t) , &this->drawCount);
+    // the fill barrier of the dispatch makes the changes visible to the cull passes
+    this->recordSlotChanges(commandBuffer);
+
+    // with occlusion culling only what passed the late test last time is drawn early
+    this->dispatch(commandBuffer, commandBufferIndex, this->renderer->usesOcclusionCulling() ? CULL_EARLY : CULL_FRUSTUM);
+}
+
+/**
+ *  Recorded into the graphics command buffer in between early and late draws: tests all draws against the depth pyramid
+ *  and overwrites the very indirect buffers the early draws consumed with the ones that became visible
+ */
+void CullPipeline::computeLate(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex) {
+    this->dispatch(commandBuffer, commandBufferIndex, CULL_LATE);
+}
+
+/**
+ *  Resets the draw and instance counts and runs the cull passes of a phase, every pass reading what the previous one wrote.
+ *  Vertex meshes are not batched and culled in a single pass
+ */
+void CullPipeline::dispatch(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex, const CullPhase phase) {
+    const bool isVertexMeshCulling = this->linkedGraphicsPipeline.has_value() && std::holds_alternative<VertexMeshPipeline *>(this->linkedGraphicsPipeline.value());
+    const Buffer & indirectDrawCountBuffer = this->renderer->getIndirectDrawCountBuffer(this->indirectBufferIndex, commandBufferIndex);
+
+    vkCmdFillBuffer(commandBuffer, indirectDrawCountBuffer.getBuffer(), 0, indirectDrawCountBuffer.getSize(), 0);
+    if (!isVertexMeshCulling) {
+        vkCmdFillBuffer(commandBuffer, this->batchBuffers[commandBufferIndex].getBuffer(), 0, (1 + this->batchCount * MAX_MESH_LODS) * sizeof(uint32_t), 0);
+    }
+
+    const VkMemoryBarrier fillBarrier {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr,
+        VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+    };
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1, &fillBarrier,
+        0, nullptr,
+        0, nullptr
+    );
 
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->pipeline);
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->layout, 0, 1, &this->descriptors.getDescriptorSets()[commandBufferIndex], 0, nullptr);
 
-    vkCmdDispatch(commandBuffer,(this->drawCount / 32)+1, 1, 1);
+    const VkMemoryBarrier passBarrier {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr,
+        VK_ACCESS_SHADER_WRITE_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+    };
+
+    const uint32_t lastPass = isVertexMeshCulling ? CULL_PASS_TEST : CULL_PASS_WRITE;
+    for (uint32_t pass=CULL_PASS_TEST;pass<=lastPass;pass++) {
+        if (pass != CULL_PASS_TEST) {
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0,
+                1, &passBarrier,
+                0, nullptr,
+                0, nullptr
+            );
+        }
+
+        const CullPushConstants pushConstants = { this->drawCount, phase, pass };
+        vkCmdPushConstants(commandBuffer, this->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants) , &pushConstants);
+
+        vkCmdDispatch(commandBuffer,(this->drawCount / 32)+1, 1, 1);
+    }
 }
 
 CullPipeline::~CullPipeline() {
     this->computeBuffer.destroy(this->renderer->getLogicalDevice());
+    for (auto & b : this->visibilityBuffers) {
+        this->renderer->trackDeviceLocalMemory(b.getSize(), true);
+        b.destroy(this->renderer->getLogicalDevice());
+    }
+    for (auto & b : this->batchBuffers) {
+        this->renderer->trackDeviceLocalMemory(b.getSize(), true);
+        b.destroy(this->renderer->getLogicalDevice());
+    }
+    for (auto & b : this->commandLodBuffers) {
+        this->renderer->trackDeviceLocalMemory(b.getSize(), true);
+        b.destroy(this->renderer->getLogicalDevice());
+    }
 }
 
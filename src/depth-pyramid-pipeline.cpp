@@ -0,0 +1,257 @@
+#include "includes/engine.h"
+
+DepthPyramidPipeline::DepthPyramidPipeline(const std::string name, Renderer * renderer) : ComputePipeline(name, renderer) { }
+
+bool DepthPyramidPipeline::initPipeline(const PipelineConfig & config) {
+    if (this->renderer == nullptr || !this->renderer->isReady()) {
+        logError("Pipeline " + this->name + " requires a ready renderer instance!");
+        return false;
+    }
+
+    this->config = std::move(static_cast<const DepthPyramidPipelineConfig &>(config));
+
+    // reads the depth attachment and writes its own images, there is no indirect buffer
+    this->indirectBufferIndex = -1;
+
+    for (const auto & s : this->config.shaders) {
+        if (!this->addShader((Engine::getAppPath(SHADERS) / s.file).string(), s.shaderType)) {
+            logError("Failed to add shader: " + s.file);
+        }
+    }
+
+    if (this->getNumberOfValidShaders() < 1) {
+        logError(" '" + this->name + "' Pipeline needs compute shader at a minimum!");
+        return false;
+    }
+
+    this->pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    this->pushConstantRange.offset = 0;
+    this->pushConstantRange.size = sizeof(DepthPyramidPushConstants);
+
+    return this->createPipeline();
+}
+
+/**
+ *  Called again for every swap chain (re)creation since the pyramid follows the swap chain extent
+ */
+bool DepthPyramidPipeline::createPipeline()
+{
+    if (!this->createPyramids()) {
+        logError("Failed to create Depth Pyramid Images");
+        return false;
+    }
+
+    if (!this->createDescriptorPool()) {
+        logError("Failed to create Depth Pyramid Pipeline Descriptor Pool");
+        return false;
+    }
+
+    if (!this->createDescriptors()) {
+        logError("Failed to create Depth Pyramid Pipeline Descriptors");
+        return false;
+    }
+
+    return this->createComputePipelineCommon();
+}
+
+bool DepthPyramidPipeline::createPyramids() {
+    if (this->renderer == nullptr || !this->renderer->isReady()) return false;
+
+    this->destroyPyramids();
+
+    const VkDevice & logicalDevice = this->renderer->getLogicalDevice();
+    const VkExtent2D extent = this->renderer->getSwapChainExtent();
+
+    // every level halves exactly, the first one covers up to 2x2 depth texels (3x3 for odd sizes)
+    this->width = std::bit_floor(std::max(extent.width, 1u));
+    this->height = std::bit_floor(std::max(extent.height, 1u));
+    this->levels = std::bit_width(std::max(this->width, this->height));
+
+    const uint32_t framesInFlight = this->renderer->getFramesInFlight();
+    this->pyramids = std::vector<Image>(framesInFlight);
+    this->levelViews = std::vector<std::vector<VkImageView>>(framesInFlight, std::vector<VkImageView>(this->levels, nullptr));
+
+    for (uint32_t f=0;f<framesInFlight;f++) {
+        ImageConfig conf;
+        conf.format = VK_FORMAT_R32_SFLOAT;
+        conf.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        conf.width = this->width;
+        conf.height = this->height;
+        conf.isDepthImage = false;
+        conf.addressMode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        conf.mipLevels = this->levels;
+
+        this->pyramids[f].createImage(this->renderer->getPhysicalDevice(), logicalDevice, conf);
+        if (!this->pyramids[f].isInitialized()) return false;
+
+        for (uint32_t l=0;l<this->levels;l++) {
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = this->pyramids[f].getImage();
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = conf.format;
+            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            viewInfo.subresourceRange.baseMipLevel = l;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(logicalDevice, &viewInfo, nullptr, &this->levelViews[f][l]) != VK_SUCCESS) {
+                logError("Failed to Create Depth Pyramid Level View!");
+                return false;
+            }
+        }
+    }
+
+    // the pyramids stay in the general layout for good, written and sampled by compute only
+    const CommandPool & pool = this->renderer->getGraphicsCommandPool();
+    const VkCommandBuffer & commandBuffer = pool.beginPrimaryCommandBuffer(logicalDevice);
+    if (commandBuffer == nullptr) return false;
+
+    for (const auto & p : this->pyramids) {
+        p.transitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 1, this->levels);
+    }
+
+    pool.endCommandBuffer(commandBuffer);
+    pool.submitCommandBuffer(logicalDevice, this->renderer->getGraphicsQueue(), commandBuffer);
+
+    return true;
+}
+
+void DepthPyramidPipeline::destroyPyramids() {
+    if (this->renderer == nullptr) return;
+
+    for (auto & views : this->levelViews) {
+        for (auto & view : views) {
+            if (view != nullptr) vkDestroyImageView(this->renderer->getLogicalDevice(), view, nullptr);
+        }
+    }
+    this->levelViews.clear();
+
+    for (auto & p : this->pyramids) p.destroy(this->renderer->getLogicalDevice());
+    this->pyramids.clear();
+}
+
+bool DepthPyramidPipeline::createDescriptorPool() {
+    if (this->renderer == nullptr || !this->renderer->isReady()) return false;
+
+    this->descriptors.destroy(this->renderer->getLogicalDevice());
+    this->descriptorPool.destroy(this->renderer->getLogicalDevice());
+
+    const uint32_t count = this->renderer->getFramesInFlight() * this->levels;
+
+    this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, count);
+    this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, count);
+
+    this->descriptorPool.createPool(this->renderer->getLogicalDevice(), count);
+
+    return this->descriptorPool.isInitialized();
+}
+
+/**
+ *  One set per frame in flight and level: the level before (the depth attachment for level 0) is read, the level itself written
+ */
+bool DepthPyramidPipeline::createDescriptors() {
+    if (this->renderer == nullptr || !this->renderer->isReady()) return false;
+
+    this->descriptors.destroy(this->renderer->getLogicalDevice());
+
+    this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+    this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+
+    this->descriptors.create(this->renderer->getLogicalDevice(), this->descriptorPool.getPool(), this->renderer->getFramesInFlight() * this->levels);
+
+    if (!this->descriptors.isInitialized()) return false;
+
+    for (uint32_t f=0;f<this->pyramids.size();f++) {
+        const VkDescriptorImageInfo & pyramidInfo = this->getDescriptorInfo(f);
+
+        for (uint32_t l=0;l<this->levels;l++) {
+            const uint32_t setIndex = f * this->levels + l;
+            if (l > 0) this->descriptors.updateWriteDescriptorWithImageInfo(this->renderer->getLogicalDevice(), 0, setIndex, { pyramidInfo });
+
+            const VkDescriptorImageInfo levelInfo = { nullptr, this->levelViews[f][l], VK_IMAGE_LAYOUT_GENERAL };
+            this->descriptors.updateWriteDescriptorWithImageInfo(this->renderer->getLogicalDevice(), 1, setIndex, { levelInfo });
+        }
+    }
+
+    // the depth attachment depends on the acquired swap chain image, see setDepthImage
+    this->boundDepthViews = std::vector<VkImageView>(this->pyramids.size(), nullptr);
+
+    return true;
+}
+
+/**
+ *  Points level 0 of the given frame at the depth image of the acquired swap chain image.
+ *  Must only be called once the frame's previous submission finished.
+ */
+void DepthPyramidPipeline::setDepthImage(const Image & depthImage, const uint16_t commandBufferIndex) {
+    if (commandBufferIndex >= this->boundDepthViews.size() || this->boundDepthViews[commandBufferIndex] == depthImage.getImageView()) return;
+
+    const VkDescriptorImageInfo depthInfo = { depthImage.getSampler(), depthImage.getImageView(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+    this->descriptors.updateWriteDescriptorWithImageInfo(this->renderer->getLogicalDevice(), 0, commandBufferIndex * this->levels, { depthInfo });
+
+    this->boundDepthViews[commandBufferIndex] = depthImage.getImageView();
+}
+
+const VkDescriptorImageInfo DepthPyramidPipeline::getDescriptorInfo(const uint16_t commandBufferIndex) const
+{
+    if (commandBufferIndex >= this->pyramids.size()) return VkDescriptorImageInfo {};
+
+    return { this->pyramids[commandBufferIndex].getSampler(), this->pyramids[commandBufferIndex].getImageView(), VK_IMAGE_LAYOUT_GENERAL };
+}
+
+void DepthPyramidPipeline::update() {}
+
+void DepthPyramidPipeline::compute(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex) {
+    if (this->levels == 0 || commandBufferIndex >= this->pyramids.size()) return;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->pipeline);
+
+    const VkExtent2D extent = this->renderer->getSwapChainExtent();
+
+    DepthPyramidPushConstants pushConstants {};
+    pushConstants.sourceSize = glm::ivec2(extent.width, extent.height);
+    pushConstants.destinationSize = glm::ivec2(this->width, this->height);
+
+    VkImageMemoryBarrier levelBarrier {};
+    levelBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    levelBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    levelBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    levelBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    levelBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    levelBarrier.image = this->pyramids[commandBufferIndex].getImage();
+    levelBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    levelBarrier.subresourceRange.levelCount = 1;
+    levelBarrier.subresourceRange.baseArrayLayer = 0;
+    levelBarrier.subresourceRange.layerCount = 1;
+
+    for (uint32_t l=0;l<this->levels;l++) {
+        pushConstants.sourceLevel = l == 0 ? 0 : l - 1;
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->layout, 0, 1, &this->descriptors.getDescriptorSets()[commandBufferIndex * this->levels + l], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, this->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DepthPyramidPushConstants), &pushConstants);
+        vkCmdDispatch(commandBuffer, (pushConstants.destinationSize.x + 7) / 8, (pushConstants.destinationSize.y + 7) / 8, 1);
+
+        // the next level reads what this one wrote, the last one is read by the late cull phase
+        levelBarrier.subresourceRange.baseMipLevel = l;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &levelBarrier
+        );
+
+        pushConstants.sourceSize = pushConstants.destinationSize;
+        pushConstants.destinationSize = glm::max(pushConstants.destinationSize / 2, glm::ivec2(1));
+    }
+}
+
+DepthPyramidPipeline::~DepthPyramidPipeline() {
+    this->destroyPyramids();
+}
@@ -45,24 +45,25 @@ std::filesystem::path Engine::getAppPath(APP_PATHS appPath) {
     return ::getAppPath(Engine::base, appPath);
 }
 
-void Engine::addMessageLog(std::shared_ptr<flatbuffers::FlatBufferBuilder> & builder)
+bool Engine::openMessageLog()
 {
-    const std::lock_guard<std::mutex> lock(this->messageLogMutex);
-
-    const auto autoIncrement = this->messageLogs.size();
-    const auto fileName = "message-" + std::to_string(autoIncrement) + ".log";
-    const auto pathName = (Engine::getAppPath(MESSAGES) / fileName).string();
+    const auto pathName = Engine::getAppPath(MESSAGES) / MESSAGE_LOG;
 
-    auto mode = std::ios::out | std::ios::binary | std::ios::app;
-    std::ofstream messageLog(pathName, mode);
+    if (!this->messageJournal.open(pathName)) {
+        logError("Failed to open message log: " + pathName.string());
+        return false;
+    }
 
-    const auto size = builder->GetSize();
-    const auto content = reinterpret_cast<char *>(builder->GetBufferPointer());
+    return true;
+}
 
-    messageLog.write(content, size);
-    messageLog.close();
+void Engine::addMessageLog(std::shared_ptr<flatbuffers::FlatBufferBuilder> & builder)
+{
+    if (builder == nullptr) return;
 
-    this->messageLogs.push_back(pathName);
+    if (!this->messageJournal.append(builder->GetBufferPointer(), builder->GetSize())) {
+        logError("Failed to add message to message log");
+    }
 }
 
 void Engine::resendFailedMessages()
@@ -79,89 +80,246 @@ void Engine::resendFailedMessages()
 
 void Engine::resendMessageLogs()
 {
-    for (auto & m : this->messageLogs) {
-        std::error_code error;
-        const auto logFileSize = std::filesystem::file_size(m, error); // this won't throw
-        if (error) {
-            logError("Failed to get file size of message log");
-            continue;
+    if (this->client == nullptr) return;
+
+    CommBuilder builder;
+    uint32_t objectsInBatch = 0;
+
+    const auto sendBatch = [this, &builder, &objectsInBatch]() {
+        if (objectsInBatch == 0) return;
+
+        CommCenter::createMessage(builder, this->debugFlags);
+        this->client->sendBlockingWithoutAck(builder.builder->GetBufferPointer(), builder.builder->GetSize());
+
+        builder = CommBuilder {};
+        objectsInBatch = 0;
+    };
+
+    /**
+     * Re-creates every logged object, batched into as few messages as possible.
+     * The server skips the ones it still knows, those come with the snapshot requested afterwards
+     */
+    this->messageJournal.replay([&builder, &objectsInBatch, &sendBatch](const ObjectCreateRequest * request) {
+        const auto objId = request->properties()->id()->str();
+
+        // objects we do not know (yet), e.g. after a restart, are sent in their logged state
+        const auto rend = GlobalRenderableStore::INSTANCE()->getObjectById<Renderable>(objId);
+        Vec3 position = request->properties()->location() != nullptr ? *request->properties()->location() : Vec3 {0.0f, 0.0f, 0.0f};
+        Vec3 rotation = request->properties()->rotation() != nullptr ? *request->properties()->rotation() : Vec3 {0.0f, 0.0f, 0.0f};
+        float scaling = request->properties()->scale();
+        if (rend != nullptr) {
+            const auto objPos = rend->getPosition();
+            const auto objRot = rend->getRotation();
+            position = { objPos.x, objPos.y, objPos.z };
+            rotation = { objRot.x, objRot.y, objRot.z };
+            scaling = rend->getScaling();
         }
-        if (logFileSize <= 0) continue;
-
-        std::ifstream infile(m, std::ios::binary | std::ios::in);
-        if (infile.is_open()) {
-            char * buffer = new char[logFileSize];
-            infile.read(buffer, logFileSize);
-            infile.close();
-
-            const auto logMessage = GetMessage(buffer);
-            if (logMessage == nullptr) {
-                delete [] buffer;
-                continue;
+
+        switch(request->object_type()) {
+            case ObjectCreateRequestUnion_SphereCreateRequest:
+            {
+                const auto sphere = request->object_as_SphereCreateRequest();
+                const Vec4 color = sphere->color() != nullptr ? *sphere->color() : Vec4 {1.0f,1.0f,1.0f,1.0f};
+                const std::string texture = sphere->texture() != nullptr ? sphere->texture()->str() : "";
+
+                CommCenter::addObjectCreateSphereRequest(builder, objId, position, rotation, scaling, sphere->radius(), color, texture);
+                break;
             }
+            case ObjectCreateRequestUnion_BoxCreateRequest:
+            {
+                const auto box = request->object_as_BoxCreateRequest();
+                const Vec4 color = box->color() != nullptr ? *box->color() : Vec4 {1.0f,1.0f,1.0f,1.0f};
+                const std::string texture = box->texture() != nullptr ? box->texture()->str() : "";
 
-            const auto contentVector = logMessage->content();
-            if (contentVector == nullptr) {
-                delete [] buffer;
-                continue;
+                CommCenter::addObjectCreateBoxRequest(builder, objId, position, rotation, scaling, box->width(), box->height(), box->depth(), color, texture);
+                break;
             }
+            case ObjectCreateRequestUnion_ModelCreateRequest:
+            {
+                const auto model = request->object_as_ModelCreateRequest();
+                const std::string file = model->file() != nullptr ? model->file()->str() : "";
 
-            const auto contentVectorType = logMessage->content_type();
-            if (contentVectorType == nullptr) {
-                delete [] buffer;
-                return;
+                CommCenter::addObjectCreateModelRequest(builder, objId, position, rotation, scaling, file, model->flags(), model->first_child_root());
+                break;
             }
+            case ObjectCreateRequestUnion_NONE:
+                return;
+        }
 
-            CommBuilder builder;
-            bool isCreationRequest = false;
+        // the create request does not carry animation state
+        if (rend != nullptr && rend->hasAnimation()) {
+            const auto animatedRenderable = static_cast<AnimatedModelMeshRenderable*>(rend);
 
-            const uint32_t nrOfMessages = contentVector->size();
-            for (uint32_t i=0;i<nrOfMessages;i++) {
-                const auto messageType = (const MessageUnion) (*contentVectorType)[i];
+            CommCenter::addObjectPropertiesUpdateRequest(
+                builder, objId, position, rotation, rend->getScaling(),
+                animatedRenderable->getCurrentAnimation(), animatedRenderable->getCurrentAnimationTime()
+            );
+        }
 
-                if (messageType != MessageUnion_ObjectCreateRequest) {
-                    delete [] buffer;
-                    continue;
-                }
-                isCreationRequest = true;
+        objectsInBatch++;
+        if (objectsInBatch >= MESSAGE_LOG_REPLAY_BATCH_SIZE) sendBatch();
+    });
 
-                const auto request = (const ObjectCreateRequest *)  (*contentVector)[i];
-                const auto objId = request->properties()->id()->str();
+    sendBatch();
+}
 
-                const auto rend = GlobalRenderableStore::INSTANCE()->getObjectById<Renderable>(objId);
-                if (rend == nullptr) {
-                    delete [] buffer;
-                    continue;
-                }
+void Engine::requestSnapshot()
+{
+    if (this->client == nullptr) return;
 
-                std::string animation = "";
-                float animationTime = 0.0f;
-                if (rend->hasAnimation()) {
-                    animation = static_cast<AnimatedModelMeshRenderable*>(rend)->getCurrentAnimation();
-                    animationTime = static_cast<AnimatedModelMeshRenderable*>(rend)->getCurrentAnimationTime();
-                }
+    // the server answers with the current state of the cells we are subscribed to, sent to us alone
+    std::vector<std::string> cells;
+    for (const auto & g : this->client->getGroups()) {
+        if (g != BROADCAST_GROUP && g != this->client->getReplyGroup()) cells.emplace_back(g);
+    }
+    if (cells.empty()) return;
 
-                const auto objPos = rend->getPosition();
-                const auto objRot = rend->getRotation();
+    CommBuilder builder;
+    CommCenter::addInterestUpdateRequest(builder, this->client->getReplyGroup(), cells);
+    CommCenter::createMessage(builder, this->debugFlags);
+    this->client->sendBlockingWithoutAck(builder.builder->GetBufferPointer(), builder.builder->GetSize());
+}
 
-                CommCenter::addObjectPropertiesUpdateRequest(
-                    builder, objId,
-                    { objPos.x, objPos.y, objPos.z },
-                    { objRot.x, objRot.y, objRot.z },
-                    rend->getScaling(),
-                    animation, animationTime
-                );
-            }
+void Engine::updateInterestRegion()
+{
+    if (this->client == nullptr) return;
+
+    /**
+     * Joins are sent to the server one update later,
+     * giving the dish a chance to have subscribed before the server answers with the cell contents
+     */
+    if (!this->pendingInterestGroups.empty()) {
+        CommBuilder builder;
+        CommCenter::addInterestUpdateRequest(builder, this->client->getReplyGroup(), this->pendingInterestGroups);
+        CommCenter::createMessage(builder, this->debugFlags);
+        this->send(builder.builder);
+
+        this->pendingInterestGroups.clear();
+    }
 
-            if (isCreationRequest) {
-                this->client->sendBlockingWithoutAck(buffer, logFileSize);
-                CommCenter::createMessage(builder);
-                this->client->sendBlockingWithoutAck(builder.builder->GetCurrentBufferPointer(),builder.builder->GetSize());
-            }
+    const glm::vec3 position = this->camera->getPosition();
+    const glm::ivec2 centerCell = getInterestCell(position);
+    const int cellRange = static_cast<int>(std::ceil(INTEREST_RADIUS / INTEREST_GRID_CELL_LENGTH));
+
+    for (int x=-cellRange;x<=cellRange;x++) {
+        for (int z=-cellRange;z<=cellRange;z++) {
+            const glm::ivec2 cell = centerCell + glm::ivec2(x, z);
+            if (getDistanceToInterestCell(position, cell) > INTEREST_RADIUS) continue;
 
-            delete [] buffer;
+            const std::string group = getInterestGroup(cell);
+            if (!this->interestGroups.emplace(group, cell).second) continue;
+
+            this->client->joinGroup(group);
+            this->pendingInterestGroups.emplace_back(group);
+        }
+    }
+
+    // only leave once we are well beyond the radius so that we don't flap at cell borders
+    std::vector<std::string> groupsToLeave;
+    for (const auto & g : this->interestGroups) {
+        if (getDistanceToInterestCell(position, g.second) > INTEREST_RADIUS + INTEREST_HYSTERESIS) {
+            groupsToLeave.emplace_back(g.first);
         }
     }
+
+    if (groupsToLeave.empty()) return;
+
+    const std::lock_guard<std::mutex> lock(this->leftInterestCellsMutex);
+    for (const auto & g : groupsToLeave) {
+        this->client->leaveGroup(g);
+        this->leftInterestCells.emplace_back(this->interestGroups[g]);
+        this->interestGroups.erase(g);
+    }
+}
+
+/**
+ *  Queues what the server created in the cells we left for removal from the pipelines, the server sends it again once a cell is re-joined.
+ *  Animated models stay, their pipeline does not support removal
+ */
+void Engine::evictLeftInterestCells()
+{
+    std::vector<glm::ivec2> leftCells;
+    {
+        const std::lock_guard<std::mutex> lock(this->leftInterestCellsMutex);
+        leftCells.swap(this->leftInterestCells);
+    }
+    if (leftCells.empty()) return;
+
+    std::vector<ColorMeshRenderable *> colorMeshRenderables;
+    std::vector<TextureMeshRenderable *> textureMeshRenderables;
+    std::vector<ModelMeshRenderable *> modelMeshRenderables;
+
+    for (const auto & r : this->serverRenderables) {
+        if (this->evictedRenderables.contains(r.first)) continue;
+
+        std::visit([&](auto && renderable) {
+            const glm::ivec2 cell = getInterestCell(renderable->getPosition());
+            if (std::find(leftCells.begin(), leftCells.end(), cell) == leftCells.end()) return;
+
+            using R = std::decay_t<decltype(renderable)>;
+            if constexpr (std::is_same_v<R, ColorMeshRenderable *>) colorMeshRenderables.emplace_back(renderable);
+            else if constexpr (std::is_same_v<R, TextureMeshRenderable *>) textureMeshRenderables.emplace_back(renderable);
+            else if constexpr (std::is_same_v<R, ModelMeshRenderable *>) modelMeshRenderables.emplace_back(renderable);
+            else return;
+
+            this->evictedRenderables.insert(r.first);
+        }, r.second);
+    }
+
+    if (!colorMeshRenderables.empty()) this->removeObjectsToBeRendered(colorMeshRenderables);
+    if (!textureMeshRenderables.empty()) this->removeObjectsToBeRendered(textureMeshRenderables);
+    if (!modelMeshRenderables.empty()) this->removeObjectsToBeRendered(modelMeshRenderables);
+}
+
+/**
+ *  Returns true if the object exists already, putting it back into its pipeline with the sent state if it had been evicted
+ */
+bool Engine::restoreKnownRenderable(const std::string & id, const UpdatedObjectProperties * updates, const BoundingSphere & boundingSphere)
+{
+    auto renderable = GlobalRenderableStore::INSTANCE()->getObjectById<Renderable>(id);
+    if (renderable == nullptr) return false;
+
+    const auto evicted = this->evictedRenderables.find(id);
+    if (evicted == this->evictedRenderables.end()) return true;
+    this->evictedRenderables.erase(evicted);
+
+    const auto serverRenderable = this->serverRenderables.find(id);
+    if (serverRenderable == this->serverRenderables.end()) return true;
+
+    const auto rot = updates->rotation();
+    renderable->setRotation({rot->x(), rot->y(), rot->z()});
+    renderable->setMatrix(updates->matrix());
+    renderable->setScaling(updates->scaling());
+    renderable->setBoundingSphere(boundingSphere);
+
+    std::visit([this](auto && r) {
+        if constexpr (!std::is_same_v<std::decay_t<decltype(r)>, VertexMeshRenderable *>) this->addObjectsToBeRendered({ r });
+    }, serverRenderable->second);
+
+    return true;
+}
+
+/**
+ *  Registers a renderable drawing the meshes of the first one registered with the same geometry key,
+ *  the geometry is only created if there is none to share yet
+ */
+template<typename R, typename F>
+R * Engine::registerSharedGeometryRenderable(const std::string & id, const std::string & geometryKey, F createGeometry) {
+    const auto geometryOwner = this->geometryOwners.find(geometryKey);
+    if (geometryOwner != this->geometryOwners.end()) {
+        auto meshRenderable = std::make_unique<R>(id, static_cast<const R *>(geometryOwner->second));
+        return GlobalRenderableStore::INSTANCE()->registerObject<R>(meshRenderable);
+    }
+
+    auto geometry = createGeometry();
+    if (geometry == nullptr) return nullptr;
+
+    auto meshRenderable = std::make_unique<R>(id, geometry);
+    auto renderable = GlobalRenderableStore::INSTANCE()->registerObject<R>(meshRenderable);
+    renderable->setGeometryShareable(true);
+    this->geometryOwners[geometryKey] = renderable;
+
+    return renderable;
 }
 
 void Engine::handleServerMessages(void * message)
@@ -187,11 +345,14 @@ void Engine::handleServerMessages(void * message)
         if (!this->renderer->hasConnectionToServer()) {
 
             this->resendMessageLogs();
+            this->requestSnapshot();
             this->renderer->setIsConnectedToServer(true);
             this->resendFailedMessages();
         }
     }
 
+    this->evictLeftInterestCells();
+
     this->lastHeartBeat = Communication::getTimeInMillis();
 
     const auto debugFlagsMessage = m->debug();
@@ -225,7 +386,7 @@ void Engine::handleServerMessages(void * message)
                     {
                         const auto sphere = request->object_as_SphereUpdateRequest();
                         const auto id = sphere->updates()->id()->str();
-                        if (GlobalRenderableStore::INSTANCE()->getObjectById<Renderable>(id) != nullptr) break;
+                        if (this->restoreKnownRenderable(id, sphere->updates(), getBoundingSphere(sphere->updates()))) break;
 
                         const auto texture = sphere->texture()->str();
                         const auto radius = sphere->radius();
@@ -233,26 +394,31 @@ void Engine::handleServerMessages(void * message)
                         const auto rot = sphere->updates()->rotation();
 
                         if (!texture.empty()) {
-                            const auto & t = GlobalTextureStore::INSTANCE()->uploadTexture(texture, this->renderer, true);
-                            auto sphereGeom = Helper::createSphereTextureMeshGeometry(sphere->radius(), 20, 20, t);
-                            if (sphereGeom == nullptr) continue;
-                            sphereGeom->sphere = getBoundingSphere(sphere->updates());
-                            auto sphereMeshRenderable = std::make_unique<TextureMeshRenderable>(id, sphereGeom);
-                            auto sphereRenderable = GlobalRenderableStore::INSTANCE()->registerObject<TextureMeshRenderable>(sphereMeshRenderable);
+                            const std::string geometryKey = "sphere:" + std::to_string(radius) + ":" + texture;
+                            auto sphereRenderable = this->registerSharedGeometryRenderable<TextureMeshRenderable>(id, geometryKey, [this, &texture, radius]() {
+                                const auto & t = GlobalTextureStore::INSTANCE()->uploadTexture(texture, this->renderer, true);
+                                return Helper::createSphereTextureMeshGeometry(radius, 20, 20, t);
+                            });
+                            if (sphereRenderable == nullptr) continue;
+                            sphereRenderable->setBoundingSphere(getBoundingSphere(sphere->updates()));
                             sphereRenderable->setRotation({rot->x(), rot->y(), rot->z()});
                             sphereRenderable->setMatrix(matrix);
                             sphereRenderable->setScaling(sphere->updates()->scaling());
                             this->addObjectsToBeRendered({ sphereRenderable});
+                            this->serverRenderables[id] = sphereRenderable;
                         } else {
-                            const auto color = sphere->color();
-                            auto sphereGeom = Helper::createSphereColorMeshGeometry(radius, 20, 20, glm::vec4(color->x(), color->y(), color->z(), color->w()));
-                            sphereGeom->sphere = getBoundingSphere(sphere->updates());
-                            auto sphereMeshRenderable = std::make_unique<ColorMeshRenderable>(id, sphereGeom);
-                            auto sphereRenderable = GlobalRenderableStore::INSTANCE()->registerObject<ColorMeshRenderable>(sphereMeshRenderable);
+                            const glm::vec4 color = { sphere->color()->x(), sphere->color()->y(), sphere->color()->z(), sphere->color()->w() };
+                            const std::string geometryKey = "sphere:" + std::to_string(radius) + ":" + glm::to_string(color);
+                            auto sphereRenderable = this->registerSharedGeometryRenderable<ColorMeshRenderable>(id, geometryKey, [radius, &color]() {
+                                return Helper::createSphereColorMeshGeometry(radius, 20, 20, color);
+                            });
+                            if (sphereRenderable == nullptr) continue;
+                            sphereRenderable->setBoundingSphere(getBoundingSphere(sphere->updates()));
                             sphereRenderable->setRotation({rot->x(), rot->y(), rot->z()});
                             sphereRenderable->setMatrix(matrix);
                             sphereRenderable->setScaling(sphere->updates()->scaling());
                             this->addObjectsToBeRendered({ sphereRenderable});
+                            this->serverRenderables[id] = sphereRenderable;
                         }
                         break;
                     }
@@ -260,7 +426,7 @@ void Engine::handleServerMessages(void * message)
                     {
                         const auto box = request->object_as_BoxUpdateRequest();
                         const auto id = box->updates()->id()->str();
-                        if (GlobalRenderableStore::INSTANCE()->getObjectById<Renderable>(id) != nullptr) break;
+                        if (this->restoreKnownRenderable(id, box->updates(), getBoundingSphere(box->updates()))) break;
 
                         const auto texture = box->texture()->str();
                         const auto width = box->width();
@@ -270,25 +436,31 @@ void Engine::handleServerMessages(void * message)
                         const auto rot = box->updates()->rotation();
 
                         if (!texture.empty()) {
-                            const auto & t = GlobalTextureStore::INSTANCE()->uploadTexture(texture, this->renderer, true);
-                            auto boxGeom = Helper::createBoxTextureMeshGeometry(width, height, depth, t);
-                            boxGeom->sphere = getBoundingSphere(box->updates());
-                            auto boxMeshRenderable = std::make_unique<TextureMeshRenderable>(id, boxGeom);
-                            auto boxRenderable = GlobalRenderableStore::INSTANCE()->registerObject<TextureMeshRenderable>(boxMeshRenderable);
+                            const std::string geometryKey = "box:" + glm::to_string(glm::vec3(width, height, depth)) + ":" + texture;
+                            auto boxRenderable = this->registerSharedGeometryRenderable<TextureMeshRenderable>(id, geometryKey, [this, &texture, width, height, depth]() {
+                                const auto & t = GlobalTextureStore::INSTANCE()->uploadTexture(texture, this->renderer, true);
+                                return Helper::createBoxTextureMeshGeometry(width, height, depth, t);
+                            });
+                            if (boxRenderable == nullptr) continue;
+                            boxRenderable->setBoundingSphere(getBoundingSphere(box->updates()));
                             boxRenderable->setRotation({rot->x(), rot->y(), rot->z()});
                             boxRenderable->setMatrix(matrix);
                             boxRenderable->setScaling(box->updates()->scaling());
                             this->addObjectsToBeRendered({ boxRenderable});
+                            this->serverRenderables[id] = boxRenderable;
                         } else {
-                            const auto color = box->color();
-                            auto boxGeom = Helper::createBoxColorMeshGeometry(width, height, depth, { color->x(), color->y(), color->z(), color->w()});
-                            boxGeom->sphere = getBoundingSphere(box->updates());
-                            auto boxMeshRenderable = std::make_unique<ColorMeshRenderable>(id, boxGeom);
-                            auto boxRenderable = GlobalRenderableStore::INSTANCE()->registerObject<ColorMeshRenderable>(boxMeshRenderable);
+                            const glm::vec4 color = { box->color()->x(), box->color()->y(), box->color()->z(), box->color()->w() };
+                            const std::string geometryKey = "box:" + glm::to_string(glm::vec3(width, height, depth)) + ":" + glm::to_string(color);
+                            auto boxRenderable = this->registerSharedGeometryRenderable<ColorMeshRenderable>(id, geometryKey, [width, height, depth, &color]() {
+                                return Helper::createBoxColorMeshGeometry(width, height, depth, color);
+                            });
+                            if (boxRenderable == nullptr) continue;
+                            boxRenderable->setBoundingSphere(getBoundingSphere(box->updates()));
                             boxRenderable->setRotation({rot->x(), rot->y(), rot->z()});
                             boxRenderable->setMatrix(matrix);
                             boxRenderable->setScaling(box->updates()->scaling());
                             this->addObjectsToBeRendered({ boxRenderable});
+                            this->serverRenderables[id] = boxRenderable;
                         }
 
                         break;
@@ -297,7 +469,7 @@ void Engine::handleServerMessages(void * message)
                     {
                         const auto model = request->object_as_ModelUpdateRequest();
                         const auto id = model->updates()->id()->str();
-                        if (GlobalRenderableStore::INSTANCE()->getObjectById<Renderable>(id) != nullptr) break;
+                        if (this->restoreKnownRenderable(id, model->updates(), getBoundingSphere(model->updates()))) break;
 
                         const auto file = model->file()->str();
                         const auto matrix = model->updates()->matrix();
@@ -308,7 +480,22 @@ void Engine::handleServerMessages(void * message)
                         const auto flags = model->flags();
                         const auto useFirstChildAsRoot = model->first_child_root();
 
-                        const auto m = Model::loadFromAssetsFolder(id, file, flags, useFirstChildAsRoot);
+                        // animated models keep their own meshes for the joint indices point into their own palettes
+                        const std::string geometryKey = "model:" + file + ":" + std::to_string(flags) + ":" + std::to_string(useFirstChildAsRoot);
+                        const auto geometryOwner = this->geometryOwners.find(geometryKey);
+
+                        std::optional<MeshRenderableVariant> m;
+                        if (animation.empty() && geometryOwner != this->geometryOwners.end()) {
+                            auto modelMeshRenderable = std::make_unique<ModelMeshRenderable>(id, static_cast<const ModelMeshRenderable *>(geometryOwner->second));
+                            m = GlobalRenderableStore::INSTANCE()->registerObject<ModelMeshRenderable>(modelMeshRenderable);
+                        } else {
+                            m = Model::loadFromAssetsFolder(id, file, flags, useFirstChildAsRoot);
+                            if (m.has_value() && std::holds_alternative<ModelMeshRenderable *>(m.value())) {
+                                std::get<ModelMeshRenderable *>(m.value())->setGeometryShareable(true);
+                                this->geometryOwners[geometryKey] = std::get<ModelMeshRenderable *>(m.value());
+                            }
+                        }
+
                         if (m.has_value()) {
                             if (animation.empty()) {
                                 auto modelRenderable = std::get<ModelMeshRenderable *>(m.value());
@@ -328,6 +515,7 @@ void Engine::handleServerMessages(void * message)
                                 this->addObjectsToBeRendered({ modelRenderable});
                             }
 
+                            this->serverRenderables[id] = m.value();
                             this->renderer->forceNewTexturesUpload();
                         }
                         break;
@@ -414,6 +602,7 @@ void Engine::handleServerMessages(void * message)
             case MessageUnion_NONE:
             case MessageUnion_ObjectCreateRequest:
             case MessageUnion_ObjectPropertiesUpdateRequest:
+            case MessageUnion_InterestUpdateRequest:
             {
                 // server-side messages - no need to be handled
                 break;
@@ -422,14 +611,21 @@ void Engine::handleServerMessages(void * message)
     }
 }
 
-bool Engine::startNetworking(const std::string ip, const uint16_t broadcastPort, const uint16_t requestPort)
+bool Engine::startNetworking(const std::string ip, const uint16_t broadcastPort, const uint16_t requestPort, const uint16_t shards)
 {
     // connect to remote server
     if (this->client != nullptr) this->client->stop();
 
-    this->client = std::make_unique<CommClient>(ip, broadcastPort, requestPort);
+    this->client = std::make_unique<CommClient>(ip, broadcastPort, requestPort, shards);
     if (this->client == nullptr) return false;
 
+    this->interestGroups.clear();
+    this->pendingInterestGroups.clear();
+    {
+        const std::lock_guard<std::mutex> lock(this->leftInterestCellsMutex);
+        this->leftInterestCells.clear();
+    }
+
     auto handler = [this](void * message) { this->handleServerMessages(message);};
     if (!this->client->start(handler)) return false;
 
@@ -501,6 +697,18 @@ bool Engine::init() {
 
     if (!createDir(TEMP)) return false;
     if (!createDir(MESSAGES)) return false;
+    if (!this->openMessageLog()) return false;
+
+    // opt-in instrumentation: PLAYGROUND_METRICS=<dump interval in seconds>, PLAYGROUND_TRACE=<chrome trace output file>
+    const char * metricsInterval = std::getenv("PLAYGROUND_METRICS");
+    const char * traceFile = std::getenv("PLAYGROUND_TRACE");
+    if (metricsInterval != nullptr || traceFile != nullptr) {
+        this->metricsDumpInterval = metricsInterval != nullptr ? std::max(1, std::atoi(metricsInterval)) * 1000 : 0;
+        this->traceFile = traceFile != nullptr ? traceFile : "";
+        Metrics::INSTANCE()->enable(true);
+        Metrics::INSTANCE()->enableTracing(traceFile != nullptr);
+        logInfo("Metrics enabled" + (traceFile != nullptr ? ", tracing into " + this->traceFile : ""));
+    }
 
     SDL_SetWindowResizable(this->graphics->getSdlWindow(), SDL_FALSE);
 
@@ -582,6 +790,8 @@ void Engine::render(const std::chrono::high_resolution_clock::time_point & frame
     this->renderer->addDeltaTime(now, time_span.count());
 
     if (addFrameToCache) this->lastFrameAddedToCache = this->renderer->getAccumulatedDeltaTime();
+
+    if (this->metricsDumpInterval > 0) Metrics::INSTANCE()->dumpStatsPeriodically(this->metricsDumpInterval);
 }
 
 void Engine::inputLoopSdl() {
@@ -599,6 +809,11 @@ void Engine::inputLoopSdl() {
             this->renderer->setIsConnectedToServer(false);
         }
 
+        if ((now - this->lastInterestUpdate) > 250) {
+            this->updateInterestRegion();
+            this->lastInterestUpdate = now;
+        }
+
         while (SDL_PollEvent(&e) != 0) {
             switch(e.type) {
                 case SDL_KEYDOWN:
@@ -939,6 +1154,13 @@ bool Engine::addPipeline<CullPipeline>(const std::string name, const CullPipelin
     return this->addPipeline0(name, pipe, config, index);
 }
 
+template<>
+bool Engine::addPipeline<AnimationPipeline>(const std::string name, const AnimationPipelineConfig & config, const int index)
+{
+    std::unique_ptr<Pipeline> pipe = std::make_unique<AnimationPipeline>(name, this->renderer);
+    return this->addPipeline0(name, pipe, config, index);
+}
+
 bool Engine::addPipeline0(const std::string & name, std::unique_ptr<Pipeline> & pipe, const PipelineConfig & config, const int & index) {
     if (!pipe->initPipeline(config)) {
         logError("Failed to init Pipeline: " + name);
@@ -1063,7 +1285,20 @@ bool Engine::createModelMeshPipeline(const std::string & name, ModelMeshPipeline
 }
 
 bool Engine::createAnimatedModelMeshPipeline(const std::string & name, AnimatedModelMeshPipelineConfig & graphicsConfig, CullPipelineConfig & cullConfig) {
-    return this->createMeshPipeline0<AnimatedModelMeshPipeline, AnimatedModelMeshPipelineConfig>(name, graphicsConfig, cullConfig);
+    if (!this->createMeshPipeline0<AnimatedModelMeshPipeline, AnimatedModelMeshPipelineConfig>(name, graphicsConfig, cullConfig)) return false;
+
+    auto graphicsPipelineToBeLinked = this->getPipeline<AnimatedModelMeshPipeline>(name);
+    if (graphicsPipelineToBeLinked == nullptr || !graphicsPipelineToBeLinked->usesGpuAnimation()) return true;
+
+    AnimationPipelineConfig animationConfig;
+    animationConfig.linkedGraphicsPipeline = MeshPipelineVariant { graphicsPipelineToBeLinked };
+
+    if (!this->addPipeline<AnimationPipeline>(name + "-animation", animationConfig)) {
+        logError("Failed to create Animation Pipeline for " + name);
+        return false;
+    }
+
+    return true;
 }
 
 bool Engine::addDebugObjectsToBeRendered(const std::vector<ColorMeshRenderable *> & additionalDebugObjectsToBeRendered)
@@ -1074,7 +1309,7 @@ bool Engine::addDebugObjectsToBeRendered(const std::vector<ColorMeshRenderable *
         return false;
     }
 
-    return pipe->addObjectsToBeRendered(additionalDebugObjectsToBeRendered, true);
+    return pipe->addObjectsToBeRendered(additionalDebugObjectsToBeRendered);
 }
 
 bool Engine::addDebugObjectsToBeRendered(const std::vector<VertexMeshRenderable *> & additionalDebugObjectsToBeRendered)
@@ -1085,7 +1320,7 @@ bool Engine::addDebugObjectsToBeRendered(const std::vector<VertexMeshRenderable
         return false;
     }
 
-    return pipe->addObjectsToBeRendered(additionalDebugObjectsToBeRendered, true);
+    return pipe->addObjectsToBeRendered(additionalDebugObjectsToBeRendered);
 }
 
 void Engine::updateDebugObjectRenderable(VertexMeshRenderable * renderable)
@@ -1118,7 +1353,7 @@ bool Engine::addObjectsToBeRendered(const std::vector<ColorMeshRenderable *>& ad
         return false;
     }
 
-    return pipe->addObjectsToBeRendered(additionalObjectsToBeRendered, true);
+    return pipe->addObjectsToBeRendered(additionalObjectsToBeRendered);
 }
 
 bool Engine::addObjectsToBeRendered(const std::vector<TextureMeshRenderable *>& additionalObjectsToBeRendered)
@@ -1131,7 +1366,7 @@ bool Engine::addObjectsToBeRendered(const std::vector<TextureMeshRenderable *>&
         return false;
     }
 
-    return pipe->addObjectsToBeRendered(additionalObjectsToBeRendered, true);
+    return pipe->addObjectsToBeRendered(additionalObjectsToBeRendered);
 }
 
 bool Engine::addObjectsToBeRendered(const std::vector<ModelMeshRenderable *>& additionalObjectsToBeRendered)
@@ -1142,7 +1377,7 @@ bool Engine::addObjectsToBeRendered(const std::vector<ModelMeshRenderable *>& ad
         return false;
     }
 
-    return pipe->addObjectsToBeRendered(additionalObjectsToBeRendered, true);
+    return pipe->addObjectsToBeRendered(additionalObjectsToBeRendered);
 }
 
 bool Engine::addObjectsToBeRendered(const std::vector<AnimatedModelMeshRenderable *>& additionalObjectsToBeRendered)
@@ -1153,7 +1388,40 @@ bool Engine::addObjectsToBeRendered(const std::vector<AnimatedModelMeshRenderabl
         return false;
     }
 
-    return pipe->addObjectsToBeRendered(additionalObjectsToBeRendered, true);
+    return pipe->addObjectsToBeRendered(additionalObjectsToBeRendered);
+}
+
+bool Engine::removeObjectsToBeRendered(const std::vector<ColorMeshRenderable *>& objectsToBeRemoved)
+{
+    auto pipe = this->getPipeline<ColorMeshPipeline>(COLOR_MESH_PIPELINE);
+    if (pipe == nullptr) {
+        logError("Engine lacks a suitable pipeline to remove the objects from!");
+        return false;
+    }
+
+    return pipe->removeObjectsToBeRendered(objectsToBeRemoved);
+}
+
+bool Engine::removeObjectsToBeRendered(const std::vector<TextureMeshRenderable *>& objectsToBeRemoved)
+{
+    auto pipe = this->getPipeline<TextureMeshPipeline>(TEXTURE_MESH_PIPELINE);
+    if (pipe == nullptr) {
+        logError("Engine lacks a suitable pipeline to remove the objects from!");
+        return false;
+    }
+
+    return pipe->removeObjectsToBeRendered(objectsToBeRemoved);
+}
+
+bool Engine::removeObjectsToBeRendered(const std::vector<ModelMeshRenderable *>& objectsToBeRemoved)
+{
+    auto pipe = this->getPipeline<ModelMeshPipeline>(MODELS_PIPELINE);
+    if (pipe == nullptr) {
+        logError("Engine lacks a suitable pipeline to remove the objects from!");
+        return false;
+    }
+
+    return pipe->removeObjectsToBeRendered(objectsToBeRemoved);
 }
 
 template <typename P, typename C>
@@ -1204,6 +1472,9 @@ void Engine::stop()
 }
 
 Engine::~Engine() {
+    // trace events reference names owned by the renderer's frame profiler
+    if (!this->traceFile.empty()) Metrics::INSTANCE()->writeTrace(this->traceFile);
+
     if (this->renderer != nullptr) {
         delete this->renderer;
         this->renderer = nullptr;
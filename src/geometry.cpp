@@ -116,6 +116,7 @@ std::unique_ptr<ColorMeshGeometry> Helper::createSphereColorMeshGeometry(const f
         theta += deltaLat;
     }
 
+    Helper::generateLods(mesh);
     geom->meshes.emplace_back(mesh);
 
     return geom;
@@ -210,6 +211,7 @@ std::unique_ptr<TextureMeshGeometry> Helper::createSphereTextureMeshGeometry(con
         vCoord += 1.0 / latIntervals;
     }
 
+    Helper::generateLods(mesh);
     geom->meshes.emplace_back(mesh);
 
     return geom;
@@ -328,3 +330,599 @@ std::unique_ptr<VertexMeshGeometry> Helper::getBoundingBoxMeshGeometry(const Bou
 
     return lines;
 }
+
+/**
+ *  Tipsify (Sander et al.): fans around the vertex most recently entered into a simulated fifo cache
+ *  that still has triangles left. Returns the first triangle of every run with cache locality (hard clusters)
+ */
+std::vector<uint32_t> Helper::optimizeVertexCache(std::vector<uint32_t> & indices, const size_t vertexCount)
+{
+    const size_t triangleCount = indices.size() / 3;
+
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (const auto & i : indices) liveTriangles[i]++;
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v=0;v<vertexCount;v++) adjacencyOffsets[v+1] = adjacencyOffsets[v] + liveTriangles[v];
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t t=0;t<triangleCount;t++) {
+        for (size_t k=0;k<3;k++) adjacency[adjacencyFill[indices[t*3+k]]++] = t;
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> optimizedIndices;
+    std::vector<uint32_t> clusters;
+    optimizedIndices.reserve(indices.size());
+
+    uint32_t timestamp = VERTEX_CACHE_SIZE + 1;
+    size_t cursor = 0;
+    bool newCluster = true;
+
+    const auto getNextSequentialVertex = [&]() -> int64_t {
+        while (cursor < vertexCount && liveTriangles[cursor] == 0) cursor++;
+        return cursor < vertexCount ? static_cast<int64_t>(cursor) : -1;
+    };
+
+    int64_t vertex = getNextSequentialVertex();
+    while (vertex >= 0) {
+        if (newCluster) {
+            clusters.emplace_back(optimizedIndices.size() / 3);
+            newCluster = false;
+        }
+
+        candidates.clear();
+        for (uint32_t a=adjacencyOffsets[vertex];a<adjacencyOffsets[vertex+1];a++) {
+            const uint32_t t = adjacency[a];
+            if (emitted[t]) continue;
+
+            for (size_t k=0;k<3;k++) {
+                const uint32_t v = indices[t*3+k];
+                optimizedIndices.emplace_back(v);
+                deadEnds.emplace_back(v);
+                candidates.emplace_back(v);
+                liveTriangles[v]--;
+
+                if (timestamp - cacheTime[v] > VERTEX_CACHE_SIZE) cacheTime[v] = timestamp++;
+            }
+            emitted[t] = true;
+        }
+
+        // prefer vertices that will still be in the cache after their remaining triangles are emitted
+        int64_t nextVertex = -1;
+        int64_t bestPriority = -1;
+        for (const auto & v : candidates) {
+            if (liveTriangles[v] == 0) continue;
+
+            int64_t priority = 0;
+            if (timestamp - cacheTime[v] + 2 * liveTriangles[v] <= VERTEX_CACHE_SIZE) priority = timestamp - cacheTime[v];
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                nextVertex = v;
+            }
+        }
+
+        while (nextVertex < 0 && !deadEnds.empty()) {
+            const uint32_t v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[v] > 0) nextVertex = v;
+        }
+
+        if (nextVertex < 0) {
+            nextVertex = getNextSequentialVertex();
+            newCluster = true;
+        }
+
+        vertex = nextVertex;
+    }
+
+    indices = std::move(optimizedIndices);
+
+    return clusters;
+}
+
+/**
+ *  Splits the hard clusters further where their cache locality is close to the average (soft clusters)
+ *  and draws the clusters facing outwards the most first, they are the most likely to occlude the others
+ */
+void Helper::optimizeOverdraw(std::vector<uint32_t> & indices, const std::vector<uint32_t> & clusters, const std::vector<glm::vec3> & positions)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || clusters.empty()) return;
+
+    std::vector<uint32_t> cacheTime(positions.size(), 0);
+    uint32_t timestamp = VERTEX_CACHE_SIZE + 1;
+
+    const auto getCacheMisses = [&](const size_t t) {
+        uint32_t misses = 0;
+        for (size_t k=0;k<3;k++) {
+            const uint32_t v = indices[t*3+k];
+            if (timestamp - cacheTime[v] > VERTEX_CACHE_SIZE) {
+                cacheTime[v] = timestamp++;
+                misses++;
+            }
+        }
+        return misses;
+    };
+
+    uint64_t totalMisses = 0;
+    for (size_t c=0;c<clusters.size();c++) {
+        const size_t end = c + 1 < clusters.size() ? clusters[c+1] : triangleCount;
+
+        timestamp += VERTEX_CACHE_SIZE + 1;
+        for (size_t t=clusters[c];t<end;t++) totalMisses += getCacheMisses(t);
+    }
+    const float averageCacheMissRatio = static_cast<float>(totalMisses) / triangleCount;
+
+    std::vector<uint32_t> softClusters;
+    for (size_t c=0;c<clusters.size();c++) {
+        const size_t end = c + 1 < clusters.size() ? clusters[c+1] : triangleCount;
+
+        timestamp += VERTEX_CACHE_SIZE + 1;
+        size_t clusterStart = clusters[c];
+        uint32_t clusterMisses = 0;
+        softClusters.emplace_back(clusterStart);
+
+        for (size_t t=clusters[c];t<end;t++) {
+            clusterMisses += getCacheMisses(t);
+
+            if (t + 1 < end && clusterMisses <= OVERDRAW_CLUSTER_THRESHOLD * averageCacheMissRatio * (t + 1 - clusterStart)) {
+                clusterStart = t + 1;
+                clusterMisses = 0;
+                softClusters.emplace_back(clusterStart);
+                timestamp += VERTEX_CACHE_SIZE + 1;
+            }
+        }
+    }
+
+    // area weighted centroids and normals
+    std::vector<glm::vec3> clusterCentroids(softClusters.size(), glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(softClusters.size(), glm::vec3(0.0f));
+    std::vector<float> clusterAreas(softClusters.size(), 0.0f);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t c=0;c<softClusters.size();c++) {
+        const size_t end = c + 1 < softClusters.size() ? softClusters[c+1] : triangleCount;
+
+        for (size_t t=softClusters[c];t<end;t++) {
+            const glm::vec3 & p0 = positions[indices[t*3]];
+            const glm::vec3 & p1 = positions[indices[t*3+1]];
+            const glm::vec3 & p2 = positions[indices[t*3+2]];
+
+            const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            const float area = glm::length(normal);
+            const glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+
+            clusterCentroids[c] += centroid * area;
+            clusterNormals[c] += normal;
+            clusterAreas[c] += area;
+            meshCentroid += centroid * area;
+            meshArea += area;
+        }
+    }
+
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    std::vector<float> clusterSortKeys(softClusters.size(), 0.0f);
+    for (size_t c=0;c<softClusters.size();c++) {
+        if (clusterAreas[c] <= 0.0f || glm::length(clusterNormals[c]) == 0.0f) continue;
+
+        clusterSortKeys[c] = glm::dot(clusterCentroids[c] / clusterAreas[c] - meshCentroid, glm::normalize(clusterNormals[c]));
+    }
+
+    std::vector<uint32_t> clusterOrder(softClusters.size());
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&clusterSortKeys](const uint32_t & a, const uint32_t & b) {
+        return clusterSortKeys[a] > clusterSortKeys[b];
+    });
+
+    std::vector<uint32_t> sortedIndices;
+    sortedIndices.reserve(indices.size());
+    for (const auto & c : clusterOrder) {
+        const size_t end = c + 1 < softClusters.size() ? softClusters[c+1] : triangleCount;
+        sortedIndices.insert(sortedIndices.end(), indices.begin() + softClusters[c] * 3, indices.begin() + end * 3);
+    }
+
+    indices = std::move(sortedIndices);
+}
+
+/**
+ *  Renumbers the vertices in order of first use, unused ones keep their relative order at the end.
+ *  Returns the old index of every vertex
+ */
+std::vector<uint32_t> Helper::optimizeVertexFetch(std::vector<uint32_t> & indices, const size_t vertexCount)
+{
+    std::vector<uint32_t> remap(vertexCount, std::numeric_limits<uint32_t>::max());
+    std::vector<uint32_t> order;
+    order.reserve(vertexCount);
+
+    for (auto & i : indices) {
+        if (remap[i] == std::numeric_limits<uint32_t>::max()) {
+            remap[i] = order.size();
+            order.emplace_back(i);
+        }
+        i = remap[i];
+    }
+
+    for (size_t v=0;v<vertexCount;v++) {
+        if (remap[v] == std::numeric_limits<uint32_t>::max()) order.emplace_back(v);
+    }
+
+    return order;
+}
+
+/**
+ *  Quadric error metric simplification (Garland & Heckbert) collapsing edges onto one of their vertices,
+ *  so that the result still indexes the given vertices. Vertices on borders (which includes attribute seams) stay put.
+ *  Stops at the target index count or once the error, relative to the mesh extent, would exceed the given one
+ */
+std::vector<uint32_t> Helper::simplifyMesh(const std::vector<uint32_t> & indices, const std::vector<glm::vec3> & positions, const size_t targetIndexCount, const float maxError)
+{
+    const size_t triangleCount = indices.size() / 3;
+    const size_t vertexCount = positions.size();
+    if (triangleCount == 0 || indices.size() <= targetIndexCount) return indices;
+
+    // upper triangle of the symmetric 4x4 plane matrix and the accumulated triangle area
+    using Quadric = std::array<double, 11>;
+    std::vector<Quadric> quadrics(vertexCount, Quadric {});
+
+    glm::vec3 minPosition = positions[indices[0]];
+    glm::vec3 maxPosition = minPosition;
+    for (size_t t=0;t<triangleCount;t++) {
+        const glm::dvec3 p0 = positions[indices[t*3]];
+        const glm::dvec3 p1 = positions[indices[t*3+1]];
+        const glm::dvec3 p2 = positions[indices[t*3+2]];
+
+        const glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const double length = glm::length(normal);
+        if (length == 0.0) continue;
+
+        const glm::dvec3 n = normal / length;
+        const double d = -glm::dot(n, p0);
+        const double area = length * 0.5;
+        const Quadric plane = {
+            n.x * n.x, n.x * n.y, n.x * n.z, n.x * d,
+            n.y * n.y, n.y * n.z, n.y * d,
+            n.z * n.z, n.z * d,
+            d * d, 1.0
+        };
+
+        for (size_t k=0;k<3;k++) {
+            const uint32_t v = indices[t*3+k];
+            for (size_t q=0;q<plane.size();q++) quadrics[v][q] += plane[q] * area;
+
+            minPosition = glm::min(minPosition, positions[v]);
+            maxPosition = glm::max(maxPosition, positions[v]);
+        }
+    }
+
+    const double extent = glm::length(maxPosition - minPosition) * maxError;
+    const double errorLimit = extent * extent;
+
+    // mean squared distance to the planes of the triangles merged into the vertex
+    const auto getError = [&](const Quadric & q, const glm::vec3 & p) -> double {
+        if (q[10] == 0.0) return 0.0;
+
+        const double x = p.x, y = p.y, z = p.z;
+        const double error =
+            q[0] * x * x + q[4] * y * y + q[7] * z * z +
+            2.0 * (q[1] * x * y + q[2] * x * z + q[5] * y * z) +
+            2.0 * (q[3] * x + q[6] * y + q[8] * z) + q[9];
+
+        return glm::max(error, 0.0) / q[10];
+    };
+
+    // edges that are not shared by exactly two triangles lock both their vertices
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t t=0;t<triangleCount;t++) {
+        for (size_t k=0;k<3;k++) {
+            const uint64_t a = indices[t*3+k];
+            const uint64_t b = indices[t*3+(k+1)%3];
+            edges.emplace_back(a < b ? (a << 32) | b : (b << 32) | a);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    std::vector<bool> locked(vertexCount, false);
+    for (size_t e=0;e<edges.size();) {
+        size_t next = e + 1;
+        while (next < edges.size() && edges[next] == edges[e]) next++;
+        if (next - e != 2) {
+            locked[edges[e] >> 32] = true;
+            locked[edges[e] & 0xffffffff] = true;
+        }
+        e = next;
+    }
+
+    std::vector<uint32_t> triangles(indices.begin(), indices.begin() + triangleCount * 3);
+    std::vector<bool> removed(triangleCount, false);
+    std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+    for (size_t t=0;t<triangleCount;t++) {
+        for (size_t k=0;k<3;k++) vertexTriangles[triangles[t*3+k]].emplace_back(t);
+    }
+
+    struct Collapse {
+        double error;
+        uint32_t from;
+        uint32_t to;
+        uint32_t fromVersion;
+        uint32_t toVersion;
+
+        bool operator>(const Collapse & other) const { return this->error > other.error; };
+    };
+
+    std::vector<uint32_t> versions(vertexCount, 0);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> collapses;
+
+    const auto getCollapseError = [&](const uint32_t from, const uint32_t to) -> double {
+        Quadric q = quadrics[from];
+        for (size_t i=0;i<q.size();i++) q[i] += quadrics[to][i];
+        return getError(q, positions[to]);
+    };
+
+    const auto pushCollapses = [&](const uint32_t v) {
+        for (const auto & t : vertexTriangles[v]) {
+            if (removed[t]) continue;
+
+            for (size_t k=0;k<3;k++) {
+                const uint32_t n = triangles[t*3+k];
+                if (n == v) continue;
+
+                if (!locked[v]) collapses.push({ getCollapseError(v, n), v, n, versions[v], versions[n] });
+                if (!locked[n]) collapses.push({ getCollapseError(n, v), n, v, versions[n], versions[v] });
+            }
+        }
+    };
+
+    for (size_t v=0;v<vertexCount;v++) {
+        if (locked[v]) continue;
+
+        for (const auto & t : vertexTriangles[v]) {
+            for (size_t k=0;k<3;k++) {
+                const uint32_t n = triangles[t*3+k];
+                if (n != v) collapses.push({ getCollapseError(v, n), static_cast<uint32_t>(v), n, 0, 0 });
+            }
+        }
+    }
+
+    // the edge has to be interior (two common neighbours) and no triangle may flip when moving onto the other vertex
+    std::vector<uint32_t> fromNeighbours;
+    std::vector<uint32_t> toNeighbours;
+    const auto isValidCollapse = [&](const uint32_t from, const uint32_t to) -> bool {
+        fromNeighbours.clear();
+        for (const auto & t : vertexTriangles[from]) {
+            if (removed[t]) continue;
+            for (size_t k=0;k<3;k++) {
+                if (triangles[t*3+k] != from) fromNeighbours.emplace_back(triangles[t*3+k]);
+            }
+        }
+        std::sort(fromNeighbours.begin(), fromNeighbours.end());
+        fromNeighbours.erase(std::unique(fromNeighbours.begin(), fromNeighbours.end()), fromNeighbours.end());
+
+        uint32_t commonNeighbours = 0;
+        toNeighbours.clear();
+        for (const auto & t : vertexTriangles[to]) {
+            if (removed[t]) continue;
+            for (size_t k=0;k<3;k++) {
+                const uint32_t n = triangles[t*3+k];
+                if (n == to || std::find(toNeighbours.begin(), toNeighbours.end(), n) != toNeighbours.end()) continue;
+                toNeighbours.emplace_back(n);
+                if (std::binary_search(fromNeighbours.begin(), fromNeighbours.end(), n)) commonNeighbours++;
+            }
+        }
+        if (commonNeighbours != 2) return false;
+
+        for (const auto & t : vertexTriangles[from]) {
+            if (removed[t]) continue;
+
+            const uint32_t i0 = triangles[t*3], i1 = triangles[t*3+1], i2 = triangles[t*3+2];
+            if (i0 == to || i1 == to || i2 == to) continue;
+
+            const glm::vec3 & p0 = positions[i0];
+            const glm::vec3 & p1 = positions[i1];
+            const glm::vec3 & p2 = positions[i2];
+            const glm::vec3 before = glm::cross(p1 - p0, p2 - p0);
+
+            const glm::vec3 & q0 = positions[i0 == from ? to : i0];
+            const glm::vec3 & q1 = positions[i1 == from ? to : i1];
+            const glm::vec3 & q2 = positions[i2 == from ? to : i2];
+            const glm::vec3 after = glm::cross(q1 - q0, q2 - q0);
+
+            if (glm::dot(before, after) <= 0.0f) return false;
+        }
+
+        return true;
+    };
+
+    size_t liveTriangles = triangleCount;
+    while (liveTriangles * 3 > targetIndexCount && !collapses.empty()) {
+        const Collapse collapse = collapses.top();
+        collapses.pop();
+
+        if (collapse.fromVersion != versions[collapse.from] || collapse.toVersion != versions[collapse.to]) continue;
+        if (collapse.error > errorLimit) break;
+        if (!isValidCollapse(collapse.from, collapse.to)) continue;
+
+        for (const auto & t : vertexTriangles[collapse.from]) {
+            if (removed[t]) continue;
+
+            bool hasTo = false;
+            for (size_t k=0;k<3;k++) hasTo = hasTo || triangles[t*3+k] == collapse.to;
+
+            if (hasTo) {
+                removed[t] = true;
+                liveTriangles--;
+                continue;
+            }
+
+            for (size_t k=0;k<3;k++) {
+                if (triangles[t*3+k] == collapse.from) triangles[t*3+k] = collapse.to;
+            }
+            vertexTriangles[collapse.to].emplace_back(t);
+        }
+
+        vertexTriangles[collapse.from].clear();
+        for (size_t i=0;i<quadrics[collapse.to].size();i++) quadrics[collapse.to][i] += quadrics[collapse.from][i];
+        locked[collapse.from] = true;
+        versions[collapse.from]++;
+        versions[collapse.to]++;
+
+        pushCollapses(collapse.to);
+    }
+
+    std::vector<uint32_t> simplifiedIndices;
+    simplifiedIndices.reserve(liveTriangles * 3);
+    for (size_t t=0;t<triangleCount;t++) {
+        if (removed[t]) continue;
+        simplifiedIndices.insert(simplifiedIndices.end(), triangles.begin() + t*3, triangles.begin() + t*3 + 3);
+    }
+
+    return simplifiedIndices;
+}
+
+/**
+ *  Grows clusters of at most MESH_CLUSTER_TRIANGLES connected triangles, each time taking the neighbour closest
+ *  to the cluster's centroid, and reorders the indices cluster by cluster (triangles keep their order within one).
+ *  Every cluster gets a bounding sphere and a cone around its triangle normals for backface culling
+ */
+std::vector<MeshCluster> Helper::buildMeshClusters(std::vector<uint32_t> & indices, const std::vector<glm::vec3> & positions)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return {};
+
+    // the triangles using every vertex
+    std::vector<uint32_t> vertexTriangleOffsets(positions.size() + 1, 0);
+    for (const auto & i : indices) vertexTriangleOffsets[i + 1]++;
+    for (size_t v=0;v<positions.size();v++) vertexTriangleOffsets[v + 1] += vertexTriangleOffsets[v];
+
+    std::vector<uint32_t> vertexTriangles(triangleCount * 3);
+    std::vector<uint32_t> nextVertexTriangle(vertexTriangleOffsets.begin(), vertexTriangleOffsets.end() - 1);
+    for (size_t t=0;t<triangleCount;t++) {
+        for (size_t k=0;k<3;k++) vertexTriangles[nextVertexTriangle[indices[t * 3 + k]]++] = t;
+    }
+
+    std::vector<glm::vec3> triangleCentroids(triangleCount);
+    for (size_t t=0;t<triangleCount;t++) {
+        triangleCentroids[t] = (positions[indices[t * 3]] + positions[indices[t * 3 + 1]] + positions[indices[t * 3 + 2]]) / 3.0f;
+    }
+
+    std::vector<bool> assigned(triangleCount, false);
+    std::vector<uint32_t> candidateOf(triangleCount, UINT32_MAX);
+    std::vector<uint32_t> clusterTriangles;
+    clusterTriangles.reserve(triangleCount);
+    std::vector<uint32_t> clusterStarts;
+
+    size_t seed = 0;
+    while (true) {
+        while (seed < triangleCount && assigned[seed]) seed++;
+        if (seed == triangleCount) break;
+
+        const uint32_t cluster = clusterStarts.size();
+        clusterStarts.emplace_back(clusterTriangles.size());
+
+        std::vector<uint32_t> members;
+        std::vector<uint32_t> candidates;
+        glm::vec3 centroidSum(0.0f);
+
+        uint32_t next = seed;
+        while (true) {
+            assigned[next] = true;
+            members.emplace_back(next);
+            centroidSum += triangleCentroids[next];
+            if (members.size() >= MESH_CLUSTER_TRIANGLES) break;
+
+            for (size_t k=0;k<3;k++) {
+                const uint32_t v = indices[next * 3 + k];
+                for (uint32_t j=vertexTriangleOffsets[v];j<vertexTriangleOffsets[v + 1];j++) {
+                    const uint32_t t = vertexTriangles[j];
+                    if (assigned[t] || candidateOf[t] == cluster) continue;
+
+                    candidateOf[t] = cluster;
+                    candidates.emplace_back(t);
+                }
+            }
+
+            if (candidates.empty()) break;
+
+            const glm::vec3 centroid = centroidSum / static_cast<float>(members.size());
+            size_t best = 0;
+            float bestDistance = std::numeric_limits<float>::max();
+            for (size_t c=0;c<candidates.size();c++) {
+                const glm::vec3 delta = triangleCentroids[candidates[c]] - centroid;
+                const float distance = glm::dot(delta, delta);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = c;
+                }
+            }
+
+            next = candidates[best];
+            candidates[best] = candidates.back();
+            candidates.pop_back();
+        }
+
+        std::sort(members.begin(), members.end());
+        clusterTriangles.insert(clusterTriangles.end(), members.begin(), members.end());
+    }
+    clusterStarts.emplace_back(clusterTriangles.size());
+
+    std::vector<uint32_t> clusteredIndices;
+    clusteredIndices.reserve(indices.size());
+    for (const auto & t : clusterTriangles) clusteredIndices.insert(clusteredIndices.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+    indices = std::move(clusteredIndices);
+
+    std::vector<MeshCluster> clusters;
+    clusters.reserve(clusterStarts.size() - 1);
+    for (size_t c=0;c<clusterStarts.size() - 1;c++) {
+        MeshCluster cluster {};
+        cluster.indexOffset = clusterStarts[c] * 3;
+        cluster.indexCount = (clusterStarts[c + 1] - clusterStarts[c]) * 3;
+
+        glm::vec3 minPosition(std::numeric_limits<float>::max());
+        glm::vec3 maxPosition(std::numeric_limits<float>::lowest());
+        for (uint32_t i=cluster.indexOffset;i<cluster.indexOffset + cluster.indexCount;i++) {
+            minPosition = glm::min(minPosition, positions[indices[i]]);
+            maxPosition = glm::max(maxPosition, positions[indices[i]]);
+        }
+
+        cluster.center = (minPosition + maxPosition) * 0.5f;
+        for (uint32_t i=cluster.indexOffset;i<cluster.indexOffset + cluster.indexCount;i++) {
+            cluster.radius = std::max(cluster.radius, glm::distance(positions[indices[i]], cluster.center));
+        }
+
+        // counter clockwise front faces, degenerate triangles are never rasterized and don't count
+        std::vector<glm::vec3> normals;
+        glm::vec3 normalSum(0.0f);
+        for (uint32_t i=cluster.indexOffset;i<cluster.indexOffset + cluster.indexCount;i+=3) {
+            const glm::vec3 & p0 = positions[indices[i]];
+            const glm::vec3 normal = glm::cross(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0);
+            const float length = glm::length(normal);
+            if (length <= std::numeric_limits<float>::epsilon()) continue;
+
+            normals.emplace_back(normal / length);
+            normalSum += normals.back();
+        }
+
+        cluster.coneCutoff = 1.0f;
+        const float axisLength = glm::length(normalSum);
+        if (!normals.empty() && axisLength > std::numeric_limits<float>::epsilon()) {
+            cluster.coneAxis = normalSum / axisLength;
+
+            float minDot = 1.0f;
+            for (const auto & n : normals) minDot = std::min(minDot, glm::dot(n, cluster.coneAxis));
+
+            // the sine of the widest angle to the axis, from 90 degrees on the cluster is always partly front facing
+            if (minDot > 0.0f) cluster.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+
+        clusters.emplace_back(cluster);
+    }
+
+    return clusters;
+}
@@ -183,11 +183,43 @@ void ImGuiPipeline::draw(const VkCommandBuffer & commandBuffer, const uint16_t c
                     memStat = m.name + " Indirect:\t" + Helper::formatMemoryUsage(m.indirectBufferTotal, true) + (m.indirectBufferUsesDeviceLocal ? "[GPU]" : "[HOST]");
                     ImGui::Text("%s", memStat.c_str());
                 }
+
+                if (m.allocatorTotal > 0) {
+                    memStat = m.name + " Allocator:\t" + Helper::formatMemoryUsage(m.allocatorUsed, true) + "/" + Helper::formatMemoryUsage(m.allocatorTotal, true) +
+                        " [" + std::to_string(m.allocatorBlocks) + " blocks|" + std::to_string(m.allocatorDedicated) + " dedicated|" +
+                        std::to_string(static_cast<int>(m.allocatorFragmentation * 100)) + "% frag]";
+                    ImGui::Text("%s", memStat.c_str());
+                }
             }
 
             ImGui::End();
         }
 
+        ImGui::SetNextWindowPos(ImVec2(0.5f, 205.0f), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(350.0f, 0.0f), ImGuiCond_Always);
+
+        if (!this->renderer->isPaused() && ImGui::Begin("##profilerContent", &flag,
+                ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_AlwaysAutoResize)) {
+
+            const auto & frameProfiler = this->renderer->getFrameProfiler();
+
+            double cpuTotal = 0.0;
+            for (const auto & t : frameProfiler.getCpuTimings()) {
+                ImGui::Text("%s:\t%.3f ms", t.first, t.second);
+                if (std::string(t.first).rfind("cpu.", 0) == 0) cpuTotal += t.second;
+            }
+            ImGui::Text("CPU Frame:\t%.3f ms", cpuTotal);
+
+            double gpuTotal = 0.0;
+            for (const auto & t : frameProfiler.getGpuTimings()) {
+                ImGui::Text("%s:\t%.3f ms", t.first, t.second);
+                gpuTotal += t.second;
+            }
+            if (gpuTotal > 0.0) ImGui::Text("GPU Frame:\t%.3f ms", gpuTotal);
+
+            ImGui::End();
+        }
+
         if (this->renderer->isRecording()) {
             bool show = this->lastRecordingShow >= 0 && !this->renderer->getCachedFrames().empty();
             if (show) {
@@ -237,6 +269,10 @@ bool ImGuiPipeline::canRender() const {
 
 void ImGuiPipeline::update() { }
 
+bool ImGuiPipeline::hasStaticCommands() const {
+    return false;
+}
+
 ImGuiPipeline::~ImGuiPipeline() {
     ImGui_ImplVulkan_Shutdown();
     ImGui_ImplSDL2_Shutdown();
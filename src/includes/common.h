@@ -17,6 +17,7 @@
 
 #include <string>
 #include <thread>
+#include <condition_variable>
 #include <queue>
 #include <set>
 #include <signal.h>
@@ -25,6 +26,7 @@
 #include <filesystem>
 #include <any>
 #include <unordered_map>
+#include <array>
 
 #include "unordered_dense.h"
 
@@ -36,6 +38,10 @@ static constexpr float NEG_INF = - std::numeric_limits<float>::infinity();
 
 static const int UNIFORM_GRID_CELL_LENGTH = 10;
 
+static const int INTEREST_GRID_CELL_LENGTH = 10 * UNIFORM_GRID_CELL_LENGTH;
+static constexpr float INTEREST_RADIUS = 500.0f;
+static constexpr float INTEREST_HYSTERESIS = 100.0f;
+
 enum ObjectType {
     MODEL, SPHERE, BOX
 };
@@ -66,6 +72,78 @@ static std::filesystem::path getAppPath(std::filesystem::path base, APP_PATHS ap
     }
 }
 
+// interest cells are columns on the xz plane, each one maps to its own broadcast group
+static glm::ivec2 getInterestCell(const glm::vec3 & position) {
+    return glm::ivec2(
+        static_cast<int>(std::floor(position.x / INTEREST_GRID_CELL_LENGTH)),
+        static_cast<int>(std::floor(position.z / INTEREST_GRID_CELL_LENGTH))
+    );
+}
+
+static std::string getInterestGroup(const glm::ivec2 & cell) {
+    return "cell" + std::to_string(cell.x) + "|" + std::to_string(cell.y);
+}
+
+static float getDistanceToInterestCell(const glm::vec3 & position, const glm::ivec2 & cell) {
+    const glm::vec2 min = glm::vec2(cell) * static_cast<float>(INTEREST_GRID_CELL_LENGTH);
+    const glm::vec2 max = min + static_cast<float>(INTEREST_GRID_CELL_LENGTH);
+    const glm::vec2 xz = glm::vec2(position.x, position.z);
+
+    return glm::distance(xz, glm::clamp(xz, min, max));
+}
+
+// shards own stripes along x that are aligned with the interest cells, assigned round robin
+static const int SHARD_STRIPE_LENGTH = INTEREST_GRID_CELL_LENGTH;
+static constexpr float SHARD_MIRROR_MARGIN = 2.0f * UNIFORM_GRID_CELL_LENGTH;
+
+static uint16_t getShardForPosition(const glm::vec3 & position, const uint16_t shards) {
+    if (shards <= 1) return 0;
+
+    const int stripe = static_cast<int>(std::floor(position.x / SHARD_STRIPE_LENGTH));
+    return static_cast<uint16_t>(((stripe % shards) + shards) % shards);
+}
+
+// normalized planes (left, right, bottom, top, near, far) of the frustum given by a view projection matrix
+static std::array<glm::vec4, 6> extractFrustumPlanes(const glm::mat4 & matrix) {
+    std::array<glm::vec4, 6> frustum;
+
+    frustum[0].x = matrix[0].w + matrix[0].x;
+    frustum[0].y = matrix[1].w + matrix[1].x;
+    frustum[0].z = matrix[2].w + matrix[2].x;
+    frustum[0].w = matrix[3].w + matrix[3].x;
+
+    frustum[1].x = matrix[0].w - matrix[0].x;
+    frustum[1].y = matrix[1].w - matrix[1].x;
+    frustum[1].z = matrix[2].w - matrix[2].x;
+    frustum[1].w = matrix[3].w - matrix[3].x;
+
+    frustum[2].x = matrix[0].w - matrix[0].y;
+    frustum[2].y = matrix[1].w - matrix[1].y;
+    frustum[2].z = matrix[2].w - matrix[2].y;
+    frustum[2].w = matrix[3].w - matrix[3].y;
+
+    frustum[3].x = matrix[0].w + matrix[0].y;
+    frustum[3].y = matrix[1].w + matrix[1].y;
+    frustum[3].z = matrix[2].w + matrix[2].y;
+    frustum[3].w = matrix[3].w + matrix[3].y;
+
+    frustum[4].x = matrix[0].w + matrix[0].z;
+    frustum[4].y = matrix[1].w + matrix[1].z;
+    frustum[4].z = matrix[2].w + matrix[2].z;
+    frustum[4].w = matrix[3].w + matrix[3].z;
+
+    frustum[5].x = matrix[0].w - matrix[0].z;
+    frustum[5].y = matrix[1].w - matrix[1].z;
+    frustum[5].z = matrix[2].w - matrix[2].z;
+    frustum[5].w = matrix[3].w - matrix[3].z;
+
+    for (uint32_t i = 0; i < frustum.size(); i++) {
+        float length = sqrtf(frustum[i].x * frustum[i].x + frustum[i].y * frustum[i].y + frustum[i].z * frustum[i].z);
+        frustum[i] /= length;
+    }
+
+    return frustum;
+}
 
 struct Vertex {
     glm::vec3 position;
@@ -215,6 +293,7 @@ class AnimationData {
         std::string currentAnimation = "";
         float currentAnimationTime = 0.0f;
 
+        std::vector<glm::mat4> jointMatrices;
         std::vector<glm::mat4> animationMatrices;
 
         void calculateJointTransformation(const std::string & animation, const float & animationTime, const NodeInformation & node, std::vector<glm::mat4> & jointTransformations, const glm::mat4 & parentTransformation) {
@@ -324,45 +403,81 @@ class AnimationData {
             this->needsAnimationRecalculation = true;
         }
 
-        bool calculateAnimationMatrices() {
+        /**
+         *  Calculates the joint palette (one matrix per joint) for the current animation time.
+         *  Sufficient if the blending per vertex is done elsewhere, e.g. in the vertex shader.
+         */
+        bool calculateJointMatrices() {
             if (!this->needsAnimationRecalculation || !this->animations.contains(this->currentAnimation) ) {
                 this->needsAnimationRecalculation = false;
                 return false;
             }
 
-            this->animationMatrices = std::vector<glm::mat4>(this->vertexJointInfo.size(), glm::mat4(1.0f));
+            this->jointMatrices = std::vector<glm::mat4>(this->joints.size(), glm::mat4(1.0f));
 
-            std::vector<glm::mat4> jointTransforms = std::vector<glm::mat4>(this->joints.size(), glm::mat4(1.0f));
+            this->calculateJointTransformation(this->currentAnimation, this->currentAnimationTime, this->rootNode, this->jointMatrices, glm::mat4(1));
 
-            this->calculateJointTransformation(this->currentAnimation, this->currentAnimationTime, this->rootNode, jointTransforms, glm::mat4(1));
+            // the palette is capped, vertices referencing joints beyond it remain unanimated
+            if (this->jointMatrices.size() > MAX_JOINTS) this->jointMatrices.resize(MAX_JOINTS);
 
-            for (uint32_t i=0;i<this->vertexJointInfo.size();i++) {
-                const VertexJointInfo & jointInfo = this->vertexJointInfo[i];
-                glm::mat4 jointTransform = glm::mat4(1.0f);
+            this->needsAnimationRecalculation = false;
 
-                if (jointInfo.weights.x > 0.0) {
-                    jointTransform += jointTransforms[jointInfo.vertexIds.x] * jointInfo.weights.x;
-                }
+            return true;
+        }
 
-                if (jointInfo.weights.y > 0.0) {
-                    jointTransform += jointTransforms[jointInfo.vertexIds.y] * jointInfo.weights.y;
-                }
+        void blendAnimationMatrices() {
+            this->animationMatrices = std::vector<glm::mat4>(this->vertexJointInfo.size(), glm::mat4(1.0f));
 
-                if (jointInfo.weights.z > 0.0) {
-                    jointTransform += jointTransforms[jointInfo.vertexIds.z] * jointInfo.weights.z;
-                }
+            const uint32_t nrOfJoints = this->jointMatrices.size();
+            for (uint32_t i=0;i<this->vertexJointInfo.size();i++) {
+                const VertexJointInfo & jointInfo = this->vertexJointInfo[i];
+                glm::mat4 jointTransform = glm::mat4(1.0f);
 
-                if (jointInfo.weights.w > 0.0) {
-                    jointTransform += jointTransforms[jointInfo.vertexIds.w] * jointInfo.weights.w;
+                for (uint32_t j=0;j<4;j++) {
+                    if (jointInfo.weights[j] > 0.0 && jointInfo.vertexIds[j] < nrOfJoints) {
+                        jointTransform += this->jointMatrices[jointInfo.vertexIds[j]] * jointInfo.weights[j];
+                    }
                 }
 
                 this->animationMatrices[i] = jointTransform;
             }
+        }
 
-            this->needsAnimationRecalculation = false;
+        bool calculateAnimationMatrices() {
+            if (!this->calculateJointMatrices()) return false;
+
+            this->blendAnimationMatrices();
 
             return true;
         }
+
+        const std::vector<glm::mat4> & getJointMatrices() const {
+            return this->jointMatrices;
+        }
+
+        const std::vector<VertexJointInfo> & getVertexJointInfo() const {
+            return this->vertexJointInfo;
+        }
+
+        const std::vector<JointInformation> & getJoints() const {
+            return this->joints;
+        }
+
+        const std::unordered_map<std::string, uint32_t> & getJointIndexByName() const {
+            return this->jointIndexByName;
+        }
+
+        const std::unordered_map<std::string, AnimationInformation> & getAnimations() const {
+            return this->animations;
+        }
+
+        const NodeInformation & getRootNode() const {
+            return this->rootNode;
+        }
+
+        const glm::mat4 & getRootInverseTransformation() const {
+            return this->rootInverseTransformation;
+        }
 };
 
 template<typename T>
@@ -439,6 +554,14 @@ class GlobalObjectStore {
             return this->objects.size();
         };
 
+        // deletes all objects, nothing may hold on to any of them any longer
+        void clear() {
+            const std::lock_guard<std::mutex> lock(this->registrationMutex);
+
+            this->lookupObjectsById.clear();
+            this->objects.clear();
+        };
+
         std::vector<std::unique_ptr<T>> getObjects() {
             return this->objects;
         };
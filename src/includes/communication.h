@@ -2,10 +2,12 @@
 #define SRC_INCLUDES_COMMUNICATION_INCL_H_
 
 #include "logging.h"
+#include "metrics.h"
 #include <zmq.h>
 #include "message.h"
 
 #include <queue>
+#include <deque>
 #include <chrono>
 #include <thread>
 #include <functional>
@@ -13,11 +15,16 @@
 #include <random>
 #include <string.h>
 #include <variant>
+#include <set>
+#include <mutex>
 
 static constexpr uint32_t DEBUG_SPHERE = 0x00000001;
 static constexpr uint32_t DEBUG_BBOX = 0x00000010;
 static constexpr uint32_t DEBUG_BOUNDING = DEBUG_SPHERE | DEBUG_BBOX;
 
+static const std::string BROADCAST_GROUP = "broadcast";
+static constexpr int REQUEST_REPLY_TIMEOUT = 2000;
+
 class Communication {
     private:
         static std::default_random_engine default_random_engine;
@@ -46,11 +53,35 @@ class Communication {
 
 class CommClient : public Communication {
     private:
-        void * tcpContext;
-        void * tcpSocket;
+        void * tcpContext = nullptr;
+        std::vector<void *> tcpSockets;
+        std::vector<std::string> shardRequestAddresses;
+
+        void * broadcastDish = nullptr;
+        std::mutex groupMutex;
+        std::set<std::string> groups { BROADCAST_GROUP };
+
+        // joined by us alone, the server sends what we request a snapshot of there
+        std::string replyGroup;
+
+        // requests of sendAsync, the first one is in flight until all its replies are in or the timeout is reached
+        struct AsyncRequest {
+            std::vector<uint8_t> data;
+            std::function<void (void*)> callback;
+        };
+        std::deque<AsyncRequest> asyncRequests;
+        std::vector<zmq_pollitem_t> asyncPendingReplies;
+        size_t asyncNumberOfPendingReplies = 0;
+        uint64_t asyncDeadline = 0;
+        void * asyncReply = nullptr;
+        bool asyncInFlight = false;
+        bool asyncFailed = false;
 
         bool startBroadcastListener(std::function<void(void*)> messageHandler);
         bool startTcp();
+        bool sendToAllShards(const void * data, const size_t size, std::vector<zmq_pollitem_t> & pendingReplies);
+        bool receiveReplies(std::vector<zmq_pollitem_t> & pendingReplies, size_t & numberOfPendingReplies, const long timeout, void ** firstReply);
+        bool sendToShards(const void * data, const size_t size, void ** firstReply = nullptr);
 
     public:
         CommClient(const CommClient&) = delete;
@@ -58,12 +89,20 @@ class CommClient : public Communication {
         CommClient(CommClient &&) = delete;
         CommClient & operator=(CommClient) = delete;
 
-        CommClient(const std::string ip, const uint16_t broadcastPort = 3000, const uint16_t requestPort = 3001) : Communication(ip, broadcastPort, requestPort) {};
+        CommClient(const std::string ip, const uint16_t broadcastPort = 3000, const uint16_t requestPort = 3001, const uint16_t shards = 1);
 
         void sendBlocking(std::shared_ptr<flatbuffers::FlatBufferBuilder> & message, const std::function<void (void*)> & callback);
         void sendBlockingWithoutAck(void * data, const size_t size);
+        void sendAsync(std::shared_ptr<flatbuffers::FlatBufferBuilder> & message, const std::function<void (void*)> & callback);
+        void pollAsyncRequests();
+
+        void joinGroup(const std::string & group);
+        void leaveGroup(const std::string & group);
+        std::vector<std::string> getGroups();
+        const std::string & getReplyGroup() const;
 
         bool start(std::function<void(void*)> messageHandler);
+        bool startWithoutBroadcast();
         void stop();
 };
 
@@ -77,7 +116,7 @@ class CommServer : public Communication {
 
         bool startBroadcast();
         bool startRequestListener(std::function<void(void*)> messageHandler);
-        void sendBlocking(std::shared_ptr<flatbuffers::FlatBufferBuilder> & message);
+        void sendBlocking(std::shared_ptr<flatbuffers::FlatBufferBuilder> & message, const std::string & group);
 
     public:
         CommServer(const CommServer&) = delete;
@@ -87,7 +126,7 @@ class CommServer : public Communication {
 
         CommServer(const std::string ip, const uint16_t broadcastPort = 3000, const uint16_t requestPort = 3001) : Communication(ip, broadcastPort, requestPort) {};
 
-        void send(std::shared_ptr<flatbuffers::FlatBufferBuilder> & message);
+        void send(std::shared_ptr<flatbuffers::FlatBufferBuilder> & message, const std::string & group = BROADCAST_GROUP);
 
         bool start(std::function<void(void*)> messageHandler);
         void stop();
@@ -105,6 +144,7 @@ using MessageVariant = std::variant<const ObjectCreateRequest *, const ObjectCre
 
 class CommCenter final {
     private:
+        std::mutex messagesMutex;
         std::queue<void*> messages;
 
         static inline const flatbuffers::Offset<ObjectProperties> createObjectProperties(CommBuilder & builder, const std::string id, const Vec3 location, const Vec3 rotation, const float scale);
@@ -134,6 +174,8 @@ class CommCenter final {
 
         static void addObjectPropertiesUpdateRequest(CommBuilder & builder, const std::string id, const Vec3 position, const Vec3 rotation = {0.0f,0.0f,0.0f}, const float scaling = 1.0f, const std::string animation="", const float animationTime = 0.0f);
 
+        static void addInterestUpdateRequest(CommBuilder & builder, const std::string & replyGroup, const std::vector<std::string> & cells);
+
         void queueMessages(void * message);
         void * getNextMessage();
 
@@ -3,6 +3,7 @@
 
 #include "pipeline.h"
 #include "models.h"
+#include "journal.h"
 
 #include <atomic>
 
@@ -19,20 +20,43 @@ class Engine final {
         std::queue<std::shared_ptr<flatbuffers::FlatBufferBuilder>> failedMessages;
 
         void addMessageLog(std::shared_ptr<flatbuffers::FlatBufferBuilder> & builder);
-        std::mutex messageLogMutex;
-        std::vector<std::string> messageLogs;
+        MessageJournal messageJournal;
+
+        ankerl::unordered_dense::map<std::string, glm::ivec2> interestGroups;
+
+        // the first renderable created from the same primitive parameters or model file, whose meshes later ones share
+        ankerl::unordered_dense::map<std::string, Renderable *> geometryOwners;
+        std::vector<std::string> pendingInterestGroups;
+        uint64_t lastInterestUpdate = 0;
+
+        // cells left by the interest region, the network thread queues the objects in them for removal by the render thread
+        std::mutex leftInterestCellsMutex;
+        std::vector<glm::ivec2> leftInterestCells;
+        // network thread only: what the server created, and which of it is out of the pipelines until its cell is joined again
+        ankerl::unordered_dense::map<std::string, MeshRenderableVariant> serverRenderables;
+        ankerl::unordered_dense::set<std::string> evictedRenderables;
 
         bool quit = false;
         uint64_t lastFrameAddedToCache = 0;
         uint32_t debugFlags = 0;
         uint64_t lastHeartBeat = 0;
 
+        std::string traceFile;
+        uint64_t metricsDumpInterval = 0;
+
         bool addPipeline0(const std::string& name, std::unique_ptr< Pipeline >& pipe, const PipelineConfig& config, const int& index);
 
         template<typename P, typename C>
         bool createMeshPipeline0(const std::string & name, C & graphicsConfig, CullPipelineConfig & cullConfig);
 
-        void openMessageLog();
+        template<typename R, typename F>
+        R * registerSharedGeometryRenderable(const std::string & id, const std::string & geometryKey, F createGeometry);
+
+        bool openMessageLog();
+        void requestSnapshot();
+        void updateInterestRegion();
+        void evictLeftInterestCells();
+        bool restoreKnownRenderable(const std::string & id, const UpdatedObjectProperties * updates, const BoundingSphere & boundingSphere);
 
         void createRenderer();
         void handleServerMessages(void * message);
@@ -48,7 +72,7 @@ class Engine final {
         bool isGraphicsActive();
         bool isReady();
 
-        bool startNetworking(const std::string ip = "127.0.0.1", const uint16_t broadcastPort = 3000, const uint16_t requestPort = 3001);
+        bool startNetworking(const std::string ip = "127.0.0.1", const uint16_t broadcastPort = 3000, const uint16_t requestPort = 3001, const uint16_t shards = 1);
         void send(std::shared_ptr<flatbuffers::FlatBufferBuilder> & flatbufferBuilder, const bool addMessageLog = false);
         void stopNetworking();
 
@@ -104,6 +128,9 @@ class Engine final {
         bool addObjectsToBeRendered(const std::vector<TextureMeshRenderable *> & additionalObjectsToBeRendered);
         bool addObjectsToBeRendered(const std::vector<ModelMeshRenderable *> & additionalObjectsToBeRendered);
         bool addObjectsToBeRendered(const std::vector<AnimatedModelMeshRenderable *> & additionalObjectsToBeRendered);
+        bool removeObjectsToBeRendered(const std::vector<ColorMeshRenderable *> & objectsToBeRemoved);
+        bool removeObjectsToBeRendered(const std::vector<TextureMeshRenderable *> & objectsToBeRemoved);
+        bool removeObjectsToBeRendered(const std::vector<ModelMeshRenderable *> & objectsToBeRemoved);
 
         bool addDebugObjectsToBeRendered(const std::vector<ColorMeshRenderable *> & additionalDebugObjectsToBeRendered);
         bool addDebugObjectsToBeRendered(const std::vector<VertexMeshRenderable *> & additionalDebugObjectsToBeRendered);
@@ -12,6 +12,68 @@ struct ModelVertex : TextureVertex {
     glm::vec3 bitangent;
 };
 
+/**
+ *  Gpu layouts of texture and model vertices (20 and 24 instead of 32 and 56 bytes):
+ *  normals and tangents are octahedral encoded, uvs are half floats
+ *  and the bitangent is reconstructed from normal, tangent and its sign
+ */
+struct PackedTextureVertex {
+    glm::vec3 position;
+    uint32_t normal;
+    uint32_t uv;
+};
+
+struct PackedModelVertex : PackedTextureVertex {
+    uint32_t tangent;
+};
+
+template<typename V>
+struct GpuVertex {
+    using type = V;
+};
+
+template<>
+struct GpuVertex<TextureVertex> {
+    using type = PackedTextureVertex;
+};
+
+template<>
+struct GpuVertex<ModelVertex> {
+    using type = PackedModelVertex;
+};
+
+static glm::vec2 encodeOctahedral(const glm::vec3 & vector) {
+    const float length = glm::abs(vector.x) + glm::abs(vector.y) + glm::abs(vector.z);
+    if (length == 0.0f) return glm::vec2(0.0f);
+
+    const glm::vec3 n = vector / length;
+    if (n.z >= 0.0f) return glm::vec2(n.x, n.y);
+
+    return glm::vec2(
+        (1.0f - glm::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+        (1.0f - glm::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)
+    );
+}
+
+static PackedTextureVertex packVertex(const TextureVertex & vertex) {
+    return PackedTextureVertex {
+        vertex.position,
+        glm::packSnorm2x16(encodeOctahedral(vertex.normal)),
+        glm::packHalf2x16(vertex.uv)
+    };
+}
+
+static PackedModelVertex packVertex(const ModelVertex & vertex) {
+    const glm::uvec2 tangent = glm::uvec2(glm::round((encodeOctahedral(vertex.tangent) * 0.5f + 0.5f) * 4095.0f));
+    const bool negativeBitangent = glm::dot(glm::cross(vertex.normal, vertex.tangent), vertex.bitangent) < 0.0f;
+
+    PackedModelVertex packedVertex;
+    static_cast<PackedTextureVertex &>(packedVertex) = packVertex(static_cast<const TextureVertex &>(vertex));
+    packedVertex.tangent = tangent.x | (tangent.y << 12) | (negativeBitangent ? 1u << 31 : 0u);
+
+    return packedVertex;
+}
+
 struct TextureMesh {
     std::vector<TextureVertex> vertices;
 };
@@ -24,13 +86,30 @@ struct VertexMesh : Mesh {
     glm::vec4 color;
 };
 
+/**
+ *  A range of the full resolution indices of a large mesh that the gpu culls on its own.
+ *  The cone cutoff is the sine of the widest angle between the axis and a triangle normal, 1 for no cone
+ */
+struct MeshCluster {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    glm::vec3 coneAxis = glm::vec3(0.0f);
+    float coneCutoff = 1.0f;
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+};
+
 struct VertexMeshIndexed : Mesh {
     std::vector<uint32_t> indices;
+    std::vector<std::vector<uint32_t>> lods;
+    std::vector<MeshCluster> clusters;
     glm::vec4 color;
 };
 
 struct TextureMeshIndexed : TextureMesh {
     std::vector<uint32_t> indices;
+    std::vector<std::vector<uint32_t>> lods;
+    std::vector<MeshCluster> clusters;
     uint32_t texture;
 };
 
@@ -42,10 +121,30 @@ struct MaterialInformation {
 
 struct ModelMeshIndexed : ModelMesh {
     std::vector<uint32_t> indices;
+    std::vector<std::vector<uint32_t>> lods;
+    std::vector<MeshCluster> clusters;
     TextureInformation textures;
     MaterialInformation material;
 };
 
+/**
+ *  In the index buffers every mesh has its full resolution indices followed by the ones of its lods,
+ *  all of them index the same vertices
+ */
+template<typename M>
+static size_t getIndexCountWithLods(const M & mesh) {
+    size_t indexCount = mesh.indices.size();
+    for (const auto & lod : mesh.lods) indexCount += lod.size();
+
+    return indexCount;
+}
+
+template<typename M>
+static void appendIndicesWithLods(const M & mesh, std::vector<uint32_t> & indices) {
+    indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+    for (const auto & lod : mesh.lods) indices.insert(indices.end(), lod.begin(), lod.end());
+}
+
 template<typename M>
 struct MeshGeometry {
     std::vector<M> meshes;
@@ -69,6 +69,93 @@ class Helper final {
         };
 
         static std::unique_ptr<VertexMeshGeometry> getBoundingBoxMeshGeometry(const BoundingBox & box, const glm::vec3 & color = { 0.0f, 0.0f, 1.0f });
+
+        static std::vector<uint32_t> optimizeVertexCache(std::vector<uint32_t> & indices, const size_t vertexCount);
+        static void optimizeOverdraw(std::vector<uint32_t> & indices, const std::vector<uint32_t> & clusters, const std::vector<glm::vec3> & positions);
+        static std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t> & indices, const size_t vertexCount);
+        static std::vector<uint32_t> simplifyMesh(const std::vector<uint32_t> & indices, const std::vector<glm::vec3> & positions, const size_t targetIndexCount, const float maxError);
+        static std::vector<MeshCluster> buildMeshClusters(std::vector<uint32_t> & indices, const std::vector<glm::vec3> & positions);
+
+        /**
+         *  Reorders the triangles of an indexed triangle mesh for the post transform cache and less overdraw,
+         *  then the vertices in order of first use. Returns the old index of every vertex for data kept alongside
+         */
+        template<typename M>
+        static std::vector<uint32_t> optimizeMesh(M & mesh)
+        {
+            if (mesh.indices.empty() || mesh.indices.size() % 3 != 0) return {};
+            for (const auto & i : mesh.indices) {
+                if (i >= mesh.vertices.size()) return {};
+            }
+
+            std::vector<glm::vec3> positions;
+            positions.reserve(mesh.vertices.size());
+            for (const auto & v : mesh.vertices) positions.emplace_back(v.position);
+
+            const std::vector<uint32_t> clusters = Helper::optimizeVertexCache(mesh.indices, mesh.vertices.size());
+            Helper::optimizeOverdraw(mesh.indices, clusters, positions);
+            const std::vector<uint32_t> order = Helper::optimizeVertexFetch(mesh.indices, mesh.vertices.size());
+
+            std::vector<typename decltype(mesh.vertices)::value_type> vertices;
+            vertices.reserve(order.size());
+            for (const auto & o : order) vertices.emplace_back(mesh.vertices[o]);
+            mesh.vertices = std::move(vertices);
+
+            return order;
+        };
+
+        /**
+         *  Fills the lods of an indexed triangle mesh, each simplified from the previous one to about half its triangles
+         *  with twice the tolerated error. Stops early once simplification no longer pays off
+         */
+        template<typename M>
+        static void generateLods(M & mesh)
+        {
+            mesh.lods.clear();
+            if (mesh.indices.empty() || mesh.indices.size() % 3 != 0) return;
+            for (const auto & i : mesh.indices) {
+                if (i >= mesh.vertices.size()) return;
+            }
+
+            std::vector<glm::vec3> positions;
+            positions.reserve(mesh.vertices.size());
+            for (const auto & v : mesh.vertices) positions.emplace_back(v.position);
+
+            mesh.lods.reserve(MAX_MESH_LODS - 1);
+            float maxError = LOD_MAX_ERROR;
+            for (uint32_t l=1;l<MAX_MESH_LODS;l++) {
+                const std::vector<uint32_t> & previous = mesh.lods.empty() ? mesh.indices : mesh.lods.back();
+                const size_t targetIndexCount = static_cast<size_t>(previous.size() / 3 * LOD_REDUCTION_FACTOR) * 3;
+                if (targetIndexCount < LOD_MIN_TRIANGLES * 3) break;
+
+                std::vector<uint32_t> lod = Helper::simplifyMesh(previous, positions, targetIndexCount, maxError);
+                if (lod.empty() || lod.size() > previous.size() * (1.0f + LOD_REDUCTION_FACTOR) / 2) break;
+
+                Helper::optimizeVertexCache(lod, mesh.vertices.size());
+                mesh.lods.emplace_back(std::move(lod));
+                maxError *= 2;
+            }
+        };
+
+        /**
+         *  Splits the full resolution indices of large indexed triangle meshes into clusters the gpu culls on their own.
+         *  Only for meshes whose vertices don't move, the cluster bounds are computed once
+         */
+        template<typename M>
+        static void generateClusters(M & mesh)
+        {
+            mesh.clusters.clear();
+            if (mesh.indices.size() < MESH_CLUSTER_MIN_TRIANGLES * 3 || mesh.indices.size() % 3 != 0) return;
+            for (const auto & i : mesh.indices) {
+                if (i >= mesh.vertices.size()) return;
+            }
+
+            std::vector<glm::vec3> positions;
+            positions.reserve(mesh.vertices.size());
+            for (const auto & v : mesh.vertices) positions.emplace_back(v.position);
+
+            mesh.clusters = Helper::buildMeshClusters(mesh.indices, positions);
+        };
 };
 
 #endif
@@ -0,0 +1,73 @@
+#ifndef SRC_INCLUDES_JOURNAL_INCL_H_
+#define SRC_INCLUDES_JOURNAL_INCL_H_
+
+#include "common.h"
+
+#include <mutex>
+
+static constexpr uint32_t JOURNAL_MAGIC = 0x4C4E524A;
+static constexpr uint32_t JOURNAL_VERSION = 1;
+static constexpr uint64_t JOURNAL_INITIAL_CAPACITY = 1024 * 1024;
+static constexpr uint64_t JOURNAL_MIN_COMPACTION_SIZE = 256 * 1024;
+
+struct JournalHeader {
+    uint32_t magic = JOURNAL_MAGIC;
+    uint32_t version = JOURNAL_VERSION;
+    uint64_t contentSize = 0;
+};
+
+/**
+ *  A single memory mapped file holding length prefixed (and 8 byte aligned) flatbuffer messages.
+ *  Records are only ever appended. Compaction replaces the journal with a rewritten copy, keeping only the latest
+ *  record per object.
+ */
+class MessageJournal final {
+    private:
+        std::filesystem::path file;
+
+        #ifdef _WIN32
+            void * fileHandle = nullptr;
+            void * mappingHandle = nullptr;
+        #else
+            int fileDescriptor = -1;
+        #endif
+
+        char * data = nullptr;
+        uint64_t capacity = 0;
+        uint64_t contentSizeAfterCompaction = 0;
+
+        std::mutex journalMutex;
+
+        bool map(const uint64_t capacity);
+        void unmap();
+
+        JournalHeader * getHeader() const;
+        void closeFile();
+
+        void forEachRecord(const std::function<void(const uint64_t, const Message *)> & callback) const;
+        static void forEachRecord(const char * content, const uint64_t contentSize, const std::function<void(const uint64_t, const Message *)> & callback);
+        ankerl::unordered_dense::map<std::string, uint64_t> getLatestRecordForIds() const;
+        void compactUnlocked();
+
+        static std::vector<std::string> getObjectIds(const Message * message);
+
+    public:
+        MessageJournal(const MessageJournal&) = delete;
+        MessageJournal& operator=(const MessageJournal &) = delete;
+        MessageJournal(MessageJournal &&) = delete;
+        MessageJournal & operator=(MessageJournal) = delete;
+        MessageJournal() {};
+
+        bool open(const std::filesystem::path & file, const uint64_t initialCapacity = JOURNAL_INITIAL_CAPACITY);
+        bool isOpen() const;
+        void close();
+
+        bool append(const uint8_t * message, const uint32_t size);
+        void compact();
+
+        void replay(const std::function<void(const ObjectCreateRequest *)> & callback);
+
+        ~MessageJournal();
+};
+
+#endif
@@ -59,6 +59,9 @@ struct ObjectPropertiesUpdateRequestBuilder;
 struct ObjectDebugRequest;
 struct ObjectDebugRequestBuilder;
 
+struct InterestUpdateRequest;
+struct InterestUpdateRequestBuilder;
+
 struct Message;
 struct MessageBuilder;
 
@@ -179,37 +182,40 @@ enum MessageUnion : uint8_t {
   MessageUnion_ObjectUpdateRequest = 3,
   MessageUnion_ObjectPropertiesUpdateRequest = 4,
   MessageUnion_ObjectDebugRequest = 5,
+  MessageUnion_InterestUpdateRequest = 6,
   MessageUnion_MIN = MessageUnion_NONE,
-  MessageUnion_MAX = MessageUnion_ObjectDebugRequest
+  MessageUnion_MAX = MessageUnion_InterestUpdateRequest
 };
 
-inline const MessageUnion (&EnumValuesMessageUnion())[6] {
+inline const MessageUnion (&EnumValuesMessageUnion())[7] {
   static const MessageUnion values[] = {
     MessageUnion_NONE,
     MessageUnion_ObjectCreateRequest,
     MessageUnion_ObjectCreateAndUpdateRequest,
     MessageUnion_ObjectUpdateRequest,
     MessageUnion_ObjectPropertiesUpdateRequest,
-    MessageUnion_ObjectDebugRequest
+    MessageUnion_ObjectDebugRequest,
+    MessageUnion_InterestUpdateRequest
   };
   return values;
 }
 
 inline const char * const *EnumNamesMessageUnion() {
-  static const char * const names[7] = {
+  static const char * const names[8] = {
     "NONE",
     "ObjectCreateRequest",
     "ObjectCreateAndUpdateRequest",
     "ObjectUpdateRequest",
     "ObjectPropertiesUpdateRequest",
     "ObjectDebugRequest",
+    "InterestUpdateRequest",
     nullptr
   };
   return names;
 }
 
 inline const char *EnumNameMessageUnion(MessageUnion e) {
-  if (::flatbuffers::IsOutRange(e, MessageUnion_NONE, MessageUnion_ObjectDebugRequest)) return "";
+  if (::flatbuffers::IsOutRange(e, MessageUnion_NONE, MessageUnion_InterestUpdateRequest)) return "";
   const size_t index = static_cast<size_t>(e);
   return EnumNamesMessageUnion()[index];
 }
@@ -238,6 +244,10 @@ template<> struct MessageUnionTraits<ObjectDebugRequest> {
   static const MessageUnion enum_value = MessageUnion_ObjectDebugRequest;
 };
 
+template<> struct MessageUnionTraits<InterestUpdateRequest> {
+  static const MessageUnion enum_value = MessageUnion_InterestUpdateRequest;
+};
+
 bool VerifyMessageUnion(::flatbuffers::Verifier &verifier, const void *obj, MessageUnion type);
 bool VerifyMessageUnionVector(::flatbuffers::Verifier &verifier, const ::flatbuffers::Vector<::flatbuffers::Offset<void>> *values, const ::flatbuffers::Vector<uint8_t> *types);
 
@@ -1585,6 +1595,58 @@ inline ::flatbuffers::Offset<ObjectDebugRequest> CreateObjectDebugRequestDirect(
       max);
 }
 
+struct InterestUpdateRequest FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
+  typedef InterestUpdateRequestBuilder Builder;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_CELLS = 4
+  };
+  const ::flatbuffers::Vector<::flatbuffers::Offset<::flatbuffers::String>> *cells() const {
+    return GetPointer<const ::flatbuffers::Vector<::flatbuffers::Offset<::flatbuffers::String>> *>(VT_CELLS);
+  }
+  bool Verify(::flatbuffers::Verifier &verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyOffset(verifier, VT_CELLS) &&
+           verifier.VerifyVector(cells()) &&
+           verifier.VerifyVectorOfStrings(cells()) &&
+           verifier.EndTable();
+  }
+};
+
+struct InterestUpdateRequestBuilder {
+  typedef InterestUpdateRequest Table;
+  ::flatbuffers::FlatBufferBuilder &fbb_;
+  ::flatbuffers::uoffset_t start_;
+  void add_cells(::flatbuffers::Offset<::flatbuffers::Vector<::flatbuffers::Offset<::flatbuffers::String>>> cells) {
+    fbb_.AddOffset(InterestUpdateRequest::VT_CELLS, cells);
+  }
+  explicit InterestUpdateRequestBuilder(::flatbuffers::FlatBufferBuilder &_fbb)
+        : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  ::flatbuffers::Offset<InterestUpdateRequest> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = ::flatbuffers::Offset<InterestUpdateRequest>(end);
+    return o;
+  }
+};
+
+inline ::flatbuffers::Offset<InterestUpdateRequest> CreateInterestUpdateRequest(
+    ::flatbuffers::FlatBufferBuilder &_fbb,
+    ::flatbuffers::Offset<::flatbuffers::Vector<::flatbuffers::Offset<::flatbuffers::String>>> cells = 0) {
+  InterestUpdateRequestBuilder builder_(_fbb);
+  builder_.add_cells(cells);
+  return builder_.Finish();
+}
+
+inline ::flatbuffers::Offset<InterestUpdateRequest> CreateInterestUpdateRequestDirect(
+    ::flatbuffers::FlatBufferBuilder &_fbb,
+    const std::vector<::flatbuffers::Offset<::flatbuffers::String>> *cells = nullptr) {
+  auto cells__ = cells ? _fbb.CreateVector<::flatbuffers::Offset<::flatbuffers::String>>(*cells) : 0;
+  return CreateInterestUpdateRequest(
+      _fbb,
+      cells__);
+}
+
 struct Message FLATBUFFERS_FINAL_CLASS : private ::flatbuffers::Table {
   typedef MessageBuilder Builder;
   enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
@@ -1766,6 +1828,10 @@ inline bool VerifyMessageUnion(::flatbuffers::Verifier &verifier, const void *ob
       auto ptr = reinterpret_cast<const ObjectDebugRequest *>(obj);
       return verifier.VerifyTable(ptr);
     }
+    case MessageUnion_InterestUpdateRequest: {
+      auto ptr = reinterpret_cast<const InterestUpdateRequest *>(obj);
+      return verifier.VerifyTable(ptr);
+    }
     default: return true;
   }
 }
@@ -0,0 +1,128 @@
+#ifndef SRC_INCLUDES_METRICS_INCL_H_
+#define SRC_INCLUDES_METRICS_INCL_H_
+
+#include "logging.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <map>
+#include <string>
+#include <limits>
+
+static constexpr uint32_t METRICS_HISTOGRAM_BUCKETS = 40;
+static constexpr size_t METRICS_MAX_TRACE_EVENTS = 1000000;
+
+// power of 2 buckets, percentiles are therefore approximations (upper bucket bounds)
+struct MetricsHistogram final {
+    uint64_t count = 0;
+    double sum = 0.0;
+    double min = std::numeric_limits<double>::max();
+    double max = 0.0;
+    std::array<uint64_t, METRICS_HISTOGRAM_BUCKETS> buckets {};
+
+    void record(const double value);
+    double getPercentile(const double percentile) const;
+};
+
+struct TraceEvent final {
+    const char * name = nullptr;
+    char phase = 'X';
+    uint64_t timestamp = 0;
+    uint64_t duration = 0;
+    uint64_t threadId = 0;
+    double value = 0.0;
+};
+
+/**
+ *  Counters, gauges and histograms by name plus an optional buffer of chrome trace events.
+ *  Everything is a relaxed atomic load and an early return as long as it is disabled.
+ *  Names are expected to be string literals (trace events keep the pointer).
+ */
+class Metrics final {
+    private:
+        static Metrics * instance;
+        Metrics();
+
+        std::atomic<bool> enabled = false;
+        std::atomic<bool> tracing = false;
+
+        std::mutex metricsMutex;
+        std::map<std::string, int64_t> counters;
+        std::map<std::string, double> gauges;
+        std::map<std::string, MetricsHistogram> histograms;
+
+        std::mutex traceMutex;
+        std::vector<TraceEvent> traceEvents;
+        uint64_t droppedTraceEvents = 0;
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        uint64_t lastDump = 0;
+
+        void addTraceEvent(const TraceEvent & event);
+
+    public:
+        Metrics& operator=(const Metrics &) = delete;
+        Metrics(Metrics &&) = delete;
+        Metrics & operator=(Metrics) = delete;
+
+        static Metrics * INSTANCE();
+
+        void enable(const bool enabled);
+        void enableTracing(const bool tracing);
+
+        bool isEnabled() const {
+            return this->enabled.load(std::memory_order_relaxed);
+        };
+
+        bool isTracing() const {
+            return this->tracing.load(std::memory_order_relaxed);
+        };
+
+        uint64_t getTimeInMicros() const;
+        static uint64_t getThreadId();
+
+        void incrementCounter(const char * name, const int64_t delta = 1);
+        void setGauge(const char * name, const double value);
+        void recordValue(const char * name, const double value);
+        void recordDuration(const char * name, const uint64_t startInMicros, const uint64_t durationInMicros, const uint64_t threadId = 0);
+
+        std::string getStats();
+        void dumpStatsPeriodically(const uint64_t intervalInMillis);
+        bool writeTrace(const std::string & file);
+
+        ~Metrics();
+};
+
+// records its lifetime in microseconds into the histogram of the given name (and as a trace event)
+class ScopedTimer final {
+    private:
+        const char * name;
+        bool running = false;
+        uint64_t start = 0;
+
+    public:
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer &) = delete;
+        ScopedTimer(ScopedTimer &&) = delete;
+        ScopedTimer & operator=(ScopedTimer) = delete;
+
+        ScopedTimer(const char * name) : name(name) {
+            if (!Metrics::INSTANCE()->isEnabled()) return;
+
+            this->running = true;
+            this->start = Metrics::INSTANCE()->getTimeInMicros();
+        };
+
+        ~ScopedTimer() {
+            if (!this->running) return;
+
+            const uint64_t end = Metrics::INSTANCE()->getTimeInMicros();
+            Metrics::INSTANCE()->recordDuration(this->name, this->start, end - this->start);
+        };
+};
+
+#endif
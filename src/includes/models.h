@@ -58,8 +58,8 @@ class Model final {
         static void correctTexturePath(char * path);
         static std::string saveEmbeddedModelTexture(const aiTexture * texture);
 
-        static void processModelNode(const aiNode * node, const aiScene * scene, std::unique_ptr<ModelMeshGeometry> & modelMeshGeom, const std::filesystem::path & parentPath);
-        static void processModelNode(const aiNode * node, const aiScene * scene, std::unique_ptr<AnimatedModelMeshGeometry> & modelMeshGeom, const std::filesystem::path & parentPath);
+        static void processModelNode(const aiNode * node, const aiScene * scene, std::unique_ptr<ModelMeshGeometry> & modelMeshGeom, const std::filesystem::path & parentPath, const bool optimizeMeshes = false);
+        static void processModelNode(const aiNode * node, const aiScene * scene, std::unique_ptr<AnimatedModelMeshGeometry> & modelMeshGeom, const std::filesystem::path & parentPath, const bool optimizeMeshes = false);
 
         template <typename G, typename M>
         static void processModelMesh(const aiMesh * mesh, const aiScene * scene, std::unique_ptr<G> & modelMeshGeom, const std::filesystem::path & parentPath);
@@ -4,11 +4,18 @@
 #include "geometry.h"
 
 struct ColorMeshDrawCommand {
-    uint32_t    indexCount;
-    uint32_t    indexOffset;
+    uint32_t    indexCount[MAX_MESH_LODS];
+    uint32_t    indexOffset[MAX_MESH_LODS];
     int32_t     vertexOffset;
     uint32_t    firstInstance;
     uint32_t    meshInstance;
+    uint32_t    lodCount;
+    // commands of instances sharing a geometry form a batch, drawn instanced by whichever is found visible first
+    uint32_t    batch;
+    uint32_t    padding[3];
+    // model space bounding sphere and normal cone of a mesh cluster, a radius of 0 means the whole mesh
+    glm::vec4   clusterSphere;
+    glm::vec4   clusterCone;
 };
 
 struct VertexMeshDrawCommand {
@@ -47,6 +54,49 @@ struct ModelMeshData final {
     TextureInformation texture;
 };
 
+/**
+ *  Flattened joint hierarchy and key frames for the animation compute shader (std430 layouts)
+ */
+struct AnimationNodeData final {
+    glm::mat4 transformation {1.0f};
+    int32_t parent = -1;
+    uint32_t padding[3] {};
+};
+
+struct AnimationTrackData final {
+    uint32_t positionOffset = 0;
+    uint32_t positionCount = 0;
+    uint32_t rotationOffset = 0;
+    uint32_t rotationCount = 0;
+    uint32_t scalingOffset = 0;
+    uint32_t scalingCount = 0;
+    uint32_t animated = 0;
+    uint32_t padding = 0;
+};
+
+struct AnimationKeyData final {
+    glm::vec4 value {0.0f};
+    float time = 0.0f;
+    float padding[3] {};
+};
+
+struct AnimationJointData final {
+    glm::mat4 offsetMatrix {1.0f};
+    int32_t node = -1;
+    uint32_t padding[3] {};
+};
+
+struct AnimationInstanceData final {
+    glm::mat4 rootInverseTransformation {1.0f};
+    uint32_t nodeOffset = 0;
+    uint32_t trackOffset = 0;
+    uint32_t jointOffset = 0;
+    uint32_t jointCount = 0;
+    uint32_t paletteOffset = 0;
+    float time = 0.0f;
+    uint32_t padding[2] {};
+};
+
 struct ColorMeshPushConstants final {
     glm::mat4 matrix {1.0f};
     glm::vec4 color {1.0f};
@@ -63,6 +113,28 @@ struct ModelMeshPushConstants {
     TextureInformation texture;
 };
 
+// early draws what was visible last time around, late what the depth pyramid of the early draws reveals
+enum CullPhase : uint32_t {
+    CULL_FRUSTUM = 0, CULL_EARLY = 1, CULL_LATE = 2
+};
+
+// every phase tests all draw commands, emits one instanced draw per batch and lod, then writes the visible instances
+enum CullPass : uint32_t {
+    CULL_PASS_TEST = 0, CULL_PASS_EMIT = 1, CULL_PASS_WRITE = 2
+};
+
+struct CullPushConstants final {
+    uint32_t drawCount = 0;
+    uint32_t phase = CULL_FRUSTUM;
+    uint32_t pass = CULL_PASS_TEST;
+};
+
+struct DepthPyramidPushConstants final {
+    glm::ivec2 sourceSize {0};
+    glm::ivec2 destinationSize {0};
+    int32_t sourceLevel = 0;
+};
+
 class Renderable {
     protected:
         std::string id;
@@ -110,10 +182,16 @@ class Renderable {
         virtual ~Renderable();
 };
 
+/**
+ *  Renderables created from the same primitive parameters or model file draw the meshes of the first one (their geometry owner),
+ *  which pipelines keep in their buffers only once
+ */
 template<typename M, typename G>
 class MeshRenderable : public Renderable {
     protected:
         std::vector<M> meshes;
+        const MeshRenderable * geometryOwner = nullptr;
+        bool geometryShareable = false;
     public:
         MeshRenderable(const MeshRenderable&) = delete;
         MeshRenderable& operator=(const MeshRenderable &) = delete;
@@ -123,10 +201,36 @@ class MeshRenderable : public Renderable {
             this->meshes = std::move(geometry->meshes);
             this->sphere = geometry->sphere;
         };
+        MeshRenderable(const std::string name, const MeshRenderable * geometryOwner) : MeshRenderable(name) {
+            this->geometryOwner = geometryOwner;
+            this->sphere = geometryOwner->getBoundingSphere();
+        };
 
         void setMeshes(const std::vector<M> & meshes) { this->meshes = std::move(meshes);};
-        const std::vector<M> & getMeshes() const { return this->meshes;};
+        const std::vector<M> & getMeshes() const { return this->geometryOwner != nullptr ? this->geometryOwner->getMeshes() : this->meshes;};
         void setBBox(const BoundingSphere & sphere) { this->sphere = std::move(sphere);};
+
+        const MeshRenderable * getGeometryOwner() const { return this->geometryOwner;};
+        void setGeometryShareable(const bool shareable) { this->geometryShareable = shareable;};
+        bool isGeometryShareable() const { return this->geometryShareable;};
+};
+
+// where the meshes of a renderable start in its pipeline's vertex, index and (gpu culling only) mesh data buffers
+struct MeshBufferOffsets final {
+    VkDeviceSize vertexOffset = 0;
+    VkDeviceSize indexOffset = 0;
+    uint32_t firstMesh = 0;
+};
+
+// what a mesh pipeline's culling pipeline has to catch up on, a removed instance's slot is taken by the last one (moved)
+enum InstanceChangeType : uint8_t {
+    INSTANCE_ADDED, INSTANCE_MOVED, INSTANCE_REMOVED, INSTANCES_CLEARED
+};
+
+struct InstanceChange final {
+    InstanceChangeType type = INSTANCE_ADDED;
+    const Renderable * renderable = nullptr;
+    uint32_t instance = 0;
 };
 
 using ColorMeshRenderable = MeshRenderable<VertexMeshIndexed, ColorMeshGeometry>;
@@ -153,13 +257,15 @@ struct GraphicsPipelineConfig : PipelineConfig {
     bool enableColorBlend = true;
     bool enableDepth = true;
 
-    VkDeviceSize reservedVertexSpace = 500 * MEGA_BYTE;
+    // initial sizes, vertex, index and mesh data buffers grow as needed
+    VkDeviceSize reservedVertexSpace = 16 * MEGA_BYTE;
     bool useDeviceLocalForVertexSpace = false;
-    VkDeviceSize reservedIndexSpace = 500 * MEGA_BYTE;
+    VkDeviceSize reservedIndexSpace = 16 * MEGA_BYTE;
     bool useDeviceLocalForIndexSpace = false;
     VkDeviceSize reservedInstanceDataSpace = 50 * MEGA_BYTE;
-    VkDeviceSize reservedMeshDataSpace = 50 * MEGA_BYTE;
+    VkDeviceSize reservedMeshDataSpace = 4 * MEGA_BYTE;
     VkDeviceSize reservedAnimationDataSpace = 50 * MEGA_BYTE;
+    VkDeviceSize reservedVertexJointSpace = 8 * MEGA_BYTE;
 };
 
 struct ColorMeshPipelineConfig : GraphicsPipelineConfig {
@@ -222,6 +328,9 @@ struct AnimatedModelMeshPipelineConfig : GraphicsPipelineConfig {
     std::vector<AnimatedModelMeshRenderable *> objectsToBeRendered;
     int indirectBufferIndex = -1;
 
+    // joint palettes are evaluated by a compute pipeline (requires gpu culling)
+    bool useGpuAnimation = USE_GPU_ANIMATION;
+
     AnimatedModelMeshPipelineConfig(const bool useGpuCulling) {
         this->shaders = {
             { "animated_model_meshes" + std::string(useGpuCulling ? "_gpu" : "") + ".vert.spv" , VK_SHADER_STAGE_VERTEX_BIT },
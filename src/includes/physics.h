@@ -130,6 +130,7 @@ class SpatialHashMap final {
 
         void addObject(PhysicsObject * physicsObject);
         void updateObject(std::set<std::string> oldIndices, std::set<std::string> newIndices, PhysicsObject * physicsObject);
+        void clear();
 
         ankerl::unordered_dense::map<std::string, std::set<PhysicsObject *>> performBroadPhaseCollisionCheck(const std::vector<PhysicsObject *> & physicsObject);
 
@@ -141,6 +142,7 @@ class Physics final {
         bool quit = true;
 
         std::mutex additionMutex;
+        std::condition_variable objectsAdded;
         std::thread worker;
         std::queue<PhysicsObject *> objctsToBeUpdated;
 
@@ -47,6 +47,10 @@ class Pipeline {
         Renderer * renderer = nullptr;
         VkPipeline pipeline = nullptr;
 
+        // profiler section names, looked up once when the pipeline is added to the renderer
+        const char * gpuSectionName = nullptr;
+        const char * updateSectionName = nullptr;
+
         DescriptorPool descriptorPool;
         Descriptors descriptors;
         VkPipelineLayout layout = nullptr;
@@ -62,6 +66,10 @@ class Pipeline {
         std::string getName() const;
         void setName(const std::string name);
 
+        void setSectionNames(const char * gpuSectionName, const char * updateSectionName);
+        const char * getGpuSectionName() const;
+        const char * getUpdateSectionName() const;
+
         bool addShader(const std::string & file, const VkShaderStageFlagBits & shaderType);
         std::vector<VkPipelineShaderStageCreateInfo> getShaderStageCreateInfos();
 
@@ -92,8 +100,10 @@ class GraphicsPipeline : public Pipeline {
         Buffer indexBuffer;
         bool usesDeviceLocalIndexBuffer = false;
         Buffer ssboMeshBuffer;
-        Buffer ssboInstanceBuffer;
-        Buffer animationMatrixBuffer;
+        FrameRingBuffer ssboInstanceBuffer;
+        FrameRingBuffer animationMatrixBuffer;
+        Buffer vertexJointBuffer;
+        bool gpuAnimation = false;
     public:
         GraphicsPipeline(const GraphicsPipeline&) = delete;
         GraphicsPipeline& operator=(const GraphicsPipeline &) = delete;
@@ -106,13 +116,17 @@ class GraphicsPipeline : public Pipeline {
 
         virtual void draw(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex) = 0;
         virtual void update() = 0;
+        virtual bool hasStaticCommands() const;
+        virtual void applyPendingChanges();
 
         bool isReady() const;
         bool canRender() const;
 
         void correctViewPortCoordinates(const VkCommandBuffer & commandBuffer);
 
-        VkDescriptorBufferInfo getInstanceDataDescriptorInfo();
+        VkDescriptorBufferInfo getInstanceDataDescriptorInfo(const uint32_t frame);
+        VkDescriptorBufferInfo getAnimationMatrixDescriptorInfo(const uint32_t frame);
+        bool usesGpuAnimation() const;
 
         MemoryUsage getMemoryUsage() const;
         int getIndirectBufferIndex() const;
@@ -127,8 +141,28 @@ class MeshPipeline : public GraphicsPipeline {
         std::vector<R *> objectsToBeRendered;
         C config;
 
+        // renderables sharing a geometry have none of their own and use their owner's
+        ankerl::unordered_dense::map<const Renderable *, MeshBufferOffsets> meshBufferOffsets;
+        ankerl::unordered_dense::map<const Renderable *, uint32_t> instanceIndexes;
+        // recorded with gpu culling only, the culling pipeline takes them on update
+        std::vector<InstanceChange> instanceChanges;
+
         std::mutex additionMutex;
 
+        /**
+         *  Appends the first count objects (whose instance data has been written) for the draw loop and object updates
+         */
+        void appendObjectsToBeRendered(const std::vector<R *> & additionalObjectsToBeRendered, const uint32_t count) {
+            for (uint32_t i=0;i<count;i++) {
+                R * o = additionalObjectsToBeRendered[i];
+                const uint32_t instance = this->objectsToBeRendered.size();
+
+                this->instanceIndexes[o] = instance;
+                this->objectsToBeRendered.emplace_back(o);
+                if (this->renderer->usesGpuCulling()) this->instanceChanges.push_back({ INSTANCE_ADDED, o, instance });
+            }
+        };
+
         bool createBuffers(const C & conf, const bool & omitIndex = false) {
             /**
             *  VERTEX BUFFER CREATION
@@ -213,8 +247,7 @@ class MeshPipeline : public GraphicsPipeline {
 
             if (this->renderer->usesGpuCulling()) {
                 reservedSize = conf.reservedInstanceDataSpace;
-                this->ssboInstanceBuffer.destroy(this->renderer->getLogicalDevice());
-                result = this->ssboInstanceBuffer.createSharedStorageBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), reservedSize);
+                result = this->ssboInstanceBuffer.create(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), reservedSize, this->renderer->getFramesInFlight());
                 if (result != VK_SUCCESS) {
                     logError("Allocation: Not enough host space!");
                 }
@@ -244,8 +277,7 @@ class MeshPipeline : public GraphicsPipeline {
 
             if (this->needsAnimationMatrices()) {
                 reservedSize = conf.reservedAnimationDataSpace;
-                this->animationMatrixBuffer.destroy(this->renderer->getLogicalDevice());
-                result = this->animationMatrixBuffer.createSharedStorageBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), reservedSize);
+                result = this->animationMatrixBuffer.create(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), reservedSize, this->renderer->getFramesInFlight());
                 if (result != VK_SUCCESS) {
                     logError("Allocation: Not enough host space!");
                 }
@@ -254,15 +286,176 @@ class MeshPipeline : public GraphicsPipeline {
                     logError("Failed to create  '" + this->name + "' Pipeline SSBO Animation Matrix Data Buffer!");
                     return false;
                 }
+
+                // joint indices (into the per frame palettes) and weights per vertex, in step with the vertex buffer
+                reservedSize = conf.reservedVertexJointSpace;
+                this->vertexJointBuffer.destroy(this->renderer->getLogicalDevice());
+                result = this->vertexJointBuffer.createSharedStorageBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), reservedSize);
+                if (result != VK_SUCCESS) {
+                    logError("Allocation: Not enough host space!");
+                }
+
+                if (!this->vertexJointBuffer.isInitialized()) {
+                    logError("Failed to create  '" + this->name + "' Pipeline SSBO Vertex Joint Buffer!");
+                    return false;
+                }
+            }
+
+            return true;
+        };
+
+        struct RequiredBufferSpace {
+            VkDeviceSize vertexSpace = 0;
+            VkDeviceSize indexSpace = 0;
+            VkDeviceSize meshDataSpace = 0;
+            VkDeviceSize vertexJointSpace = 0;
+        };
+
+        // waiting for the render thread to grow the buffers they need
+        std::vector<R *> objectsAwaitingGrowth;
+        VkDeviceSize meshDataSizeForGrowth = 0;
+        // waiting for the render thread to take them out, objects added in the meantime wait along with those above
+        std::vector<R *> objectsAwaitingRemoval;
+
+        VkDeviceSize getMaxBufferSize(const VkBufferUsageFlagBits usage) const {
+            // vertex and mesh data are bound as storage buffers
+            return usage == VK_BUFFER_USAGE_STORAGE_BUFFER_BIT ?
+                this->renderer->getPhysicalDeviceProperty(STORAGE_BUFFER_LIMIT) : std::numeric_limits<VkDeviceSize>::max();
+        };
+
+        /**
+         *  Replaces the buffer with one of at least twice the size, existing content is carried over (by gpu copy for device local ones).
+         *  The old buffer is retired with the renderer which destroys it once it can no longer be in use.
+         *  Render thread only, with the addition lock held
+         */
+        bool growBuffer(Buffer & buffer, const bool isDeviceLocal, const VkDeviceSize requiredSize, const VkBufferUsageFlagBits usage) {
+            if (requiredSize <= buffer.getSize()) return true;
+
+            const VkDeviceSize maxSize = this->getMaxBufferSize(usage);
+            if (requiredSize > maxSize) return false;
+
+            const VkDeviceSize grownSize = std::min(std::max(requiredSize, buffer.getSize() * 2), maxSize);
+
+            auto grownBuffer = std::make_unique<Buffer>();
+
+            VkResult result;
+            if (isDeviceLocal) {
+                result = grownBuffer->createDeviceLocalBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), grownSize, usage);
+            } else if (usage == VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+                result = grownBuffer->createSharedIndexBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), grownSize);
+            } else {
+                result = grownBuffer->createSharedStorageBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), grownSize);
+            }
+
+            if (result != VK_SUCCESS || !grownBuffer->isInitialized()) {
+                logError("Pipeline '" + this->name + "': failed to grow buffer to " + Helper::formatMemoryUsage(grownSize));
+                return false;
+            }
+
+            const VkDeviceSize contentSize = buffer.getContentSize();
+            if (contentSize > 0) {
+                if (isDeviceLocal) {
+                    if (!this->renderer->getUploadManager().copyBuffer(buffer, *grownBuffer, contentSize)) {
+                        grownBuffer->destroy(this->renderer->getLogicalDevice());
+                        return false;
+                    }
+                } else memcpy(grownBuffer->getBufferData(), buffer.getBufferData(), contentSize);
+            }
+            grownBuffer->updateContentSize(contentSize);
+
+            if (isDeviceLocal) {
+                this->renderer->trackDeviceLocalMemory(buffer.getSize(), true);
+                this->renderer->trackDeviceLocalMemory(grownSize);
+            }
+
+            buffer.swap(*grownBuffer);
+            this->renderer->retireBuffer(std::move(grownBuffer));
+
+            return true;
+        };
+
+        RequiredBufferSpace getRequiredSpace(const std::vector<R *> & additionalObjectsToBeRendered, const VkDeviceSize meshDataSize) const {
+            RequiredBufferSpace space;
+
+            for (const auto & o : additionalObjectsToBeRendered) {
+                if (o->getGeometryOwner() != nullptr) continue;
+
+                for (const auto & mesh : o->getMeshes()) {
+                    space.vertexSpace += sizeof(typename GpuVertex<typename std::decay_t<decltype(mesh.vertices)>::value_type>::type) * mesh.vertices.size();
+                    space.vertexJointSpace += sizeof(VertexJointInfo) * mesh.vertices.size();
+                    if constexpr (requires { mesh.indices; }) space.indexSpace += sizeof(uint32_t) * getIndexCountWithLods(mesh);
+                    space.meshDataSpace += meshDataSize;
+                }
+            }
+
+            return space;
+        };
+
+        /**
+         *  Queues the objects (behind any queued earlier) if the buffers have to grow for them and can, or if removals are pending.
+         *  Growing swaps buffers that recorded frames and descriptors still use, which only the render thread may do
+         */
+        bool deferUntilGrown(const std::vector<R *> & additionalObjectsToBeRendered, const VkDeviceSize meshDataSize) {
+            if (this->objectsAwaitingGrowth.empty() && this->objectsAwaitingRemoval.empty()) {
+                const RequiredBufferSpace space = this->getRequiredSpace(additionalObjectsToBeRendered, meshDataSize);
+
+                bool needsGrowth = false;
+                bool canGrow = true;
+                const auto check = [&needsGrowth, &canGrow, this](const Buffer & buffer, const VkDeviceSize additionalSpace, const VkBufferUsageFlagBits usage) {
+                    if (!buffer.isInitialized() || buffer.getContentSize() + additionalSpace <= buffer.getSize()) return;
+
+                    needsGrowth = true;
+                    if (buffer.getContentSize() + additionalSpace > this->getMaxBufferSize(usage)) canGrow = false;
+                };
+
+                check(this->vertexBuffer, space.vertexSpace, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+                check(this->indexBuffer, space.indexSpace, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+                if (this->renderer->usesGpuCulling()) check(this->ssboMeshBuffer, space.meshDataSpace, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+                check(this->vertexJointBuffer, space.vertexJointSpace, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+                // objects not fitting are dropped by the caller
+                if (!needsGrowth || !canGrow) return false;
             }
 
+            this->meshDataSizeForGrowth = meshDataSize;
+            this->objectsAwaitingGrowth.insert(this->objectsAwaitingGrowth.end(), additionalObjectsToBeRendered.begin(), additionalObjectsToBeRendered.end());
+
             return true;
         };
 
+        /**
+         *  Removes the given objects, the last one takes over the instance slot of each (having its instance data rewritten by the update).
+         *  Their meshes stay in the buffers until the pipeline is cleared, for any renderables that might still share them
+         */
+        void removeObjectsNow(const std::vector<R *> & objectsToBeRemoved) {
+            for (const auto & o : objectsToBeRemoved) {
+                const auto instanceIndex = this->instanceIndexes.find(o);
+                if (instanceIndex == this->instanceIndexes.end()) continue;
+
+                const uint32_t instance = instanceIndex->second;
+                this->instanceIndexes.erase(instanceIndex);
+                if (!o->isGeometryShareable()) this->meshBufferOffsets.erase(o);
+                if (this->renderer->usesGpuCulling()) this->instanceChanges.push_back({ INSTANCE_REMOVED, o, instance });
+
+                R * last = this->objectsToBeRendered.back();
+                if (last != o) {
+                    this->objectsToBeRendered[instance] = last;
+                    this->instanceIndexes[last] = instance;
+                    last->setDirty(true);
+                    if (this->renderer->usesGpuCulling()) this->instanceChanges.push_back({ INSTANCE_MOVED, last, instance });
+                }
+
+                this->objectsToBeRendered.pop_back();
+                if (this->renderer->usesGpuCulling()) this->ssboInstanceBuffer.release(sizeof(ColorMeshInstanceData));
+            }
+
+            this->renderer->invalidateCommandBuffers();
+        };
+
         bool createDescriptorPool() {
             if (this->renderer == nullptr || !this->renderer->isReady() || this->descriptorPool.isInitialized()) return false;
 
-            const uint32_t count = this->renderer->getImageCount();
+            const uint32_t count = this->renderer->getFramesInFlight();
 
             this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, count);
             this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
@@ -271,6 +464,7 @@ class MeshPipeline : public GraphicsPipeline {
                 this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
                 this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
                 this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
+                this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
             }
 
             if (this->needsImageSampler()) {
@@ -279,6 +473,7 @@ class MeshPipeline : public GraphicsPipeline {
 
             if (this->needsAnimationMatrices()) {
                 this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
+                this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
             }
 
             this->descriptorPool.createPool(this->renderer->getLogicalDevice(), count);
@@ -299,6 +494,7 @@ class MeshPipeline : public GraphicsPipeline {
                 this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1);
                 this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1);
                 this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1);
+                this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1);
             }
 
             std::vector<VkDescriptorImageInfo> descriptorImageInfos;
@@ -318,24 +514,30 @@ class MeshPipeline : public GraphicsPipeline {
 
             if (this->needsAnimationMatrices()) {
                 this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1);
+                this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1);
             }
 
-            this->descriptors.create(this->renderer->getLogicalDevice(), this->descriptorPool.getPool(), this->renderer->getImageCount());
+            this->descriptors.create(this->renderer->getLogicalDevice(), this->descriptorPool.getPool(), this->renderer->getFramesInFlight());
 
             if (!this->descriptors.isInitialized()) return false;
 
             const VkDescriptorBufferInfo & ssboBufferVertexInfo = this->vertexBuffer.getDescriptorInfo();
 
-            VkDescriptorBufferInfo indirectDrawInfo;
-            if (this->renderer->usesGpuCulling()) indirectDrawInfo = this->renderer->getIndirectDrawBuffer(this->indirectBufferIndex).getDescriptorInfo();
-            const VkDescriptorBufferInfo & ssboInstanceBufferInfo = this->ssboInstanceBuffer.getDescriptorInfo();
             const VkDescriptorBufferInfo & ssboMeshDataBufferInfo = this->ssboMeshBuffer.getDescriptorInfo();
-
-            const VkDescriptorBufferInfo & ssboAnimationMatrixDataBufferInfo = this->animationMatrixBuffer.getDescriptorInfo();
+            const VkDescriptorBufferInfo & ssboVertexJointBufferInfo = this->vertexJointBuffer.getDescriptorInfo();
 
             const uint32_t descSize = this->descriptors.getDescriptorSets().size();
             for (size_t i = 0; i < descSize; i++) {
                 const VkDescriptorBufferInfo & uniformBufferInfo = this->renderer->getUniformBuffer(i).getDescriptorInfo();
+                const VkDescriptorBufferInfo & ssboInstanceBufferInfo = this->ssboInstanceBuffer.getDescriptorInfo(i);
+                const VkDescriptorBufferInfo & ssboAnimationMatrixDataBufferInfo = this->animationMatrixBuffer.getDescriptorInfo(i);
+
+                VkDescriptorBufferInfo indirectDrawInfo;
+                VkDescriptorBufferInfo indirectInstanceInfo;
+                if (this->renderer->usesGpuCulling()) {
+                    indirectDrawInfo = this->renderer->getIndirectDrawBuffer(this->indirectBufferIndex, i).getDescriptorInfo();
+                    indirectInstanceInfo = this->renderer->getIndirectInstanceBuffer(this->indirectBufferIndex, i).getDescriptorInfo();
+                }
 
                 int j=0;
                 this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), j++, i, uniformBufferInfo);
@@ -345,6 +547,7 @@ class MeshPipeline : public GraphicsPipeline {
                     this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), j++, i, indirectDrawInfo);
                     this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), j++, i, ssboInstanceBufferInfo);
                     this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), j++, i, ssboMeshDataBufferInfo);
+                    this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), j++, i, indirectInstanceInfo);
                 }
 
                 if (this->needsImageSampler()) {
@@ -353,13 +556,14 @@ class MeshPipeline : public GraphicsPipeline {
 
                 if (this->needsAnimationMatrices()) {
                     this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), j++, i, ssboAnimationMatrixDataBufferInfo);
+                    this->descriptors.updateWriteDescriptorWithBufferInfo(this->renderer->getLogicalDevice(), j++, i, ssboVertexJointBufferInfo);
                 }
             }
 
             return true;
         };
 
-        bool addObjectsToBeRenderedCommon(const void * additionalVertexData, const VkDeviceSize & additionalVertexDataSize, const std::vector<uint32_t > & additionalIndices, const bool useAltGraphicsQueue = false) {
+        bool addObjectsToBeRenderedCommon(const void * additionalVertexData, const VkDeviceSize & additionalVertexDataSize, const std::vector<uint32_t > & additionalIndices) {
             if (!this->vertexBuffer.isInitialized() || additionalVertexDataSize == 0) return false;
 
             const VkDeviceSize vertexBufferContentSize =  this->vertexBuffer.getContentSize();
@@ -368,29 +572,8 @@ class MeshPipeline : public GraphicsPipeline {
             const VkDeviceSize indexBufferContentSize =  this->indexBuffer.getContentSize();
             VkDeviceSize indexBufferAdditionalContentSize =  additionalIndices.size() * sizeof(uint32_t);
 
-            Buffer stagingBuffer;
             if (this->usesDeviceLocalVertexBuffer) {
-                stagingBuffer.createStagingBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), vertexBufferAdditionalContentSize);
-                if (stagingBuffer.isInitialized()) {
-                    stagingBuffer.updateContentSize(vertexBufferAdditionalContentSize);
-
-                    memcpy(static_cast<char *>(stagingBuffer.getBufferData()), additionalVertexData, vertexBufferAdditionalContentSize);
-
-                    const CommandPool & pool = renderer->getGraphicsCommandPool();
-                    const VkCommandBuffer & commandBuffer = pool.beginPrimaryCommandBuffer(renderer->getLogicalDevice());
-
-                    VkBufferCopy copyRegion {};
-                    copyRegion.srcOffset = 0;
-                    copyRegion.dstOffset = vertexBufferContentSize;
-                    copyRegion.size = vertexBufferAdditionalContentSize;
-                    vkCmdCopyBuffer(commandBuffer, stagingBuffer.getBuffer(), this->vertexBuffer.getBuffer(), 1, &copyRegion);
-
-                    pool.endCommandBuffer(commandBuffer);
-                    pool.submitCommandBuffer(
-                        renderer->getLogicalDevice(),  useAltGraphicsQueue ? renderer->getAltGraphicsQueue() : renderer->getGraphicsQueue(), commandBuffer);
-
-                    stagingBuffer.destroy(this->renderer->getLogicalDevice());
-
+                if (this->renderer->getUploadManager().uploadBuffer(this->vertexBuffer, vertexBufferContentSize, additionalVertexData, vertexBufferAdditionalContentSize)) {
                     this->vertexBuffer.updateContentSize(vertexBufferContentSize + vertexBufferAdditionalContentSize);
                 }
             } else {
@@ -400,27 +583,7 @@ class MeshPipeline : public GraphicsPipeline {
 
             if (this->indexBuffer.isInitialized() && !additionalIndices.empty()) {
                 if (this->usesDeviceLocalIndexBuffer) {
-                    stagingBuffer.createStagingBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), indexBufferAdditionalContentSize);
-                    if (stagingBuffer.isInitialized()) {
-                        stagingBuffer.updateContentSize(indexBufferAdditionalContentSize);
-
-                        memcpy(static_cast<char *>(stagingBuffer.getBufferData()), additionalIndices.data(), indexBufferAdditionalContentSize);
-
-                        const CommandPool & pool = renderer->getGraphicsCommandPool();
-                        const VkCommandBuffer & commandBuffer = pool.beginPrimaryCommandBuffer(renderer->getLogicalDevice());
-
-                        VkBufferCopy copyRegion {};
-                        copyRegion.srcOffset = 0;
-                        copyRegion.dstOffset = indexBufferContentSize;
-                        copyRegion.size = indexBufferAdditionalContentSize;
-                        vkCmdCopyBuffer(commandBuffer, stagingBuffer.getBuffer(), this->indexBuffer.getBuffer(), 1, &copyRegion);
-
-                        pool.endCommandBuffer(commandBuffer);
-                        pool.submitCommandBuffer(
-                            renderer->getLogicalDevice(), useAltGraphicsQueue ? renderer->getAltGraphicsQueue() : renderer->getGraphicsQueue(), commandBuffer);
-
-                        stagingBuffer.destroy(this->renderer->getLogicalDevice());
-
+                    if (this->renderer->getUploadManager().uploadBuffer(this->indexBuffer, indexBufferContentSize, additionalIndices.data(), indexBufferAdditionalContentSize)) {
                         this->indexBuffer.updateContentSize(indexBufferContentSize + indexBufferAdditionalContentSize);
                     }
                 } else {
@@ -429,6 +592,8 @@ class MeshPipeline : public GraphicsPipeline {
                 }
             }
 
+            this->renderer->invalidateCommandBuffers();
+
             return true;
         };
 
@@ -440,6 +605,8 @@ class MeshPipeline : public GraphicsPipeline {
             return false;
         };
 
+        bool addVertexJointInfo(const VkDeviceSize firstVertex, const std::vector<VertexJointInfo> & additionalVertexJointInfo);
+
     public:
         MeshPipeline & operator=(MeshPipeline) = delete;
         MeshPipeline(const MeshPipeline&) = delete;
@@ -457,12 +624,99 @@ class MeshPipeline : public GraphicsPipeline {
             return this->createGraphicsPipelineCommon(true, true, true, this->config.topology);
         };
 
-        bool addObjectsToBeRendered(const std::vector<R *> & objectsToBeRendered, const bool useAltGraphicsQueue = false);
+        bool addObjectsToBeRendered(const std::vector<R *> & objectsToBeRendered);
+
+        /**
+         *  Takes out the objects queued for removal, then grows vertex, index, mesh data (and vertex joint) buffers for the objects awaiting
+         *  the space and adds them. Called by the renderer ahead of recording, the descriptors (ours and the culling pipeline's) are rebound by
+         *  the render update growing triggers
+         */
+        void applyPendingChanges() {
+            std::vector<R *> objects;
+            {
+                const std::lock_guard<std::mutex> lock(this->additionMutex);
+
+                if (!this->objectsAwaitingRemoval.empty()) {
+                    std::vector<R *> objectsToBeRemoved;
+                    objectsToBeRemoved.swap(this->objectsAwaitingRemoval);
+                    this->removeObjectsNow(objectsToBeRemoved);
+                }
+
+                if (this->objectsAwaitingGrowth.empty()) return;
+
+                objects.swap(this->objectsAwaitingGrowth);
+                const RequiredBufferSpace space = this->getRequiredSpace(objects, this->meshDataSizeForGrowth);
+
+                const VkDeviceSize vertexBufferSize = this->vertexBuffer.getSize();
+                const VkDeviceSize indexBufferSize = this->indexBuffer.getSize();
+                const VkDeviceSize meshDataBufferSize = this->ssboMeshBuffer.getSize();
+                const VkDeviceSize vertexJointBufferSize = this->vertexJointBuffer.getSize();
+
+                bool success = this->growBuffer(this->vertexBuffer, this->usesDeviceLocalVertexBuffer,
+                    this->vertexBuffer.getContentSize() + space.vertexSpace, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+                if (this->indexBuffer.isInitialized()) {
+                    success = this->growBuffer(this->indexBuffer, this->usesDeviceLocalIndexBuffer,
+                        this->indexBuffer.getContentSize() + space.indexSpace, VK_BUFFER_USAGE_INDEX_BUFFER_BIT) && success;
+                }
+
+                if (this->renderer->usesGpuCulling()) {
+                    success = this->growBuffer(this->ssboMeshBuffer, false,
+                        this->ssboMeshBuffer.getContentSize() + space.meshDataSpace, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) && success;
+                }
+
+                if (this->vertexJointBuffer.isInitialized()) {
+                    success = this->growBuffer(this->vertexJointBuffer, false,
+                        this->vertexJointBuffer.getContentSize() + space.vertexJointSpace, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) && success;
+                }
+
+                const bool hasGrown = vertexBufferSize != this->vertexBuffer.getSize() || indexBufferSize != this->indexBuffer.getSize() ||
+                    meshDataBufferSize != this->ssboMeshBuffer.getSize() || vertexJointBufferSize != this->vertexJointBuffer.getSize();
+                if (hasGrown) {
+                    logInfo("Pipeline '" + this->name + "': grew buffers to " + Helper::formatMemoryUsage(this->vertexBuffer.getSize()) + " vertex, " +
+                        Helper::formatMemoryUsage(this->indexBuffer.getSize()) + " index, " + Helper::formatMemoryUsage(this->ssboMeshBuffer.getSize()) + " mesh data");
+                    this->renderer->forceRenderUpdate();
+                }
+
+                // adding them again would only queue them again
+                if (!success) {
+                    logError("Pipeline '" + this->name + "': dropped " + std::to_string(objects.size()) + " objects for lack of buffer space");
+                    return;
+                }
+            }
+
+            this->addObjectsToBeRendered(objects);
+        };
+
+        /**
+         *  Queues the given objects for removal by the render thread, which updates and draws the objects without a lock.
+         *  Objects still waiting to be added are dropped right away
+         */
+        bool removeObjectsToBeRendered(const std::vector<R *> & objectsToBeRemoved) {
+            const std::lock_guard<std::mutex> lock(this->additionMutex);
+
+            for (const auto & o : objectsToBeRemoved) std::erase(this->objectsAwaitingGrowth, o);
+            this->objectsAwaitingRemoval.insert(this->objectsAwaitingRemoval.end(), objectsToBeRemoved.begin(), objectsToBeRemoved.end());
+
+            return true;
+        };
 
         void clearObjectsToBeRendered() {
+            const std::lock_guard<std::mutex> lock(this->additionMutex);
+
             this->objectsToBeRendered.clear();
+            this->objectsAwaitingGrowth.clear();
+            this->objectsAwaitingRemoval.clear();
+            this->meshBufferOffsets.clear();
+            this->instanceIndexes.clear();
+            this->instanceChanges.clear();
+            if (this->renderer != nullptr && this->renderer->usesGpuCulling()) this->instanceChanges.push_back({ INSTANCES_CLEARED });
             if (this->indexBuffer.isInitialized()) this->indexBuffer.updateContentSize(0);
             if (this->vertexBuffer.isInitialized()) this->vertexBuffer.updateContentSize(0);
+            this->ssboInstanceBuffer.clear();
+            this->animationMatrixBuffer.clear();
+            if (this->vertexJointBuffer.isInitialized()) this->vertexJointBuffer.updateContentSize(0);
+            if (this->renderer != nullptr) this->renderer->invalidateCommandBuffers();
         };
 
         void draw(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex);
@@ -479,19 +733,35 @@ class MeshPipeline : public GraphicsPipeline {
                             o->getMatrix(), sphere.center, sphere.radius
                         };
 
-                        memcpy(static_cast<char *>(this->ssboInstanceBuffer.getBufferData()) + (i * instanceDataSize), &instanceData, instanceDataSize);
+                        this->ssboInstanceBuffer.write(i * instanceDataSize, &instanceData, instanceDataSize);
                     }
 
                     o->setDirty(false);
                 }
                 i++;
             }
+
+            this->ssboInstanceBuffer.flush(this->renderer->getCurrentFrame());
         };
 
         std::vector<R *> & getRenderables() {
             return this->objectsToBeRendered;
         };
 
+        MeshBufferOffsets getMeshBufferOffsets(const R * renderable) const {
+            const auto offsets = this->meshBufferOffsets.find(renderable->getGeometryOwner() != nullptr ? renderable->getGeometryOwner() : renderable);
+            return offsets != this->meshBufferOffsets.end() ? offsets->second : MeshBufferOffsets {};
+        };
+
+        std::vector<InstanceChange> takeInstanceChanges() {
+            const std::lock_guard<std::mutex> lock(this->additionMutex);
+
+            std::vector<InstanceChange> changes;
+            changes.swap(this->instanceChanges);
+
+            return changes;
+        };
+
         ~MeshPipeline() {
             this->clearObjectsToBeRendered();
         };
@@ -515,7 +785,7 @@ bool VertexMeshPipeline0::needsAnimationMatrices();
 template<>
 bool VertexMeshPipeline0::initPipeline(const PipelineConfig & config);
 template<>
-bool VertexMeshPipeline0::addObjectsToBeRendered(const std::vector<VertexMeshRenderable *> & additionalObjectsToBeRendered, const bool useAltGraphicsQueue);
+bool VertexMeshPipeline0::addObjectsToBeRendered(const std::vector<VertexMeshRenderable *> & additionalObjectsToBeRendered);
 template<>
 void VertexMeshPipeline0::draw(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex);
 
@@ -541,7 +811,7 @@ bool ColorMeshPipeline0::needsAnimationMatrices();
 template<>
 bool ColorMeshPipeline0::initPipeline(const PipelineConfig & config);
 template<>
-bool ColorMeshPipeline0::addObjectsToBeRendered(const std::vector<ColorMeshRenderable *> & additionalObjectsToBeRendered, const bool useAltGraphicsQueue);
+bool ColorMeshPipeline0::addObjectsToBeRendered(const std::vector<ColorMeshRenderable *> & additionalObjectsToBeRendered);
 template<>
 void ColorMeshPipeline0::draw(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex);
 
@@ -553,7 +823,7 @@ bool TextureMeshPipeline::needsAnimationMatrices();
 template<>
 bool TextureMeshPipeline::initPipeline(const PipelineConfig & config);
 template<>
-bool TextureMeshPipeline::addObjectsToBeRendered(const std::vector<TextureMeshRenderable *> & additionalObjectsToBeRendered, const bool useAltGraphicsQueue);
+bool TextureMeshPipeline::addObjectsToBeRendered(const std::vector<TextureMeshRenderable *> & additionalObjectsToBeRendered);
 template<>
 void TextureMeshPipeline::draw(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex);
 
@@ -565,7 +835,7 @@ bool ModelMeshPipeline::needsAnimationMatrices();
 template<>
 bool ModelMeshPipeline::initPipeline(const PipelineConfig & config);
 template<>
-bool ModelMeshPipeline::addObjectsToBeRendered(const std::vector<ModelMeshRenderable *> & additionalObjectsToBeRendered, const bool useAltGraphicsQueue);
+bool ModelMeshPipeline::addObjectsToBeRendered(const std::vector<ModelMeshRenderable *> & additionalObjectsToBeRendered);
 template<>
 void ModelMeshPipeline::draw(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex);
 
@@ -577,7 +847,11 @@ bool AnimatedModelMeshPipeline::needsAnimationMatrices();
 template<>
 bool AnimatedModelMeshPipeline::initPipeline(const PipelineConfig & config);
 template<>
-bool AnimatedModelMeshPipeline::addObjectsToBeRendered(const std::vector<AnimatedModelMeshRenderable *> & additionalObjectsToBeRendered, const bool useAltGraphicsQueue);
+bool AnimatedModelMeshPipeline::addVertexJointInfo(const VkDeviceSize firstVertex, const std::vector<VertexJointInfo> & additionalVertexJointInfo);
+template<>
+bool AnimatedModelMeshPipeline::addObjectsToBeRendered(const std::vector<AnimatedModelMeshRenderable *> & additionalObjectsToBeRendered);
+template<>
+bool AnimatedModelMeshPipeline::removeObjectsToBeRendered(const std::vector<AnimatedModelMeshRenderable *> & objectsToBeRemoved);
 template<>
 void AnimatedModelMeshPipeline::draw(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex);
 template<>
@@ -601,6 +875,22 @@ struct CullPipelineConfig : ComputePipelineConfig {
     };
 };
 
+struct DepthPyramidPipelineConfig : ComputePipelineConfig {
+    DepthPyramidPipelineConfig() {
+        this->shaders = { { "depth-pyramid.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT} };
+    };
+};
+
+struct AnimationPipelineConfig : ComputePipelineConfig {
+    VkDeviceSize reservedSkeletonSpace = 8 * MEGA_BYTE;
+    VkDeviceSize reservedInstanceDataSpace = MEGA_BYTE;
+
+    AnimationPipelineConfig() {
+        this->reservedComputeSpace = 32 * MEGA_BYTE;
+        this->shaders = { { "animation.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT} };
+    };
+};
+
 class ComputePipeline : public Pipeline {
     protected:
         Buffer computeBuffer;
@@ -622,6 +912,7 @@ class ComputePipeline : public Pipeline {
 
         virtual void update() = 0;
         virtual void compute(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex) = 0;
+        virtual void computeLate(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex);
 
         MemoryUsage getMemoryUsage() const;
         int getIndirectBufferIndex() const;
@@ -633,20 +924,67 @@ class ComputePipeline : public Pipeline {
 
 class CullPipeline : public ComputePipeline {
     private:
-        uint32_t vertexOffset = 0;
-        uint32_t indexOffset = 0;
-        uint32_t instanceOffset = 0;
-        uint32_t meshOffset = 0;
-
         CullPipelineConfig config;
         std::optional<MeshPipelineVariant> linkedGraphicsPipeline;
 
+        // one flag per draw command and frame in flight, written by the late phase, read by the early one
+        std::vector<Buffer> visibilityBuffers;
+
+        // per frame in flight: the visible instances of every batch and lod, and the lod every draw command passed with
+        uint32_t batchCount = 0;
+        std::vector<Buffer> batchBuffers;
+        std::vector<Buffer> commandLodBuffers;
+
+        // every draw command has a slot in the compute and visibility buffers, freed ones are reused and compacted away once too many
+        ankerl::unordered_dense::map<const Renderable *, std::vector<uint32_t>> slotsByRenderable;
+        std::vector<const Renderable *> slotOwners;
+        std::set<uint32_t> freeSlots;
+        std::set<uint32_t> dirtySlots;
+        // recorded with the next compute commands: visibility resets of new slots, and the moves of a compaction
+        std::set<uint32_t> addedSlots;
+        std::vector<VkBufferCopy> pendingDrawCommandCopies;
+        std::vector<VkBufferCopy> pendingVisibilityCopies;
+
+        // the compute buffer content, kept for the type of draw commands the linked pipeline needs
+        std::vector<ColorMeshDrawCommand> drawCommands;
+        std::vector<VertexMeshDrawCommand> vertexDrawCommands;
+
+        // shareable geometries keep their draw commands (and batches) for renderables sharing them later
+        ankerl::unordered_dense::map<const Renderable *, std::vector<ColorMeshDrawCommand>> sharedDrawCommands;
+        std::vector<uint32_t> batchReferences;
+        std::vector<uint32_t> freeBatches;
+
         bool createDescriptorPool();
         bool createDescriptors();
         bool createComputeBuffer();
-
-        template<typename T>
-        void updateComputeBuffer(T * pipeline);
+        bool createVisibilityBuffers();
+        bool createBatchBuffers();
+
+        void dispatch(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex, const CullPhase phase);
+
+        uint32_t allocateSlot(const Renderable * renderable);
+        uint32_t allocateBatch();
+        void releaseBatch(const uint32_t batch);
+        void clearSlots();
+        void recordSlotChanges(const VkCommandBuffer & commandBuffer);
+
+        template<typename R, typename C>
+        void addDrawCommands(MeshPipeline<R, C> * pipeline, const R * renderable, const uint32_t instance, std::vector<ColorMeshDrawCommand> & commands);
+        void addDrawCommands(VertexMeshPipeline0 * pipeline, const VertexMeshRenderable * renderable, const uint32_t instance, std::vector<VertexMeshDrawCommand> & commands);
+        template<typename M>
+        void addDrawCommand(const M & mesh, MeshBufferOffsets & offsets, std::vector<ColorMeshDrawCommand> & drawCommands);
+        template<typename M>
+        static uint32_t getDrawCommandCount(const M & mesh);
+        template<typename D>
+        void moveDrawCommands(const Renderable * renderable, const uint32_t instance, std::vector<D> & commands);
+        template<typename D>
+        void removeDrawCommands(const Renderable * renderable, std::vector<D> & commands);
+        template<typename D>
+        void trimSlots(std::vector<D> & commands);
+        template<typename D>
+        void commitSlots(std::vector<D> & commands);
+        template<typename R, typename C, typename D>
+        void updateComputeBuffer(MeshPipeline<R, C> * pipeline, std::vector<D> & commands);
     public:
         CullPipeline(const CullPipeline&) = delete;
         CullPipeline& operator=(const CullPipeline &) = delete;
@@ -655,6 +993,7 @@ class CullPipeline : public ComputePipeline {
 
         void update();
         void compute(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex);
+        void computeLate(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex);
 
         bool initPipeline(const PipelineConfig & config);
         bool createPipeline();
@@ -662,6 +1001,86 @@ class CullPipeline : public ComputePipeline {
         ~CullPipeline();
 };
 
+/**
+ *  Reduces the depth buffer of the early draws into a mip chain of farthest depths (one per frame in flight),
+ *  which the late cull phase tests bounding spheres against. The pyramid is the power of 2 below the swap chain extent.
+ */
+class DepthPyramidPipeline : public ComputePipeline {
+    private:
+        DepthPyramidPipelineConfig config;
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t levels = 0;
+
+        std::vector<Image> pyramids;
+        std::vector<std::vector<VkImageView>> levelViews;
+        std::vector<VkImageView> boundDepthViews;
+
+        bool createPyramids();
+        void destroyPyramids();
+        bool createDescriptorPool();
+        bool createDescriptors();
+    public:
+        DepthPyramidPipeline(const DepthPyramidPipeline&) = delete;
+        DepthPyramidPipeline& operator=(const DepthPyramidPipeline &) = delete;
+        DepthPyramidPipeline(DepthPyramidPipeline &&) = delete;
+        DepthPyramidPipeline(const std::string name, Renderer * renderer);
+
+        void update();
+        void compute(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex);
+
+        bool initPipeline(const PipelineConfig & config);
+        bool createPipeline();
+
+        void setDepthImage(const Image & depthImage, const uint16_t commandBufferIndex);
+        const VkDescriptorImageInfo getDescriptorInfo(const uint16_t commandBufferIndex) const;
+
+        ~DepthPyramidPipeline();
+};
+
+/**
+ *  Evaluates the joint palettes of the linked animated model pipeline on the gpu:
+ *  one invocation per instance and joint walks up the flattened hierarchy sampling the key frames.
+ *  Key frames live in the compute buffer, the per frame instance data holds animation and time.
+ */
+class AnimationPipeline : public ComputePipeline {
+    private:
+        uint32_t instanceOffset = 0;
+        uint32_t paletteOffset = 0;
+        uint32_t maxJointCount = 0;
+
+        AnimationPipelineConfig config;
+        AnimatedModelMeshPipeline * linkedGraphicsPipeline = nullptr;
+
+        Buffer nodeBuffer;
+        Buffer trackBuffer;
+        Buffer jointBuffer;
+        FrameRingBuffer instanceBuffer;
+
+        std::vector<AnimationInstanceData> instances;
+        std::vector<std::unordered_map<std::string, uint32_t>> trackOffsetsByAnimation;
+
+        bool createDescriptorPool();
+        bool createDescriptors();
+        bool createComputeBuffers();
+
+        bool addAnimationData(AnimatedModelMeshRenderable * renderable);
+    public:
+        AnimationPipeline(const AnimationPipeline&) = delete;
+        AnimationPipeline& operator=(const AnimationPipeline &) = delete;
+        AnimationPipeline(AnimationPipeline &&) = delete;
+        AnimationPipeline(const std::string name, Renderer * renderer);
+
+        void update();
+        void compute(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex);
+
+        bool initPipeline(const PipelineConfig & config);
+        bool createPipeline();
+
+        ~AnimationPipeline();
+};
+
 class ImGuiPipeline : public GraphicsPipeline {
     private:
         ImGUIPipelineConfig config;
@@ -686,6 +1105,7 @@ class ImGuiPipeline : public GraphicsPipeline {
 
         void draw(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex);
         void update();
+        bool hasStaticCommands() const;
 
         ~ImGuiPipeline();
 };
@@ -3,6 +3,14 @@
 
 #include "graphics.h"
 
+class GraphicsPipeline;
+class DepthPyramidPipeline;
+
+struct RecordedCommandBuffer {
+    VkCommandBuffer commandBuffer = nullptr;
+    const CommandPool * pool = nullptr;
+};
+
 class Renderer final {
     private:
         bool isConnectedToServer = false;
@@ -14,6 +22,8 @@ class Renderer final {
         VkDevice logicalDevice = nullptr;
 
         bool useGpuCulling = USE_GPU_CULLING;
+        bool useOcclusionCulling = USE_OCCLUSION_CULLING;
+        bool useParallelCommandRecording = USE_PARALLEL_COMMAND_RECORDING;
         bool recording = false;
 
         std::unordered_map<std::string, uint64_t> deviceProperties;
@@ -23,11 +33,13 @@ class Renderer final {
 
         CommandPool graphicsCommandPool;
         CommandPool computeCommandPool;
+        std::vector<std::unique_ptr<CommandPool>> recordingCommandPools;
 
         std::vector<VkCommandBuffer> commandBuffers;
         std::vector<VkCommandBuffer> computeBuffers;
 
         uint32_t imageCount = 0;
+        uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
 
         int graphicsQueueIndex = -1;
         VkQueue graphicsQueue = nullptr;
@@ -47,9 +59,11 @@ class Renderer final {
         VkDeviceSize indirectDrawBufferSize = INDIRECT_DRAW_BUFFER_SIZE_DEFAULT;
         std::vector<bool> usesDeviceIndirectDrawBuffer;
         std::vector<Buffer> indirectDrawCountBuffer;
+        std::vector<Buffer> indirectInstanceBuffer;
         std::vector<uint32_t> maxIndirectDrawCount;
 
         std::vector<Pipeline *> pipelines;
+        DepthPyramidPipeline * depthPyramidPipeline = nullptr;
 
         std::vector<float> deltaTimes;
         float lastDeltaTime = DELTA_TIME_60FPS;
@@ -70,6 +84,7 @@ class Renderer final {
         bool fullScreen = false;
 
         VkRenderPass renderPass = nullptr;
+        VkRenderPass lateRenderPass = nullptr;
         VkExtent2D swapChainExtent;
 
         VkSwapchainKHR swapChain = nullptr;
@@ -82,12 +97,36 @@ class Renderer final {
 
         std::vector<VkSemaphore> imageAvailableSemaphores;
         std::vector<VkSemaphore> renderFinishedSemaphores;
-        std::vector<VkFence> inFlightFences;
-        std::vector<VkSemaphore> computeFinishedSemaphores;
-        std::vector<VkFence> computeFences;
 
-        bool createRenderPass0(VkRenderPass & renderPass, const VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED, const VkImageLayout depthImageFinalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, const bool clear = true);
+        // timeline values: graphics counts submitted frames, compute counts its submissions
+        VkSemaphore graphicsTimeline = nullptr;
+        VkSemaphore computeTimeline = nullptr;
+        uint64_t graphicsTimelineValue = 0;
+        uint64_t computeTimelineValue = 0;
+        // set while recording compute commands that overwrite what the frames in flight read
+        bool computeOverwritesDataInUse = false;
+
+        FrameProfiler frameProfiler;
+        UploadManager uploadManager;
+        WorkerPool workerPool;
+
+        // replaced buffers stay alive until the next render update waited for the queues
+        std::mutex retiredBuffersMutex;
+        std::vector<std::unique_ptr<Buffer>> retiredBuffers;
+        void destroyRetiredBuffers();
+
+        std::atomic<uint64_t> commandBufferGeneration = 1;
+        std::vector<std::vector<RecordedCommandBuffer>> staticCommandBuffers;
+        std::vector<uint64_t> staticCommandBufferGenerations;
+        std::vector<size_t> staticSectionCounts;
+        std::vector<std::vector<RecordedCommandBuffer>> dynamicCommandBuffers;
+        std::vector<VkCommandBuffer> lateCommandBuffers;
+        std::vector<uint64_t> computeBufferGenerations;
+
+        bool createRenderPass0(VkRenderPass & renderPass, const VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED, const VkImageLayout depthImageInitialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                               const VkImageLayout depthImageFinalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, const bool clear = true);
         bool createRenderPass();
+        bool createDepthPyramid();
         bool createSwapChain();
         bool createFramebuffers();
         bool createDepthResources();
@@ -99,10 +138,20 @@ class Renderer final {
         void destroyCommandBuffer(VkCommandBuffer commandBuffer, const bool resetOnly = false);
         VkCommandBuffer createCommandBuffer(const uint16_t commandBufferIndex, const uint16_t imageIndex, const bool useSecondaryCommandBuffers = false);
         void renderPipeline(const std::string pipelineName, const VkRenderPass renderPass, const VkCommandBuffer & commandBuffer, const uint16_t imageIndex);
+        void recordPipelines(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex, const bool staticCommands);
+        bool recordStaticCommandBuffer(const uint16_t commandBufferIndex);
+        bool recordCommandBuffersInParallel(const uint16_t commandBufferIndex, const std::vector<GraphicsPipeline *> & graphicsPipelines, const bool reusable, std::vector<RecordedCommandBuffer> & commandBuffers);
+        bool recordDynamicCommandBuffers(const uint16_t commandBufferIndex);
+        void freeDynamicCommandBuffers(const uint16_t commandBufferIndex);
+        bool recordLateCommandBuffer(const uint16_t commandBufferIndex, const std::vector<GraphicsPipeline *> & staticPipelines);
+        void recordOcclusionCulling(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex, const uint16_t imageIndex);
+        void freeStaticCommandBuffers(const uint16_t commandBufferIndex);
 
         void update();
+        bool waitForFrame();
         void renderFrame(const bool addFrameToCache = false);
         void computeFrame();
+        void submitComputeFrame();
 
         bool createUniformBuffers();
         void updateUniformBuffers(int index);
@@ -133,6 +182,9 @@ class Renderer final {
         VkDevice getLogicalDevice() const;
         VkPhysicalDevice getPhysicalDevice() const;
         uint32_t getImageCount() const;
+        uint32_t getFramesInFlight() const;
+        uint16_t getCurrentFrame() const;
+        void setFramesInFlight(const uint32_t framesInFlight);
 
         std::vector<std::unique_ptr<Buffer>> & getCachedFrames();
         void setCachedFrameIndex(const int frameIndex);
@@ -147,6 +199,8 @@ class Renderer final {
         bool recreatePipelines();
 
         void forceRenderUpdate(const bool requiresSwapChainRecreate = false);
+        void invalidateCommandBuffers();
+        void retireBuffer(std::unique_ptr<Buffer> buffer);
         void resetRenderUpdate();
         void forceNewTexturesUpload();
         bool doesShowWireFrame() const;
@@ -156,6 +210,13 @@ class Renderer final {
         bool usesGpuCulling() const;
         void setGpuCulling(const bool useGpuCulling);
 
+        bool usesOcclusionCulling() const;
+        void setOcclusionCulling(const bool useOcclusionCulling);
+        const DepthPyramidPipeline * getDepthPyramidPipeline() const;
+
+        bool usesParallelCommandRecording() const;
+        void setParallelCommandRecording(const bool useParallelCommandRecording);
+
         bool isRecording() const;
         void setRecording(const bool recording);
 
@@ -172,8 +233,9 @@ class Renderer final {
 
         void setClearValue(const VkClearColorValue & clearColorValue);
 
-        Buffer & getIndirectDrawBuffer(const int & index);
-        Buffer & getIndirectDrawCountBuffer(const int & index);
+        Buffer & getIndirectDrawBuffer(const int & index, const uint16_t frame = 0);
+        Buffer & getIndirectDrawCountBuffer(const int & index, const uint16_t frame = 0);
+        Buffer & getIndirectInstanceBuffer(const int & index, const uint16_t frame = 0);
         bool createIndirectDrawBuffers();
         void setMaxIndirectCallCount(uint32_t maxIndirectDrawCount, const int & index);
         uint32_t getMaxIndirectCallCount(const int & index);
@@ -190,8 +252,13 @@ class Renderer final {
         const Buffer & getUniformComputeBuffer(int index) const;
 
         std::vector<MemoryUsage> getMemoryUsage() const;
+        FrameProfiler & getFrameProfiler();
+        UploadManager & getUploadManager();
+        WorkerPool & getWorkerPool();
+        void setComputeOverwritesDataInUse();
 
         void setIndirectDrawBufferSize(const VkDeviceSize & size);
+        uint32_t getIndirectDrawCapacity() const;
 
         const GraphicsContext * getGraphicsContext() const;
 
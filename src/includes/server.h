@@ -3,6 +3,24 @@
 
 #include "physics.h"
 
+static constexpr uint32_t SNAPSHOT_OBJECTS_PER_MESSAGE = 100;
+
+struct ShardConfig final {
+    uint16_t index = 0;
+    uint16_t count = 1;
+
+    bool owns(const glm::vec3 & position) const {
+        return getShardForPosition(position, this->count) == this->index;
+    }
+
+    // objects bordering our stripe are mirrored for the broad phase but not owned
+    bool mirrors(const glm::vec3 & position) const {
+        return this->owns(position) ||
+            this->owns(position - glm::vec3(SHARD_MIRROR_MARGIN, 0.0f, 0.0f)) ||
+            this->owns(position + glm::vec3(SHARD_MIRROR_MARGIN, 0.0f, 0.0f));
+    }
+};
+
 class ObjectFactory final
 {
     private:
@@ -26,6 +44,9 @@ class ObjectFactory final
         static bool handleCreateUpdateResponse(CommBuilder & builder, const PhysicsObject * physicsObject);
         static void addDebugResponse(CommBuilder & builder, const PhysicsObject * physicsObject);
         static PhysicsObject * handleObjectPropertiesUpdateRequest(const ObjectPropertiesUpdateRequest * request);
+        static uint32_t handleSnapshotRequest(const std::function<void(CommBuilder &, const std::string &)> & sendChunk, const uint32_t debugFlags = 0, const std::set<std::string> & interestGroups = {}, const uint32_t objectsPerMessage = SNAPSHOT_OBJECTS_PER_MESSAGE);
+        static std::string getInterestGroup(PhysicsObject * physicsObject, const bool update = false);
+        static bool handleHandOffRequest(CommBuilder & builder, const PhysicsObject * physicsObject);
 
 
         static std::filesystem::path getAppPath(APP_PATHS appPath);
@@ -21,6 +21,11 @@
 #include <variant>
 #include <optional>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <bit>
+#include <deque>
+#include <set>
 
 #include "imgui.h"
 #include "imgui_internal.h"
@@ -32,6 +37,7 @@ int start(int argc, char* argv []);
 
 const std::string APP_NAME = "Playground";
 const std::string MESSAGE_LOG = "messages.log";
+static constexpr uint32_t MESSAGE_LOG_REPLAY_BATCH_SIZE = 100;
 
 constexpr uint32_t VULKAN_VERSION = VK_MAKE_VERSION(1,2,0);
 static constexpr VkClearColorValue BLACK = {{ 0.0f, 0.0f, 0.0f, 1.0f }};
@@ -67,11 +73,41 @@ const std::string DEVICE_MEMORY_USAGE_MANUALLY_TRACKED = "deviceMemoryManuallyTr
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 
 static constexpr bool USE_GPU_CULLING = true;
+static constexpr bool USE_OCCLUSION_CULLING = false;
+static constexpr bool USE_GPU_ANIMATION = false;
+static constexpr bool USE_PARALLEL_COMMAND_RECORDING = true;
+static constexpr uint32_t MAX_COMMAND_RECORDING_THREADS = 8;
+static constexpr uint32_t MIN_ANIMATIONS_PER_UPDATE_THREAD = 8;
 static constexpr uint64_t FRAME_RECORDING_INTERVAL = 20;
 static constexpr uint32_t FRAME_RECORDING_MAX_FRAMES = 150;
 
+static constexpr uint32_t FRAME_PROFILER_MAX_SECTIONS = 32;
+static constexpr double FRAME_PROFILER_SMOOTHING = 0.05;
+static constexpr uint64_t FRAME_PROFILER_GPU_TRACK = 100000;
+
+static constexpr VkDeviceSize FRAME_RING_BUFFER_CHUNK_SIZE = 256;
+static const VkDeviceSize UPLOAD_STAGING_BUFFER_SIZE = 64 * MEGA_BYTE;
+static constexpr VkDeviceSize UPLOAD_STAGING_ALIGNMENT = 16;
+
+static const VkDeviceSize MEMORY_ALLOCATOR_BLOCK_SIZE = 64 * MEGA_BYTE;
+static constexpr VkDeviceSize MEMORY_ALLOCATOR_MIN_ALLOCATION = 256;
+
+static constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+static constexpr float OVERDRAW_CLUSTER_THRESHOLD = 1.05f;
+
+static constexpr uint32_t MAX_MESH_LODS = 4;
+static constexpr uint32_t LOD_MIN_TRIANGLES = 32;
+static constexpr float LOD_REDUCTION_FACTOR = 0.5f;
+static constexpr float LOD_MAX_ERROR = 0.01f;
+
+static constexpr uint32_t MESH_CLUSTER_TRIANGLES = 128;
+static constexpr uint32_t MESH_CLUSTER_MIN_TRIANGLES = 4096;
+static constexpr float LOD_SCREEN_COVERAGE = 0.25f;
+static constexpr float CULL_SLOT_COMPACTION_RATIO = 0.25f;
+
 static constexpr uint32_t MAX_NUMBER_OF_TEXTURES = 5000;
 static constexpr uint32_t DEFAULT_BUFFERING = 3;
+static constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
 static constexpr uint32_t MIPMAP_LEVELS = 8;
 
 static constexpr int FRAME_RATE_60 = 60;
@@ -97,6 +133,11 @@ struct MemoryUsage {
     bool computeBufferUsesDeviceLocal = false;
     VkDeviceSize indirectBufferTotal = 0;
     bool indirectBufferUsesDeviceLocal = false;
+    uint32_t allocatorBlocks = 0;
+    uint32_t allocatorDedicated = 0;
+    VkDeviceSize allocatorUsed = 0;
+    VkDeviceSize allocatorTotal = 0;
+    float allocatorFragmentation = 0.0f;
 };
 
 struct DeviceMemoryUsage {
@@ -114,6 +155,10 @@ struct GraphicsUniforms {
 
 struct CullUniforms {
     std::array<glm::vec4, 6> frustumPlanes;
+    glm::vec4 cameraAndLodScale;
+    glm::mat4 viewProjMatrix;
+    // x: draws, y: visible instances
+    glm::uvec4 indirectCapacity;
 };
 
 class DescriptorPool final {
@@ -177,10 +222,102 @@ struct ImageConfig {
     uint32_t mipLevels = 1;
 };
 
+struct MemoryAllocation {
+    VkDeviceMemory memory = nullptr;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void * mappedData = nullptr;
+    int32_t block = -1;
+};
+
+struct MemoryAllocatorStats {
+    uint32_t blocks = 0;
+    uint32_t dedicatedAllocations = 0;
+    uint32_t liveAllocations = 0;
+    VkDeviceSize blockBytes = 0;
+    VkDeviceSize usedBytes = 0;
+    VkDeviceSize dedicatedBytes = 0;
+    VkDeviceSize largestFreeRange = 0;
+    // free bytes of each block outside of its own largest free range, summed up
+    VkDeviceSize fragmentedFreeBytes = 0;
+};
+
+/**
+ *  One VkDeviceMemory handed out in power of 2 pieces by a buddy allocator.
+ *  Pieces are aligned to their own size which covers any (power of 2) alignment requirement.
+ */
+class MemoryBlock final {
+    private:
+        VkDeviceMemory memory = nullptr;
+        void * mappedData = nullptr;
+        VkDeviceSize size = 0;
+        uint32_t memoryTypeIndex = 0;
+        bool forImages = false;
+        VkDeviceSize used = 0;
+
+        std::vector<std::set<VkDeviceSize>> freeLists;
+        std::unordered_map<VkDeviceSize, uint32_t> allocatedLevels;
+
+    public:
+        MemoryBlock();
+        MemoryBlock(const MemoryBlock&) = delete;
+        MemoryBlock& operator=(const MemoryBlock &) = delete;
+        MemoryBlock(MemoryBlock &&) = delete;
+        MemoryBlock & operator=(MemoryBlock) = delete;
+
+        VkResult create(const VkDevice & logicalDevice, const VkDeviceSize size, const uint32_t memoryTypeIndex, const bool hostVisible, const bool forImages);
+        void destroy(const VkDevice & logicalDevice);
+
+        bool allocate(const VkDeviceSize size, const VkDeviceSize alignment, MemoryAllocation & allocation);
+        void free(const VkDeviceSize offset);
+
+        bool matches(const uint32_t memoryTypeIndex, const bool forImages) const;
+        bool isEmpty() const;
+        VkDeviceSize getSize() const;
+        VkDeviceSize getUsed() const;
+        VkDeviceSize getLargestFreeRange() const;
+        uint32_t getNumberOfAllocations() const;
+};
+
+/**
+ *  Sub allocates buffer and image memory out of blocks pooled per memory type (images and buffers apart for the granularity).
+ *  Anything above half a block gets memory of its own, host visible blocks stay mapped for their lifetime.
+ */
+class MemoryAllocator final {
+    private:
+        static MemoryAllocator * instance;
+        MemoryAllocator();
+
+        std::mutex allocationMutex;
+        std::vector<std::unique_ptr<MemoryBlock>> blocks;
+        uint32_t dedicatedAllocations = 0;
+        VkDeviceSize dedicatedBytes = 0;
+        uint32_t maxAllocationCount = 0;
+        VkPhysicalDeviceMemoryProperties memoryProperties {};
+
+        bool allocateDedicated(const VkDevice & logicalDevice, const VkDeviceSize size, const uint32_t memoryTypeIndex, const bool hostVisible, MemoryAllocation & allocation);
+
+    public:
+        MemoryAllocator& operator=(const MemoryAllocator &) = delete;
+        MemoryAllocator(MemoryAllocator &&) = delete;
+        MemoryAllocator & operator=(MemoryAllocator) = delete;
+
+        static MemoryAllocator * INSTANCE();
+
+        bool allocate(const VkPhysicalDevice & physicalDevice, const VkDevice & logicalDevice, const VkMemoryRequirements & memoryRequirements,
+                      const uint32_t memoryTypeIndex, const bool forImage, MemoryAllocation & allocation);
+        void free(const VkDevice & logicalDevice, MemoryAllocation & allocation);
+        void destroy(const VkDevice & logicalDevice);
+
+        MemoryAllocatorStats getStats();
+
+        ~MemoryAllocator();
+};
+
 class Image final {
     private:
         VkImage image = nullptr;
-        VkDeviceMemory imageMemory = nullptr;
+        MemoryAllocation imageMemory;
         VkImageView imageView = nullptr;
         VkSampler imageSampler = nullptr;
         bool initialized = false;
@@ -200,7 +337,7 @@ class Image final {
         const VkImage & getImage() const;
         const VkImageView & getImageView() const;
         void transitionImageLayout(const VkCommandBuffer& commandBuffer, const VkImageLayout oldLayout, const VkImageLayout newLayout, const uint16_t layerCount = 1, const uint32_t mipLevels = 1) const;
-        void copyBufferToImage(const VkCommandBuffer& commandBuffer, const VkBuffer& buffer, const uint32_t width, const uint32_t height, const uint16_t layerCount = 1, const VkImageLayout imageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        void copyBufferToImage(const VkCommandBuffer& commandBuffer, const VkBuffer& buffer, const uint32_t width, const uint32_t height, const uint16_t layerCount = 1, const VkImageLayout imageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, const VkDeviceSize bufferOffset = 0);
         void generateMipMaps(const VkCommandBuffer& commandBuffer, const int32_t width, const int32_t height, const uint32_t levels) const;
         const VkDescriptorImageInfo getDescriptorInfo() const;
         const VkSampler & getSampler() const;
@@ -226,8 +363,8 @@ class CommandPool final {
         void reset(const VkDevice& logicalDevice);
         void create(const VkDevice & logicalDevice, const int queueIndex = 0);
 
-        VkCommandBuffer beginPrimaryCommandBuffer(const VkDevice & logicalDevice) const;
-        VkCommandBuffer beginSecondaryCommandBuffer(const VkDevice & logicalDevice, const VkRenderPass & renderPass) const;
+        VkCommandBuffer beginPrimaryCommandBuffer(const VkDevice & logicalDevice, const bool reusable = false) const;
+        VkCommandBuffer beginSecondaryCommandBuffer(const VkDevice & logicalDevice, const VkRenderPass & renderPass, const bool reusable = false) const;
 
         void endCommandBuffer(const VkCommandBuffer & commandBuffer) const;
         void freeCommandBuffer(const VkDevice & logicalDevice, const VkCommandBuffer & commandBuffer) const;
@@ -238,7 +375,7 @@ class CommandPool final {
 class Buffer final {
     private:
         VkBuffer buffer = nullptr;
-        VkDeviceMemory bufferMemory = nullptr;
+        MemoryAllocation bufferMemory;
         void * bufferData = nullptr;
         VkDeviceSize bufferSize = 0;
         VkDeviceSize bufferContentSize = 0;
@@ -275,6 +412,242 @@ class Buffer final {
         const VkBuffer& getBuffer() const;
         const VkDeviceMemory & getBufferMemory() const;
         const VkDescriptorBufferInfo getDescriptorInfo() const;
+
+        void swap(Buffer & other);
+};
+
+/**
+ *  Persistently mapped storage buffer holding a copy of its content for every frame in flight.
+ *  Writes go into a cpu side shadow copy and mark the touched chunks dirty for all frames (by atomic bitmasks),
+ *  flushing a frame copies only its dirty chunks so that the gpu never reads a copy that is being written to.
+ *  Every range of 64 chunks (one bitmask word) has its own lock so that a flush never copies a half written range
+ */
+class FrameRingBuffer final {
+    private:
+        Buffer buffer;
+        std::unique_ptr<uint8_t[]> shadow;
+        std::unique_ptr<std::atomic<uint64_t>[]> dirtyChunks;
+        std::unique_ptr<std::mutex[]> rangeLocks;
+        VkDeviceSize frameSize = 0;
+        uint32_t frames = 0;
+        size_t wordsPerFrame = 0;
+        std::atomic<VkDeviceSize> contentSize = 0;
+
+        void markDirty(const VkDeviceSize offset, const VkDeviceSize size);
+
+    public:
+        FrameRingBuffer();
+        FrameRingBuffer(const FrameRingBuffer&) = delete;
+        FrameRingBuffer& operator=(const FrameRingBuffer &) = delete;
+        FrameRingBuffer(FrameRingBuffer &&) = delete;
+        FrameRingBuffer & operator=(FrameRingBuffer) = delete;
+
+        VkResult create(const VkPhysicalDevice & physicalDevice, const VkDevice & logicalDevice, const VkDeviceSize size, const uint32_t frames);
+        void destroy(const VkDevice & logicalDevice);
+        bool isInitialized() const;
+
+        bool allocate(const VkDeviceSize size, VkDeviceSize & offset);
+        void release(const VkDeviceSize size);
+        void write(const VkDeviceSize offset, const void * data, const VkDeviceSize size);
+        void flush(const uint32_t frame);
+        void clear();
+
+        VkDeviceSize getSize() const;
+        VkDeviceSize getContentSize() const;
+        const VkDescriptorBufferInfo getDescriptorInfo(const uint32_t frame) const;
+};
+
+struct UploadBufferCopy {
+    VkBuffer source = nullptr;
+    VkBuffer destination = nullptr;
+    VkBufferCopy region {};
+    uint32_t sequence = 0;
+};
+
+struct UploadImageCopy {
+    Image * image = nullptr;
+    VkBuffer source = nullptr;
+    VkDeviceSize sourceOffset = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipLevels = 1;
+};
+
+struct UploadBatch {
+    uint64_t value = 0;
+    VkCommandBuffer commandBuffer = nullptr;
+    VkDeviceSize ringEnd = 0;
+    VkDeviceSize ringBytes = 0;
+    std::vector<std::unique_ptr<Buffer>> stagingBuffers;
+};
+
+/**
+ *  Streams buffer and texture data to the gpu by way of a persistently mapped staging ring.
+ *  Uploads can be queued from any thread, flush records everything pending into one command buffer
+ *  and signals a timeline semaphore which the next frame waits on (no queue idle waits).
+ *  Ring space is reclaimed once the timeline passed a batch, uploads not fitting get a staging buffer of their own.
+ */
+class UploadManager final {
+    private:
+        VkPhysicalDevice physicalDevice = nullptr;
+        VkDevice logicalDevice = nullptr;
+        VkQueue queue = nullptr;
+        CommandPool commandPool;
+        VkSemaphore timeline = nullptr;
+        uint64_t timelineValue = 0;
+
+        std::mutex uploadMutex;
+        Buffer stagingRing;
+        VkDeviceSize ringHead = 0;
+        VkDeviceSize ringTail = 0;
+        VkDeviceSize ringUsed = 0;
+        VkDeviceSize pendingRingBytes = 0;
+        uint32_t pendingSequence = 0;
+
+        // the last submitted values of the queues reading uploaded data, waited for by uploads overwriting data in use
+        std::vector<std::pair<VkSemaphore, uint64_t>> consumers;
+        bool pendingOverwrites = false;
+
+        std::vector<std::unique_ptr<Buffer>> pendingStagingBuffers;
+        std::vector<UploadBufferCopy> pendingBufferCopies;
+        std::vector<UploadImageCopy> pendingImageCopies;
+        std::deque<UploadBatch> batches;
+
+        bool allocateFromRing(const VkDeviceSize size, VkDeviceSize & offset);
+        bool stage(const void * data, const VkDeviceSize size, VkBuffer & source, VkDeviceSize & sourceOffset);
+        void reclaim();
+        void recordBufferCopies(const VkCommandBuffer & commandBuffer);
+
+    public:
+        UploadManager();
+        UploadManager(const UploadManager&) = delete;
+        UploadManager& operator=(const UploadManager &) = delete;
+        UploadManager(UploadManager &&) = delete;
+        UploadManager & operator=(UploadManager) = delete;
+
+        bool create(const VkPhysicalDevice & physicalDevice, const VkDevice & logicalDevice, const int queueIndex, const VkQueue & queue, const VkDeviceSize size = UPLOAD_STAGING_BUFFER_SIZE);
+        void destroy();
+        bool isInitialized() const;
+
+        bool uploadBuffer(const Buffer & destination, const VkDeviceSize destinationOffset, const void * data, const VkDeviceSize size, const bool overwritesDataInUse = false);
+        bool uploadImage(Image & image, const void * data, const VkDeviceSize size, const uint32_t width, const uint32_t height, const uint32_t mipLevels = 1);
+        bool copyBuffer(const Buffer & source, const Buffer & destination, const VkDeviceSize size);
+        bool flush();
+
+        void setConsumer(const VkSemaphore & timeline, const uint64_t value);
+        void removeConsumer(const VkSemaphore & timeline);
+        const VkSemaphore & getTimeline() const;
+        uint64_t getTimelineValue() const;
+};
+
+/**
+ *  Threads kept around for the work the render thread spreads every frame (animation updates, command recording).
+ *  run hands out the tasks of one job, the calling thread takes on tasks as well and returns once all are done
+ */
+class WorkerPool final {
+    private:
+        std::vector<std::thread> workers;
+
+        std::mutex runMutex;
+        std::mutex jobMutex;
+        std::condition_variable jobAvailable;
+        std::condition_variable jobDone;
+
+        const std::function<void(const size_t)> * job = nullptr;
+        size_t taskCount = 0;
+        size_t nextTask = 0;
+        size_t pendingTasks = 0;
+        bool quit = false;
+
+        bool runNextTask(std::unique_lock<std::mutex> & lock);
+        void work();
+
+    public:
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool &) = delete;
+        WorkerPool(WorkerPool &&) = delete;
+        WorkerPool & operator=(WorkerPool) = delete;
+        WorkerPool();
+
+        // workers plus the calling thread
+        uint32_t getConcurrency() const;
+        void run(const size_t taskCount, const std::function<void(const size_t)> & job);
+
+        ~WorkerPool();
+};
+
+struct FrameProfilerQueries {
+    VkQueryPool pool = nullptr;
+    uint64_t validBitsMask = 0;
+    std::vector<std::vector<const char *>> sections;
+    std::vector<uint64_t> recordTimes;
+    std::vector<bool> pending;
+};
+
+/**
+ *  Smoothed per frame breakdown of cpu sections and gpu timestamp queries (one query pool slice per frame in flight).
+ *  Results of a frame are collected once its fence was waited on, everything is forwarded to Metrics as well.
+ */
+class FrameProfiler final {
+    private:
+        float timestampPeriod = 0.0f;
+        FrameProfilerQueries graphicsQueries;
+        FrameProfilerQueries computeQueries;
+
+        std::set<std::string> names;
+        std::vector<std::pair<const char *, double>> cpuTimings;
+        std::vector<std::pair<const char *, double>> gpuTimings;
+
+        bool createQueries(const VkDevice & logicalDevice, FrameProfilerQueries & queries, const uint32_t validBits, const uint32_t frames);
+        void destroyQueries(const VkDevice & logicalDevice, FrameProfilerQueries & queries);
+        void addTiming(std::vector<std::pair<const char *, double>> & timings, const char * name, const double millis);
+
+    public:
+        FrameProfiler();
+        FrameProfiler(const FrameProfiler&) = delete;
+        FrameProfiler& operator=(const FrameProfiler &) = delete;
+        FrameProfiler(FrameProfiler &&) = delete;
+        FrameProfiler & operator=(FrameProfiler) = delete;
+
+        bool create(const VkPhysicalDevice & physicalDevice, const VkDevice & logicalDevice, const int graphicsQueueIndex, const int computeQueueIndex, const uint32_t frames);
+        void destroy(const VkDevice & logicalDevice);
+
+        const char * getName(const std::string & name);
+
+        // a null command buffer skips the query reset, i.e. the commands of a recorded buffer including their sections are reused
+        void beginFrame(const VkCommandBuffer & commandBuffer, const uint32_t frame, const bool compute = false, const size_t keepSections = 0);
+        bool beginSection(const VkCommandBuffer & commandBuffer, const uint32_t frame, const char * name, const bool compute = false);
+        void endSection(const VkCommandBuffer & commandBuffer, const uint32_t frame, const bool compute = false);
+
+        // for recording on other threads: reserve on the render thread, the timestamp writes only read
+        int32_t reserveSection(const uint32_t frame, const char * name, const bool compute = false);
+        void writeSectionTimestamp(const VkCommandBuffer & commandBuffer, const uint32_t frame, const int32_t section, const bool end, const bool compute = false) const;
+        void collect(const VkDevice & logicalDevice, const uint32_t frame, const bool compute = false);
+        size_t getSectionCount(const uint32_t frame, const bool compute = false) const;
+
+        void recordCpuTime(const char * name, const uint64_t startInMicros, const uint64_t durationInMicros);
+
+        const std::vector<std::pair<const char *, double>> & getCpuTimings() const;
+        const std::vector<std::pair<const char *, double>> & getGpuTimings() const;
+};
+
+class ScopedFrameTimer final {
+    private:
+        FrameProfiler & profiler;
+        const char * name;
+        const uint64_t start;
+
+    public:
+        ScopedFrameTimer(const ScopedFrameTimer&) = delete;
+        ScopedFrameTimer& operator=(const ScopedFrameTimer &) = delete;
+        ScopedFrameTimer(ScopedFrameTimer &&) = delete;
+        ScopedFrameTimer & operator=(ScopedFrameTimer) = delete;
+
+        ScopedFrameTimer(FrameProfiler & profiler, const char * name) : profiler(profiler), name(name), start(Metrics::INSTANCE()->getTimeInMicros()) {};
+
+        ~ScopedFrameTimer() {
+            this->profiler.recordCpuTime(this->name, this->start, Metrics::INSTANCE()->getTimeInMicros() - this->start);
+        };
 };
 
 class Renderable;
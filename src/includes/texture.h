@@ -57,7 +57,7 @@ class GlobalTextureStore final {
 
         std::mutex textureAdditionMutex;
 
-        bool uploadTextureToGPU(Renderer * renderer, Texture * texture, const bool useAltGraphicsQueue = true);
+        bool uploadTextureToGPU(Renderer * renderer, Texture * texture);
         int addTexture(const std::string id, std::unique_ptr<Texture> & texture);
         int addTexture(const std::string fileName, const bool prefixWithAssetsImageFolder = false);
 
@@ -0,0 +1,390 @@
+#include "includes/journal.h"
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+    // collides with the flatbuffers generated accessor
+    #undef GetMessage
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+static constexpr uint64_t JOURNAL_RECORD_ALIGNMENT = 8;
+static constexpr uint64_t JOURNAL_RECORD_PREFIX = 8;
+
+static inline uint64_t alignRecordSize(const uint64_t size) {
+    return (size + JOURNAL_RECORD_ALIGNMENT - 1) & ~(JOURNAL_RECORD_ALIGNMENT - 1);
+}
+
+bool MessageJournal::open(const std::filesystem::path & file, const uint64_t initialCapacity)
+{
+    const std::lock_guard<std::mutex> lock(this->journalMutex);
+
+    if (this->data != nullptr) this->unmap();
+
+    this->file = file;
+
+    std::error_code error;
+    const uint64_t existingSize = std::filesystem::exists(file, error) ? std::filesystem::file_size(file, error) : 0;
+    if (error) {
+        logError("Failed to get size of message journal: " + file.string());
+        return false;
+    }
+
+    uint64_t capacity = std::max(initialCapacity, static_cast<uint64_t>(sizeof(JournalHeader)));
+    if (existingSize > capacity) capacity = existingSize;
+
+    if (!this->map(capacity)) return false;
+
+    auto header = this->getHeader();
+    if (existingSize < sizeof(JournalHeader) || header->magic != JOURNAL_MAGIC ||
+        header->version != JOURNAL_VERSION || sizeof(JournalHeader) + header->contentSize > this->capacity) {
+        if (existingSize > 0) logInfo("Message journal '" + file.string() + "' is invalid. Resetting it ...");
+
+        *header = JournalHeader {};
+    }
+
+    this->contentSizeAfterCompaction = header->contentSize;
+
+    return true;
+}
+
+bool MessageJournal::isOpen() const
+{
+    return this->data != nullptr;
+}
+
+bool MessageJournal::map(const uint64_t capacity)
+{
+    #ifdef _WIN32
+        if (this->fileHandle == nullptr) {
+            HANDLE handle = CreateFileW(this->file.wstring().c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (handle == INVALID_HANDLE_VALUE) {
+                logError("Failed to open message journal: " + this->file.string());
+                return false;
+            }
+            this->fileHandle = handle;
+        }
+
+        // mapping beyond the current file size grows the file
+        HANDLE mapping = CreateFileMappingW(static_cast<HANDLE>(this->fileHandle), NULL, PAGE_READWRITE, static_cast<DWORD>(capacity >> 32), static_cast<DWORD>(capacity & 0xFFFFFFFF), NULL);
+        if (mapping == NULL) {
+            logError("Failed to create mapping for message journal: " + this->file.string());
+            return false;
+        }
+
+        void * view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, capacity);
+        if (view == NULL) {
+            CloseHandle(mapping);
+            logError("Failed to map message journal: " + this->file.string());
+            return false;
+        }
+
+        this->mappingHandle = mapping;
+        this->data = static_cast<char *>(view);
+    #else
+        if (this->fileDescriptor < 0) {
+            this->fileDescriptor = ::open(this->file.string().c_str(), O_RDWR | O_CREAT, 0644);
+            if (this->fileDescriptor < 0) {
+                logError("Failed to open message journal: " + this->file.string());
+                return false;
+            }
+        }
+
+        struct stat fileStats;
+        if (fstat(this->fileDescriptor, &fileStats) != 0) {
+            logError("Failed to stat message journal: " + this->file.string());
+            return false;
+        }
+
+        if (static_cast<uint64_t>(fileStats.st_size) < capacity && ftruncate(this->fileDescriptor, capacity) != 0) {
+            logError("Failed to resize message journal: " + this->file.string());
+            return false;
+        }
+
+        void * view = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, this->fileDescriptor, 0);
+        if (view == MAP_FAILED) {
+            logError("Failed to map message journal: " + this->file.string());
+            return false;
+        }
+
+        this->data = static_cast<char *>(view);
+    #endif
+
+    this->capacity = capacity;
+
+    return true;
+}
+
+void MessageJournal::unmap()
+{
+    if (this->data == nullptr) return;
+
+    #ifdef _WIN32
+        FlushViewOfFile(this->data, 0);
+        UnmapViewOfFile(this->data);
+        if (this->mappingHandle != nullptr) CloseHandle(static_cast<HANDLE>(this->mappingHandle));
+        this->mappingHandle = nullptr;
+    #else
+        msync(this->data, this->capacity, MS_ASYNC);
+        munmap(this->data, this->capacity);
+    #endif
+
+    this->data = nullptr;
+    this->capacity = 0;
+}
+
+JournalHeader * MessageJournal::getHeader() const
+{
+    return reinterpret_cast<JournalHeader *>(this->data);
+}
+
+bool MessageJournal::append(const uint8_t * message, const uint32_t size)
+{
+    if (message == nullptr || size == 0) return false;
+
+    const std::lock_guard<std::mutex> lock(this->journalMutex);
+
+    if (this->data == nullptr) return false;
+
+    const uint64_t recordSize = alignRecordSize(JOURNAL_RECORD_PREFIX + size);
+    uint64_t contentSize = this->getHeader()->contentSize;
+
+    if (sizeof(JournalHeader) + contentSize + recordSize > this->capacity) {
+        // try to reclaim space first before we grow
+        this->compactUnlocked();
+        if (this->data == nullptr) return false;
+        contentSize = this->getHeader()->contentSize;
+
+        if (sizeof(JournalHeader) + contentSize + recordSize > this->capacity) {
+            uint64_t newCapacity = this->capacity * 2;
+            while (sizeof(JournalHeader) + contentSize + recordSize > newCapacity) newCapacity *= 2;
+
+            this->unmap();
+            if (!this->map(newCapacity)) {
+                logError("Failed to grow message journal!");
+                return false;
+            }
+        }
+    }
+
+    char * record = this->data + sizeof(JournalHeader) + contentSize;
+    memcpy(record, &size, sizeof(uint32_t));
+    memset(record + sizeof(uint32_t), 0, JOURNAL_RECORD_PREFIX - sizeof(uint32_t));
+    memcpy(record + JOURNAL_RECORD_PREFIX, message, size);
+
+    // publish the record only once it has been written in full
+    this->getHeader()->contentSize = contentSize + recordSize;
+
+    if (this->getHeader()->contentSize > JOURNAL_MIN_COMPACTION_SIZE &&
+        this->getHeader()->contentSize > 2 * this->contentSizeAfterCompaction) {
+        this->compactUnlocked();
+    }
+
+    return true;
+}
+
+void MessageJournal::forEachRecord(const std::function<void(const uint64_t, const Message *)> & callback) const
+{
+    if (this->data == nullptr) return;
+
+    MessageJournal::forEachRecord(this->data + sizeof(JournalHeader), this->getHeader()->contentSize, callback);
+}
+
+void MessageJournal::forEachRecord(const char * content, const uint64_t contentSize, const std::function<void(const uint64_t, const Message *)> & callback)
+{
+    uint64_t offset = 0;
+    while (offset + JOURNAL_RECORD_PREFIX <= contentSize) {
+        uint32_t size = 0;
+        memcpy(&size, content + offset, sizeof(uint32_t));
+
+        const uint64_t recordSize = alignRecordSize(JOURNAL_RECORD_PREFIX + size);
+        if (size == 0 || offset + recordSize > contentSize) {
+            logError("Message journal contains a truncated record!");
+            break;
+        }
+
+        const uint8_t * buffer = reinterpret_cast<const uint8_t *>(content + offset + JOURNAL_RECORD_PREFIX);
+        flatbuffers::Verifier verifier(buffer, size);
+        if (VerifyMessageBuffer(verifier)) callback(offset, GetMessage(buffer));
+
+        offset += recordSize;
+    }
+}
+
+std::vector<std::string> MessageJournal::getObjectIds(const Message * message)
+{
+    std::vector<std::string> ids;
+
+    const auto contentVector = message->content();
+    const auto contentVectorType = message->content_type();
+    if (contentVector == nullptr || contentVectorType == nullptr) return ids;
+
+    const uint32_t nrOfMessages = contentVector->size();
+    for (uint32_t i=0;i<nrOfMessages;i++) {
+        if ((MessageUnion) (*contentVectorType)[i] != MessageUnion_ObjectCreateRequest) continue;
+
+        const auto request = (const ObjectCreateRequest *)  (*contentVector)[i];
+        if (request->properties() == nullptr || request->properties()->id() == nullptr) continue;
+
+        ids.emplace_back(request->properties()->id()->str());
+    }
+
+    return ids;
+}
+
+ankerl::unordered_dense::map<std::string, uint64_t> MessageJournal::getLatestRecordForIds() const
+{
+    // the latest record wins for every object
+    ankerl::unordered_dense::map<std::string, uint64_t> latestRecordForId;
+
+    this->forEachRecord([&latestRecordForId](const uint64_t offset, const Message * message) {
+        for (const auto & id : MessageJournal::getObjectIds(message)) latestRecordForId[id] = offset;
+    });
+
+    return latestRecordForId;
+}
+
+void MessageJournal::compact()
+{
+    const std::lock_guard<std::mutex> lock(this->journalMutex);
+
+    this->compactUnlocked();
+}
+
+/**
+ *  Writes the kept records into a temporary file that replaces the journal once complete,
+ *  a crash midway leaves the journal as it was
+ */
+void MessageJournal::compactUnlocked()
+{
+    if (this->data == nullptr) return;
+
+    const auto latestRecordForId = this->getLatestRecordForIds();
+
+    ankerl::unordered_dense::set<uint64_t> recordsToKeep;
+    for (const auto & r : latestRecordForId) recordsToKeep.emplace(r.second);
+
+    const char * content = this->data + sizeof(JournalHeader);
+    std::vector<char> compactedContent;
+
+    this->forEachRecord([content, &recordsToKeep, &compactedContent](const uint64_t offset, const Message * /* message */) {
+        if (!recordsToKeep.contains(offset)) return;
+
+        uint32_t size = 0;
+        memcpy(&size, content + offset, sizeof(uint32_t));
+
+        const uint64_t recordSize = alignRecordSize(JOURNAL_RECORD_PREFIX + size);
+        compactedContent.insert(compactedContent.end(), content + offset, content + offset + recordSize);
+    });
+
+    JournalHeader header;
+    header.contentSize = compactedContent.size();
+
+    const std::filesystem::path compactedFile = std::filesystem::path(this->file).concat(".tmp");
+    {
+        std::ofstream out(compactedFile, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(JournalHeader));
+        out.write(compactedContent.data(), compactedContent.size());
+        out.close();
+
+        if (!out) {
+            logError("Failed to write compacted message journal: " + compactedFile.string());
+            return;
+        }
+    }
+
+    #ifndef _WIN32
+        const int compactedFileDescriptor = ::open(compactedFile.string().c_str(), O_RDONLY);
+        if (compactedFileDescriptor >= 0) {
+            fsync(compactedFileDescriptor);
+            ::close(compactedFileDescriptor);
+        }
+    #endif
+
+    const uint64_t capacity = this->capacity;
+    this->unmap();
+    this->closeFile();
+
+    std::error_code error;
+    std::filesystem::rename(compactedFile, this->file, error);
+    if (error) logError("Failed to replace message journal with its compacted version: " + this->file.string());
+
+    if (!this->map(capacity)) {
+        logError("Failed to map message journal after compaction!");
+        return;
+    }
+
+    this->contentSizeAfterCompaction = this->getHeader()->contentSize;
+}
+
+/**
+ *  Hands the latest create request of every object to the callback.
+ *  The records are copied out first, the callback (sending them) does not hold up appending
+ */
+void MessageJournal::replay(const std::function<void(const ObjectCreateRequest *)> & callback)
+{
+    std::vector<char> content;
+    ankerl::unordered_dense::map<std::string, uint64_t> latestRecordForId;
+    {
+        const std::lock_guard<std::mutex> lock(this->journalMutex);
+
+        if (this->data == nullptr) return;
+
+        this->compactUnlocked();
+        if (this->data == nullptr) return;
+
+        latestRecordForId = this->getLatestRecordForIds();
+
+        const char * records = this->data + sizeof(JournalHeader);
+        content.assign(records, records + this->getHeader()->contentSize);
+    }
+
+    MessageJournal::forEachRecord(content.data(), content.size(), [&callback, &latestRecordForId](const uint64_t offset, const Message * message) {
+        const auto contentVector = message->content();
+        const auto contentVectorType = message->content_type();
+        if (contentVector == nullptr || contentVectorType == nullptr) return;
+
+        const uint32_t nrOfMessages = contentVector->size();
+        for (uint32_t i=0;i<nrOfMessages;i++) {
+            if ((MessageUnion) (*contentVectorType)[i] != MessageUnion_ObjectCreateRequest) continue;
+
+            const auto request = (const ObjectCreateRequest *)  (*contentVector)[i];
+            if (request->properties() == nullptr || request->properties()->id() == nullptr) continue;
+
+            // skip anything superseded by a later record
+            const auto latestRecord = latestRecordForId.find(request->properties()->id()->str());
+            if (latestRecord == latestRecordForId.end() || latestRecord->second != offset) continue;
+
+            callback(request);
+        }
+    });
+}
+
+void MessageJournal::closeFile()
+{
+    #ifdef _WIN32
+        if (this->fileHandle != nullptr) CloseHandle(static_cast<HANDLE>(this->fileHandle));
+        this->fileHandle = nullptr;
+    #else
+        if (this->fileDescriptor >= 0) ::close(this->fileDescriptor);
+        this->fileDescriptor = -1;
+    #endif
+}
+
+void MessageJournal::close()
+{
+    const std::lock_guard<std::mutex> lock(this->journalMutex);
+
+    this->unmap();
+    this->closeFile();
+}
+
+MessageJournal::~MessageJournal()
+{
+    this->close();
+}
@@ -0,0 +1,340 @@
+#include "includes/common.h"
+
+#include <sstream>
+
+// stdout is reserved for the results
+void logInfo(std::string message) {
+    std::cerr << message << std::endl;
+}
+
+void logError(std::string message) {
+    std::cerr << message << std::endl;
+}
+
+bool stop = false;
+
+void signalHandler(int signal) {
+    stop = true;
+}
+
+static constexpr float LOADGEN_AREA = INTEREST_RADIUS;
+static constexpr float LOADGEN_MAX_STEP = 2.0f;
+
+struct LoadGenConfig final {
+    std::string ip = "127.0.0.1";
+    uint16_t clients = 10;
+    uint32_t durationInSeconds = 30;
+    float createsPerSecond = 5.0f;
+    float updatesPerSecond = 50.0f;
+    uint16_t shards = 1;
+};
+
+static uint64_t getTimeInMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class LatencyRecorder final {
+    private:
+        std::mutex samplesMutex;
+        std::vector<uint64_t> samples;
+
+    public:
+        LatencyRecorder(const LatencyRecorder&) = delete;
+        LatencyRecorder& operator=(const LatencyRecorder &) = delete;
+        LatencyRecorder(LatencyRecorder &&) = delete;
+        LatencyRecorder & operator=(LatencyRecorder) = delete;
+        LatencyRecorder() {};
+
+        void add(const uint64_t micros) {
+            const std::lock_guard<std::mutex> lock(this->samplesMutex);
+            this->samples.emplace_back(micros);
+        }
+
+        size_t getCount() {
+            const std::lock_guard<std::mutex> lock(this->samplesMutex);
+            return this->samples.size();
+        }
+
+        std::string toJson() {
+            const std::lock_guard<std::mutex> lock(this->samplesMutex);
+
+            std::sort(this->samples.begin(), this->samples.end());
+
+            const auto percentile = [this](const double p) -> uint64_t {
+                if (this->samples.empty()) return 0;
+                const size_t index = static_cast<size_t>(std::ceil(p * this->samples.size())) - 1;
+                return this->samples[std::min(index, this->samples.size() - 1)];
+            };
+
+            uint64_t sum = 0;
+            for (const auto & s : this->samples) sum += s;
+
+            std::ostringstream json;
+            json << "{\"count\":" << this->samples.size() <<
+                ",\"mean_us\":" << (this->samples.empty() ? 0 : sum / this->samples.size()) <<
+                ",\"p50_us\":" << percentile(0.5) <<
+                ",\"p90_us\":" << percentile(0.9) <<
+                ",\"p99_us\":" << percentile(0.99) <<
+                ",\"max_us\":" << (this->samples.empty() ? 0 : this->samples.back()) << "}";
+
+            return json.str();
+        }
+};
+
+/**
+ *  Matches broadcasts to the requests that caused them: creates are answered by a create and update,
+ *  property updates by an update of the same object.
+ */
+class FanOutTracker final {
+    private:
+        std::mutex pendingMutex;
+        ankerl::unordered_dense::map<std::string, uint64_t> pendingCreates;
+        ankerl::unordered_dense::map<std::string, std::deque<uint64_t>> pendingUpdates;
+        uint64_t broadcastsReceived = 0;
+
+    public:
+        LatencyRecorder createLatencies;
+        LatencyRecorder updateLatencies;
+
+        FanOutTracker(const FanOutTracker&) = delete;
+        FanOutTracker& operator=(const FanOutTracker &) = delete;
+        FanOutTracker(FanOutTracker &&) = delete;
+        FanOutTracker & operator=(FanOutTracker) = delete;
+        FanOutTracker() {};
+
+        void addPendingCreate(const std::string & id, const uint64_t sent) {
+            const std::lock_guard<std::mutex> lock(this->pendingMutex);
+            this->pendingCreates[id] = sent;
+        }
+
+        void addPendingUpdate(const std::string & id, const uint64_t sent) {
+            const std::lock_guard<std::mutex> lock(this->pendingMutex);
+            this->pendingUpdates[id].emplace_back(sent);
+        }
+
+        void handleBroadcast(void * message) {
+            if (message == nullptr) return;
+
+            const uint64_t now = getTimeInMicros();
+            const auto m = GetMessage(static_cast<uint8_t *>(message));
+            const auto contentVector = m->content();
+            const auto contentVectorType = m->content_type();
+
+            if (contentVector != nullptr && contentVectorType != nullptr) {
+                const std::lock_guard<std::mutex> lock(this->pendingMutex);
+
+                this->broadcastsReceived++;
+
+                const uint32_t nrOfMessages = contentVector->size();
+                for (uint32_t i=0;i<nrOfMessages;i++) {
+                    const auto messageType = (const MessageUnion) (*contentVectorType)[i];
+                    if (messageType == MessageUnion_ObjectCreateAndUpdateRequest) {
+                        const auto request = (const ObjectCreateAndUpdateRequest *)  (*contentVector)[i];
+                        if (request->object_type() != ObjectUpdateRequestUnion_SphereUpdateRequest) continue;
+
+                        const auto id = request->object_as_SphereUpdateRequest()->updates()->id()->str();
+                        const auto pending = this->pendingCreates.find(id);
+                        if (pending == this->pendingCreates.end()) continue;
+
+                        this->createLatencies.add(now - pending->second);
+                        this->pendingCreates.erase(pending);
+                    } else if (messageType == MessageUnion_ObjectUpdateRequest) {
+                        const auto request = (const ObjectUpdateRequest *)  (*contentVector)[i];
+                        const auto pending = this->pendingUpdates.find(request->updates()->id()->str());
+                        if (pending == this->pendingUpdates.end() || pending->second.empty()) continue;
+
+                        this->updateLatencies.add(now - pending->second.front());
+                        pending->second.pop_front();
+                    }
+                }
+            }
+
+            free(message);
+        }
+
+        uint64_t getBroadcastsReceived() {
+            const std::lock_guard<std::mutex> lock(this->pendingMutex);
+            return this->broadcastsReceived;
+        }
+
+        uint64_t getMissing() {
+            const std::lock_guard<std::mutex> lock(this->pendingMutex);
+
+            uint64_t missing = this->pendingCreates.size();
+            for (const auto & p : this->pendingUpdates) missing += p.second.size();
+
+            return missing;
+        }
+};
+
+struct ClientStats final {
+    uint64_t creates = 0;
+    uint64_t updates = 0;
+    uint64_t failed = 0;
+};
+
+static void runClient(const LoadGenConfig & config, const uint16_t index, const std::string & runId, LatencyRecorder & ackLatencies, FanOutTracker & tracker, ClientStats & stats) {
+    std::unique_ptr<CommClient> client = std::make_unique<CommClient>(config.ip, 3000, 3001, config.shards);
+    if (!client->startWithoutBroadcast()) {
+        logError("Load generator client " + std::to_string(index) + " failed to connect");
+        return;
+    }
+
+    std::default_random_engine random(runId.size() + index);
+    std::uniform_real_distribution<float> positionDistribution(-LOADGEN_AREA, LOADGEN_AREA);
+    std::uniform_real_distribution<float> stepDistribution(-LOADGEN_MAX_STEP, LOADGEN_MAX_STEP);
+
+    std::vector<std::pair<std::string, glm::vec3>> objects;
+
+    const uint64_t createInterval = config.createsPerSecond > 0 ? static_cast<uint64_t>(1000000 / config.createsPerSecond) : 0;
+    const uint64_t updateInterval = config.updatesPerSecond > 0 ? static_cast<uint64_t>(1000000 / config.updatesPerSecond) : 0;
+
+    const uint64_t start = getTimeInMicros();
+    const uint64_t end = start + static_cast<uint64_t>(config.durationInSeconds) * 1000000;
+    uint64_t nextCreate = start;
+    uint64_t nextUpdate = start + updateInterval;
+
+    const auto send = [&client, &ackLatencies, &stats](CommBuilder & builder, const uint64_t sent) {
+        client->sendBlocking(builder.builder, [&ackLatencies, &stats, sent](void * reply) {
+            if (reply == nullptr) {
+                stats.failed++;
+                return;
+            }
+
+            ackLatencies.add(getTimeInMicros() - sent);
+            free(reply);
+        });
+    };
+
+    while (!stop) {
+        const uint64_t now = getTimeInMicros();
+        if (now >= end) break;
+
+        if (createInterval > 0 && now >= nextCreate) {
+            const std::string id = "loadgen-" + runId + "-" + std::to_string(index) + "-" + std::to_string(objects.size());
+            const glm::vec3 position(positionDistribution(random), 0.0f, positionDistribution(random));
+
+            CommBuilder builder;
+            CommCenter::addObjectCreateSphereRequest(builder, id, {position.x, position.y, position.z}, {0,0,0}, 1, 1.0f);
+            CommCenter::createMessage(builder);
+
+            const uint64_t sent = getTimeInMicros();
+            tracker.addPendingCreate(id, sent);
+            send(builder, sent);
+
+            objects.emplace_back(id, position);
+            stats.creates++;
+            nextCreate += createInterval;
+        }
+
+        if (updateInterval > 0 && !objects.empty() && now >= nextUpdate) {
+            auto & object = objects[random() % objects.size()];
+            object.second = glm::clamp(
+                object.second + glm::vec3(stepDistribution(random), 0.0f, stepDistribution(random)),
+                glm::vec3(-LOADGEN_AREA), glm::vec3(LOADGEN_AREA)
+            );
+
+            CommBuilder builder;
+            CommCenter::addObjectPropertiesUpdateRequest(builder, object.first, {object.second.x, object.second.y, object.second.z});
+            CommCenter::createMessage(builder);
+
+            const uint64_t sent = getTimeInMicros();
+            tracker.addPendingUpdate(object.first, sent);
+            send(builder, sent);
+
+            stats.updates++;
+            nextUpdate += updateInterval;
+        }
+
+        // falling behind the rate is reported via the throughput, not caught up in bursts
+        const uint64_t after = getTimeInMicros();
+        if (nextCreate < after && createInterval > 0) nextCreate = std::max(nextCreate, after - createInterval);
+        if (nextUpdate < after && updateInterval > 0) nextUpdate = std::max(nextUpdate, after - updateInterval);
+
+        uint64_t next = end;
+        if (createInterval > 0) next = std::min(next, nextCreate);
+        if (updateInterval > 0) next = std::min(next, nextUpdate);
+        if (next > after) std::this_thread::sleep_for(std::chrono::microseconds(std::min<uint64_t>(next - after, 10000)));
+    }
+
+    client->stop();
+}
+
+int main(int argc, char* argv []) {
+    LoadGenConfig config;
+    if (argc > 1) config.ip = argv[1];
+    if (argc > 2) config.clients = static_cast<uint16_t>(std::max(1, std::atoi(argv[2])));
+    if (argc > 3) config.durationInSeconds = static_cast<uint32_t>(std::max(1, std::atoi(argv[3])));
+    if (argc > 4) config.createsPerSecond = std::max(0.0f, static_cast<float>(std::atof(argv[4])));
+    if (argc > 5) config.updatesPerSecond = std::max(0.0f, static_cast<float>(std::atof(argv[5])));
+    if (argc > 6) config.shards = static_cast<uint16_t>(std::max(1, std::atoi(argv[6])));
+
+    signal(SIGINT, signalHandler);
+
+    const std::string runId = std::to_string(Communication::getTimeInMillis());
+
+    // a single listener stands in for all simulated clients, there can only be one dish bound to the broadcast port
+    FanOutTracker tracker;
+    std::unique_ptr<CommClient> listener = std::make_unique<CommClient>(config.ip, 3000, 3001, config.shards);
+
+    const auto minCell = getInterestCell(glm::vec3(-LOADGEN_AREA));
+    const auto maxCell = getInterestCell(glm::vec3(LOADGEN_AREA));
+    for (int x=minCell.x;x<=maxCell.x;x++) {
+        for (int z=minCell.y;z<=maxCell.y;z++) {
+            listener->joinGroup(getInterestGroup(glm::ivec2(x, z)));
+        }
+    }
+
+    if (!listener->start([&tracker](void * message) { tracker.handleBroadcast(message); })) {
+        logError("Failed to start broadcast listener");
+        return -1;
+    }
+
+    // give the server's radio time to (re)connect to us
+    Communication::sleepInMillis(1000);
+
+    logInfo("Running " + std::to_string(config.clients) + " clients for " + std::to_string(config.durationInSeconds) + "s ...");
+
+    LatencyRecorder ackLatencies;
+    std::vector<ClientStats> stats(config.clients);
+    std::vector<std::thread> clients;
+
+    const uint64_t start = getTimeInMicros();
+    for (uint16_t i=0;i<config.clients;i++) {
+        clients.emplace_back(runClient, std::cref(config), i, std::cref(runId), std::ref(ackLatencies), std::ref(tracker), std::ref(stats[i]));
+    }
+    for (auto & c : clients) c.join();
+    const uint64_t sendingDone = getTimeInMicros();
+
+    // let outstanding broadcasts trickle in
+    Communication::sleepInMillis(1000);
+    listener->stop();
+
+    ClientStats total;
+    for (const auto & s : stats) {
+        total.creates += s.creates;
+        total.updates += s.updates;
+        total.failed += s.failed;
+    }
+
+    const double elapsedInSeconds = std::max<uint64_t>(sendingDone - start, 1) / 1000000.0;
+
+    std::ostringstream json;
+    json << "{\"config\":{\"ip\":\"" << config.ip << "\",\"clients\":" << config.clients <<
+        ",\"duration_s\":" << config.durationInSeconds <<
+        ",\"creates_per_s\":" << config.createsPerSecond <<
+        ",\"updates_per_s\":" << config.updatesPerSecond <<
+        ",\"shards\":" << config.shards << "}" <<
+        ",\"elapsed_s\":" << elapsedInSeconds <<
+        ",\"requests\":{\"creates\":" << total.creates << ",\"updates\":" << total.updates << ",\"failed\":" << total.failed << "}" <<
+        ",\"throughput\":{\"requests_per_s\":" << (total.creates + total.updates) / elapsedInSeconds <<
+        ",\"broadcasts_per_s\":" << tracker.getBroadcastsReceived() / elapsedInSeconds << "}" <<
+        ",\"ack_latency\":" << ackLatencies.toJson() <<
+        ",\"fanout_latency\":{\"create\":" << tracker.createLatencies.toJson() <<
+        ",\"update\":" << tracker.updateLatencies.toJson() <<
+        ",\"missing\":" << tracker.getMissing() << "}}";
+
+    std::cout << json.str() << std::endl;
+
+    return total.failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,194 @@
+#include "includes/metrics.h"
+
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+
+void MetricsHistogram::record(const double value)
+{
+    this->count++;
+    this->sum += value;
+    this->min = std::min(this->min, value);
+    this->max = std::max(this->max, value);
+
+    uint32_t bucket = 0;
+    if (value >= 1.0) bucket = std::min<uint32_t>(static_cast<uint32_t>(std::log2(value)) + 1, METRICS_HISTOGRAM_BUCKETS - 1);
+
+    this->buckets[bucket]++;
+}
+
+double MetricsHistogram::getPercentile(const double percentile) const
+{
+    if (this->count == 0) return 0.0;
+
+    const uint64_t rank = static_cast<uint64_t>(std::ceil(percentile * this->count));
+
+    uint64_t seen = 0;
+    for (uint32_t i=0;i<METRICS_HISTOGRAM_BUCKETS;i++) {
+        seen += this->buckets[i];
+        if (seen >= rank) return std::min(std::pow(2.0, i), this->max);
+    }
+
+    return this->max;
+}
+
+Metrics::Metrics() {}
+
+Metrics * Metrics::INSTANCE()
+{
+    if (Metrics::instance == nullptr) {
+        Metrics::instance = new Metrics();
+    }
+
+    return Metrics::instance;
+}
+
+void Metrics::enable(const bool enabled)
+{
+    this->enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Metrics::enableTracing(const bool tracing)
+{
+    if (tracing) {
+        const std::lock_guard<std::mutex> lock(this->traceMutex);
+        this->traceEvents.reserve(METRICS_MAX_TRACE_EVENTS / 10);
+    }
+
+    this->tracing.store(tracing, std::memory_order_relaxed);
+}
+
+uint64_t Metrics::getTimeInMicros() const
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - this->start).count();
+}
+
+uint64_t Metrics::getThreadId()
+{
+    return std::hash<std::thread::id>{}(std::this_thread::get_id()) % 100000;
+}
+
+void Metrics::addTraceEvent(const TraceEvent & event)
+{
+    const std::lock_guard<std::mutex> lock(this->traceMutex);
+
+    if (this->traceEvents.size() >= METRICS_MAX_TRACE_EVENTS) {
+        this->droppedTraceEvents++;
+        return;
+    }
+
+    this->traceEvents.emplace_back(event);
+}
+
+void Metrics::incrementCounter(const char * name, const int64_t delta)
+{
+    if (!this->isEnabled()) return;
+
+    const std::lock_guard<std::mutex> lock(this->metricsMutex);
+    this->counters[name] += delta;
+}
+
+void Metrics::setGauge(const char * name, const double value)
+{
+    if (!this->isEnabled()) return;
+
+    {
+        const std::lock_guard<std::mutex> lock(this->metricsMutex);
+        this->gauges[name] = value;
+    }
+
+    if (this->isTracing()) this->addTraceEvent({ name, 'C', this->getTimeInMicros(), 0, Metrics::getThreadId(), value });
+}
+
+void Metrics::recordValue(const char * name, const double value)
+{
+    if (!this->isEnabled()) return;
+
+    const std::lock_guard<std::mutex> lock(this->metricsMutex);
+    this->histograms[name].record(value);
+}
+
+void Metrics::recordDuration(const char * name, const uint64_t startInMicros, const uint64_t durationInMicros, const uint64_t threadId)
+{
+    if (!this->isEnabled()) return;
+
+    {
+        const std::lock_guard<std::mutex> lock(this->metricsMutex);
+        this->histograms[name].record(static_cast<double>(durationInMicros));
+    }
+
+    if (this->isTracing()) this->addTraceEvent({ name, 'X', startInMicros, durationInMicros, threadId == 0 ? Metrics::getThreadId() : threadId, 0.0 });
+}
+
+std::string Metrics::getStats()
+{
+    const std::lock_guard<std::mutex> lock(this->metricsMutex);
+
+    std::ostringstream stats;
+    stats << std::fixed << std::setprecision(1);
+
+    for (const auto & c : this->counters) stats << c.first << ": " << c.second << std::endl;
+    for (const auto & g : this->gauges) stats << g.first << ": " << g.second << std::endl;
+
+    for (const auto & h : this->histograms) {
+        const auto & histogram = h.second;
+        stats << h.first << ": count " << histogram.count <<
+            " mean " << (histogram.count == 0 ? 0.0 : histogram.sum / histogram.count) <<
+            " min " << (histogram.count == 0 ? 0.0 : histogram.min) <<
+            " p50 " << histogram.getPercentile(0.5) <<
+            " p99 " << histogram.getPercentile(0.99) <<
+            " max " << histogram.max << std::endl;
+    }
+
+    return stats.str();
+}
+
+void Metrics::dumpStatsPeriodically(const uint64_t intervalInMillis)
+{
+    if (!this->isEnabled()) return;
+
+    const uint64_t now = this->getTimeInMicros() / 1000;
+    if (now - this->lastDump < intervalInMillis) return;
+
+    this->lastDump = now;
+    logInfo("=== Stats @ " + std::to_string(now / 1000) + "s ===\n" + this->getStats());
+}
+
+bool Metrics::writeTrace(const std::string & file)
+{
+    std::ofstream out(file, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        logError("Failed to open trace file: " + file);
+        return false;
+    }
+
+    const std::lock_guard<std::mutex> lock(this->traceMutex);
+
+    out << "{\"traceEvents\":[";
+    for (size_t i=0;i<this->traceEvents.size();i++) {
+        const auto & e = this->traceEvents[i];
+
+        out << (i > 0 ? ",\n" : "\n") << "{\"name\":\"" << e.name << "\",\"ph\":\"" << e.phase <<
+            "\",\"ts\":" << e.timestamp << ",\"pid\":1,\"tid\":" << e.threadId;
+
+        if (e.phase == 'X') out << ",\"dur\":" << e.duration;
+        else out << ",\"args\":{\"value\":" << e.value << "}";
+
+        out << "}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" << this->droppedTraceEvents << "}}" << std::endl;
+
+    logInfo("Wrote " + std::to_string(this->traceEvents.size()) + " trace events to " + file);
+
+    return true;
+}
+
+Metrics::~Metrics()
+{
+    if (Metrics::instance == nullptr) return;
+
+    delete Metrics::instance;
+    Metrics::instance = nullptr;
+}
+
+Metrics * Metrics::instance = nullptr;
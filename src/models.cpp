@@ -12,6 +12,10 @@ std::optional<MeshRenderableVariant> Model::load(const std::string renderableNam
     unsigned int flags = 0 | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
     if (importerFlags != 0) flags |= importerFlags;
 
+    // asking for cache locality selects our optimisation stage (vertex cache, overdraw and vertex fetch) instead
+    const bool optimizeMeshes = (flags & aiProcess_ImproveCacheLocality) == aiProcess_ImproveCacheLocality;
+    flags &= ~aiProcess_ImproveCacheLocality;
+
     const aiScene * scene = importer.ReadFile(name.c_str(), flags);
 
     if (scene == nullptr) {
@@ -31,7 +35,7 @@ std::optional<MeshRenderableVariant> Model::load(const std::string renderableNam
         auto modelMesh = std::make_unique<AnimatedModelMeshGeometry>();
         modelMesh->joints.reserve(MAX_JOINTS);
 
-        Model::processModelNode(root, scene, modelMesh, parentPath);
+        Model::processModelNode(root, scene, modelMesh, parentPath, optimizeMeshes);
 
         if (!modelMesh->jointIndexByName.empty()) {
             modelMesh->joints.resize(modelMesh->jointIndexByName.size());
@@ -60,7 +64,7 @@ std::optional<MeshRenderableVariant> Model::load(const std::string renderableNam
         return GlobalRenderableStore::INSTANCE()->registerObject<AnimatedModelMeshRenderable>(modelMeshRenderable);
     } else {
         auto modelMesh = std::make_unique<ModelMeshGeometry>();
-        Model::processModelNode(root, scene, modelMesh, parentPath);
+        Model::processModelNode(root, scene, modelMesh, parentPath, optimizeMeshes);
 
         auto modelMeshRenderable = std::make_unique<ModelMeshRenderable>(renderableName, modelMesh);
         return GlobalRenderableStore::INSTANCE()->registerObject<ModelMeshRenderable>(modelMeshRenderable);
@@ -69,20 +73,29 @@ std::optional<MeshRenderableVariant> Model::load(const std::string renderableNam
     return std::nullopt;
 }
 
-void Model::processModelNode(const aiNode * node, const aiScene * scene, std::unique_ptr<ModelMeshGeometry> & modelMeshGeom, const std::filesystem::path & parentPath)
+void Model::processModelNode(const aiNode * node, const aiScene * scene, std::unique_ptr<ModelMeshGeometry> & modelMeshGeom, const std::filesystem::path & parentPath, const bool optimizeMeshes)
 {
     for(unsigned int i=0; i < node->mNumMeshes; i++) {
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
 
         Model::processModelMesh<ModelMeshGeometry,ModelMeshIndexed>(mesh, scene, modelMeshGeom, parentPath);
+
+        if (optimizeMeshes && mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE) {
+            Helper::optimizeMesh(modelMeshGeom->meshes.back());
+        }
+
+        if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE) {
+            Helper::generateLods(modelMeshGeom->meshes.back());
+            Helper::generateClusters(modelMeshGeom->meshes.back());
+        }
     }
 
     for(unsigned int i=0; i<node->mNumChildren; i++) {
-        Model::processModelNode(node->mChildren[i], scene, modelMeshGeom, parentPath);
+        Model::processModelNode(node->mChildren[i], scene, modelMeshGeom, parentPath, optimizeMeshes);
     }
 }
 
-void Model::processModelNode(const aiNode * node, const aiScene * scene, std::unique_ptr<AnimatedModelMeshGeometry> & modelMeshGeom, const std::filesystem::path & parentPath)
+void Model::processModelNode(const aiNode * node, const aiScene * scene, std::unique_ptr<AnimatedModelMeshGeometry> & modelMeshGeom, const std::filesystem::path & parentPath, const bool optimizeMeshes)
 {
     for(unsigned int i=0; i < node->mNumMeshes; i++) {
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
@@ -94,10 +107,22 @@ void Model::processModelNode(const aiNode * node, const aiScene * scene, std::un
 
         Model::processModelMesh<AnimatedModelMeshGeometry,ModelMeshIndexed>(mesh, scene, modelMeshGeom, parentPath);
         Model::processModelMeshAnimation(mesh, modelMeshGeom, vertexOffset);
+
+        // joint infos are kept per vertex and have to follow the vertices
+        if (optimizeMeshes && mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE) {
+            const std::vector<uint32_t> order = Helper::optimizeMesh(modelMeshGeom->meshes.back());
+
+            std::vector<VertexJointInfo> vertexJointInfo;
+            vertexJointInfo.reserve(order.size());
+            for (const auto & o : order) vertexJointInfo.emplace_back(modelMeshGeom->vertexJointInfo[vertexOffset + o]);
+            std::copy(vertexJointInfo.begin(), vertexJointInfo.end(), modelMeshGeom->vertexJointInfo.begin() + vertexOffset);
+        }
+
+        if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE) Helper::generateLods(modelMeshGeom->meshes.back());
     }
 
     for(unsigned int i=0; i<node->mNumChildren; i++) {
-        Model::processModelNode(node->mChildren[i], scene, modelMeshGeom, parentPath);
+        Model::processModelNode(node->mChildren[i], scene, modelMeshGeom, parentPath, optimizeMeshes);
     }
 }
 
@@ -507,7 +532,10 @@ const std::string AnimatedModelMeshRenderable::getCurrentAnimation() const {
 }
 
 std::vector<glm::mat4> & AnimatedModelMeshRenderable::getAnimationMatrices() {
-    return animationMatrices;
+    // rendering only needs the joint palette, per vertex matrices are blended on demand
+    this->blendAnimationMatrices();
+
+    return this->animationMatrices;
 }
 
 void AnimatedModelMeshRenderable::dumpJointHierarchy(const uint32_t index, const uint16_t tabs) {
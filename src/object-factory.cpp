@@ -487,6 +487,124 @@ bool ObjectFactory::handleCreateUpdateResponse(CommBuilder & builder, const Phys
     return true;
 }
 
+uint32_t ObjectFactory::handleSnapshotRequest(const std::function<void(CommBuilder &, const std::string &)> & sendChunk, const uint32_t debugFlags, const std::set<std::string> & interestGroups, const uint32_t objectsPerMessage)
+{
+    // the physics object store is the authoritative world state, sorted into the interest groups
+    ankerl::unordered_dense::map<std::string, std::vector<PhysicsObject *>> objectsByGroup;
+
+    const uint32_t nrOfObjects = GlobalPhysicsObjectStore::INSTANCE()->getNumberOfObjects();
+    for (uint32_t i=0;i<nrOfObjects;i++) {
+        const auto physicsObject = GlobalPhysicsObjectStore::INSTANCE()->getObjectByIndex<PhysicsObject>(i);
+        if (physicsObject == nullptr) continue;
+
+        // mirrored objects are served by the shard owning them
+        if (!physicsObject->getProperty<bool>("owned", true)) continue;
+
+        const auto group = ObjectFactory::getInterestGroup(physicsObject);
+        if (!interestGroups.empty() && !interestGroups.contains(group)) continue;
+
+        objectsByGroup[group].emplace_back(physicsObject);
+    }
+
+    uint32_t objectsSent = 0;
+
+    for (const auto & g : objectsByGroup) {
+        CommBuilder builder;
+        uint32_t objectsInChunk = 0;
+
+        for (const auto & physicsObject : g.second) {
+            if (!ObjectFactory::handleCreateObjectResponse(builder, physicsObject)) continue;
+
+            if ((debugFlags & DEBUG_BBOX) == DEBUG_BBOX ) {
+                ObjectFactory::addDebugResponse(builder, physicsObject);
+            }
+
+            objectsInChunk++;
+            if (objectsInChunk >= objectsPerMessage) {
+                CommCenter::createMessage(builder, debugFlags);
+                sendChunk(builder, g.first);
+
+                objectsSent += objectsInChunk;
+                builder = CommBuilder {};
+                objectsInChunk = 0;
+            }
+        }
+
+        if (objectsInChunk > 0) {
+            CommCenter::createMessage(builder, debugFlags);
+            sendChunk(builder, g.first);
+
+            objectsSent += objectsInChunk;
+        }
+    }
+
+    return objectsSent;
+}
+
+std::string ObjectFactory::getInterestGroup(PhysicsObject * physicsObject, const bool update)
+{
+    if (physicsObject == nullptr) return BROADCAST_GROUP;
+
+    const auto currentGroup = ::getInterestGroup(getInterestCell(physicsObject->getPosition()));
+    if (!update) return physicsObject->getProperty<std::string>("interestGroup", currentGroup);
+
+    // hand back the group clients have known the object by so far
+    const auto previousGroup = physicsObject->getProperty<std::string>("interestGroup", currentGroup);
+    physicsObject->setProperty<std::string>("interestGroup", currentGroup);
+
+    return previousGroup;
+}
+
+bool ObjectFactory::handleHandOffRequest(CommBuilder & builder, const PhysicsObject * physicsObject)
+{
+    if (physicsObject == nullptr) return false;
+
+    const auto id = physicsObject->getId();
+    const auto location = Vec3 { physicsObject->getPosition().x, physicsObject->getPosition().y, physicsObject->getPosition().z };
+    const auto rotation = Vec3 { physicsObject->getRotation().x, physicsObject->getRotation().y, physicsObject->getRotation().z };
+
+    switch(physicsObject->getObjectType()) {
+        case SPHERE:
+            CommCenter::addObjectCreateSphereRequest(
+                builder, id, location, rotation, physicsObject->getScaling(),
+                physicsObject->getProperty<float>("radius", 0.0f),
+                physicsObject->getProperty<Vec4>("color", Vec4(1.0f,1.0f,1.0f,1.0f)),
+                physicsObject->getProperty<std::string>("texture", "")
+            );
+            break;
+        case BOX:
+            CommCenter::addObjectCreateBoxRequest(
+                builder, id, location, rotation, physicsObject->getScaling(),
+                physicsObject->getProperty<float>("width", 0.0f),
+                physicsObject->getProperty<float>("height", 0.0f),
+                physicsObject->getProperty<float>("depth", 0.0f),
+                physicsObject->getProperty<Vec4>("color", Vec4(1.0f,1.0f,1.0f,1.0f)),
+                physicsObject->getProperty<std::string>("texture", "")
+            );
+            break;
+        case MODEL:
+            CommCenter::addObjectCreateModelRequest(
+                builder, id, location, rotation, physicsObject->getScaling(),
+                physicsObject->getProperty<std::string>("file", ""),
+                physicsObject->getProperty<uint32_t>("flags", 0),
+                physicsObject->getProperty<bool>("useFirstChildAsRoot", false)
+            );
+
+            // the create request does not carry animation state
+            if (!physicsObject->getCurrentAnimation().empty()) {
+                CommCenter::addObjectPropertiesUpdateRequest(
+                    builder, id, location, rotation, physicsObject->getScaling(),
+                    physicsObject->getCurrentAnimation(), physicsObject->getCurrentAnimationTime()
+                );
+            }
+            break;
+        default:
+            return false;
+    }
+
+    return true;
+}
+
 std::filesystem::path ObjectFactory::getAppPath(APP_PATHS appPath)
 {
     return ::getAppPath(ObjectFactory::base, appPath);
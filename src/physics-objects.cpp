@@ -523,6 +523,11 @@ void SpatialHashMap::addObject(PhysicsObject * physicsObject)
     }
 }
 
+void SpatialHashMap::clear()
+{
+    this->gridMap.clear();
+}
+
 ankerl::unordered_dense::map<std::string, std::set<PhysicsObject *>> SpatialHashMap::performBroadPhaseCollisionCheck(const std::vector<PhysicsObject *> & physicsObjects)
 {
     ankerl::unordered_dense::map<std::string, std::set<PhysicsObject *>> collisions;
@@ -6,6 +6,11 @@ void Physics::start()
 {
     logInfo("Starting Physics ...");
 
+    {
+        const std::lock_guard<std::mutex> lock(this->additionMutex);
+        this->quit = false;
+    }
+
     this->worker = std::thread { &Physics::work, this };
     this->worker.detach();
 }
@@ -13,18 +18,43 @@ void Physics::start()
 void Physics::stop()
 {
     logInfo("Stopping Physics ...");
-    this->quit = true;
+
+    {
+        const std::lock_guard<std::mutex> lock(this->additionMutex);
+        this->quit = true;
+    }
+    this->objectsAdded.notify_all();
 }
 
 void Physics::work()
 {
-    this->quit = false;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(this->additionMutex);
+
+            // sleep until there is something to check, so that timings reflect actual work
+            this->objectsAdded.wait(lock, [this] {
+                return this->quit || !this->objctsToBeUpdated.empty();
+            });
+            if (this->quit) break;
+
+            Metrics::INSTANCE()->setGauge("physics.update_queue", this->objctsToBeUpdated.size());
+        }
 
-    while (!this->quit) {
         auto start = Communication::getTimeInMillis();
 
-        const auto & collisions = this->performBroadPhaseCollisionCheck();
-        this->checkAndResolveCollisions(collisions);
+        {
+            const ScopedTimer tickTimer("physics.tick");
+
+            ankerl::unordered_dense::map<std::string, std::set<PhysicsObject *>> collisions;
+            {
+                const ScopedTimer broadPhaseTimer("physics.broad_phase");
+                collisions = this->performBroadPhaseCollisionCheck();
+            }
+
+            const ScopedTimer collisionTimer("physics.resolve_collisions");
+            this->checkAndResolveCollisions(collisions);
+        }
 
         auto end = Communication::getTimeInMillis();
 
@@ -38,11 +68,16 @@ void Physics::work()
 
 void Physics::addObjectsToBeUpdated(std::vector<PhysicsObject *> physicsObjects)
 {
-    const std::lock_guard<std::mutex> lock(this->additionMutex);
+    if (physicsObjects.empty()) return;
 
-    for (auto r : physicsObjects) {
-        this->objctsToBeUpdated.push(r);
+    {
+        const std::lock_guard<std::mutex> lock(this->additionMutex);
+
+        for (auto r : physicsObjects) {
+            this->objctsToBeUpdated.push(r);
+        }
     }
+    this->objectsAdded.notify_one();
 }
 
 ankerl::unordered_dense::map<std::string, std::set<PhysicsObject *>> Physics::performBroadPhaseCollisionCheck()
@@ -58,6 +93,8 @@ ankerl::unordered_dense::map<std::string, std::set<PhysicsObject *>> Physics::pe
         }
     }
 
+    if (!physicsObjects.empty()) Metrics::INSTANCE()->recordValue("physics.objects_per_tick", physicsObjects.size());
+
     return SpatialHashMap::INSTANCE()->performBroadPhaseCollisionCheck(physicsObjects);
 }
 
@@ -65,6 +102,7 @@ void Physics::checkAndResolveCollisions(const ankerl::unordered_dense::map<std::
 {
     for (auto c : collisions) {
         if (!c.second.empty()) {
+            Metrics::INSTANCE()->incrementCounter("physics.collisions", c.second.size());
             logInfo("Detected collision of " + c.first + " with following:");
             for (auto r : c.second) {
                 logInfo(r->getId());
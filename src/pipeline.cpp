@@ -14,6 +14,19 @@ void Pipeline::setName(const std::string name) {
     this->name = name;
 }
 
+void Pipeline::setSectionNames(const char * gpuSectionName, const char * updateSectionName) {
+    this->gpuSectionName = gpuSectionName;
+    this->updateSectionName = updateSectionName;
+}
+
+const char * Pipeline::getGpuSectionName() const {
+    return this->gpuSectionName;
+}
+
+const char * Pipeline::getUpdateSectionName() const {
+    return this->updateSectionName;
+}
+
 Pipeline::~Pipeline() {
     for (auto & shader : this->shaders) {
         if (shader.second != nullptr) {
@@ -253,9 +266,19 @@ bool GraphicsPipeline::createGraphicsPipelineCommon(const bool doColorBlend, con
     return true;
 }
 
-VkDescriptorBufferInfo GraphicsPipeline::getInstanceDataDescriptorInfo()
+VkDescriptorBufferInfo GraphicsPipeline::getInstanceDataDescriptorInfo(const uint32_t frame)
 {
-    return this->ssboInstanceBuffer.getDescriptorInfo();
+    return this->ssboInstanceBuffer.getDescriptorInfo(frame);
+}
+
+VkDescriptorBufferInfo GraphicsPipeline::getAnimationMatrixDescriptorInfo(const uint32_t frame)
+{
+    return this->animationMatrixBuffer.getDescriptorInfo(frame);
+}
+
+bool GraphicsPipeline::usesGpuAnimation() const
+{
+    return this->gpuAnimation;
 }
 
 bool GraphicsPipeline::canRender() const
@@ -263,6 +286,17 @@ bool GraphicsPipeline::canRender() const
     return true;
 }
 
+// with gpu culling the indirect draws don't change from frame to frame, only when objects/buffers do
+bool GraphicsPipeline::hasStaticCommands() const
+{
+    return this->renderer != nullptr && this->renderer->usesGpuCulling();
+}
+
+// only mesh pipelines grow their buffers and remove objects
+void GraphicsPipeline::applyPendingChanges()
+{
+}
+
 bool GraphicsPipeline::isReady() const {
     uint8_t validShaders = this->getNumberOfValidShaders();
     return this->hasPipeline() && validShaders >= 2;
@@ -328,6 +362,7 @@ GraphicsPipeline::~GraphicsPipeline() {
     this->ssboMeshBuffer.destroy(this->renderer->getLogicalDevice());
     this->ssboInstanceBuffer.destroy(this->renderer->getLogicalDevice());
     this->animationMatrixBuffer.destroy(this->renderer->getLogicalDevice());
+    this->vertexJointBuffer.destroy(this->renderer->getLogicalDevice());
 }
 
 ComputePipeline::ComputePipeline(const std::string name, Renderer * renderer) : Pipeline(name, renderer) {}
@@ -352,6 +387,9 @@ bool ComputePipeline::canRender() const
     return false;
 }
 
+// only pipelines that take part in occlusion culling have anything to do in between early and late draws
+void ComputePipeline::computeLate(const VkCommandBuffer & /* commandBuffer */, const uint16_t /* commandBufferIndex */) {}
+
 bool ComputePipeline::createComputePipelineCommon() {
     if (this->renderer == nullptr) {
         logError("Compute Pipeline needs renderer instance!");
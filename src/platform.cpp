@@ -58,16 +58,18 @@ int start(int argc, char* argv []) {
 
     signal(SIGINT, signalHandler);
 
-    if (!engine->startNetworking()) {
+    // the number of server shards is optional and defaults to a single server
+    const uint16_t shards = argc > 2 ? static_cast<uint16_t>(std::max(1, std::atoi(argv[2]))) : 1;
+    if (!engine->startNetworking("127.0.0.1", 3000, 3001, shards)) {
         logError("Failed to start Networking");
         return -1;
     }
 
     engine->createSkyboxPipeline();
-    engine->createColorMeshPipelines(1000 * MEGA_BYTE, 1000* MEGA_BYTE);
-    engine->createModelPipelines(100 * MEGA_BYTE, 100* MEGA_BYTE);
+    engine->createColorMeshPipelines(32 * MEGA_BYTE, 32 * MEGA_BYTE);
+    engine->createModelPipelines(32 * MEGA_BYTE, 32 * MEGA_BYTE);
 
-    engine->activateDebugging(1000 * MEGA_BYTE, DEBUG_BBOX);
+    engine->activateDebugging(16 * MEGA_BYTE, DEBUG_BBOX);
 
     engine->createGuiPipeline();
 
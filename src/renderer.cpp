@@ -60,6 +60,7 @@ Renderer::Renderer(const GraphicsContext * graphicsContext, const VkPhysicalDevi
     deviceFeatures.sType =  VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
     deviceFeatures.features.samplerAnisotropy = VK_TRUE;
     deviceFeatures.features.multiDrawIndirect = this->useGpuCulling ? VK_TRUE : VK_FALSE;
+    deviceFeatures.features.drawIndirectFirstInstance = this->useGpuCulling ? VK_TRUE : VK_FALSE;
     deviceFeatures.features.fillModeNonSolid = VK_TRUE;
     deviceFeatures.features.geometryShader = VK_TRUE;
 
@@ -68,6 +69,7 @@ Renderer::Renderer(const GraphicsContext * graphicsContext, const VkPhysicalDevi
     vulkan12Features.drawIndirectCount = true;
     vulkan12Features.descriptorIndexing = this->descriptorIndexingSupported;
     vulkan12Features.runtimeDescriptorArray = this->descriptorIndexingSupported;
+    vulkan12Features.timelineSemaphore = VK_TRUE;
 
     deviceFeatures.pNext = &vulkan12Features;
 
@@ -210,7 +212,7 @@ bool Renderer::createUniformBuffers() {
 
     bool initialized = true;
 
-    this->uniformBuffer = std::vector<Buffer>(this->imageCount);
+    this->uniformBuffer = std::vector<Buffer>(this->framesInFlight);
     for (auto & b : this->uniformBuffer) {
         b.createSharedUniformBuffer(this->getPhysicalDevice(), this->getLogicalDevice(), bufferSize);
         if (!b.isInitialized()) {
@@ -220,7 +222,7 @@ bool Renderer::createUniformBuffers() {
 
     bufferSize = sizeof(CullUniforms);
 
-    this->uniformBufferCompute = std::vector<Buffer>(this->imageCount);
+    this->uniformBufferCompute = std::vector<Buffer>(this->framesInFlight);
     for (auto & b : this->uniformBufferCompute) {
         b.createSharedUniformBuffer(this->getPhysicalDevice(), this->getLogicalDevice(), bufferSize);
         if (!b.isInitialized()) {
@@ -244,6 +246,11 @@ void Renderer::updateUniformBuffers(int index) {
     if (this->useGpuCulling) {
         CullUniforms cullUniforms {};
         cullUniforms.frustumPlanes = Camera::INSTANCE()->calculateFrustum(graphUniforms.viewProjMatrix);
+        // spheres covering less than LOD_SCREEN_COVERAGE of the half screen height (radius * projection scale / distance) drop lods
+        const float projectionScale = glm::abs(Camera::INSTANCE()->getProjectionMatrix()[1][1]);
+        cullUniforms.cameraAndLodScale = glm::vec4(pos.x, pos.y, pos.z, projectionScale / LOD_SCREEN_COVERAGE);
+        cullUniforms.viewProjMatrix = graphUniforms.viewProjMatrix;
+        cullUniforms.indirectCapacity = glm::uvec4(this->getIndirectDrawCapacity(), this->getIndirectDrawCapacity(), 0, 0);
         memcpy(this->uniformBufferCompute[index].getBufferData(), &cullUniforms, sizeof(CullUniforms));
     }
 }
@@ -270,15 +277,14 @@ bool Renderer::canRender() const
 {
     bool graphicCanRender =
         this->isReady() && this->swapChain != nullptr && this->swapChainImages.size() == this->imageCount &&
-        this->imageAvailableSemaphores.size() == this->imageCount && this->renderFinishedSemaphores.size() == this->imageCount && this->inFlightFences.size() == this->imageCount &&
+        this->imageAvailableSemaphores.size() == this->framesInFlight && this->renderFinishedSemaphores.size() == this->imageCount && this->graphicsTimeline != nullptr &&
         this->swapChainFramebuffers.size() == this->swapChainImages.size() && this->depthImages.size() == this->swapChainImages.size() && this->depthImages.size() == this->imageCount &&
         this->graphicsCommandPool.isInitialized();
     if (!graphicCanRender) return false;
 
     if (!this->useGpuCulling) return true;
 
-    return this->computeFinishedSemaphores.size() == this->imageCount && this->computeFences.size() == this->imageCount &&
-            this->computeCommandPool.isInitialized() && this->indirectDrawBuffer[0].isInitialized();;
+    return this->computeTimeline != nullptr && this->computeCommandPool.isInitialized() && this->indirectDrawBuffer[0].isInitialized();
 }
 
 
@@ -294,6 +300,9 @@ bool Renderer::addPipeline(std::unique_ptr<Pipeline> & pipeline, const int index
         return false;
     }
 
+    // the profiler names are needed every frame, they are not to be put together every time
+    pipeline->setSectionNames(this->frameProfiler.getName("gpu." + pipeline->getName()), this->frameProfiler.getName("update." + pipeline->getName()));
+
     const bool wasPaused = this->isPaused();
     if (!wasPaused) {
         this->pause();
@@ -325,6 +334,7 @@ void Renderer::enablePipeline(const std::string name, const bool flag) {
     if (p == nullptr) return;
 
     p->setEnabled(flag);
+    this->invalidateCommandBuffers();
 }
 
 void Renderer::removePipeline(const std::string name) {
@@ -362,7 +372,7 @@ void Renderer::removePipeline(const std::string name) {
     }
 }
 
-bool Renderer::createRenderPass0(VkRenderPass & renderPass, const VkImageLayout initialLayout, const VkImageLayout depthImageFinalLayout, const bool clear)
+bool Renderer::createRenderPass0(VkRenderPass & renderPass, const VkImageLayout initialLayout, const VkImageLayout depthImageInitialLayout, const VkImageLayout depthImageFinalLayout, const bool clear)
 {
     if (!this->isReady()) {
         logError("Renderer has not been initialized!");
@@ -396,10 +406,11 @@ bool Renderer::createRenderPass0(VkRenderPass & renderPass, const VkImageLayout
     depthAttachment.format = depthFormat;
     depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     if (clear) depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    // depth only outlives the pass if somebody is to read it afterwards
+    depthAttachment.storeOp = depthImageFinalLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
     depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = initialLayout;
+    depthAttachment.initialLayout = depthImageInitialLayout;
     depthAttachment.finalLayout = depthImageFinalLayout;
 
     attachments.emplace_back(depthAttachment);
@@ -423,6 +434,18 @@ bool Renderer::createRenderPass0(VkRenderPass & renderPass, const VkImageLayout
         }
     };
 
+    // early draws of occlusion culling: the depth pyramid is built from the depth written
+    // and the late cull phase overwrites the indirect and instance buffers just read, the late draws continue on the colors written
+    if (depthImageFinalLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL) {
+        dependencies.push_back({
+            0, VK_SUBPASS_EXTERNAL,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, 0
+        });
+    }
+
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
     renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
@@ -442,7 +465,32 @@ bool Renderer::createRenderPass0(VkRenderPass & renderPass, const VkImageLayout
 }
 
 bool Renderer::createRenderPass() {
-    return this->createRenderPass0(this->renderPass);
+    if (!this->usesOcclusionCulling()) return this->createRenderPass0(this->renderPass);
+
+    // the early draws keep their depth for the pyramid, the late ones continue on top of what they drew
+    return this->createRenderPass0(this->renderPass, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL) &&
+           this->createRenderPass0(this->lateRenderPass, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, false);
+}
+
+/**
+ *  The pyramid exists whenever gpu culling is on since the cull pipelines bind it either way.
+ *  It follows the swap chain extent and has to be there before the cull pipelines (re)create their descriptors
+ */
+bool Renderer::createDepthPyramid() {
+    if (!this->useGpuCulling) return true;
+
+    if (this->depthPyramidPipeline != nullptr) return this->depthPyramidPipeline->createPipeline();
+
+    this->depthPyramidPipeline = new DepthPyramidPipeline("depth-pyramid", this);
+
+    DepthPyramidPipelineConfig conf;
+    if (!this->depthPyramidPipeline->initPipeline(conf)) {
+        delete this->depthPyramidPipeline;
+        this->depthPyramidPipeline = nullptr;
+        return false;
+    }
+
+    return true;
 }
 
 bool Renderer::createSwapChain() {
@@ -524,7 +572,9 @@ bool Renderer::createSwapChain() {
         return false;
     }
 
-    logInfo("Buffering: " + std::to_string(this->imageCount));
+    this->framesInFlight = std::clamp<uint32_t>(this->framesInFlight, 1, this->imageCount);
+
+    logInfo("Buffering: " + std::to_string(this->imageCount) + ", Frames in Flight: " + std::to_string(this->framesInFlight));
     this->swapChainImages = std::vector<Image>(this->imageCount);
 
     std::vector<VkImage> swapchainImgs(this->imageCount);
@@ -551,32 +601,47 @@ bool Renderer::createSyncObjects() {
         return false;
     }
 
-    this->imageAvailableSemaphores.resize(this->imageCount);
+    // acquire is per frame in flight, present per swap chain image since that is what its wait is tied to
+    this->imageAvailableSemaphores.resize(this->framesInFlight);
     this->renderFinishedSemaphores.resize(this->imageCount);
-    this->inFlightFences.resize(this->imageCount);
-    this->computeFences.resize(this->imageCount);
-    this->computeFinishedSemaphores.resize(this->imageCount);
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    for (size_t i = 0; i < this->framesInFlight; i++) {
+        if (vkCreateSemaphore(this->logicalDevice, &semaphoreInfo, nullptr, &this->imageAvailableSemaphores[i]) != VK_SUCCESS) {
+            logError("Failed to Create Synchronization Objects For Frame!");
+            return false;
+        }
+    }
 
     for (size_t i = 0; i < this->imageCount; i++) {
-
-        if (vkCreateSemaphore(this->logicalDevice, &semaphoreInfo, nullptr, &this->imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(this->logicalDevice, &semaphoreInfo, nullptr, &this->renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(this->logicalDevice, &semaphoreInfo, nullptr, &this->computeFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(this->logicalDevice, &fenceInfo, nullptr, &this->inFlightFences[i]) != VK_SUCCESS ||
-            vkCreateFence(this->logicalDevice, &fenceInfo, nullptr, &this->computeFences[i]) != VK_SUCCESS) {
-                logError("Failed to Create Synchronization Objects For Frame!");
-                return false;
+        if (vkCreateSemaphore(this->logicalDevice, &semaphoreInfo, nullptr, &this->renderFinishedSemaphores[i]) != VK_SUCCESS) {
+            logError("Failed to Create Synchronization Objects For Frame!");
+            return false;
         }
     }
 
-    return true;
+    VkSemaphoreTypeCreateInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo timelineSemaphoreInfo{};
+    timelineSemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    timelineSemaphoreInfo.pNext = &timelineInfo;
+
+    if (vkCreateSemaphore(this->logicalDevice, &timelineSemaphoreInfo, nullptr, &this->graphicsTimeline) != VK_SUCCESS ||
+        vkCreateSemaphore(this->logicalDevice, &timelineSemaphoreInfo, nullptr, &this->computeTimeline) != VK_SUCCESS) {
+            logError("Failed to Create Timeline Semaphores!");
+            return false;
+    }
+
+    this->graphicsTimelineValue = 0;
+    this->computeTimelineValue = 0;
+    this->currentFrame = 0;
+
+    return this->frameProfiler.create(this->physicalDevice, this->logicalDevice, this->graphicsQueueIndex, this->computeQueueIndex, this->framesInFlight);
 }
 
 bool Renderer::createCommandPools() {
@@ -591,8 +656,19 @@ bool Renderer::createCommandPools() {
     if (!this->useGpuCulling) return true;
 
     this->computeCommandPool.create(this->getLogicalDevice(), this->getComputeQueueIndex());
+    if (!this->computeCommandPool.isInitialized()) return false;
+
+    // persistent draws are only recorded with gpu culling, the worker pools are of no use otherwise
+    const uint32_t numberOfRecordingThreads = std::min(std::max(std::thread::hardware_concurrency(), 1u), MAX_COMMAND_RECORDING_THREADS);
+    for (uint32_t i=0;i<numberOfRecordingThreads;i++) {
+        auto pool = std::make_unique<CommandPool>();
+        pool->create(this->getLogicalDevice(), this->getGraphicsQueueIndex());
+        if (!pool->isInitialized()) break;
 
-    return this->computeCommandPool.isInitialized();
+        this->recordingCommandPools.emplace_back(std::move(pool));
+    }
+
+    return true;
 }
 
 const CommandPool & Renderer::getGraphicsCommandPool() const {
@@ -656,6 +732,7 @@ bool Renderer::createDepthResources() {
         ImageConfig conf;
         conf.format = depthFormat;
         conf.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        if (this->usesOcclusionCulling()) conf.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
         conf.width = this->swapChainExtent.width;
         conf.height = this->swapChainExtent.height;
 
@@ -672,10 +749,14 @@ bool Renderer::createDepthResources() {
 }
 
 bool Renderer::initRenderer() {
-    if (!this->createRenderer() ||
-        !this->createCommandPools() ||
+    // the depth pyramid transitions its images when created along with the swap chain
+    if (!this->createCommandPools() ||
+        !this->createRenderer() ||
         !this->createUniformBuffers()) return false;
 
+    // uploads go onto the second graphics queue (same family, no ownership transfers needed and mip blits are fine)
+    if (!this->uploadManager.create(this->physicalDevice, this->logicalDevice, this->graphicsQueueIndex, this->altGraphicsQueue)) return false;
+
     if (this->useGpuCulling) {
         if (!this->createIndirectDrawBuffers()) return false;
     }
@@ -685,15 +766,24 @@ bool Renderer::initRenderer() {
     return true;
 }
 
+// the size of every indirect draw buffer, each frame in flight having its own
 void Renderer::setIndirectDrawBufferSize(const VkDeviceSize & size) {
     this->indirectDrawBufferSize = size;
 }
 
+// draws (and visible instances) fitting the indirect buffers, the cull shaders drop anything beyond
+uint32_t Renderer::getIndirectDrawCapacity() const {
+    return this->indirectDrawBufferSize / sizeof(ColorMeshIndirectDrawCommand);
+}
+
 void Renderer::destroyRendererObjects() {
     if (this->logicalDevice == nullptr) return;
 
     this->destroySwapChainObjects();
 
+    this->uploadManager.destroy();
+    this->destroyRetiredBuffers();
+
     for (auto & b : this->uniformBuffer) {
         b.destroy(this->logicalDevice);
     }
@@ -710,6 +800,10 @@ void Renderer::destroyRendererObjects() {
         b.destroy(this->logicalDevice);
     }
 
+    for (auto & b : this->indirectInstanceBuffer) {
+        b.destroy(this->logicalDevice);
+    }
+
     for (Pipeline * pipeline : this->pipelines) {
         if (pipeline != nullptr) {
             delete pipeline;
@@ -718,8 +812,15 @@ void Renderer::destroyRendererObjects() {
     }
     pipelines.clear();
 
+    if (this->depthPyramidPipeline != nullptr) {
+        delete this->depthPyramidPipeline;
+        this->depthPyramidPipeline = nullptr;
+    }
+
     this->graphicsCommandPool.destroy(this->logicalDevice);
     this->computeCommandPool.destroy(this->logicalDevice);
+    for (auto & pool : this->recordingCommandPools) pool->destroy(this->logicalDevice);
+    this->recordingCommandPools.clear();
 
     GlobalTextureStore::INSTANCE()->cleanUpTextures(this->logicalDevice);
 }
@@ -727,43 +828,30 @@ void Renderer::destroyRendererObjects() {
 void Renderer::destroySyncObjects() {
     if (this->logicalDevice == nullptr) return;
 
-    for (size_t i = 0; i < this->imageCount; i++) {
-        if (i < this->renderFinishedSemaphores.size()) {
-            if (this->renderFinishedSemaphores[i] != nullptr) {
-                vkDestroySemaphore(this->logicalDevice, this->renderFinishedSemaphores[i], nullptr);
-            }
-        }
+    for (auto & semaphore : this->renderFinishedSemaphores) {
+        if (semaphore != nullptr) vkDestroySemaphore(this->logicalDevice, semaphore, nullptr);
+    }
 
-        if (i < this->imageAvailableSemaphores.size()) {
-            if (this->imageAvailableSemaphores[i] != nullptr) {
-                vkDestroySemaphore(this->logicalDevice, this->imageAvailableSemaphores[i], nullptr);
-            }
-        }
+    for (auto & semaphore : this->imageAvailableSemaphores) {
+        if (semaphore != nullptr) vkDestroySemaphore(this->logicalDevice, semaphore, nullptr);
+    }
 
-        if (i < this->computeFinishedSemaphores.size()) {
-            if (this->computeFinishedSemaphores[i] != nullptr) {
-                vkDestroySemaphore(this->logicalDevice, this->computeFinishedSemaphores[i], nullptr);
-            }
-        }
+    this->renderFinishedSemaphores.clear();
+    this->imageAvailableSemaphores.clear();
 
-        if (i < this->inFlightFences.size()) {
-            if (this->inFlightFences[i] != nullptr) {
-                vkDestroyFence(this->logicalDevice, this->inFlightFences[i], nullptr);
-            }
-        }
+    if (this->graphicsTimeline != nullptr) {
+        this->uploadManager.removeConsumer(this->graphicsTimeline);
+        vkDestroySemaphore(this->logicalDevice, this->graphicsTimeline, nullptr);
+        this->graphicsTimeline = nullptr;
+    }
 
-        if (i < this->computeFences.size()) {
-            if (this->computeFences[i] != nullptr) {
-                vkDestroyFence(this->logicalDevice, this->computeFences[i], nullptr);
-            }
-        }
+    if (this->computeTimeline != nullptr) {
+        this->uploadManager.removeConsumer(this->computeTimeline);
+        vkDestroySemaphore(this->logicalDevice, this->computeTimeline, nullptr);
+        this->computeTimeline = nullptr;
     }
 
-    this->renderFinishedSemaphores.clear();
-    this->imageAvailableSemaphores.clear();
-    this->computeFinishedSemaphores.clear();
-    this->inFlightFences.clear();
-    this->computeFences.clear();
+    this->frameProfiler.destroy(this->logicalDevice);
 }
 
 void Renderer::destroySwapChainObjects(const bool destroyPipelines) {
@@ -784,6 +872,7 @@ void Renderer::destroySwapChainObjects(const bool destroyPipelines) {
     this->swapChainFramebuffers.clear();
 
     this->graphicsCommandPool.reset(this->logicalDevice);
+    for (auto & pool : this->recordingCommandPools) pool->reset(this->logicalDevice);
 
     if (destroyPipelines) {
         for (Pipeline * pipeline : this->pipelines) {
@@ -798,6 +887,11 @@ void Renderer::destroySwapChainObjects(const bool destroyPipelines) {
         this->renderPass = nullptr;
     }
 
+    if (this->lateRenderPass != nullptr) {
+        vkDestroyRenderPass(this->logicalDevice, this->lateRenderPass, nullptr);
+        this->lateRenderPass = nullptr;
+    }
+
     for (uint16_t j=0;j<this->swapChainImages.size();j++) {
         this->swapChainImages[j].destroy(this->logicalDevice, true);
     }
@@ -864,13 +958,50 @@ VkCommandBuffer Renderer::createCommandBuffer(const uint16_t commandBufferIndex,
     const VkCommandBuffer & commandBuffer = this->graphicsCommandPool.beginPrimaryCommandBuffer(this->logicalDevice);
     if (commandBuffer == nullptr) return nullptr;
 
+    if (useSecondaryCommandBuffers) {
+        const bool needsRecording = this->staticCommandBufferGenerations[commandBufferIndex] != this->commandBufferGeneration.load();
+        this->frameProfiler.beginFrame(commandBuffer, commandBufferIndex, false, needsRecording ? 0 : this->staticSectionCounts[commandBufferIndex]);
+        if (needsRecording) this->recordStaticCommandBuffer(commandBufferIndex);
+    } else {
+        this->frameProfiler.beginFrame(commandBuffer, commandBufferIndex);
+    }
+
     if (this->useGpuCulling && this->getGraphicsQueueIndex() != this->getComputeQueueIndex()) {
         for (Pipeline * pipeline : this->pipelines) {
             if (pipeline->isEnabled() && isReady() && pipeline->canRender()) {
-                const int indIndex = static_cast<GraphicsPipeline *>(pipeline)->getIndirectBufferIndex();
+                GraphicsPipeline * graphicsPipeline = static_cast<GraphicsPipeline *>(pipeline);
+
+                // palettes written by the animation pipeline
+                if (graphicsPipeline->usesGpuAnimation()) {
+                    const VkDescriptorBufferInfo & animationMatrixInfo = graphicsPipeline->getAnimationMatrixDescriptorInfo(commandBufferIndex);
+
+                    const VkBufferMemoryBarrier paletteBarrier {
+                        VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                        nullptr,
+                        0,
+                        VK_ACCESS_SHADER_READ_BIT,
+                        static_cast<uint32_t>(this->getComputeQueueIndex()),
+                        static_cast<uint32_t>(this->getGraphicsQueueIndex()),
+                        animationMatrixInfo.buffer,
+                        animationMatrixInfo.offset,
+                        animationMatrixInfo.range
+                    };
+
+                    vkCmdPipelineBarrier(
+                        commandBuffer,
+                        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                        0,
+                        0, nullptr,
+                        1, &paletteBarrier,
+                        0, nullptr
+                    );
+                }
+
+                const int indIndex = graphicsPipeline->getIndirectBufferIndex();
                 if (indIndex < 0) continue;
 
-                const std::array<VkBufferMemoryBarrier,2> indirectBarriers {{
+                const std::array<VkBufferMemoryBarrier,3> indirectBarriers {{
                 {
                     VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
                     nullptr,
@@ -878,9 +1009,9 @@ VkCommandBuffer Renderer::createCommandBuffer(const uint16_t commandBufferIndex,
                     VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
                     static_cast<uint32_t>(this->getComputeQueueIndex()),
                     static_cast<uint32_t>(this->getGraphicsQueueIndex()),
-                    this->indirectDrawBuffer[indIndex].getBuffer(),
+                    this->getIndirectDrawBuffer(indIndex, commandBufferIndex).getBuffer(),
                     0,
-                    this->indirectDrawBuffer[indIndex].getSize()
+                    this->getIndirectDrawBuffer(indIndex, commandBufferIndex).getSize()
                 },
                 {
                     VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
@@ -889,16 +1020,27 @@ VkCommandBuffer Renderer::createCommandBuffer(const uint16_t commandBufferIndex,
                     VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
                     static_cast<uint32_t>(this->getComputeQueueIndex()),
                     static_cast<uint32_t>(this->getGraphicsQueueIndex()),
-                    this->indirectDrawCountBuffer[indIndex].getBuffer(),
+                    this->getIndirectDrawCountBuffer(indIndex, commandBufferIndex).getBuffer(),
                     0,
-                    this->indirectDrawCountBuffer[indIndex].getSize()
+                    this->getIndirectDrawCountBuffer(indIndex, commandBufferIndex).getSize()
+                },
+                {
+                    VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                    nullptr,
+                    VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_ACCESS_SHADER_READ_BIT,
+                    static_cast<uint32_t>(this->getComputeQueueIndex()),
+                    static_cast<uint32_t>(this->getGraphicsQueueIndex()),
+                    this->getIndirectInstanceBuffer(indIndex, commandBufferIndex).getBuffer(),
+                    0,
+                    this->getIndirectInstanceBuffer(indIndex, commandBufferIndex).getSize()
                 }
                 }};
 
                 vkCmdPipelineBarrier(
                     commandBuffer,
                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-                    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
                     0,
                     0, nullptr,
                     indirectBarriers.size(),
@@ -925,10 +1067,46 @@ VkCommandBuffer Renderer::createCommandBuffer(const uint16_t commandBufferIndex,
 
     vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, useSecondaryCommandBuffers ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
 
-    for (Pipeline * pipeline : this->pipelines) {
-        if (pipeline->isEnabled() && this->isReady() && pipeline->canRender()) {
-            static_cast<GraphicsPipeline *>(pipeline)->update();
-            static_cast<GraphicsPipeline *>(pipeline)->draw(commandBuffer, commandBufferIndex);
+    if (useSecondaryCommandBuffers) {
+        // anything that changes from frame to frame (e.g. the gui) is recorded anew next to the persistent commands
+        this->recordDynamicCommandBuffers(commandBufferIndex);
+        const auto & dynamicCommandBuffers = this->dynamicCommandBuffers[commandBufferIndex];
+
+        const bool occlusionCulling = this->usesOcclusionCulling();
+
+        std::vector<VkCommandBuffer> secondaryCommandBuffers;
+        for (const auto & s : this->staticCommandBuffers[commandBufferIndex]) secondaryCommandBuffers.push_back(s.commandBuffer);
+        if (!occlusionCulling) {
+            for (const auto & d : dynamicCommandBuffers) secondaryCommandBuffers.push_back(d.commandBuffer);
+        }
+
+        if (!secondaryCommandBuffers.empty()) vkCmdExecuteCommands(commandBuffer, secondaryCommandBuffers.size(), secondaryCommandBuffers.data());
+
+        if (occlusionCulling) {
+            vkCmdEndRenderPass(commandBuffer);
+
+            this->recordOcclusionCulling(commandBuffer, commandBufferIndex, imageIndex);
+
+            renderPassInfo.renderPass = this->lateRenderPass;
+            renderPassInfo.clearValueCount = 0;
+            renderPassInfo.pClearValues = nullptr;
+
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+            // the gui goes last for nothing drawn late to end up on top of it
+            secondaryCommandBuffers.clear();
+            if (this->lateCommandBuffers[commandBufferIndex] != nullptr) secondaryCommandBuffers.push_back(this->lateCommandBuffers[commandBufferIndex]);
+            for (const auto & d : dynamicCommandBuffers) secondaryCommandBuffers.push_back(d.commandBuffer);
+
+            if (!secondaryCommandBuffers.empty()) vkCmdExecuteCommands(commandBuffer, secondaryCommandBuffers.size(), secondaryCommandBuffers.data());
+        }
+    } else {
+        for (Pipeline * pipeline : this->pipelines) {
+            if (pipeline->isEnabled() && this->isReady() && pipeline->canRender()) {
+                const bool timed = this->frameProfiler.beginSection(commandBuffer, commandBufferIndex, pipeline->getGpuSectionName());
+                static_cast<GraphicsPipeline *>(pipeline)->draw(commandBuffer, commandBufferIndex);
+                if (timed) this->frameProfiler.endSection(commandBuffer, commandBufferIndex);
+            }
         }
     }
 
@@ -939,9 +1117,233 @@ VkCommandBuffer Renderer::createCommandBuffer(const uint16_t commandBufferIndex,
     return commandBuffer;
 }
 
+/**
+ *  Recorded in between early and late draws: the depth of the early draws is reduced into the pyramid of the frame
+ *  and the cull pipelines test everything against it, writing the draws that became visible into their indirect buffers
+ */
+void Renderer::recordOcclusionCulling(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex, const uint16_t imageIndex) {
+    const bool timed = this->frameProfiler.beginSection(commandBuffer, commandBufferIndex, "gpu.occlusion_culling");
+
+    this->depthPyramidPipeline->setDepthImage(this->depthImages[imageIndex], commandBufferIndex);
+    this->depthPyramidPipeline->compute(commandBuffer, commandBufferIndex);
+
+    for (Pipeline * pipeline : this->pipelines) {
+        if (pipeline->isEnabled() && this->isReady() && !pipeline->canRender()) {
+            static_cast<ComputePipeline *>(pipeline)->computeLate(commandBuffer, commandBufferIndex);
+        }
+    }
+
+    // the late draws read the indirect buffers just written and write the depth the pyramid was built from
+    const VkMemoryBarrier lateCullBarrier {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr,
+        VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT
+    };
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        0,
+        1, &lateCullBarrier,
+        0, nullptr,
+        0, nullptr
+    );
+
+    if (timed) this->frameProfiler.endSection(commandBuffer, commandBufferIndex);
+}
+
+/**
+ *  Records all pipelines whose draw commands stay the same from frame to frame (static)
+ *  or those that don't (dynamic) into the given secondary command buffer
+ */
+void Renderer::recordPipelines(const VkCommandBuffer & commandBuffer, const uint16_t commandBufferIndex, const bool staticCommands) {
+    for (Pipeline * pipeline : this->pipelines) {
+        if (!pipeline->isEnabled() || !this->isReady() || !pipeline->canRender()) continue;
+
+        GraphicsPipeline * graphicsPipeline = static_cast<GraphicsPipeline *>(pipeline);
+        if (graphicsPipeline->hasStaticCommands() != staticCommands) continue;
+
+        const bool timed = this->frameProfiler.beginSection(commandBuffer, commandBufferIndex, pipeline->getGpuSectionName());
+        graphicsPipeline->draw(commandBuffer, commandBufferIndex);
+        if (timed) this->frameProfiler.endSection(commandBuffer, commandBufferIndex);
+    }
+}
+
+/**
+ *  The persistent part of a frame is kept as secondary command buffer per frame
+ *  and only recorded again after invalidateCommandBuffers was called
+ */
+bool Renderer::recordStaticCommandBuffer(const uint16_t commandBufferIndex) {
+    const ScopedFrameTimer recordTimer(this->frameProfiler, "cpu.record_static_commands");
+
+    // read before recording, any invalidation during recording will trigger another one next time around
+    const uint64_t generation = this->commandBufferGeneration.load();
+
+    this->freeStaticCommandBuffers(commandBufferIndex);
+
+    std::vector<GraphicsPipeline *> staticPipelines;
+    for (Pipeline * pipeline : this->pipelines) {
+        if (!pipeline->isEnabled() || !this->isReady() || !pipeline->canRender()) continue;
+
+        GraphicsPipeline * graphicsPipeline = static_cast<GraphicsPipeline *>(pipeline);
+        if (graphicsPipeline->hasStaticCommands()) staticPipelines.emplace_back(graphicsPipeline);
+    }
+
+    if (this->useParallelCommandRecording && !this->recordingCommandPools.empty() && staticPipelines.size() > 1) {
+        if (!this->recordCommandBuffersInParallel(commandBufferIndex, staticPipelines, true, this->staticCommandBuffers[commandBufferIndex])) return false;
+    } else {
+        const VkCommandBuffer commandBuffer = this->graphicsCommandPool.beginSecondaryCommandBuffer(this->logicalDevice, this->renderPass, true);
+        if (commandBuffer == nullptr) return false;
+
+        this->recordPipelines(commandBuffer, commandBufferIndex, true);
+        this->graphicsCommandPool.endCommandBuffer(commandBuffer);
+
+        this->staticCommandBuffers[commandBufferIndex].push_back({ commandBuffer, &this->graphicsCommandPool });
+    }
+
+    if (this->usesOcclusionCulling() && !this->recordLateCommandBuffer(commandBufferIndex, staticPipelines)) return false;
+
+    this->staticCommandBufferGenerations[commandBufferIndex] = generation;
+    this->staticSectionCounts[commandBufferIndex] = this->frameProfiler.getSectionCount(commandBufferIndex);
+
+    return true;
+}
+
+/**
+ *  Every pipeline is recorded into a secondary command buffer of its own, the pipelines being spread over
+ *  the recording command pools, one per worker thread (command pools must not be used concurrently).
+ *  Anything that is not thread safe (profiler section bookkeeping, name lookup) is done upfront on the render thread
+ */
+bool Renderer::recordCommandBuffersInParallel(const uint16_t commandBufferIndex, const std::vector<GraphicsPipeline *> & graphicsPipelines, const bool reusable, std::vector<RecordedCommandBuffer> & commandBuffers) {
+    std::vector<int32_t> sections;
+    for (auto p : graphicsPipelines) {
+        sections.emplace_back(this->frameProfiler.reserveSection(commandBufferIndex, p->getGpuSectionName()));
+    }
+
+    const size_t numberOfWorkers = std::min(this->recordingCommandPools.size(), graphicsPipelines.size());
+    std::vector<RecordedCommandBuffer> recordedCommandBuffers(graphicsPipelines.size());
+
+    this->workerPool.run(numberOfWorkers, [&](const size_t w) {
+        const CommandPool * pool = this->recordingCommandPools[w].get();
+
+        for (size_t i=w;i<graphicsPipelines.size();i+=numberOfWorkers) {
+            const VkCommandBuffer commandBuffer = pool->beginSecondaryCommandBuffer(this->logicalDevice, this->renderPass, reusable);
+            if (commandBuffer == nullptr) continue;
+
+            this->frameProfiler.writeSectionTimestamp(commandBuffer, commandBufferIndex, sections[i], false);
+            graphicsPipelines[i]->draw(commandBuffer, commandBufferIndex);
+            this->frameProfiler.writeSectionTimestamp(commandBuffer, commandBufferIndex, sections[i], true);
+
+            pool->endCommandBuffer(commandBuffer);
+
+            recordedCommandBuffers[i] = { commandBuffer, pool };
+        }
+    });
+
+    // keep the pipeline order for execution
+    bool success = true;
+    for (const auto & r : recordedCommandBuffers) {
+        if (r.commandBuffer == nullptr) {
+            success = false;
+            continue;
+        }
+
+        commandBuffers.emplace_back(r);
+    }
+
+    if (!success) logError("Failed to record all Secondary Command Buffers!");
+
+    return success;
+}
+
+/**
+ *  The pipelines whose draw commands change from frame to frame (cpu culled ones, the gui) are recorded anew every frame,
+ *  spread over the worker threads the same way as the static ones if there is more than one of them
+ */
+bool Renderer::recordDynamicCommandBuffers(const uint16_t commandBufferIndex) {
+    this->freeDynamicCommandBuffers(commandBufferIndex);
+
+    std::vector<GraphicsPipeline *> dynamicPipelines;
+    for (Pipeline * pipeline : this->pipelines) {
+        if (!pipeline->isEnabled() || !this->isReady() || !pipeline->canRender()) continue;
+
+        GraphicsPipeline * graphicsPipeline = static_cast<GraphicsPipeline *>(pipeline);
+        if (!graphicsPipeline->hasStaticCommands()) dynamicPipelines.emplace_back(graphicsPipeline);
+    }
+
+    if (dynamicPipelines.empty()) return true;
+
+    if (this->useParallelCommandRecording && !this->recordingCommandPools.empty() && dynamicPipelines.size() > 1) {
+        return this->recordCommandBuffersInParallel(commandBufferIndex, dynamicPipelines, false, this->dynamicCommandBuffers[commandBufferIndex]);
+    }
+
+    const VkCommandBuffer commandBuffer = this->graphicsCommandPool.beginSecondaryCommandBuffer(this->logicalDevice, this->renderPass);
+    if (commandBuffer == nullptr) return false;
+
+    this->recordPipelines(commandBuffer, commandBufferIndex, false);
+    this->graphicsCommandPool.endCommandBuffer(commandBuffer);
+
+    this->dynamicCommandBuffers[commandBufferIndex].push_back({ commandBuffer, &this->graphicsCommandPool });
+
+    return true;
+}
+
+void Renderer::freeDynamicCommandBuffers(const uint16_t commandBufferIndex) {
+    for (const auto & d : this->dynamicCommandBuffers[commandBufferIndex]) {
+        d.pool->freeCommandBuffer(this->logicalDevice, d.commandBuffer);
+    }
+
+    this->dynamicCommandBuffers[commandBufferIndex].clear();
+}
+
+/**
+ *  The late draws of occlusion culling replay the culled static pipelines (without profiling),
+ *  reading the indirect buffers that the late cull phase overwrote
+ */
+bool Renderer::recordLateCommandBuffer(const uint16_t commandBufferIndex, const std::vector<GraphicsPipeline *> & staticPipelines) {
+    const VkCommandBuffer commandBuffer = this->graphicsCommandPool.beginSecondaryCommandBuffer(this->logicalDevice, this->lateRenderPass, true);
+    if (commandBuffer == nullptr) return false;
+
+    for (auto p : staticPipelines) {
+        if (p->getIndirectBufferIndex() >= 0) p->draw(commandBuffer, commandBufferIndex);
+    }
+
+    this->graphicsCommandPool.endCommandBuffer(commandBuffer);
+
+    this->lateCommandBuffers[commandBufferIndex] = commandBuffer;
+
+    return true;
+}
+
+void Renderer::freeStaticCommandBuffers(const uint16_t commandBufferIndex) {
+    for (const auto & s : this->staticCommandBuffers[commandBufferIndex]) {
+        s.pool->freeCommandBuffer(this->logicalDevice, s.commandBuffer);
+    }
+
+    this->staticCommandBuffers[commandBufferIndex].clear();
+
+    if (this->lateCommandBuffers[commandBufferIndex] != nullptr) {
+        this->graphicsCommandPool.freeCommandBuffer(this->logicalDevice, this->lateCommandBuffers[commandBufferIndex]);
+        this->lateCommandBuffers[commandBufferIndex] = nullptr;
+    }
+}
+
+void Renderer::invalidateCommandBuffers() {
+    this->commandBufferGeneration++;
+}
+
 bool Renderer::createCommandBuffers() {
-    this->commandBuffers.resize(this->swapChainFramebuffers.size());
-    this->computeBuffers.resize(this->swapChainFramebuffers.size());
+    this->commandBuffers.resize(this->framesInFlight);
+    this->computeBuffers.resize(this->framesInFlight);
+    this->staticCommandBuffers.resize(this->framesInFlight);
+    this->dynamicCommandBuffers.resize(this->framesInFlight);
+    this->lateCommandBuffers.resize(this->framesInFlight);
+
+    // the graphics command pool has been reset, everything needs to be recorded again
+    this->staticCommandBufferGenerations = std::vector<uint64_t>(this->framesInFlight, 0);
+    this->computeBufferGenerations = std::vector<uint64_t>(this->framesInFlight, 0);
+    this->staticSectionCounts = std::vector<size_t>(this->framesInFlight, 0);
 
     this->lastFrameRateUpdate = std::chrono::high_resolution_clock::now();
 
@@ -949,8 +1351,16 @@ bool Renderer::createCommandBuffers() {
 }
 
 void Renderer::render(const bool addFrameToCache) {
+    // removals and buffers grown for objects added by other threads are applied ahead of the render update rebinding them
+    for (Pipeline * pipeline : this->pipelines) {
+        if (pipeline->isEnabled() && this->isReady() && pipeline->canRender()) static_cast<GraphicsPipeline *>(pipeline)->applyPendingChanges();
+    }
+
     if (this->requiresRenderUpdate) {
+        // copies out of retired buffers might still be pending
+        this->uploadManager.flush();
         this->waitForQueuesToBeIdle();
+        this->destroyRetiredBuffers();
 
         bool success = true;
         if (this->requiresSwapChainRecreate) {
@@ -979,12 +1389,20 @@ void Renderer::render(const bool addFrameToCache) {
 
     if (this->uploadTexturesToGPU) {
         this->uploadTexturesToGPU = false;
+
+        const ScopedFrameTimer uploadTimer(this->frameProfiler, "cpu.texture_upload");
         if (GlobalTextureStore::INSTANCE()->uploadTexturesToGPU(this) > 0) return;
     }
 
+    if (!this->waitForFrame()) return;
+
+    this->update();
+
     if (this->useGpuCulling) {
+        const ScopedFrameTimer computeTimer(this->frameProfiler, "cpu.compute_frame");
         this->computeFrame();
     } else {
+        const ScopedFrameTimer cullTimer(this->frameProfiler, "cpu.frustum_culling");
         GlobalRenderableStore::INSTANCE()->performFrustumCulling(Camera::INSTANCE()->getFrustumPlanes());
         this->updateUniformBuffers(this->currentFrame);
     }
@@ -1023,7 +1441,7 @@ bool Renderer::renderCachedFrame()
     }
 
     VkRenderPass cachedFrameRenderPass {};
-    if (!this->createRenderPass0(cachedFrameRenderPass, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, false)) {
+    if (!this->createRenderPass0(cachedFrameRenderPass, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, false)) {
         this->forceRenderUpdate(true);
         return false;
     }
@@ -1054,36 +1472,90 @@ bool Renderer::renderCachedFrame()
     return true;
 }
 
+/**
+ *  Blocks until the frame that last used the resources of the current frame in flight has finished on the gpu.
+ *  Graphics waits for its compute counterpart, the graphics timeline therefore covers both queues.
+ *  Apart from that the cpu never waits: compute of the next frame overlaps with graphics of the previous one
+ */
+bool Renderer::waitForFrame() {
+    if (this->graphicsTimelineValue >= this->framesInFlight) {
+        const uint64_t waitValue = this->graphicsTimelineValue + 1 - this->framesInFlight;
+
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &this->graphicsTimeline;
+        waitInfo.pValues = &waitValue;
+
+        VkResult ret;
+        {
+            const ScopedFrameTimer waitTimer(this->frameProfiler, "cpu.wait_for_frame");
+            ret = vkWaitSemaphores(this->logicalDevice, &waitInfo, UINT64_MAX);
+        }
+        if (ret != VK_SUCCESS) {
+            logError("Failed at vkWaitSemaphores");
+            this->forceRenderUpdate(true);
+            return false;
+        }
+    }
+
+    this->frameProfiler.collect(this->logicalDevice, this->currentFrame);
+    if (this->useGpuCulling) this->frameProfiler.collect(this->logicalDevice, this->currentFrame, true);
+
+    return true;
+}
+
+/**
+ *  Graphics pipelines flush their changed instance data into the copy of the current frame,
+ *  which has to happen ahead of the compute submission that culls using that very copy
+ */
+void Renderer::update() {
+    for (Pipeline * pipeline : this->pipelines) {
+        if (pipeline->isEnabled() && this->isReady() && pipeline->canRender()) {
+            const ScopedFrameTimer updateTimer(this->frameProfiler, pipeline->getUpdateSectionName());
+            static_cast<GraphicsPipeline *>(pipeline)->update();
+        }
+    }
+}
+
 /**
  *  Central method for cpu culling and indirect draw buffer population
  */
 void Renderer::computeFrame() {
-    VkResult ret = vkWaitForFences(this->logicalDevice, 1, &this->computeFences[this->currentFrame], VK_TRUE, UINT64_MAX);
-    if (ret != VK_SUCCESS) {
-        return;
+    // updates can change the draw counts and thereby invalidate the recorded compute commands
+    for (Pipeline * pipeline : this->pipelines) {
+        if (pipeline->isEnabled() && isReady() && !pipeline->canRender()) {
+            const ScopedFrameTimer updateTimer(this->frameProfiler, pipeline->getUpdateSectionName());
+            static_cast<ComputePipeline *>(pipeline)->update();
+        }
     }
 
-    ret = vkResetFences(this->logicalDevice, 1, &this->computeFences[this->currentFrame]);
-    if (ret != VK_SUCCESS) {
-        logError("Failed to Reset Fence!");
+    const uint64_t generation = this->commandBufferGeneration.load();
+    if (this->computeBuffers[this->currentFrame] != nullptr && this->computeBufferGenerations[this->currentFrame] == generation) {
+        this->frameProfiler.beginFrame(nullptr, this->currentFrame, true, FRAME_PROFILER_MAX_SECTIONS);
+        this->submitComputeFrame();
+        return;
     }
 
     if (this->computeBuffers[this->currentFrame] != nullptr) {
         this->computeCommandPool.freeCommandBuffer(this->logicalDevice, this->computeBuffers[this->currentFrame]);
+        this->computeBuffers[this->currentFrame] = nullptr;
     }
 
-    const VkCommandBuffer & commandBuffer = this->computeCommandPool.beginPrimaryCommandBuffer(this->logicalDevice);
+    const VkCommandBuffer & commandBuffer = this->computeCommandPool.beginPrimaryCommandBuffer(this->logicalDevice, true);
     if (commandBuffer == nullptr) return;
 
     this->computeBuffers[this->currentFrame] = commandBuffer;
+    this->computeBufferGenerations[this->currentFrame] = generation;
+    this->frameProfiler.beginFrame(commandBuffer, this->currentFrame, true);
 
     for (Pipeline * pipeline : this->pipelines) {
         if (pipeline->isEnabled() && isReady() && !pipeline->canRender()) {
             ComputePipeline * compPipe = static_cast<ComputePipeline *>(pipeline);
             const int ind = compPipe->getIndirectBufferIndex();
 
-            if (this->getGraphicsQueueIndex() != this->getComputeQueueIndex()) {
-                const std::array<VkBufferMemoryBarrier,2> indirectBarriers {{
+            if (ind >= 0 && this->getGraphicsQueueIndex() != this->getComputeQueueIndex()) {
+                const std::array<VkBufferMemoryBarrier,3> indirectBarriers {{
                     {
                         VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
                         nullptr,
@@ -1091,9 +1563,9 @@ void Renderer::computeFrame() {
                         VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
                         static_cast<uint32_t>(this->getComputeQueueIndex()),
                         static_cast<uint32_t>(this->getGraphicsQueueIndex()),
-                        this->indirectDrawBuffer[ind].getBuffer(),
+                        this->getIndirectDrawBuffer(ind, this->currentFrame).getBuffer(),
                         0,
-                        this->indirectDrawBuffer[ind].getSize()
+                        this->getIndirectDrawBuffer(ind, this->currentFrame).getSize()
                     },
                     {
                         VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
@@ -1102,9 +1574,20 @@ void Renderer::computeFrame() {
                         VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
                         static_cast<uint32_t>(this->getComputeQueueIndex()),
                         static_cast<uint32_t>(this->getGraphicsQueueIndex()),
-                        this->indirectDrawCountBuffer[ind].getBuffer(),
+                        this->getIndirectDrawCountBuffer(ind, this->currentFrame).getBuffer(),
                         0,
-                        this->indirectDrawCountBuffer[ind].getSize()
+                        this->getIndirectDrawCountBuffer(ind, this->currentFrame).getSize()
+                    },
+                    {
+                        VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                        nullptr,
+                        VK_ACCESS_SHADER_WRITE_BIT,
+                        VK_ACCESS_SHADER_READ_BIT,
+                        static_cast<uint32_t>(this->getComputeQueueIndex()),
+                        static_cast<uint32_t>(this->getGraphicsQueueIndex()),
+                        this->getIndirectInstanceBuffer(ind, this->currentFrame).getBuffer(),
+                        0,
+                        this->getIndirectInstanceBuffer(ind, this->currentFrame).getSize()
                     }
                 }};
 
@@ -1120,49 +1603,80 @@ void Renderer::computeFrame() {
                 );
             }
 
-            compPipe->update();
+            const bool timed = this->frameProfiler.beginSection(commandBuffer, this->currentFrame, pipeline->getGpuSectionName(), true);
             compPipe->compute(commandBuffer, this->currentFrame);
+            if (timed) this->frameProfiler.endSection(commandBuffer, this->currentFrame, true);
         }
     }
 
     this->computeCommandPool.endCommandBuffer(commandBuffer);
 
+    this->submitComputeFrame();
+}
+
+void Renderer::submitComputeFrame() {
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
     submitInfo.commandBufferCount = this->computeBuffers.empty() ? 0 : 1;
     submitInfo.pCommandBuffers = &this->computeBuffers[this->currentFrame];
 
-    VkSemaphore signalSemaphores[] = {this->computeFinishedSemaphores[this->currentFrame]};
+    const uint64_t signalValue = this->computeTimelineValue + 1;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<uint64_t> waitValues;
+
+    // draw commands queued by the compute pipelines' updates are copied before the cull reads or moves them
+    this->uploadManager.flush();
+    if (this->uploadManager.getTimelineValue() > 0) {
+        waitSemaphores.push_back(this->uploadManager.getTimeline());
+        waitStages.push_back(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT);
+        waitValues.push_back(this->uploadManager.getTimelineValue());
+    }
+
+    // recorded moves of data the late cull of frames in flight still reads wait for those frames
+    if (this->computeOverwritesDataInUse && this->graphicsTimelineValue > 0) {
+        waitSemaphores.push_back(this->graphicsTimeline);
+        waitStages.push_back(VK_PIPELINE_STAGE_TRANSFER_BIT);
+        waitValues.push_back(this->graphicsTimelineValue);
+    }
+    this->computeOverwritesDataInUse = false;
+
+    submitInfo.waitSemaphoreCount = waitSemaphores.size();
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    timelineInfo.waitSemaphoreValueCount = waitValues.size();
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+
+    submitInfo.pNext = &timelineInfo;
     submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+    submitInfo.pSignalSemaphores = &this->computeTimeline;
 
     this->updateUniformBuffers(this->currentFrame);
 
-    ret = vkQueueSubmit(this->computeQueue, 1, &submitInfo, this->computeFences[this->currentFrame]);
+    const VkResult ret = vkQueueSubmit(this->computeQueue, 1, &submitInfo, VK_NULL_HANDLE);
     if (ret != VK_SUCCESS) {
         logError("Failed to Submit Compute Command Buffer!");
         return;
     }
+
+    this->computeTimelineValue = signalValue;
+    this->uploadManager.setConsumer(this->computeTimeline, this->computeTimelineValue);
 }
 
 void Renderer::renderFrame(const bool addFrameToCache) {
-    VkResult ret = vkWaitForFences(this->logicalDevice, 1, &this->inFlightFences[this->currentFrame], VK_TRUE, UINT64_MAX);
-    if (ret != VK_SUCCESS) {
-        logError("Failed at graphics vkWaitForFences");
-        this->forceRenderUpdate(true);
-        return;
-    }
-
-    ret = vkResetFences(this->logicalDevice, 1, &this->inFlightFences[this->currentFrame]);
-    if (ret != VK_SUCCESS) {
-        logError("Failed at graphics vkResetFences");
-        this->forceRenderUpdate(true);
-        return;
-    }
-
+    VkResult ret;
     uint32_t imageIndex;
-    ret = vkAcquireNextImageKHR(this->logicalDevice, this->swapChain, UINT64_MAX, this->imageAvailableSemaphores[this->currentFrame], VK_NULL_HANDLE, &imageIndex);
+    {
+        const ScopedFrameTimer acquireTimer(this->frameProfiler, "cpu.acquire_image");
+        ret = vkAcquireNextImageKHR(this->logicalDevice, this->swapChain, UINT64_MAX, this->imageAvailableSemaphores[this->currentFrame], VK_NULL_HANDLE, &imageIndex);
+    }
     if (ret != VK_SUCCESS) {
         if (ret != VK_ERROR_OUT_OF_DATE_KHR && ret != VK_SUBOPTIMAL_KHR) logError("Failed at graphics vkAcquireNextImageKHR");
         this->forceRenderUpdate(true);
@@ -1173,7 +1687,10 @@ void Renderer::renderFrame(const bool addFrameToCache) {
         this->graphicsCommandPool.freeCommandBuffer(this->logicalDevice, this->commandBuffers[this->currentFrame]);
     }
 
-    this->commandBuffers[this->currentFrame] = this->createCommandBuffer(this->currentFrame, imageIndex);
+    {
+        const ScopedFrameTimer recordTimer(this->frameProfiler, "cpu.create_command_buffer");
+        this->commandBuffers[this->currentFrame] = this->createCommandBuffer(this->currentFrame, imageIndex, this->useGpuCulling);
+    }
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -1182,16 +1699,28 @@ void Renderer::renderFrame(const bool addFrameToCache) {
         this->imageAvailableSemaphores[this->currentFrame],
     };
 
-    if (this->useGpuCulling) {
-        waitSemaphores.push_back(this->computeFinishedSemaphores[this->currentFrame]);
-    }
-
     std::vector<VkPipelineStageFlags> waitStages = {
         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
     };
 
+    // binary semaphores ignore their value
+    std::vector<uint64_t> waitValues = { 0 };
+
     if (this->useGpuCulling) {
-        waitStages.push_back(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        waitSemaphores.push_back(this->computeTimeline);
+        // the late cull phase rewrites what the early one wrote
+        waitStages.push_back(this->usesOcclusionCulling() ?
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT :
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+        waitValues.push_back(this->computeTimelineValue);
+    }
+
+    // anything queued for upload up until recording finished is copied before the frame reads it
+    this->uploadManager.flush();
+    if (this->uploadManager.getTimelineValue() > 0) {
+        waitSemaphores.push_back(this->uploadManager.getTimeline());
+        waitStages.push_back(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        waitValues.push_back(this->uploadManager.getTimelineValue());
     }
 
     submitInfo.waitSemaphoreCount = waitSemaphores.size();
@@ -1201,24 +1730,38 @@ void Renderer::renderFrame(const bool addFrameToCache) {
     submitInfo.commandBufferCount = this->commandBuffers.empty() ? 0 : 1;
     submitInfo.pCommandBuffers = &this->commandBuffers[this->currentFrame];
 
-    VkSemaphore signalSemaphores[] = {this->renderFinishedSemaphores[this->currentFrame]};
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+    const std::array<VkSemaphore, 2> signalSemaphores = { this->graphicsTimeline, this->renderFinishedSemaphores[imageIndex] };
+    const std::array<uint64_t, 2> signalValues = { this->graphicsTimelineValue + 1, 0 };
+    submitInfo.signalSemaphoreCount = signalSemaphores.size();
+    submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = waitValues.size();
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = signalValues.size();
+    timelineInfo.pSignalSemaphoreValues = signalValues.data();
+    submitInfo.pNext = &timelineInfo;
 
-    ret = vkQueueSubmit(this->graphicsQueue, 1, &submitInfo, this->inFlightFences[this->currentFrame]);
+    const ScopedFrameTimer submitTimer(this->frameProfiler, "cpu.submit_and_present");
+
+    ret = vkQueueSubmit(this->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
     if (ret != VK_SUCCESS) {
         logError("Failed at graphics vkQueueSubmit");
         this->forceRenderUpdate(true);
         return;
     }
 
+    this->graphicsTimelineValue++;
+    this->uploadManager.setConsumer(this->graphicsTimeline, this->graphicsTimelineValue);
+
     if (addFrameToCache) this->addFrameToCache(imageIndex);
 
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
+    presentInfo.pWaitSemaphores = &this->renderFinishedSemaphores[imageIndex];
 
     VkSwapchainKHR swapChains[] = {this->swapChain};
     presentInfo.swapchainCount = 1;
@@ -1233,7 +1776,7 @@ void Renderer::renderFrame(const bool addFrameToCache) {
         return;
     }
 
-    this->currentFrame = (this->currentFrame + 1) % this->imageCount;
+    this->currentFrame = (this->currentFrame + 1) % this->framesInFlight;
 }
 
 /**
@@ -1344,6 +1887,40 @@ void Renderer::setGpuCulling(const bool useGpuCulling)
     this->useGpuCulling = useGpuCulling;
 }
 
+/**
+ *  The late cull phase runs on the graphics queue, rewriting buffers of the compute queue without ownership transfers
+ */
+bool Renderer::usesOcclusionCulling() const
+{
+    return this->useGpuCulling && this->useOcclusionCulling && this->depthPyramidPipeline != nullptr &&
+           this->getGraphicsQueueIndex() == this->getComputeQueueIndex();
+}
+
+void Renderer::setOcclusionCulling(const bool useOcclusionCulling)
+{
+    if (this->useOcclusionCulling == useOcclusionCulling) return;
+
+    // render passes and depth images differ
+    this->useOcclusionCulling = useOcclusionCulling;
+    this->forceRenderUpdate(true);
+}
+
+const DepthPyramidPipeline * Renderer::getDepthPyramidPipeline() const
+{
+    return this->depthPyramidPipeline;
+}
+
+bool Renderer::usesParallelCommandRecording() const
+{
+    return this->useParallelCommandRecording;
+}
+
+void Renderer::setParallelCommandRecording(const bool useParallelCommandRecording)
+{
+    this->useParallelCommandRecording = useParallelCommandRecording;
+    this->invalidateCommandBuffers();
+}
+
 bool Renderer::isRecording() const
 {
     return this->recording;
@@ -1369,6 +1946,22 @@ VkExtent2D Renderer::getSwapChainExtent() const {
     return this->swapChainExtent;
 }
 
+FrameProfiler & Renderer::getFrameProfiler() {
+    return this->frameProfiler;
+}
+
+UploadManager & Renderer::getUploadManager() {
+    return this->uploadManager;
+}
+
+WorkerPool & Renderer::getWorkerPool() {
+    return this->workerPool;
+}
+
+void Renderer::setComputeOverwritesDataInUse() {
+    this->computeOverwritesDataInUse = true;
+}
+
 std::vector<MemoryUsage> Renderer::getMemoryUsage() const {
     std::vector<MemoryUsage> memStats;
 
@@ -1380,6 +1973,19 @@ std::vector<MemoryUsage> Renderer::getMemoryUsage() const {
         rendererMem.indirectBufferUsesDeviceLocal = this->usesDeviceIndirectDrawBuffer[0];
     }
 
+    for (auto & iB : this->indirectInstanceBuffer) {
+        rendererMem.indirectBufferTotal += iB.getSize();
+    }
+
+    // fragmentation: share of free block space that is not part of its block's largest free range
+    const auto allocatorStats = MemoryAllocator::INSTANCE()->getStats();
+    const VkDeviceSize allocatorFree = allocatorStats.blockBytes - allocatorStats.usedBytes;
+    rendererMem.allocatorBlocks = allocatorStats.blocks;
+    rendererMem.allocatorDedicated = allocatorStats.dedicatedAllocations;
+    rendererMem.allocatorUsed = allocatorStats.usedBytes + allocatorStats.dedicatedBytes;
+    rendererMem.allocatorTotal = allocatorStats.blockBytes + allocatorStats.dedicatedBytes;
+    rendererMem.allocatorFragmentation = allocatorFree == 0 ? 0.0f : static_cast<float>(allocatorStats.fragmentedFreeBytes) / allocatorFree;
+
     memStats.emplace_back(rendererMem);
 
     for (const auto & p : this->pipelines) {
@@ -1407,6 +2013,7 @@ bool Renderer::createRenderer(const bool recreatePipelines) {
 
     if (!this->createSwapChain()) return false;
     if (!this->createSyncObjects()) return false;
+    if (!this->createDepthPyramid()) return false;
     if (!this->createRenderPass()) return false;
 
     if (recreatePipelines) {
@@ -1445,7 +2052,25 @@ uint32_t Renderer::getImageCount() const {
     return this->imageCount;
 }
 
+uint32_t Renderer::getFramesInFlight() const {
+    return this->framesInFlight;
+}
+
+uint16_t Renderer::getCurrentFrame() const {
+    return this->currentFrame;
+}
+
+void Renderer::setFramesInFlight(const uint32_t framesInFlight) {
+    if (!this->uniformBuffer.empty()) {
+        logError("Frames in flight have to be set before the renderer is initialized!");
+        return;
+    }
+
+    this->framesInFlight = std::max<uint32_t>(framesInFlight, 1);
+}
+
 void Renderer::forceRenderUpdate(const bool requiresSwapChainRecreate) {
+    this->invalidateCommandBuffers();
     this->requiresRenderUpdate = true;
     this->requiresSwapChainRecreate = requiresSwapChainRecreate;
 }
@@ -1471,6 +2096,21 @@ void Renderer::waitForQueuesToBeIdle() {
     }
 
     vkQueueWaitIdle(this->graphicsQueue);
+    if (this->altGraphicsQueue != this->graphicsQueue) vkQueueWaitIdle(this->altGraphicsQueue);
+}
+
+void Renderer::retireBuffer(std::unique_ptr<Buffer> buffer) {
+    if (buffer == nullptr) return;
+
+    const std::lock_guard<std::mutex> lock(this->retiredBuffersMutex);
+    this->retiredBuffers.emplace_back(std::move(buffer));
+}
+
+void Renderer::destroyRetiredBuffers() {
+    const std::lock_guard<std::mutex> lock(this->retiredBuffersMutex);
+
+    for (auto & b : this->retiredBuffers) b->destroy(this->logicalDevice);
+    this->retiredBuffers.clear();
 }
 
 void Renderer::pause() {
@@ -1515,6 +2155,7 @@ Renderer::~Renderer() {
 
     logInfo("Destroying Renderer...");
     this->destroyRendererObjects();
+    MemoryAllocator::INSTANCE()->destroy(this->logicalDevice);
 
     logInfo("Destroying Logical Device...");
     if (this->logicalDevice != nullptr) {
@@ -1543,22 +2184,34 @@ uint64_t Renderer::getAccumulatedDeltaTime() {
     return this->accumulatedDeltaTime;
 }
 
-Buffer & Renderer::getIndirectDrawBuffer(const int & index) {
-    if (index >= this->indirectDrawBuffer.size()) return this->indirectDrawBuffer[0];
+Buffer & Renderer::getIndirectDrawBuffer(const int & index, const uint16_t frame) {
+    const size_t i = static_cast<size_t>(frame) * INDIRECT_DRAW_DEFAULT_NUMBER_OF_BUFFERS + index;
+    if (i >= this->indirectDrawBuffer.size()) return this->indirectDrawBuffer[0];
 
-    return this->indirectDrawBuffer[index];
+    return this->indirectDrawBuffer[i];
 }
 
-Buffer & Renderer::getIndirectDrawCountBuffer(const int & index) {
-    if (index >= this->indirectDrawCountBuffer.size()) return this->indirectDrawBuffer[0];
+Buffer & Renderer::getIndirectDrawCountBuffer(const int & index, const uint16_t frame) {
+    const size_t i = static_cast<size_t>(frame) * INDIRECT_DRAW_DEFAULT_NUMBER_OF_BUFFERS + index;
+    if (i >= this->indirectDrawCountBuffer.size()) return this->indirectDrawBuffer[0];
 
-    return this->indirectDrawCountBuffer[index];
+    return this->indirectDrawCountBuffer[i];
+}
+
+Buffer & Renderer::getIndirectInstanceBuffer(const int & index, const uint16_t frame) {
+    const size_t i = static_cast<size_t>(frame) * INDIRECT_DRAW_DEFAULT_NUMBER_OF_BUFFERS + index;
+    if (i >= this->indirectInstanceBuffer.size()) return this->indirectInstanceBuffer[0];
+
+    return this->indirectInstanceBuffer[i];
 }
 
 void Renderer::setMaxIndirectCallCount(uint32_t maxIndirectDrawCount, const int & index)
 {
     if (index >= this->maxIndirectDrawCount.size()) return;
 
+    maxIndirectDrawCount = std::min(maxIndirectDrawCount, this->getIndirectDrawCapacity());
+
+    if (this->maxIndirectDrawCount[index] != maxIndirectDrawCount) this->invalidateCommandBuffers();
     this->maxIndirectDrawCount[index] = maxIndirectDrawCount;
 }
 
@@ -1577,26 +2230,31 @@ uint32_t Renderer::getComputeQueueIndex() const {
 /**
  *  For compute culling and indirect drawing we require a buffer for the draw commands
  *  as well as the count that is the draws left over after culling both of which will be
- *  populated by the compute shader
+ *  populated by the compute shader.
+ *  Every frame in flight has its own set (of the configured size) so that culling the next frame
+ *  does not overwrite what the previous one is still drawing
  */
 
 bool Renderer::createIndirectDrawBuffers()
 {
-    const bool hasEnoughDeviceLocalSpace = this->getDeviceMemory().available >= this->indirectDrawBufferSize * INDIRECT_DRAW_DEFAULT_NUMBER_OF_BUFFERS;
-
-    this->indirectDrawBuffer = std::vector<Buffer>(INDIRECT_DRAW_DEFAULT_NUMBER_OF_BUFFERS);
-    this->indirectDrawCountBuffer = std::vector<Buffer>(INDIRECT_DRAW_DEFAULT_NUMBER_OF_BUFFERS);
-    this->usesDeviceIndirectDrawBuffer = std::vector<bool>(INDIRECT_DRAW_DEFAULT_NUMBER_OF_BUFFERS, hasEnoughDeviceLocalSpace);
+    const size_t numberOfBuffers = INDIRECT_DRAW_DEFAULT_NUMBER_OF_BUFFERS * this->framesInFlight;
+    const VkDeviceSize bufferSize = this->indirectDrawBufferSize;
+    const bool hasEnoughDeviceLocalSpace = this->getDeviceMemory().available >= bufferSize * numberOfBuffers;
+
+    this->indirectDrawBuffer = std::vector<Buffer>(numberOfBuffers);
+    this->indirectDrawCountBuffer = std::vector<Buffer>(numberOfBuffers);
+    this->indirectInstanceBuffer = std::vector<Buffer>(numberOfBuffers);
+    this->usesDeviceIndirectDrawBuffer = std::vector<bool>(numberOfBuffers, hasEnoughDeviceLocalSpace);
     this->maxIndirectDrawCount = std::vector<uint32_t>(INDIRECT_DRAW_DEFAULT_NUMBER_OF_BUFFERS, 0);
 
     VkResult result;
     int i=0;
     for (auto & b : this->indirectDrawBuffer) {
-        result = b.createIndirectDrawBuffer(this->physicalDevice, this->logicalDevice, this->indirectDrawBufferSize, this->usesDeviceIndirectDrawBuffer[i]);
+        result = b.createIndirectDrawBuffer(this->physicalDevice, this->logicalDevice, bufferSize, this->usesDeviceIndirectDrawBuffer[i]);
 
         if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY) {
             this->usesDeviceIndirectDrawBuffer[i] = false;
-            b.createIndirectDrawBuffer(this->physicalDevice, this->logicalDevice, this->indirectDrawBufferSize, this->usesDeviceIndirectDrawBuffer[i]);
+            b.createIndirectDrawBuffer(this->physicalDevice, this->logicalDevice, bufferSize, this->usesDeviceIndirectDrawBuffer[i]);
         }
 
         if (!b.isInitialized()) return false;
@@ -1606,7 +2264,7 @@ bool Renderer::createIndirectDrawBuffers()
     }
 
     const VkDeviceSize countBufferSize = sizeof(uint32_t);
-    bool useDeviceLocalMemory = this->getDeviceMemory().available >= countBufferSize * INDIRECT_DRAW_DEFAULT_NUMBER_OF_BUFFERS;
+    bool useDeviceLocalMemory = this->getDeviceMemory().available >= countBufferSize * numberOfBuffers;
 
     for (auto & b : this->indirectDrawCountBuffer) {
 
@@ -1620,6 +2278,23 @@ bool Renderer::createIndirectDrawBuffers()
         if (useDeviceLocalMemory) this->trackDeviceLocalMemory(b.getSize());
     }
 
+    // the instances of the instanced draws, every draw command could be one visible instance of its own
+    const VkDeviceSize instanceBufferSize = (bufferSize / sizeof(ColorMeshIndirectDrawCommand)) * sizeof(uint32_t);
+
+    useDeviceLocalMemory = hasEnoughDeviceLocalSpace;
+
+    for (auto & b : this->indirectInstanceBuffer) {
+        result = b.createIndirectDrawBuffer(this->physicalDevice, this->logicalDevice, instanceBufferSize, useDeviceLocalMemory);
+
+        if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY) {
+            useDeviceLocalMemory = false;
+            result = b.createIndirectDrawBuffer(this->physicalDevice, this->logicalDevice, instanceBufferSize, useDeviceLocalMemory);
+        }
+
+        if (!b.isInitialized()) return false;
+        if (useDeviceLocalMemory) this->trackDeviceLocalMemory(b.getSize());
+    }
+
     return true;
 }
 
@@ -18,6 +18,15 @@ int main(int argc, char* argv []) {
     const std::string root = argc > 1 ? argv[1] : "";
     const std::string ip = argc > 2 ? argv[2] : "127.0.0.1";
 
+    // optional sharding: <shard index> <number of shards>, each shard process listens on request port + shard index
+    ShardConfig shard;
+    shard.index = argc > 3 ? static_cast<uint16_t>(std::max(0, std::atoi(argv[3]))) : 0;
+    shard.count = argc > 4 ? static_cast<uint16_t>(std::max(1, std::atoi(argv[4]))) : 1;
+    if (shard.index >= shard.count) {
+        logError("Shard index " + std::to_string(shard.index) + " exceeds number of shards " + std::to_string(shard.count));
+        return -1;
+    }
+
     ObjectFactory::base = root;
 
     if (!std::filesystem::exists(ObjectFactory::base)) {
@@ -40,7 +49,20 @@ int main(int argc, char* argv []) {
 
     signal(SIGINT, signalHandler);
 
-    std::unique_ptr<CommServer> server = std::make_unique<CommServer>(ip);
+    // opt-in instrumentation: PLAYGROUND_METRICS=<dump interval in seconds>, PLAYGROUND_TRACE=<chrome trace output file>
+    const char * metricsInterval = std::getenv("PLAYGROUND_METRICS");
+    const char * traceFile = std::getenv("PLAYGROUND_TRACE");
+    const uint64_t metricsDumpInterval = metricsInterval != nullptr ? std::max(1, std::atoi(metricsInterval)) * 1000 : 10000;
+    if (metricsInterval != nullptr || traceFile != nullptr) {
+        Metrics::INSTANCE()->enable(true);
+        Metrics::INSTANCE()->enableTracing(traceFile != nullptr);
+        logInfo("Metrics enabled" + (traceFile != nullptr ? ", tracing into " + std::string(traceFile) : ""));
+    }
+
+    const uint16_t broadcastPort = 3000;
+    const uint16_t requestPort = 3001;
+
+    std::unique_ptr<CommServer> server = std::make_unique<CommServer>(ip, broadcastPort, requestPort + shard.index);
     std::unique_ptr<CommCenter> center = std::make_unique<CommCenter>();
     auto handler = [&center](void * message) {
         center->queueMessages(message);
@@ -48,6 +70,20 @@ int main(int argc, char* argv []) {
 
     if (!server->start(handler)) return -1;
 
+    // objects leaving our stripe are handed off to the owning shard via its request port
+    std::vector<std::unique_ptr<CommClient>> peers(shard.count);
+    for (uint16_t i=0;i<shard.count;i++) {
+        if (i == shard.index) continue;
+
+        peers[i] = std::make_unique<CommClient>(ip, broadcastPort, requestPort + i);
+        if (!peers[i]->startWithoutBroadcast()) {
+            logError("Failed to connect to shard " + std::to_string(i));
+            return -1;
+        }
+    }
+
+    if (shard.count > 1) logInfo("Running shard " + std::to_string(shard.index+1) + " of " + std::to_string(shard.count));
+
     GlobalPhysicsObjectStore::INSTANCE();
     SpatialHashMap::INSTANCE();
 
@@ -57,15 +93,26 @@ int main(int argc, char* argv []) {
     uint64_t lastHeartBeat = 0;
 
     while(!stop) {
+        // hand-offs are answered by the peers while we carry on
+        for (auto & p : peers) {
+            if (p != nullptr) p->pollAsyncRequests();
+        }
+
         // get any queues messages and process them by delegation
         const auto nextMessage = center->getNextMessage();
         if (nextMessage != nullptr) {
+            const ScopedTimer messageTimer("server.message");
 
             const auto m = GetMessage(static_cast<uint8_t *>(nextMessage));
             if (m == nullptr) continue;
 
             const uint32_t debugFlags = m->debug();
 
+            if (m->ack()) {
+                lastHeartBeat = Communication::getTimeInMillis();
+                continue;
+            }
+
             const auto contentVector = m->content();
             if (contentVector == nullptr) continue;
 
@@ -76,9 +123,25 @@ int main(int argc, char* argv []) {
             for (uint32_t i=0;i<nrOfMessages;i++) {
                 const auto messageType = (const MessageUnion) (*contentVectorType)[i];
                 if (messageType == MessageUnion_ObjectCreateRequest) {
-                    const auto physicsObject = ObjectFactory::handleCreateObjectRequest((const ObjectCreateRequest *)  (*contentVector)[i]);
+                    Metrics::INSTANCE()->incrementCounter("server.create_requests");
+                    const auto request = (const ObjectCreateRequest *)  (*contentVector)[i];
+
+                    // shards only take on objects within or bordering their stripe
+                    const auto location = request->properties()->location();
+                    if (location != nullptr && !shard.mirrors({ location->x(), location->y(), location->z() })) continue;
+
+                    // replayed by a reconnecting client, known objects reach it with the snapshot it requests
+                    if (GlobalPhysicsObjectStore::INSTANCE()->getObjectById<PhysicsObject>(request->properties()->id()->str()) != nullptr) continue;
+
+                    const auto physicsObject = ObjectFactory::handleCreateObjectRequest(request);
                     if (physicsObject != nullptr) {
                         SpatialHashMap::INSTANCE()->addObject(physicsObject);
+                        ObjectFactory::getInterestGroup(physicsObject, true);
+                        Metrics::INSTANCE()->setGauge("objects.total", GlobalPhysicsObjectStore::INSTANCE()->getNumberOfObjects());
+
+                        const bool owned = shard.owns(physicsObject->getPosition());
+                        physicsObject->setProperty<bool>("owned", owned);
+                        if (!owned) continue;
 
                         CommBuilder builder;
                         if (ObjectFactory::handleCreateObjectResponse(builder, physicsObject)) {
@@ -86,24 +149,74 @@ int main(int argc, char* argv []) {
                                 ObjectFactory::addDebugResponse(builder, physicsObject);
                             }
                             CommCenter::createMessage(builder, debugFlags);
-                            server->send(builder.builder);
+                            server->send(builder.builder, ObjectFactory::getInterestGroup(physicsObject));
                         }
                     }
                 } else if (messageType == MessageUnion_ObjectPropertiesUpdateRequest) {
+                    Metrics::INSTANCE()->incrementCounter("server.update_requests");
                     const auto physicsObject = ObjectFactory::handleObjectPropertiesUpdateRequest((const ObjectPropertiesUpdateRequest *)  (*contentVector)[i]);
                     if (physicsObject != nullptr && physicsObject->isDirty()) {
                         physicsObject->updateBoundingVolumes(physicsObject->doAnimationRecalculation());
                         physics->addObjectsToBeUpdated({physicsObject});
 
+                        const auto previousGroup = ObjectFactory::getInterestGroup(physicsObject, true);
+                        const auto currentGroup = ObjectFactory::getInterestGroup(physicsObject);
+
+                        const bool wasOwned = physicsObject->getProperty<bool>("owned", true);
+                        const bool owned = shard.owns(physicsObject->getPosition());
+                        physicsObject->setProperty<bool>("owned", owned);
+
+                        // hand off to the new owner, it might not even mirror the object
+                        if (wasOwned && !owned) {
+                            const auto & peer = peers[getShardForPosition(physicsObject->getPosition(), shard.count)];
+
+                            CommBuilder handOffBuilder;
+                            if (peer != nullptr && ObjectFactory::handleHandOffRequest(handOffBuilder, physicsObject)) {
+                                Metrics::INSTANCE()->incrementCounter("server.hand_offs");
+                                CommCenter::createMessage(handOffBuilder, debugFlags);
+                                peer->sendAsync(handOffBuilder.builder, [](void * reply) {
+                                    if (reply == nullptr) logError("Failed to hand off object to shard");
+                                    else free(reply);
+                                });
+                            }
+                        }
+
+                        if (!owned) continue;
+
                         CommBuilder builder;
                         if (ObjectFactory::handleCreateUpdateResponse(builder, physicsObject)) {
                             if ((debugFlags & DEBUG_BBOX) == DEBUG_BBOX ) {
                                 ObjectFactory::addDebugResponse(builder, physicsObject);
                             }
                             CommCenter::createMessage(builder, debugFlags);
-                            server->send(builder.builder);
+                            server->send(builder.builder, previousGroup);
+                        }
+
+                        // clients of the cell entered might not know the object yet
+                        if (previousGroup != currentGroup) {
+                            CommBuilder createBuilder;
+                            if (ObjectFactory::handleCreateObjectResponse(createBuilder, physicsObject)) {
+                                CommCenter::createMessage(createBuilder, debugFlags);
+                                server->send(createBuilder.builder, currentGroup);
+                            }
                         }
                     }
+                } else if (messageType == MessageUnion_InterestUpdateRequest) {
+                    Metrics::INSTANCE()->incrementCounter("server.interest_requests");
+                    const auto request = (const InterestUpdateRequest *)  (*contentVector)[i];
+                    if (request->cells() == nullptr) continue;
+
+                    // the first group is joined by the requesting client alone, it gets the state of the cells following
+                    if (request->cells()->size() < 2) continue;
+
+                    const std::string replyGroup = request->cells()->Get(0)->str();
+                    std::set<std::string> groups;
+                    for (uint32_t c=1;c<request->cells()->size();c++) groups.emplace(request->cells()->Get(c)->str());
+
+                    Metrics::INSTANCE()->incrementCounter("server.snapshots");
+                    ObjectFactory::handleSnapshotRequest([&server, &replyGroup](CommBuilder & builder, const std::string & /* group */) {
+                        server->send(builder.builder, replyGroup);
+                    }, debugFlags, groups);
                 }
             }
 
@@ -117,10 +230,19 @@ int main(int argc, char* argv []) {
                 lastHeartBeat = now;
             }
         }
+
+        Metrics::INSTANCE()->dumpStatsPeriodically(metricsDumpInterval);
+    }
+
+    for (auto & p : peers) {
+        if (p != nullptr) p->stop();
     }
 
     server->stop();
     physics->stop();
 
+    if (traceFile != nullptr) Metrics::INSTANCE()->writeTrace(traceFile);
+    if (Metrics::INSTANCE()->isEnabled()) logInfo(Metrics::INSTANCE()->getStats());
+
     return 0;
 }
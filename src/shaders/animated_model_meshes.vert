@@ -7,12 +7,13 @@ layout(binding = 0) uniform UniformBufferObject {
     vec4 lightLocationAndStrength;
 } worldUniforms;
 
+// packed: normal octahedral encoded (snorm16x2), uv as half floats,
+// tangent octahedral encoded (unorm12x2) with the bitangent sign in the highest bit
 struct VertexData {
     float inPositionX, inPositionY, inPositionZ;
-    float inNormalX, inNormalY, inNormalZ;
-    float inUvX, inUvY;
-    float inTangentX, inTangentY, inTangentZ;
-    float inBiTangentX, inBiTangentY, inBiTangentZ;
+    uint inNormal;
+    uint inUv;
+    uint inTangent;
 };
 
 layout(binding = 1) readonly buffer verticesSSBO {
@@ -33,30 +34,59 @@ layout(binding = 3) readonly buffer animationMatricesSSBO {
     mat4 matrices[];
 };
 
+struct VertexJointData {
+    uvec4 joints;
+    vec4 weights;
+};
+
+layout(binding = 4) readonly buffer vertexJointsSSBO {
+    VertexJointData vertexJoints[];
+};
+
 layout(location = 0) out vec3 outPosition;
 layout(location = 1) out vec3 outNormals;
 layout(location = 2) out vec2 outUV;
 layout(location = 3) out vec3 outCameraTBN;
 layout(location = 4) out vec3 outLightTBN;
 
+vec3 decodeOctahedral(const vec2 e) {
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    if (n.z < 0.0f) n.xy = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    return normalize(n);
+}
+
+vec3 decodeTangent(const uint t) {
+    return decodeOctahedral(vec2(t & 0xFFFu, (t >> 12) & 0xFFFu) / 4095.0f * 2.0f - 1.0f);
+}
+
+float decodeBitangentSign(const uint t) {
+    return (t >> 31) != 0 ? -1.0f : 1.0f;
+}
+
 void main() {
     VertexData vertexData = vertices[gl_VertexIndex];
 
     vec4 inPosition = vec4(vertexData.inPositionX, vertexData.inPositionY, vertexData.inPositionZ, 1.0f);
-    vec4 inNormals = vec4(vertexData.inNormalX, vertexData.inNormalY, vertexData.inNormalZ, 1.0f);
+    vec4 inNormals = vec4(decodeOctahedral(unpackSnorm2x16(vertexData.inNormal)), 1.0f);
+
+    // joint indices point into the instance's palette
+    VertexJointData vertexJointData = vertexJoints[gl_VertexIndex];
+    mat4 animationMatrix = mat4(1.0f);
+    for (int i=0;i<4;i++) {
+        if (vertexJointData.weights[i] > 0.0f) animationMatrix += matrices[vertexJointData.joints[i]] * vertexJointData.weights[i];
+    }
 
-    mat4 animationMatrix = matrices[gl_VertexIndex];
     inPosition = animationMatrix * inPosition;
     inNormals = animationMatrix * inNormals;
 
-    vec3 inTangent = vec3(vertexData.inTangentX, vertexData.inTangentY, vertexData.inTangentZ);
-    vec3 inBitangent = vec3(vertexData.inBiTangentX, vertexData.inBiTangentY, vertexData.inBiTangentZ);
+    vec3 inTangent = decodeTangent(vertexData.inTangent);
+    vec3 inBitangent = decodeBitangentSign(vertexData.inTangent) * cross(decodeOctahedral(unpackSnorm2x16(vertexData.inNormal)), inTangent);
 
     gl_Position = worldUniforms.viewproj * pushConstants.matrix * inPosition;
 
     outPosition = (pushConstants.matrix * inPosition).xyz;
     outNormals = normalize(inNormals).xyz;
-    outUV = vec2(vertexData.inUvX, vertexData.inUvY);
+    outUV = unpackHalf2x16(vertexData.inUv);
     outCameraTBN = worldUniforms.camera.xyz;
     outLightTBN = worldUniforms.lightLocationAndStrength.xyz;
 
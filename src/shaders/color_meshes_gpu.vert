@@ -49,6 +49,11 @@ layout(binding = 4) buffer meshDataSSBO {
     MeshData meshes[];
 };
 
+// the instances of all instanced draws, grouped per draw
+layout(binding = 5) readonly buffer visibleInstanceSSBO {
+    uint visibleInstances[];
+};
+
 layout(location = 0) out vec3 outPosition;
 layout(location = 1) out vec3 outNormals;
 layout(location = 2) out vec4 outColor;
@@ -56,7 +61,7 @@ layout(location = 2) out vec4 outColor;
 void main() {
     VertexData vertexData = vertices[gl_VertexIndex];
     IndirectDrawCommand draw = draws[gl_DrawID];
-    InstanceData instanceData = instances[draw.firstInstance];
+    InstanceData instanceData = instances[visibleInstances[gl_InstanceIndex]];
     MeshData meshData = meshes[draw.meshInstance];
 
     vec4 inPosition = vec4(vertexData.inPositionX, vertexData.inPositionY, vertexData.inPositionZ, 1.0f);
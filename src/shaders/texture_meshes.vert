@@ -8,10 +8,11 @@ layout(binding = 0) uniform UniformBufferObject {
     vec4 lightLocationAndStrength;
 } worldUniforms;
 
+// packed: normal octahedral encoded (snorm16x2), uv as half floats
 struct VertexData {
     float inPositionX, inPositionY, inPositionZ;
-    float inNormalX, inNormalY, inNormalZ;
-    float inUvX, inUvY;
+    uint inNormal;
+    uint inUv;
 };
 
 layout(binding = 1) readonly buffer verticesSSBO {
@@ -28,6 +29,12 @@ layout(location = 1) out vec3 outNormals;
 layout(location = 2) out vec2 outUV;
 layout(location = 3) out uint outTextureId;
 
+vec3 decodeOctahedral(const vec2 e) {
+    vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+    if (n.z < 0.0f) n.xy = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    return normalize(n);
+}
+
 void main() {
     VertexData vertexData = vertices[gl_VertexIndex];
     vec4 inPosition = vec4(vertexData.inPositionX, vertexData.inPositionY, vertexData.inPositionZ, 1.0f);
@@ -35,8 +42,8 @@ void main() {
     gl_Position = worldUniforms.viewproj * pushConstants.matrix * inPosition;
 
     outPosition = (pushConstants.matrix * inPosition).xyz;
-    outUV = vec2(vertexData.inUvX, vertexData.inUvY);
+    outUV = unpackHalf2x16(vertexData.inUv);
     outTextureId = pushConstants.textureId;
 
-    outNormals = normalize(vec3(vertexData.inNormalX, vertexData.inNormalY, vertexData.inNormalZ));
+    outNormals = normalize(decodeOctahedral(unpackSnorm2x16(vertexData.inNormal)));
 }
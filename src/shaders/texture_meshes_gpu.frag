@@ -9,9 +9,9 @@ layout(binding = 0) uniform UniformBufferObject {
 } worldUniforms;
 
 #ifdef GL_EXT_nonuniform_qualifier
-layout(binding = 5) uniform sampler2D samplers[];
+layout(binding = 6) uniform sampler2D samplers[];
 #else
-layout(binding = 5) uniform sampler2D samplers[5000];
+layout(binding = 6) uniform sampler2D samplers[5000];
 #endif
 
 layout(location = 0) in vec3 inPosition;
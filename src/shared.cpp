@@ -169,6 +169,319 @@ void Descriptors::updateWriteDescriptorWithImageInfo(const VkDevice & logicalDev
         vkUpdateDescriptorSets(logicalDevice, 1, &writeDescriptorSet, 0, nullptr);
 }
 
+MemoryBlock::MemoryBlock() {}
+
+VkResult MemoryBlock::create(const VkDevice & logicalDevice, const VkDeviceSize size, const uint32_t memoryTypeIndex, const bool hostVisible, const bool forImages)
+{
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkResult ret = vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &this->memory);
+    if (ret != VK_SUCCESS) return ret;
+
+    if (hostVisible) {
+        ret = vkMapMemory(logicalDevice, this->memory, 0, size, 0, &this->mappedData);
+        if (ret != VK_SUCCESS) {
+            this->destroy(logicalDevice);
+            return ret;
+        }
+    }
+
+    this->size = size;
+    this->memoryTypeIndex = memoryTypeIndex;
+    this->forImages = forImages;
+    this->used = 0;
+
+    // level 0 is the entire block, every level down halves the piece size
+    const uint32_t levels = std::countr_zero(size / MEMORY_ALLOCATOR_MIN_ALLOCATION) + 1;
+    this->freeLists = std::vector<std::set<VkDeviceSize>>(levels);
+    this->freeLists[0].insert(0);
+
+    return VK_SUCCESS;
+}
+
+void MemoryBlock::destroy(const VkDevice & logicalDevice)
+{
+    if (this->memory != nullptr) {
+        if (this->mappedData != nullptr) vkUnmapMemory(logicalDevice, this->memory);
+        vkFreeMemory(logicalDevice, this->memory, nullptr);
+    }
+
+    this->memory = nullptr;
+    this->mappedData = nullptr;
+    this->size = 0;
+    this->used = 0;
+    this->freeLists.clear();
+    this->allocatedLevels.clear();
+}
+
+bool MemoryBlock::allocate(const VkDeviceSize size, const VkDeviceSize alignment, MemoryAllocation & allocation)
+{
+    const VkDeviceSize pieceSize = std::bit_ceil(std::max({ size, alignment, MEMORY_ALLOCATOR_MIN_ALLOCATION }));
+    if (pieceSize > this->size) return false;
+
+    const uint32_t level = std::countr_zero(this->size / pieceSize);
+
+    // smallest free piece that fits, split it down to the level needed
+    int32_t freeLevel = level;
+    while (freeLevel >= 0 && this->freeLists[freeLevel].empty()) freeLevel--;
+    if (freeLevel < 0) return false;
+
+    const VkDeviceSize offset = *this->freeLists[freeLevel].begin();
+    this->freeLists[freeLevel].erase(this->freeLists[freeLevel].begin());
+
+    for (uint32_t l=freeLevel+1;l<=level;l++) {
+        this->freeLists[l].insert(offset + (this->size >> l));
+    }
+
+    this->allocatedLevels[offset] = level;
+    this->used += pieceSize;
+
+    allocation.memory = this->memory;
+    allocation.offset = offset;
+    allocation.size = pieceSize;
+    allocation.mappedData = this->mappedData != nullptr ? static_cast<char *>(this->mappedData) + offset : nullptr;
+
+    return true;
+}
+
+void MemoryBlock::free(const VkDeviceSize offset)
+{
+    const auto allocated = this->allocatedLevels.find(offset);
+    if (allocated == this->allocatedLevels.end()) return;
+
+    uint32_t level = allocated->second;
+    this->allocatedLevels.erase(allocated);
+    this->used -= this->size >> level;
+
+    // merge with the buddy for as long as it is free as well
+    VkDeviceSize freeOffset = offset;
+    while (level > 0) {
+        const VkDeviceSize buddy = freeOffset ^ (this->size >> level);
+        if (this->freeLists[level].erase(buddy) == 0) break;
+
+        freeOffset = std::min(freeOffset, buddy);
+        level--;
+    }
+
+    this->freeLists[level].insert(freeOffset);
+}
+
+bool MemoryBlock::matches(const uint32_t memoryTypeIndex, const bool forImages) const
+{
+    return this->memoryTypeIndex == memoryTypeIndex && this->forImages == forImages;
+}
+
+bool MemoryBlock::isEmpty() const
+{
+    return this->allocatedLevels.empty();
+}
+
+VkDeviceSize MemoryBlock::getSize() const
+{
+    return this->size;
+}
+
+VkDeviceSize MemoryBlock::getUsed() const
+{
+    return this->used;
+}
+
+VkDeviceSize MemoryBlock::getLargestFreeRange() const
+{
+    for (uint32_t l=0;l<this->freeLists.size();l++) {
+        if (!this->freeLists[l].empty()) return this->size >> l;
+    }
+
+    return 0;
+}
+
+uint32_t MemoryBlock::getNumberOfAllocations() const
+{
+    return this->allocatedLevels.size();
+}
+
+MemoryAllocator::MemoryAllocator() {}
+
+MemoryAllocator * MemoryAllocator::INSTANCE()
+{
+    if (MemoryAllocator::instance == nullptr) {
+        MemoryAllocator::instance = new MemoryAllocator();
+    }
+
+    return MemoryAllocator::instance;
+}
+
+bool MemoryAllocator::allocateDedicated(const VkDevice & logicalDevice, const VkDeviceSize size, const uint32_t memoryTypeIndex, const bool hostVisible, MemoryAllocation & allocation)
+{
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    if (vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &allocation.memory) != VK_SUCCESS) return false;
+
+    allocation.offset = 0;
+    allocation.size = size;
+    allocation.block = -1;
+    allocation.mappedData = nullptr;
+
+    if (hostVisible && vkMapMemory(logicalDevice, allocation.memory, 0, size, 0, &allocation.mappedData) != VK_SUCCESS) {
+        vkFreeMemory(logicalDevice, allocation.memory, nullptr);
+        allocation.memory = nullptr;
+        return false;
+    }
+
+    this->dedicatedAllocations++;
+    this->dedicatedBytes += size;
+
+    return true;
+}
+
+bool MemoryAllocator::allocate(const VkPhysicalDevice & physicalDevice, const VkDevice & logicalDevice, const VkMemoryRequirements & memoryRequirements,
+                               const uint32_t memoryTypeIndex, const bool forImage, MemoryAllocation & allocation)
+{
+    const std::lock_guard<std::mutex> lock(this->allocationMutex);
+
+    if (this->maxAllocationCount == 0) {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        this->maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &this->memoryProperties);
+    }
+
+    const bool hostVisible = (this->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+
+    uint32_t numberOfDeviceAllocations = this->dedicatedAllocations;
+    for (const auto & b : this->blocks) {
+        if (b != nullptr) numberOfDeviceAllocations++;
+    }
+
+    const bool needsNewAllocation = memoryRequirements.size > MEMORY_ALLOCATOR_BLOCK_SIZE / 2;
+    if (needsNewAllocation) {
+        if (numberOfDeviceAllocations >= this->maxAllocationCount) {
+            logError("Exceeded Memory Allocation Count Limit");
+            return false;
+        }
+
+        return this->allocateDedicated(logicalDevice, memoryRequirements.size, memoryTypeIndex, hostVisible, allocation);
+    }
+
+    for (uint32_t i=0;i<this->blocks.size();i++) {
+        auto & block = this->blocks[i];
+        if (block == nullptr || !block->matches(memoryTypeIndex, forImage)) continue;
+
+        if (block->allocate(memoryRequirements.size, memoryRequirements.alignment, allocation)) {
+            allocation.block = i;
+            return true;
+        }
+    }
+
+    if (numberOfDeviceAllocations >= this->maxAllocationCount) {
+        logError("Exceeded Memory Allocation Count Limit");
+        return false;
+    }
+
+    auto block = std::make_unique<MemoryBlock>();
+    if (block->create(logicalDevice, MEMORY_ALLOCATOR_BLOCK_SIZE, memoryTypeIndex, hostVisible, forImage) != VK_SUCCESS) {
+        // the heap might not have a whole block left, try for the exact size
+        return this->allocateDedicated(logicalDevice, memoryRequirements.size, memoryTypeIndex, hostVisible, allocation);
+    }
+
+    if (!block->allocate(memoryRequirements.size, memoryRequirements.alignment, allocation)) {
+        block->destroy(logicalDevice);
+        return false;
+    }
+
+    auto freeSlot = std::find(this->blocks.begin(), this->blocks.end(), nullptr);
+    if (freeSlot == this->blocks.end()) freeSlot = this->blocks.emplace(this->blocks.end());
+    *freeSlot = std::move(block);
+    allocation.block = std::distance(this->blocks.begin(), freeSlot);
+
+    return true;
+}
+
+void MemoryAllocator::free(const VkDevice & logicalDevice, MemoryAllocation & allocation)
+{
+    if (allocation.memory == nullptr) return;
+
+    const std::lock_guard<std::mutex> lock(this->allocationMutex);
+
+    if (allocation.block < 0) {
+        if (allocation.mappedData != nullptr) vkUnmapMemory(logicalDevice, allocation.memory);
+        vkFreeMemory(logicalDevice, allocation.memory, nullptr);
+
+        this->dedicatedAllocations--;
+        this->dedicatedBytes -= allocation.size;
+    } else if (static_cast<size_t>(allocation.block) < this->blocks.size() && this->blocks[allocation.block] != nullptr) {
+        auto & block = this->blocks[allocation.block];
+        block->free(allocation.offset);
+
+        // keep one empty block around to not thrash on transient (staging) allocations
+        if (block->isEmpty()) {
+            const bool hasOtherEmpty = std::any_of(this->blocks.begin(), this->blocks.end(), [&block](const std::unique_ptr<MemoryBlock> & b) {
+                return b != nullptr && b != block && b->isEmpty();
+            });
+            if (hasOtherEmpty) {
+                block->destroy(logicalDevice);
+                block.reset();
+            }
+        }
+    }
+
+    allocation = MemoryAllocation();
+}
+
+void MemoryAllocator::destroy(const VkDevice & logicalDevice)
+{
+    const std::lock_guard<std::mutex> lock(this->allocationMutex);
+
+    for (auto & block : this->blocks) {
+        if (block == nullptr) continue;
+
+        if (!block->isEmpty()) logError("Memory Block still has " + std::to_string(block->getNumberOfAllocations()) + " allocations");
+        block->destroy(logicalDevice);
+    }
+    this->blocks.clear();
+
+    if (this->dedicatedAllocations > 0) logError("Still " + std::to_string(this->dedicatedAllocations) + " dedicated memory allocations");
+}
+
+MemoryAllocatorStats MemoryAllocator::getStats()
+{
+    const std::lock_guard<std::mutex> lock(this->allocationMutex);
+
+    MemoryAllocatorStats stats;
+    stats.dedicatedAllocations = this->dedicatedAllocations;
+    stats.dedicatedBytes = this->dedicatedBytes;
+    stats.liveAllocations = this->dedicatedAllocations;
+
+    for (const auto & block : this->blocks) {
+        if (block == nullptr) continue;
+
+        stats.blocks++;
+        stats.blockBytes += block->getSize();
+        stats.usedBytes += block->getUsed();
+        stats.liveAllocations += block->getNumberOfAllocations();
+        stats.largestFreeRange = std::max(stats.largestFreeRange, block->getLargestFreeRange());
+        stats.fragmentedFreeBytes += block->getSize() - block->getUsed() - block->getLargestFreeRange();
+    }
+
+    return stats;
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+    if (MemoryAllocator::instance == nullptr) return;
+
+    delete MemoryAllocator::instance;
+    MemoryAllocator::instance = nullptr;
+}
+
+MemoryAllocator * MemoryAllocator::instance = nullptr;
+
 Buffer::Buffer() {}
 
 const VkDescriptorBufferInfo Buffer::getDescriptorInfo() const
@@ -210,23 +523,17 @@ VkResult Buffer::createBuffer(const VkPhysicalDevice & physicalDevice, const VkD
             return VK_ERROR_UNKNOWN ;
     }
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = memoryTypeIndex;
-
-    ret = vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &this->bufferMemory);
-    if (ret != VK_SUCCESS) {
+    if (!MemoryAllocator::INSTANCE()->allocate(physicalDevice, logicalDevice, memRequirements, memoryTypeIndex, false, this->bufferMemory)) {
         this->destroy(logicalDevice);
         logError("Failed to Allocate Memory for Buffer!");
-        return ret;
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
     }
     this->bufferSize = size;
 
-    vkBindBufferMemory(logicalDevice, this->buffer, this->bufferMemory, 0);
+    vkBindBufferMemory(logicalDevice, this->buffer, this->bufferMemory.memory, this->bufferMemory.offset);
 
     if (!isDeviceLocal) {
-        vkMapMemory(logicalDevice, this->bufferMemory, 0, this->bufferSize, 0, &this->bufferData);
+        this->bufferData = this->bufferMemory.mappedData;
     }
 
     this->initialized = true;
@@ -252,7 +559,8 @@ VkResult Buffer::createSharedUniformBuffer(const VkPhysicalDevice & physicalDevi
 
 VkResult Buffer::createDeviceLocalBuffer(const VkPhysicalDevice & physicalDevice, const VkDevice & logicalDevice, const VkDeviceSize size,const VkBufferUsageFlagBits usage)
 {
-    return this->createBuffer(physicalDevice, logicalDevice, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, size, true);
+    // transfer source as well so that content can be carried over into a bigger buffer
+    return this->createBuffer(physicalDevice, logicalDevice, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, size, true);
 }
 
 VkResult Buffer::createDeviceLocalBufferFromStagingBuffer(Buffer& stagingBuffer, const VkDeviceSize offset, const VkDeviceSize size, const VkPhysicalDevice & physicalDevice, const VkDevice & logicalDevice, const CommandPool & commandPool, const VkQueue & graphicsQueue, VkBufferUsageFlagBits usage)
@@ -312,20 +620,14 @@ void Buffer::destroy(const VkDevice & logicalDevice) {
     this->bufferSize = 0;
     this->bufferContentSize = 0;
 
-    if (this->bufferData != nullptr) {
-        vkUnmapMemory(logicalDevice, this->bufferMemory);
-        this->bufferData = nullptr;
-    }
+    this->bufferData = nullptr;
 
     if (this->buffer != nullptr) {
         vkDestroyBuffer(logicalDevice, this->buffer, nullptr);
         this->buffer = nullptr;
     }
 
-    if (this->bufferMemory != nullptr) {
-        vkFreeMemory(logicalDevice, this->bufferMemory, nullptr);
-        this->bufferMemory = nullptr;
-    }
+    MemoryAllocator::INSTANCE()->free(logicalDevice, this->bufferMemory);
 }
 
 void * Buffer::getBufferData()
@@ -342,7 +644,675 @@ const VkBuffer & Buffer::getBuffer() const
 
 const VkDeviceMemory & Buffer::getBufferMemory() const
 {
-    return this->bufferMemory;
+    return this->bufferMemory.memory;
+}
+
+void Buffer::swap(Buffer & other)
+{
+    std::swap(this->buffer, other.buffer);
+    std::swap(this->bufferMemory, other.bufferMemory);
+    std::swap(this->bufferData, other.bufferData);
+    std::swap(this->bufferSize, other.bufferSize);
+    std::swap(this->bufferContentSize, other.bufferContentSize);
+    std::swap(this->initialized, other.initialized);
+}
+
+FrameRingBuffer::FrameRingBuffer() {}
+
+VkResult FrameRingBuffer::create(const VkPhysicalDevice & physicalDevice, const VkDevice & logicalDevice, const VkDeviceSize size, const uint32_t frames)
+{
+    this->destroy(logicalDevice);
+    if (size == 0 || frames == 0) return VK_ERROR_UNKNOWN;
+
+    // chunk aligned frame copies also satisfy the storage buffer offset alignment (at most 256)
+    this->frameSize = ((size + FRAME_RING_BUFFER_CHUNK_SIZE - 1) / FRAME_RING_BUFFER_CHUNK_SIZE) * FRAME_RING_BUFFER_CHUNK_SIZE;
+    this->frames = frames;
+
+    const VkResult ret = this->buffer.createSharedStorageBuffer(physicalDevice, logicalDevice, this->frameSize * this->frames);
+    if (ret != VK_SUCCESS) return ret;
+
+    this->shadow = std::unique_ptr<uint8_t[]>(new uint8_t[this->frameSize]);
+    this->wordsPerFrame = (this->frameSize / FRAME_RING_BUFFER_CHUNK_SIZE + 63) / 64;
+    this->dirtyChunks = std::make_unique<std::atomic<uint64_t>[]>(this->wordsPerFrame * this->frames);
+    this->rangeLocks = std::make_unique<std::mutex[]>(this->wordsPerFrame);
+    this->contentSize = 0;
+
+    return ret;
+}
+
+void FrameRingBuffer::destroy(const VkDevice & logicalDevice)
+{
+    this->buffer.destroy(logicalDevice);
+    this->shadow.reset();
+    this->dirtyChunks.reset();
+    this->rangeLocks.reset();
+    this->frameSize = 0;
+    this->frames = 0;
+    this->wordsPerFrame = 0;
+    this->contentSize = 0;
+}
+
+bool FrameRingBuffer::isInitialized() const
+{
+    return this->buffer.isInitialized() && this->shadow != nullptr;
+}
+
+bool FrameRingBuffer::allocate(const VkDeviceSize size, VkDeviceSize & offset)
+{
+    VkDeviceSize current = this->contentSize.load(std::memory_order_relaxed);
+    do {
+        if (current + size > this->frameSize) return false;
+    } while (!this->contentSize.compare_exchange_weak(current, current + size, std::memory_order_relaxed));
+
+    offset = current;
+
+    return true;
+}
+
+/**
+ *  Gives back the given size at the end of the content, i.e. what was allocated last
+ */
+void FrameRingBuffer::release(const VkDeviceSize size)
+{
+    VkDeviceSize current = this->contentSize.load(std::memory_order_relaxed);
+    while (!this->contentSize.compare_exchange_weak(current, current - std::min(current, size), std::memory_order_relaxed));
+}
+
+void FrameRingBuffer::markDirty(const VkDeviceSize offset, const VkDeviceSize size)
+{
+    const size_t firstChunk = offset / FRAME_RING_BUFFER_CHUNK_SIZE;
+    const size_t lastChunk = (offset + size - 1) / FRAME_RING_BUFFER_CHUNK_SIZE;
+
+    for (size_t w=firstChunk / 64;w<=lastChunk / 64;w++) {
+        const size_t from = std::max(firstChunk, w * 64) - w * 64;
+        const size_t to = std::min(lastChunk, w * 64 + 63) - w * 64;
+        const uint64_t mask = (to - from == 63 ? ~0ull : ((1ull << (to - from + 1)) - 1)) << from;
+
+        for (uint32_t f=0;f<this->frames;f++) {
+            this->dirtyChunks[f * this->wordsPerFrame + w].fetch_or(mask, std::memory_order_release);
+        }
+    }
+}
+
+void FrameRingBuffer::write(const VkDeviceSize offset, const void * data, const VkDeviceSize size)
+{
+    if (!this->isInitialized() || size == 0 || offset + size > this->frameSize) return;
+
+    // ranges are locked in ascending order, like flush does, to not deadlock with one another
+    const size_t firstWord = offset / FRAME_RING_BUFFER_CHUNK_SIZE / 64;
+    const size_t lastWord = (offset + size - 1) / FRAME_RING_BUFFER_CHUNK_SIZE / 64;
+    for (size_t w=firstWord;w<=lastWord;w++) this->rangeLocks[w].lock();
+
+    memcpy(this->shadow.get() + offset, data, size);
+    this->markDirty(offset, size);
+
+    for (size_t w=lastWord+1;w>firstWord;w--) this->rangeLocks[w-1].unlock();
+}
+
+/**
+ *  Copies the dirty chunks of the given frame, consecutive ones within a range in one go.
+ *  A range is locked while its dirty bits are taken and copied so that no write can tear what is copied
+ */
+void FrameRingBuffer::flush(const uint32_t frame)
+{
+    if (!this->isInitialized() || frame >= this->frames) return;
+
+    uint8_t * frameData = static_cast<uint8_t *>(this->buffer.getBufferData()) + frame * this->frameSize;
+    std::atomic<uint64_t> * dirty = this->dirtyChunks.get() + frame * this->wordsPerFrame;
+
+    const VkDeviceSize usedChunks = (this->contentSize.load(std::memory_order_relaxed) + FRAME_RING_BUFFER_CHUNK_SIZE - 1) / FRAME_RING_BUFFER_CHUNK_SIZE;
+    const size_t usedWords = std::min<size_t>((usedChunks + 63) / 64, this->wordsPerFrame);
+
+    for (size_t w=0;w<usedWords;w++) {
+        if (dirty[w].load(std::memory_order_relaxed) == 0) continue;
+
+        const std::lock_guard<std::mutex> lock(this->rangeLocks[w]);
+
+        VkDeviceSize rangeStart = 0;
+        VkDeviceSize rangeEnd = 0;
+
+        uint64_t bits = dirty[w].exchange(0, std::memory_order_acquire);
+        while (bits != 0) {
+            const VkDeviceSize chunkStart = (w * 64 + std::countr_zero(bits)) * FRAME_RING_BUFFER_CHUNK_SIZE;
+            bits &= bits - 1;
+
+            if (chunkStart != rangeEnd || rangeEnd == rangeStart) {
+                if (rangeEnd > rangeStart) memcpy(frameData + rangeStart, this->shadow.get() + rangeStart, rangeEnd - rangeStart);
+                rangeStart = chunkStart;
+            }
+            rangeEnd = chunkStart + FRAME_RING_BUFFER_CHUNK_SIZE;
+        }
+
+        if (rangeEnd > rangeStart) memcpy(frameData + rangeStart, this->shadow.get() + rangeStart, rangeEnd - rangeStart);
+    }
+}
+
+void FrameRingBuffer::clear()
+{
+    this->contentSize = 0;
+}
+
+VkDeviceSize FrameRingBuffer::getSize() const
+{
+    return this->frameSize;
+}
+
+VkDeviceSize FrameRingBuffer::getContentSize() const
+{
+    return this->contentSize.load(std::memory_order_relaxed);
+}
+
+const VkDescriptorBufferInfo FrameRingBuffer::getDescriptorInfo(const uint32_t frame) const
+{
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = this->buffer.getBuffer();
+    bufferInfo.offset = std::min(frame, this->frames > 0 ? this->frames - 1 : 0) * this->frameSize;
+    bufferInfo.range = this->frameSize;
+
+    return bufferInfo;
+}
+
+WorkerPool::WorkerPool() {
+    const uint32_t numberOfWorkers = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+    for (uint32_t i=0;i<numberOfWorkers;i++) this->workers.emplace_back(&WorkerPool::work, this);
+}
+
+uint32_t WorkerPool::getConcurrency() const {
+    return this->workers.size() + 1;
+}
+
+bool WorkerPool::runNextTask(std::unique_lock<std::mutex> & lock) {
+    if (this->job == nullptr || this->nextTask >= this->taskCount) return false;
+
+    const size_t task = this->nextTask++;
+    const auto job = this->job;
+
+    lock.unlock();
+    (*job)(task);
+    lock.lock();
+
+    this->pendingTasks--;
+    if (this->pendingTasks == 0) this->jobDone.notify_all();
+
+    return true;
+}
+
+void WorkerPool::work() {
+    std::unique_lock<std::mutex> lock(this->jobMutex);
+
+    while (true) {
+        this->jobAvailable.wait(lock, [this] {
+            return this->quit || (this->job != nullptr && this->nextTask < this->taskCount);
+        });
+        if (this->quit) return;
+
+        this->runNextTask(lock);
+    }
+}
+
+void WorkerPool::run(const size_t taskCount, const std::function<void(const size_t)> & job) {
+    if (taskCount == 0) return;
+
+    if (taskCount == 1 || this->workers.empty()) {
+        for (size_t i=0;i<taskCount;i++) job(i);
+        return;
+    }
+
+    const std::lock_guard<std::mutex> runLock(this->runMutex);
+
+    std::unique_lock<std::mutex> lock(this->jobMutex);
+    this->job = &job;
+    this->taskCount = taskCount;
+    this->nextTask = 0;
+    this->pendingTasks = taskCount;
+    this->jobAvailable.notify_all();
+
+    while (this->runNextTask(lock)) {}
+
+    this->jobDone.wait(lock, [this] { return this->pendingTasks == 0; });
+    this->job = nullptr;
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        const std::lock_guard<std::mutex> lock(this->jobMutex);
+        this->quit = true;
+    }
+    this->jobAvailable.notify_all();
+
+    for (auto & w : this->workers) {
+        if (w.joinable()) w.join();
+    }
+}
+
+UploadManager::UploadManager() {}
+
+bool UploadManager::create(const VkPhysicalDevice & physicalDevice, const VkDevice & logicalDevice, const int queueIndex, const VkQueue & queue, const VkDeviceSize size)
+{
+    this->destroy();
+
+    this->physicalDevice = physicalDevice;
+    this->logicalDevice = logicalDevice;
+    this->queue = queue;
+
+    this->commandPool.create(logicalDevice, queueIndex);
+    if (!this->commandPool.isInitialized()) {
+        logError("Failed to create Upload Command Pool");
+        return false;
+    }
+
+    VkSemaphoreTypeCreateInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &timelineInfo;
+
+    if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &this->timeline) != VK_SUCCESS) {
+        logError("Failed to create Upload Timeline Semaphore");
+        return false;
+    }
+    this->timelineValue = 0;
+
+    if (this->stagingRing.createStagingBuffer(physicalDevice, logicalDevice, size) != VK_SUCCESS) {
+        logError("Failed to create Upload Staging Buffer");
+        return false;
+    }
+
+    this->ringHead = 0;
+    this->ringTail = 0;
+    this->ringUsed = 0;
+    this->pendingRingBytes = 0;
+
+    return true;
+}
+
+void UploadManager::destroy()
+{
+    if (this->logicalDevice == nullptr) return;
+
+    const std::lock_guard<std::mutex> lock(this->uploadMutex);
+
+    if (this->queue != nullptr) vkQueueWaitIdle(this->queue);
+
+    for (auto & batch : this->batches) {
+        if (batch.commandBuffer != nullptr) this->commandPool.freeCommandBuffer(this->logicalDevice, batch.commandBuffer);
+        for (auto & b : batch.stagingBuffers) b->destroy(this->logicalDevice);
+    }
+    this->batches.clear();
+
+    for (auto & b : this->pendingStagingBuffers) b->destroy(this->logicalDevice);
+    this->pendingStagingBuffers.clear();
+    this->pendingBufferCopies.clear();
+    this->pendingImageCopies.clear();
+    this->consumers.clear();
+    this->pendingOverwrites = false;
+
+    this->stagingRing.destroy(this->logicalDevice);
+    this->commandPool.destroy(this->logicalDevice);
+
+    if (this->timeline != nullptr) {
+        vkDestroySemaphore(this->logicalDevice, this->timeline, nullptr);
+        this->timeline = nullptr;
+    }
+
+    this->logicalDevice = nullptr;
+}
+
+bool UploadManager::isInitialized() const
+{
+    return this->stagingRing.isInitialized() && this->commandPool.isInitialized() && this->timeline != nullptr;
+}
+
+bool UploadManager::allocateFromRing(const VkDeviceSize size, VkDeviceSize & offset)
+{
+    const VkDeviceSize ringSize = this->stagingRing.getSize();
+    if (size > ringSize) return false;
+
+    if (this->ringUsed == 0) {
+        this->ringHead = 0;
+        this->ringTail = 0;
+    } else if (this->ringHead == this->ringTail) return false;
+
+    if (this->ringHead >= this->ringTail) {
+        if (this->ringHead + size <= ringSize) {
+            offset = this->ringHead;
+            this->ringHead += size;
+            this->ringUsed += size;
+            this->pendingRingBytes += size;
+            return true;
+        }
+
+        // wrap around, the remainder at the end is wasted until the batch completes
+        if (size <= this->ringTail) {
+            const VkDeviceSize wasted = ringSize - this->ringHead;
+            offset = 0;
+            this->ringHead = size;
+            this->ringUsed += wasted + size;
+            this->pendingRingBytes += wasted + size;
+            return true;
+        }
+
+        return false;
+    }
+
+    if (this->ringHead + size > this->ringTail) return false;
+
+    offset = this->ringHead;
+    this->ringHead += size;
+    this->ringUsed += size;
+    this->pendingRingBytes += size;
+
+    return true;
+}
+
+bool UploadManager::stage(const void * data, const VkDeviceSize size, VkBuffer & source, VkDeviceSize & sourceOffset)
+{
+    const VkDeviceSize alignedSize = ((size + UPLOAD_STAGING_ALIGNMENT - 1) / UPLOAD_STAGING_ALIGNMENT) * UPLOAD_STAGING_ALIGNMENT;
+
+    this->reclaim();
+
+    if (this->allocateFromRing(alignedSize, sourceOffset)) {
+        memcpy(static_cast<char *>(this->stagingRing.getBufferData()) + sourceOffset, data, size);
+        source = this->stagingRing.getBuffer();
+        return true;
+    }
+
+    // ring is exhausted (or too small), fall back onto a staging buffer that lives as long as the batch
+    Metrics::INSTANCE()->incrementCounter("upload.ring_overflows");
+
+    auto stagingBuffer = std::make_unique<Buffer>();
+    if (stagingBuffer->createStagingBuffer(this->physicalDevice, this->logicalDevice, size) != VK_SUCCESS) {
+        logError("Failed to create Upload Staging Buffer");
+        return false;
+    }
+
+    memcpy(stagingBuffer->getBufferData(), data, size);
+    source = stagingBuffer->getBuffer();
+    sourceOffset = 0;
+
+    this->pendingStagingBuffers.emplace_back(std::move(stagingBuffer));
+
+    return true;
+}
+
+void UploadManager::reclaim()
+{
+    if (this->batches.empty()) return;
+
+    uint64_t completedValue = 0;
+    if (vkGetSemaphoreCounterValue(this->logicalDevice, this->timeline, &completedValue) != VK_SUCCESS) return;
+
+    while (!this->batches.empty() && this->batches.front().value <= completedValue) {
+        auto & batch = this->batches.front();
+
+        if (batch.commandBuffer != nullptr) this->commandPool.freeCommandBuffer(this->logicalDevice, batch.commandBuffer);
+        for (auto & b : batch.stagingBuffers) b->destroy(this->logicalDevice);
+
+        this->ringTail = batch.ringEnd;
+        this->ringUsed -= batch.ringBytes;
+
+        this->batches.pop_front();
+    }
+}
+
+/**
+ *  Uploads overwriting data that frames in flight might still read make the flush wait for all work submitted to the consumers
+ */
+bool UploadManager::uploadBuffer(const Buffer & destination, const VkDeviceSize destinationOffset, const void * data, const VkDeviceSize size, const bool overwritesDataInUse)
+{
+    if (!this->isInitialized() || !destination.isInitialized() || data == nullptr || size == 0) return false;
+
+    if (destinationOffset + size > destination.getSize()) {
+        logError("Upload exceeds destination buffer size");
+        return false;
+    }
+
+    const std::lock_guard<std::mutex> lock(this->uploadMutex);
+
+    VkBuffer source = nullptr;
+    VkDeviceSize sourceOffset = 0;
+    if (!this->stage(data, size, source, sourceOffset)) return false;
+
+    UploadBufferCopy copy;
+    copy.source = source;
+    copy.destination = destination.getBuffer();
+    copy.region.srcOffset = sourceOffset;
+    copy.region.dstOffset = destinationOffset;
+    copy.region.size = size;
+    copy.sequence = this->pendingSequence;
+    this->pendingBufferCopies.emplace_back(copy);
+
+    if (overwritesDataInUse) this->pendingOverwrites = true;
+
+    Metrics::INSTANCE()->incrementCounter("upload.bytes", size);
+
+    return true;
+}
+
+bool UploadManager::copyBuffer(const Buffer & source, const Buffer & destination, const VkDeviceSize size)
+{
+    if (!this->isInitialized() || !source.isInitialized() || !destination.isInitialized() || size == 0) return false;
+
+    if (size > source.getSize() || size > destination.getSize()) {
+        logError("Buffer copy exceeds buffer sizes");
+        return false;
+    }
+
+    const std::lock_guard<std::mutex> lock(this->uploadMutex);
+
+    // has to see all uploads into the source queued so far and be seen by the ones into the destination to follow
+    UploadBufferCopy copy;
+    copy.source = source.getBuffer();
+    copy.destination = destination.getBuffer();
+    copy.region.srcOffset = 0;
+    copy.region.dstOffset = 0;
+    copy.region.size = size;
+    copy.sequence = ++this->pendingSequence;
+    this->pendingBufferCopies.emplace_back(copy);
+
+    this->pendingSequence++;
+
+    return true;
+}
+
+bool UploadManager::uploadImage(Image & image, const void * data, const VkDeviceSize size, const uint32_t width, const uint32_t height, const uint32_t mipLevels)
+{
+    if (!this->isInitialized() || !image.isInitialized() || data == nullptr || size == 0) return false;
+
+    const std::lock_guard<std::mutex> lock(this->uploadMutex);
+
+    UploadImageCopy copy;
+    if (!this->stage(data, size, copy.source, copy.sourceOffset)) return false;
+
+    copy.image = &image;
+    copy.width = width;
+    copy.height = height;
+    copy.mipLevels = mipLevels;
+    this->pendingImageCopies.emplace_back(copy);
+
+    Metrics::INSTANCE()->incrementCounter("upload.bytes", size);
+
+    return true;
+}
+
+void UploadManager::recordBufferCopies(const VkCommandBuffer & commandBuffer)
+{
+    // group by destination (stable, so that later writes to the same range still come last) within sequences separated by barriers
+    std::stable_sort(this->pendingBufferCopies.begin(), this->pendingBufferCopies.end(), [](const UploadBufferCopy & a, const UploadBufferCopy & b) {
+        if (a.sequence != b.sequence) return a.sequence < b.sequence;
+        return a.destination < b.destination;
+    });
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    std::vector<VkBufferCopy> regions;
+    VkDeviceSize writtenStart = 0;
+    VkDeviceSize writtenEnd = 0;
+
+    const size_t numberOfCopies = this->pendingBufferCopies.size();
+    for (size_t i=0;i<numberOfCopies;i++) {
+        const auto & copy = this->pendingBufferCopies[i];
+        const bool startsSequence = i > 0 && this->pendingBufferCopies[i-1].sequence != copy.sequence;
+        const bool startsDestination = i == 0 || this->pendingBufferCopies[i-1].destination != copy.destination;
+
+        if (startsSequence) {
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+
+        if (startsSequence || startsDestination) {
+            writtenStart = copy.region.dstOffset;
+            writtenEnd = copy.region.dstOffset;
+        } else if (copy.region.dstOffset < writtenEnd && copy.region.dstOffset + copy.region.size > writtenStart) {
+            // rewrite of a range that was written already in this batch: copies in flight must not race
+            if (!regions.empty()) {
+                vkCmdCopyBuffer(commandBuffer, this->pendingBufferCopies[i-1].source, copy.destination, regions.size(), regions.data());
+                regions.clear();
+            }
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+            writtenStart = copy.region.dstOffset;
+            writtenEnd = copy.region.dstOffset;
+        }
+
+        // adjacent in both, staging and destination, merge into one region
+        if (!regions.empty() && regions.back().srcOffset + regions.back().size == copy.region.srcOffset &&
+            regions.back().dstOffset + regions.back().size == copy.region.dstOffset) {
+            regions.back().size += copy.region.size;
+        } else regions.emplace_back(copy.region);
+
+        writtenStart = std::min(writtenStart, copy.region.dstOffset);
+        writtenEnd = std::max(writtenEnd, copy.region.dstOffset + copy.region.size);
+
+        const bool continuesCommand = i + 1 < numberOfCopies && this->pendingBufferCopies[i+1].sequence == copy.sequence &&
+            this->pendingBufferCopies[i+1].destination == copy.destination && this->pendingBufferCopies[i+1].source == copy.source;
+        if (continuesCommand) continue;
+
+        vkCmdCopyBuffer(commandBuffer, copy.source, copy.destination, regions.size(), regions.data());
+        regions.clear();
+    }
+}
+
+bool UploadManager::flush()
+{
+    if (!this->isInitialized()) return false;
+
+    const std::lock_guard<std::mutex> lock(this->uploadMutex);
+
+    this->reclaim();
+
+    if (this->pendingBufferCopies.empty() && this->pendingImageCopies.empty()) return true;
+
+    const ScopedTimer flushTimer("cpu.upload_flush");
+
+    UploadBatch batch;
+    batch.ringEnd = this->ringHead;
+    batch.ringBytes = this->pendingRingBytes;
+    batch.stagingBuffers = std::move(this->pendingStagingBuffers);
+    batch.value = this->timelineValue;
+
+    this->pendingRingBytes = 0;
+    this->pendingStagingBuffers.clear();
+
+    batch.commandBuffer = this->commandPool.beginPrimaryCommandBuffer(this->logicalDevice);
+
+    this->recordBufferCopies(batch.commandBuffer);
+
+    for (auto & copy : this->pendingImageCopies) {
+        copy.image->transitionImageLayout(batch.commandBuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, copy.mipLevels);
+        copy.image->copyBufferToImage(batch.commandBuffer, copy.source, copy.width, copy.height, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copy.sourceOffset);
+        copy.image->generateMipMaps(batch.commandBuffer, copy.width, copy.height, copy.mipLevels);
+    }
+
+    Metrics::INSTANCE()->recordValue("upload.copies_per_flush", this->pendingBufferCopies.size() + this->pendingImageCopies.size());
+
+    this->pendingBufferCopies.clear();
+    this->pendingImageCopies.clear();
+    this->pendingSequence = 0;
+
+    this->commandPool.endCommandBuffer(batch.commandBuffer);
+
+    const uint64_t signalValue = this->timelineValue + 1;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+    if (this->pendingOverwrites) {
+        for (const auto & c : this->consumers) {
+            if (c.second == 0) continue;
+            waitSemaphores.emplace_back(c.first);
+            waitValues.emplace_back(c.second);
+        }
+        this->pendingOverwrites = false;
+    }
+    const std::vector<VkPipelineStageFlags> waitStages(waitSemaphores.size(), VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    timelineInfo.waitSemaphoreValueCount = waitValues.size();
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+    submitInfo.waitSemaphoreCount = waitSemaphores.size();
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &this->timeline;
+
+    const VkResult ret = vkQueueSubmit(this->queue, 1, &submitInfo, VK_NULL_HANDLE);
+    if (ret != VK_SUCCESS) {
+        // nothing got submitted, the batch (value already reached) is released with the next reclaim
+        logError("Failed to submit Uploads");
+        this->batches.emplace_back(std::move(batch));
+        return false;
+    }
+
+    this->timelineValue = signalValue;
+    batch.value = signalValue;
+    this->batches.emplace_back(std::move(batch));
+
+    return true;
+}
+
+void UploadManager::setConsumer(const VkSemaphore & timeline, const uint64_t value)
+{
+    const std::lock_guard<std::mutex> lock(this->uploadMutex);
+
+    for (auto & c : this->consumers) {
+        if (c.first != timeline) continue;
+        c.second = value;
+        return;
+    }
+
+    this->consumers.emplace_back(timeline, value);
+}
+
+void UploadManager::removeConsumer(const VkSemaphore & timeline)
+{
+    const std::lock_guard<std::mutex> lock(this->uploadMutex);
+
+    std::erase_if(this->consumers, [&timeline](const std::pair<VkSemaphore, uint64_t> & c) { return c.first == timeline; });
+}
+
+const VkSemaphore & UploadManager::getTimeline() const
+{
+    return this->timeline;
+}
+
+uint64_t UploadManager::getTimelineValue() const
+{
+    return this->timelineValue;
 }
 
 
@@ -404,19 +1374,14 @@ void Image::createImage(const VkPhysicalDevice & physicalDevice, const VkDevice
         return;
     }
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = memoryTypeIndex;
-
-    ret = vkAllocateMemory(logicalDevice, &allocInfo, nullptr, &this->imageMemory);
-    if (ret != VK_SUCCESS) {
+    // linear images share pools with buffers, optimal ones are kept apart for the buffer image granularity
+    if (!MemoryAllocator::INSTANCE()->allocate(physicalDevice, logicalDevice, memRequirements, memoryTypeIndex, config.tiling == VK_IMAGE_TILING_OPTIMAL, this->imageMemory)) {
         this->destroy(logicalDevice);
         logError("Failed to Allocate Image Memory");
         return;
     }
 
-    vkBindImageMemory(logicalDevice, this->image, this->imageMemory, 0);
+    vkBindImageMemory(logicalDevice, this->image, this->imageMemory.memory, this->imageMemory.offset);
 
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -491,10 +1456,7 @@ void Image::destroy(const VkDevice & logicalDevice, const bool isSwapChainImage)
         this->image = nullptr;
     }
 
-    if (!isSwapChainImage && this->imageMemory != nullptr) {
-        vkFreeMemory(logicalDevice, this->imageMemory, nullptr);
-        this->imageMemory = nullptr;
-    }
+    if (!isSwapChainImage) MemoryAllocator::INSTANCE()->free(logicalDevice, this->imageMemory);
 
     if (!isSwapChainImage && this->imageSampler != nullptr) {
         vkDestroySampler(logicalDevice, this->imageSampler, nullptr);
@@ -582,6 +1544,12 @@ void Image::transitionImageLayout(const VkCommandBuffer & commandBuffer, const V
 
         sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    } else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_GENERAL) {
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        destinationStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
     } else if (oldLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR && newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
         sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
         destinationStage = VK_PIPELINE_STAGE_HOST_BIT;
@@ -610,11 +1578,11 @@ void Image::transitionImageLayout(const VkCommandBuffer & commandBuffer, const V
     );
 }
 
-void Image::copyBufferToImage(const VkCommandBuffer& commandBuffer, const VkBuffer & buffer, const uint32_t width, const uint32_t height, const uint16_t layerCount, const VkImageLayout imageLayout)
+void Image::copyBufferToImage(const VkCommandBuffer& commandBuffer, const VkBuffer & buffer, const uint32_t width, const uint32_t height, const uint16_t layerCount, const VkImageLayout imageLayout, const VkDeviceSize bufferOffset)
 {
     std::vector<VkBufferImageCopy> regions;
     VkBufferImageCopy region;
-    region.bufferOffset = 0;
+    region.bufferOffset = bufferOffset;
     region.bufferRowLength = 0;
     region.bufferImageHeight = 0;
     region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -758,14 +1726,14 @@ void CommandPool::resetCommandBuffer(const VkCommandBuffer& commandBuffer) const
     vkResetCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
 }
 
-VkCommandBuffer CommandPool::beginPrimaryCommandBuffer(const VkDevice & logicalDevice) const
+VkCommandBuffer CommandPool::beginPrimaryCommandBuffer(const VkDevice & logicalDevice, const bool reusable) const
 {
     VkCommandBuffer commandBuffer = this->beginCommandBuffer(logicalDevice);
     if (commandBuffer == nullptr) return nullptr;
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.flags = reusable ? 0 : VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     beginInfo.pInheritanceInfo = VK_NULL_HANDLE;
 
     VkResult ret = vkBeginCommandBuffer(commandBuffer, &beginInfo);
@@ -797,7 +1765,7 @@ VkCommandBuffer CommandPool::beginCommandBuffer(const VkDevice & logicalDevice,
     return commandBuffer;
 }
 
-VkCommandBuffer CommandPool::beginSecondaryCommandBuffer(const VkDevice & logicalDevice, const VkRenderPass & renderPass) const
+VkCommandBuffer CommandPool::beginSecondaryCommandBuffer(const VkDevice & logicalDevice, const VkRenderPass & renderPass, const bool reusable) const
 {
     VkCommandBuffer commandBuffer = this->beginCommandBuffer(logicalDevice, false);
     if (commandBuffer == nullptr) return nullptr;
@@ -808,7 +1776,7 @@ VkCommandBuffer CommandPool::beginSecondaryCommandBuffer(const VkDevice & logica
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | (reusable ? 0 : VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
     beginInfo.pInheritanceInfo = &inheritenceInfo;
 
     VkResult ret = vkBeginCommandBuffer(commandBuffer, &beginInfo);
@@ -842,3 +1810,205 @@ void CommandPool::submitCommandBuffer(const VkDevice & logicalDevice, const VkQu
 
     this->freeCommandBuffer(logicalDevice, commandBuffer);
 }
+
+FrameProfiler::FrameProfiler() {}
+
+bool FrameProfiler::create(const VkPhysicalDevice & physicalDevice, const VkDevice & logicalDevice, const int graphicsQueueIndex, const int computeQueueIndex, const uint32_t frames)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    this->timestampPeriod = properties.limits.timestampPeriod;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    const auto getValidBits = [&queueFamilies](const int queueIndex) -> uint32_t {
+        if (queueIndex < 0 || queueIndex >= static_cast<int>(queueFamilies.size())) return 0;
+        return queueFamilies[queueIndex].timestampValidBits;
+    };
+
+    if (this->timestampPeriod <= 0.0f) {
+        logInfo("GPU Timestamps are not supported. Frame Profiler measures CPU only");
+        return true;
+    }
+
+    if (!this->createQueries(logicalDevice, this->graphicsQueries, getValidBits(graphicsQueueIndex), frames)) return false;
+
+    return this->createQueries(logicalDevice, this->computeQueries, getValidBits(computeQueueIndex), frames);
+}
+
+bool FrameProfiler::createQueries(const VkDevice & logicalDevice, FrameProfilerQueries & queries, const uint32_t validBits, const uint32_t frames)
+{
+    if (validBits == 0) return true;
+
+    VkQueryPoolCreateInfo queryPoolInfo {};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = frames * FRAME_PROFILER_MAX_SECTIONS * 2;
+
+    const VkResult ret = vkCreateQueryPool(logicalDevice, &queryPoolInfo, nullptr, &queries.pool);
+    if (ret != VK_SUCCESS) {
+        logError("Failed to Create Timestamp Query Pool!");
+        queries.pool = nullptr;
+        return false;
+    }
+
+    queries.validBitsMask = validBits >= 64 ? std::numeric_limits<uint64_t>::max() : (uint64_t{1} << validBits) - 1;
+    queries.sections = std::vector<std::vector<const char *>>(frames);
+    queries.recordTimes = std::vector<uint64_t>(frames, 0);
+    queries.pending = std::vector<bool>(frames, false);
+
+    return true;
+}
+
+void FrameProfiler::destroyQueries(const VkDevice & logicalDevice, FrameProfilerQueries & queries)
+{
+    if (queries.pool != nullptr) {
+        vkDestroyQueryPool(logicalDevice, queries.pool, nullptr);
+        queries.pool = nullptr;
+    }
+
+    queries.sections.clear();
+    queries.recordTimes.clear();
+    queries.pending.clear();
+}
+
+void FrameProfiler::destroy(const VkDevice & logicalDevice)
+{
+    if (logicalDevice == nullptr) return;
+
+    this->destroyQueries(logicalDevice, this->graphicsQueries);
+    this->destroyQueries(logicalDevice, this->computeQueries);
+}
+
+const char * FrameProfiler::getName(const std::string & name)
+{
+    return this->names.emplace(name).first->c_str();
+}
+
+void FrameProfiler::beginFrame(const VkCommandBuffer & commandBuffer, const uint32_t frame, const bool compute, const size_t keepSections)
+{
+    FrameProfilerQueries & queries = compute ? this->computeQueries : this->graphicsQueries;
+    if (queries.pool == nullptr || frame >= queries.sections.size()) return;
+
+    if (commandBuffer != nullptr) {
+        vkCmdResetQueryPool(commandBuffer, queries.pool, frame * FRAME_PROFILER_MAX_SECTIONS * 2, FRAME_PROFILER_MAX_SECTIONS * 2);
+    }
+
+    auto & sections = queries.sections[frame];
+    sections.resize(std::min(keepSections, sections.size()));
+    queries.recordTimes[frame] = Metrics::INSTANCE()->getTimeInMicros();
+    queries.pending[frame] = true;
+}
+
+int32_t FrameProfiler::reserveSection(const uint32_t frame, const char * name, const bool compute)
+{
+    FrameProfilerQueries & queries = compute ? this->computeQueries : this->graphicsQueries;
+    if (queries.pool == nullptr || frame >= queries.sections.size()) return -1;
+
+    auto & sections = queries.sections[frame];
+    if (sections.size() >= FRAME_PROFILER_MAX_SECTIONS) return -1;
+
+    sections.emplace_back(name);
+
+    return static_cast<int32_t>(sections.size() - 1);
+}
+
+void FrameProfiler::writeSectionTimestamp(const VkCommandBuffer & commandBuffer, const uint32_t frame, const int32_t section, const bool end, const bool compute) const
+{
+    const FrameProfilerQueries & queries = compute ? this->computeQueries : this->graphicsQueries;
+    if (queries.pool == nullptr || section < 0) return;
+
+    vkCmdWriteTimestamp(
+        commandBuffer, end ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        queries.pool, (frame * FRAME_PROFILER_MAX_SECTIONS + section) * 2 + (end ? 1 : 0));
+}
+
+bool FrameProfiler::beginSection(const VkCommandBuffer & commandBuffer, const uint32_t frame, const char * name, const bool compute)
+{
+    const int32_t section = this->reserveSection(frame, name, compute);
+    if (section < 0) return false;
+
+    this->writeSectionTimestamp(commandBuffer, frame, section, false, compute);
+
+    return true;
+}
+
+void FrameProfiler::endSection(const VkCommandBuffer & commandBuffer, const uint32_t frame, const bool compute)
+{
+    const size_t sections = this->getSectionCount(frame, compute);
+    if (sections == 0) return;
+
+    this->writeSectionTimestamp(commandBuffer, frame, static_cast<int32_t>(sections - 1), true, compute);
+}
+
+void FrameProfiler::collect(const VkDevice & logicalDevice, const uint32_t frame, const bool compute)
+{
+    FrameProfilerQueries & queries = compute ? this->computeQueries : this->graphicsQueries;
+    if (queries.pool == nullptr || frame >= queries.sections.size()) return;
+
+    auto & sections = queries.sections[frame];
+    if (sections.empty() || !queries.pending[frame]) return;
+
+    queries.pending[frame] = false;
+
+    std::array<uint64_t, FRAME_PROFILER_MAX_SECTIONS * 2> timestamps {};
+    const VkResult ret = vkGetQueryPoolResults(
+        logicalDevice, queries.pool, frame * FRAME_PROFILER_MAX_SECTIONS * 2, sections.size() * 2,
+        sizeof(uint64_t) * timestamps.size(), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    // the fence of the frame has been waited on so anything not ready was never submitted
+    if (ret != VK_SUCCESS) return;
+
+    // gpu and cpu clocks are not calibrated, the trace places gpu sections relative to recording time
+    const uint64_t firstTimestamp = timestamps[0] & queries.validBitsMask;
+    for (size_t i=0;i<sections.size();i++) {
+        const uint64_t begin = timestamps[i*2] & queries.validBitsMask;
+        const uint64_t end = timestamps[i*2+1] & queries.validBitsMask;
+        const double durationInMicros = static_cast<double>((end - begin) & queries.validBitsMask) * this->timestampPeriod / 1000.0;
+        const double offsetInMicros = static_cast<double>((begin - firstTimestamp) & queries.validBitsMask) * this->timestampPeriod / 1000.0;
+
+        this->addTiming(this->gpuTimings, sections[i], durationInMicros / 1000.0);
+        Metrics::INSTANCE()->recordDuration(
+            sections[i], queries.recordTimes[frame] + static_cast<uint64_t>(offsetInMicros), static_cast<uint64_t>(durationInMicros),
+            FRAME_PROFILER_GPU_TRACK + (compute ? 1 : 0));
+    }
+}
+
+size_t FrameProfiler::getSectionCount(const uint32_t frame, const bool compute) const
+{
+    const FrameProfilerQueries & queries = compute ? this->computeQueries : this->graphicsQueries;
+    if (frame >= queries.sections.size()) return 0;
+
+    return queries.sections[frame].size();
+}
+
+void FrameProfiler::recordCpuTime(const char * name, const uint64_t startInMicros, const uint64_t durationInMicros)
+{
+    this->addTiming(this->cpuTimings, name, durationInMicros / 1000.0);
+    Metrics::INSTANCE()->recordDuration(name, startInMicros, durationInMicros);
+}
+
+void FrameProfiler::addTiming(std::vector<std::pair<const char *, double>> & timings, const char * name, const double millis)
+{
+    for (auto & t : timings) {
+        if (t.first != name) continue;
+
+        t.second += (millis - t.second) * FRAME_PROFILER_SMOOTHING;
+        return;
+    }
+
+    timings.emplace_back(name, millis);
+}
+
+const std::vector<std::pair<const char *, double>> & FrameProfiler::getCpuTimings() const
+{
+    return this->cpuTimings;
+}
+
+const std::vector<std::pair<const char *, double>> & FrameProfiler::getGpuTimings() const
+{
+    return this->gpuTimings;
+}
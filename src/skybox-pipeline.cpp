@@ -62,7 +62,7 @@ bool SkyboxPipeline::createPipeline() {
 bool SkyboxPipeline::createDescriptorPool() {
     if (this->renderer == nullptr || !this->renderer->isReady() || this->descriptorPool.isInitialized()) return false;
 
-    const uint32_t count = this->renderer->getImageCount();
+    const uint32_t count = this->renderer->getFramesInFlight();
 
     this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, count);
     this->descriptorPool.addResource(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, count);
@@ -83,7 +83,7 @@ bool SkyboxPipeline::createDescriptors() {
     this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1);
     this->descriptors.addBindings(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1);
 
-    this->descriptors.create(this->renderer->getLogicalDevice(), this->descriptorPool.getPool(), this->renderer->getImageCount());
+    this->descriptors.create(this->renderer->getLogicalDevice(), this->descriptorPool.getPool(), this->renderer->getFramesInFlight());
 
     if (!this->descriptors.isInitialized()) return false;
 
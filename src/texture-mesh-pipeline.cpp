@@ -73,12 +73,15 @@ bool TextureMeshPipeline::initPipeline(const PipelineConfig & config)
 }
 
 template<>
-bool TextureMeshPipeline::addObjectsToBeRendered(const std::vector<TextureMeshRenderable *> & additionalObjectsToBeRendered, const bool useAltGraphicsQueue) {
+bool TextureMeshPipeline::addObjectsToBeRendered(const std::vector<TextureMeshRenderable *> & additionalObjectsToBeRendered) {
     if (!this->vertexBuffer.isInitialized() || additionalObjectsToBeRendered.empty()) return false;
 
     const std::lock_guard<std::mutex> lock(this->additionMutex);
 
-    std::vector<TextureVertex> additionalVertices;
+    // objects not fitting (or not waiting for the buffers to grow) are dropped further down
+    if (this->deferUntilGrown(additionalObjectsToBeRendered, sizeof(TextureMeshData))) return true;
+
+    std::vector<PackedTextureVertex> additionalVertices;
     std::vector<uint32_t> additionalIndices;
 
     VkDeviceSize vertexBufferContentSize =  this->vertexBuffer.getContentSize();
@@ -103,10 +106,33 @@ bool TextureMeshPipeline::addObjectsToBeRendered(const std::vector<TextureMeshRe
             logInfo("Warning: Object to be rendered has not been registered with the GlobalRenderableStore!");
         }
 
+        // renderables sharing the geometry of another one only come with instance data
+        if (o->getGeometryOwner() != nullptr) {
+            if (!this->meshBufferOffsets.contains(o->getGeometryOwner())) {
+                logError("Pipeline '" + this->name + "': the geometry owner of '" + o->getId() + "' has not been added");
+                break;
+            }
+
+            additionalObjectsAdded++;
+            continue;
+        }
+
+        // owners removed and added again still have their geometry
+        if (this->meshBufferOffsets.contains(o)) {
+            additionalObjectsAdded++;
+            continue;
+        }
+
+        const MeshBufferOffsets offsets = {
+            (vertexBufferContentSize + vertexBufferAdditionalContentSize) / sizeof(PackedTextureVertex),
+            (indexBufferContentSize + indexBufferAdditionalContentSize) / sizeof(uint32_t),
+            static_cast<uint32_t>((meshDataBufferContentSize + meshDataBufferAdditionalContentSize) / meshDataSize)
+        };
+
         bool bufferTooSmall = false;
         for (const auto & mesh : o->getMeshes()) {
-            vertexBufferAdditionalContentSize += sizeof(TextureVertex) * mesh.vertices.size();
-            indexBufferAdditionalContentSize += sizeof(uint32_t) * mesh.indices.size();
+            vertexBufferAdditionalContentSize += sizeof(PackedTextureVertex) * mesh.vertices.size();
+            indexBufferAdditionalContentSize += sizeof(uint32_t) * getIndexCountWithLods(mesh);
             meshDataBufferAdditionalContentSize += meshDataSize;
 
             // only continue if we fit into the pre-allocated size
@@ -123,18 +149,20 @@ bool TextureMeshPipeline::addObjectsToBeRendered(const std::vector<TextureMeshRe
                 meshDatas.emplace_back(meshData);
             }
 
-            additionalVertices.insert(additionalVertices.end(), mesh.vertices.begin(), mesh.vertices.end());
-            additionalIndices.insert(additionalIndices.end(), mesh.indices.begin(), mesh.indices.end());
+            for (const auto & v : mesh.vertices) additionalVertices.emplace_back(packVertex(v));
+            appendIndicesWithLods(mesh, additionalIndices);
         }
 
         if (bufferTooSmall) break;
 
+        this->meshBufferOffsets[o] = offsets;
+
         // do this in batches
         if (vertexBufferAdditionalContentSize > 250 * MEGA_BYTE) {
-            if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices, useAltGraphicsQueue)) break;
+            if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices)) break;
 
             vertexBufferContentSize = this->vertexBuffer.getContentSize();
-            indexBufferContentSize = this->vertexBuffer.getContentSize();
+            indexBufferContentSize = this->indexBuffer.getContentSize();
             vertexBufferAdditionalContentSize = 0;
             indexBufferAdditionalContentSize = 0;
 
@@ -154,7 +182,7 @@ bool TextureMeshPipeline::addObjectsToBeRendered(const std::vector<TextureMeshRe
     }
 
     // delegate filling up vertex and index buffeers to break up code
-    if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices, useAltGraphicsQueue)) return false;
+    if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices)) return false;
 
     /**
      * Populate per instance and mesh data buffers
@@ -182,16 +210,15 @@ bool TextureMeshPipeline::addObjectsToBeRendered(const std::vector<TextureMeshRe
         additionalObjectsAdded = c;
 
         const VkDeviceSize totalIntanceDataSize = instanceDataSize * meshInstanceData.size();
-        memcpy(static_cast<char *>(this->ssboInstanceBuffer.getBufferData()) + instanceDataOffset, meshInstanceData.data(), totalIntanceDataSize);
-
-        this->ssboInstanceBuffer.updateContentSize(instanceDataOffset + totalIntanceDataSize);
+        if (!this->ssboInstanceBuffer.allocate(totalIntanceDataSize, instanceDataOffset)) {
+            logError("Pipeline '" + this->name + "': instance data buffer size too small");
+            return false;
+        }
+        this->ssboInstanceBuffer.write(instanceDataOffset, meshInstanceData.data(), totalIntanceDataSize);
     }
 
     // finally add object references to be used for draw loop and object updates
-    this->objectsToBeRendered.insert(
-        this->objectsToBeRendered.end(), additionalObjectsToBeRendered.begin(),
-        additionalObjectsToBeRendered.begin() + additionalObjectsAdded
-    );
+    this->appendObjectsToBeRendered(additionalObjectsToBeRendered, additionalObjectsAdded);
 
     return true;
 }
@@ -225,8 +252,8 @@ void TextureMeshPipeline::draw(const VkCommandBuffer& commandBuffer, const uint1
 
         uint32_t maxSize = this->renderer->getMaxIndirectCallCount(this->indirectBufferIndex);
 
-        const VkBuffer & buffer = this->renderer->getIndirectDrawBuffer(this->indirectBufferIndex).getBuffer();
-        const VkBuffer & countBuffer = this->renderer->getIndirectDrawCountBuffer(this->indirectBufferIndex).getBuffer();
+        const VkBuffer & buffer = this->renderer->getIndirectDrawBuffer(this->indirectBufferIndex, commandBufferIndex).getBuffer();
+        const VkBuffer & countBuffer = this->renderer->getIndirectDrawCountBuffer(this->indirectBufferIndex, commandBufferIndex).getBuffer();
 
         vkCmdDrawIndexedIndirectCount(commandBuffer, buffer,0, countBuffer, 0, maxSize, indirectDrawBufferSize);
 
@@ -235,10 +262,10 @@ void TextureMeshPipeline::draw(const VkCommandBuffer& commandBuffer, const uint1
 
     // direct drawing from here on only
 
-    VkDeviceSize vertexOffset = 0;
-    VkDeviceSize indexOffset = 0;
-
     for (const auto & o : this->objectsToBeRendered) {
+        // renderables sharing a geometry draw the meshes of its owner
+        MeshBufferOffsets offsets = this->getMeshBufferOffsets(o);
+
         for (const auto & m : o->getMeshes()) {
             const VkDeviceSize vertexCount = m.vertices.size();
             const VkDeviceSize indexCount = m.indices.size();
@@ -246,11 +273,11 @@ void TextureMeshPipeline::draw(const VkCommandBuffer& commandBuffer, const uint1
             if (o->shouldBeRendered()) {
                 const TextureMeshPushConstants & pushConstants = { o->getMatrix(), m.texture };
                 vkCmdPushConstants(commandBuffer, this->layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants) , &pushConstants);
-                vkCmdDrawIndexed(commandBuffer, indexCount, 1, indexOffset, vertexOffset, 0);
+                vkCmdDrawIndexed(commandBuffer, indexCount, 1, offsets.indexOffset, offsets.vertexOffset, 0);
             }
 
-            vertexOffset += vertexCount;
-            indexOffset += indexCount;
+            offsets.vertexOffset += vertexCount;
+            offsets.indexOffset += getIndexCountWithLods(m);
         }
     }
 }
@@ -203,7 +203,7 @@ uint32_t GlobalTextureStore::uploadTexturesToGPU(Renderer * renderer)
 
     uint32_t uploaded = 0;
     for (auto & texture : this->textures) {
-        if (this->uploadTextureToGPU(renderer, texture.get(), true)) uploaded++;
+        if (this->uploadTextureToGPU(renderer, texture.get())) uploaded++;
     }
 
     if (uploaded > 0) {
@@ -214,20 +214,9 @@ uint32_t GlobalTextureStore::uploadTexturesToGPU(Renderer * renderer)
     return uploaded;
 }
 
-bool GlobalTextureStore::uploadTextureToGPU(Renderer * renderer, Texture * texture, const bool useAltGraphicsQueue) {
+bool GlobalTextureStore::uploadTextureToGPU(Renderer * renderer, Texture * texture) {
     if (!texture->isValid() || texture->hasInitializedTextureImage()) return false;
 
-    VkDeviceSize imageSize = texture->getSize();
-
-    Buffer stagingBuffer;
-    stagingBuffer.createStagingBuffer(renderer->getPhysicalDevice(), renderer->getLogicalDevice(), imageSize);
-    if (!stagingBuffer.isInitialized()) {
-        logError("Failed to Create Textures Staging Buffer");
-        return false;
-    }
-
-    memcpy(stagingBuffer.getBufferData(), texture->getPixels(), static_cast<size_t>(imageSize));
-
     Image & textureImage = texture->getTextureImage();
 
     ImageConfig conf;
@@ -241,23 +230,17 @@ bool GlobalTextureStore::uploadTextureToGPU(Renderer * renderer, Texture * textu
 
     textureImage.createImage(renderer->getPhysicalDevice(), renderer->getLogicalDevice(), conf);
     if (!textureImage.isInitialized()) {
-        stagingBuffer.destroy(renderer->getLogicalDevice());
         logError("Failed to create Texture Image For Upload");
         return false;
     }
 
-    const CommandPool & pool = renderer->getGraphicsCommandPool();
-    const VkCommandBuffer & commandBuffer = pool.beginPrimaryCommandBuffer(renderer->getLogicalDevice());
-
-    textureImage.transitionImageLayout(commandBuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,1, MIPMAP_LEVELS);
-    textureImage.copyBufferToImage(commandBuffer, stagingBuffer.getBuffer(), static_cast<uint32_t>(texture->getWidth()), static_cast<uint32_t>(texture->getHeight()));
-    textureImage.generateMipMaps(commandBuffer, texture->getWidth(), texture->getHeight(), MIPMAP_LEVELS);
-
-    pool.endCommandBuffer(commandBuffer);
-    pool.submitCommandBuffer(
-        renderer->getLogicalDevice(), useAltGraphicsQueue ? renderer->getAltGraphicsQueue() : renderer->getGraphicsQueue(), commandBuffer);
-
-    stagingBuffer.destroy(renderer->getLogicalDevice());
+    // pixels are staged right away, layout transition, copy and mip maps are recorded with the next upload flush
+    if (!renderer->getUploadManager().uploadImage(
+            textureImage, texture->getPixels(), texture->getSize(), static_cast<uint32_t>(texture->getWidth()), static_cast<uint32_t>(texture->getHeight()), MIPMAP_LEVELS)) {
+        textureImage.destroy(renderer->getLogicalDevice());
+        logError("Failed to queue Texture Upload");
+        return false;
+    }
 
     texture->freeSurface();
 
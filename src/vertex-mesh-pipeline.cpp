@@ -79,11 +79,14 @@ bool VertexMeshPipeline0::initPipeline(const PipelineConfig & config)
 }
 
 template<>
-bool VertexMeshPipeline0::addObjectsToBeRendered(const std::vector<VertexMeshRenderable *> & additionalObjectsToBeRendered, const bool useAltGraphicsQueue) {
+bool VertexMeshPipeline0::addObjectsToBeRendered(const std::vector<VertexMeshRenderable *> & additionalObjectsToBeRendered) {
     if (!this->vertexBuffer.isInitialized() || additionalObjectsToBeRendered.empty()) return false;
 
     const std::lock_guard<std::mutex> lock(this->additionMutex);
 
+    // objects not fitting (or not waiting for the buffers to grow) are dropped further down
+    if (this->deferUntilGrown(additionalObjectsToBeRendered, sizeof(ColorMeshData))) return true;
+
     std::vector<Vertex> additionalVertices;
     std::vector<uint32_t> additionalIndices;
 
@@ -106,6 +109,12 @@ bool VertexMeshPipeline0::addObjectsToBeRendered(const std::vector<VertexMeshRen
             logInfo("Warning: Object to be rendered has not been registered with the GlobalRenderableStore!");
         }
 
+        const MeshBufferOffsets offsets = {
+            (vertexBufferContentSize + vertexBufferAdditionalContentSize) / sizeof(Vertex),
+            0,
+            static_cast<uint32_t>((meshDataBufferContentSize + meshDataBufferAdditionalContentSize) / meshDataSize)
+        };
+
         bool bufferTooSmall = false;
         for (const auto & mesh : o->getMeshes()) {
             vertexBufferAdditionalContentSize += sizeof(Vertex) * mesh.vertices.size();
@@ -129,9 +138,11 @@ bool VertexMeshPipeline0::addObjectsToBeRendered(const std::vector<VertexMeshRen
 
         if (bufferTooSmall) break;
 
+        this->meshBufferOffsets[o] = offsets;
+
         // do this in batches
         if (vertexBufferAdditionalContentSize > 250 * MEGA_BYTE) {
-            if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices, useAltGraphicsQueue)) break;
+            if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices)) break;
 
             vertexBufferContentSize = this->vertexBuffer.getContentSize();
             vertexBufferAdditionalContentSize = 0;
@@ -151,7 +162,7 @@ bool VertexMeshPipeline0::addObjectsToBeRendered(const std::vector<VertexMeshRen
     }
 
     // delegate filling up vertex and index buffeers to break up code
-    if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices, useAltGraphicsQueue)) return false;
+    if (!this->addObjectsToBeRenderedCommon(additionalVertices.data(), vertexBufferAdditionalContentSize, additionalIndices)) return false;
 
     /**
      * Populate per instance and mesh data buffers
@@ -179,16 +190,15 @@ bool VertexMeshPipeline0::addObjectsToBeRendered(const std::vector<VertexMeshRen
         additionalObjectsAdded = c;
 
         const VkDeviceSize totalIntanceDataSize = instanceDataSize * meshInstanceData.size();
-        memcpy(static_cast<char *>(this->ssboInstanceBuffer.getBufferData()) + instanceDataOffset, meshInstanceData.data(), totalIntanceDataSize);
-
-        this->ssboInstanceBuffer.updateContentSize(instanceDataOffset + totalIntanceDataSize);
+        if (!this->ssboInstanceBuffer.allocate(totalIntanceDataSize, instanceDataOffset)) {
+            logError("Pipeline '" + this->name + "': instance data buffer size too small");
+            return false;
+        }
+        this->ssboInstanceBuffer.write(instanceDataOffset, meshInstanceData.data(), totalIntanceDataSize);
     }
 
     // finally add object references to be used for draw loop and object updates
-    this->objectsToBeRendered.insert(
-        this->objectsToBeRendered.end(), additionalObjectsToBeRendered.begin(),
-        additionalObjectsToBeRendered.begin() + additionalObjectsAdded
-    );
+    this->appendObjectsToBeRendered(additionalObjectsToBeRendered, additionalObjectsAdded);
 
     return true;
 }
@@ -196,10 +206,10 @@ bool VertexMeshPipeline0::addObjectsToBeRendered(const std::vector<VertexMeshRen
 void VertexMeshPipeline::updateVertexBufferForObjectWithId(const std::string & id) {
     std::vector<Vertex> additionalVertices;
 
-    VkDeviceSize vertexBufferOffset = 0;
-
     for (const auto & o : this->objectsToBeRendered) {
         if (o->getId() == id) {
+            const VkDeviceSize vertexBufferOffset = this->getMeshBufferOffsets(o).vertexOffset * sizeof(Vertex);
+
             for (auto & m : o->getMeshes()) {
                 additionalVertices.insert(additionalVertices.end(), m.vertices.begin(), m.vertices.end());
             }
@@ -207,36 +217,13 @@ void VertexMeshPipeline::updateVertexBufferForObjectWithId(const std::string & i
             const auto & vertexSpace  = sizeof(Vertex) * additionalVertices.size();
 
             if (this->usesDeviceLocalVertexBuffer) {
-                Buffer stagingBuffer;
-
-                stagingBuffer.createStagingBuffer(this->renderer->getPhysicalDevice(), this->renderer->getLogicalDevice(), vertexSpace);
-                if (stagingBuffer.isInitialized()) {
-                    memcpy(static_cast<char *>(stagingBuffer.getBufferData()), additionalVertices.data(), vertexSpace);
-
-                    const CommandPool & pool = renderer->getGraphicsCommandPool();
-                    const VkCommandBuffer & commandBuffer = pool.beginPrimaryCommandBuffer(renderer->getLogicalDevice());
-
-                    VkBufferCopy copyRegion {};
-                    copyRegion.srcOffset = 0;
-                    copyRegion.dstOffset = vertexBufferOffset;
-                    copyRegion.size = vertexSpace;
-                    vkCmdCopyBuffer(commandBuffer, stagingBuffer.getBuffer(), this->vertexBuffer.getBuffer(), 1, &copyRegion);
-
-                    pool.endCommandBuffer(commandBuffer);
-                    pool.submitCommandBuffer(renderer->getLogicalDevice(), renderer->getGraphicsQueue(), commandBuffer);
-
-                    stagingBuffer.destroy(this->renderer->getLogicalDevice());
-                }
+                this->renderer->getUploadManager().uploadBuffer(this->vertexBuffer, vertexBufferOffset, additionalVertices.data(), vertexSpace);
             } else {
                 memcpy(static_cast<char *>(this->vertexBuffer.getBufferData()) + vertexBufferOffset, additionalVertices.data(), vertexSpace);
             }
 
             break;
         }
-
-        for (auto & m : o->getMeshes()) {
-            vertexBufferOffset += sizeof(Vertex) * m.vertices.size();
-        }
     }
 }
 
@@ -266,8 +253,8 @@ void VertexMeshPipeline0::draw(const VkCommandBuffer& commandBuffer, const uint1
 
         uint32_t maxSize = this->renderer->getMaxIndirectCallCount(this->indirectBufferIndex);
 
-        const VkBuffer & buffer = this->renderer->getIndirectDrawBuffer(this->indirectBufferIndex).getBuffer();
-        const VkBuffer & countBuffer = this->renderer->getIndirectDrawCountBuffer(this->indirectBufferIndex).getBuffer();
+        const VkBuffer & buffer = this->renderer->getIndirectDrawBuffer(this->indirectBufferIndex, commandBufferIndex).getBuffer();
+        const VkBuffer & countBuffer = this->renderer->getIndirectDrawCountBuffer(this->indirectBufferIndex, commandBufferIndex).getBuffer();
 
         vkCmdDrawIndirectCount(commandBuffer, buffer,0, countBuffer, 0, maxSize, indirectDrawBufferSize);
 
@@ -275,8 +262,9 @@ void VertexMeshPipeline0::draw(const VkCommandBuffer& commandBuffer, const uint1
     }
 
     // direct drawing from here on only
-    VkDeviceSize vertexOffset = 0;
     for (const auto & o : this->objectsToBeRendered) {
+        VkDeviceSize vertexOffset = this->getMeshBufferOffsets(o).vertexOffset;
+
         for (const auto & m : o->getMeshes()) {
             const VkDeviceSize vertexCount = m.vertices.size();
 